@@ -24,6 +24,7 @@ distribution.
 #include <malloc.h>
 #include "LanguageCode.h"
 #include "AnimatedBanner.h"
+#include "gui/residency.hpp"
 #include "gui/text.hpp"
 #include "memory/mem2.hpp"
 #include "unzip/U8Archive.h"
@@ -35,6 +36,8 @@ AnimatedBanner::AnimatedBanner()
 {
 	layout_banner = NULL;
 	newBanner = NULL;
+	resHandle = -1;
+	memset(&bannerArc, 0, sizeof(bannerArc));
 }
 
 void AnimatedBanner::LoadFont(u8 *font1, u8 *font2)
@@ -50,11 +53,14 @@ void AnimatedBanner::Clear()
 		delete layout_banner;
 		layout_banner = NULL;
 	}
+	u8_close(&bannerArc);
 	if(newBanner != NULL)
 	{
 		free(newBanner);
 		newBanner = NULL;
 	}
+	Residency.Remove(resHandle);
+	resHandle = -1;
 }
 
 bool AnimatedBanner::LoadBanner()
@@ -108,11 +114,19 @@ void AnimatedBanner::SetBannerTexture(const char *tex_name, const u8 *data, floa
 Layout* AnimatedBanner::LoadLayout(const u8 *bnr, u32 bnr_size, const std::string& lyt_name, const std::string &language)
 {
 	u32 brlyt_size = 0;
+	/* The textures stay inside the decompressed archive */
+	Residency.Reserve(RES_BANNER, bnr_size);
 	newBanner = DecompressCopy(bnr, bnr_size, &bnr_size);
 	if(newBanner == NULL)
 		return NULL;
+	resHandle = Residency.Add(RES_BANNER, bnr_size);
+	if(!u8_open(&bannerArc, newBanner, bnr_size))
+	{
+		gprintf("Banner archive is corrupt\n");
+		return NULL;
+	}
 
-	const u8 *brlyt = u8_get_file(newBanner, fmt("%s.brlyt", lyt_name.c_str()), &brlyt_size);
+	const u8 *brlyt = u8_find(&bannerArc, fmt("%s.brlyt", lyt_name.c_str()), &brlyt_size);
 	if(!brlyt)
 		return NULL;
 
@@ -122,29 +136,29 @@ Layout* AnimatedBanner::LoadLayout(const u8 *bnr, u32 bnr_size, const std::strin
 	u32 length_start = 0, length_loop = 0;
 
 	u32 brlan_start_size = 0;
-	const u8 *brlan_start = u8_get_file(newBanner, fmt("%s_Start.brlan", lyt_name.c_str()), &brlan_start_size);
+	const u8 *brlan_start = u8_find(&bannerArc, fmt("%s_Start.brlan", lyt_name.c_str()), &brlan_start_size);
 	const u8 *brlan_loop = 0;
 
 	// try the alternative file
 	if(!brlan_start)
-		brlan_start = u8_get_file(newBanner, fmt("%s_In.brlan", lyt_name.c_str()), &brlan_start_size);
+		brlan_start = u8_find(&bannerArc, fmt("%s_In.brlan", lyt_name.c_str()), &brlan_start_size);
 
 	if(brlan_start)
 		length_start = Animator::LoadAnimators((const RLAN_Header *)brlan_start, *layout, 0);
 
 	u32 brlan_loop_size = 0;
-	brlan_loop = u8_get_file(newBanner, fmt("%s.brlan", lyt_name.c_str()), &brlan_loop_size);
+	brlan_loop = u8_find(&bannerArc, fmt("%s.brlan", lyt_name.c_str()), &brlan_loop_size);
 	if(!brlan_loop)
-		brlan_loop = u8_get_file(newBanner, fmt("%s_Loop.brlan", lyt_name.c_str()), &brlan_loop_size);
+		brlan_loop = u8_find(&bannerArc, fmt("%s_Loop.brlan", lyt_name.c_str()), &brlan_loop_size);
 	if(!brlan_loop)
-		brlan_loop = u8_get_file(newBanner, fmt("%s_Rso0.brlan", lyt_name.c_str()), &brlan_loop_size); // added for "artstyle" wiiware
+		brlan_loop = u8_find(&bannerArc, fmt("%s_Rso0.brlan", lyt_name.c_str()), &brlan_loop_size); // added for "artstyle" wiiware
 
 	if(brlan_loop)
 		length_loop = Animator::LoadAnimators((const RLAN_Header *)brlan_loop, *layout, 1);
 
 	// load textures after loading the animations so we get the list of tpl filenames from the brlans
-	layout->LoadTextures(newBanner);
-	layout->LoadFonts(newBanner);
+	layout->LoadTextures(&bannerArc);
+	layout->LoadFonts(&bannerArc);
 	layout->SetLanguage(language);
 	layout->SetLoopStart(length_start);
 	layout->SetLoopEnd(length_start + length_loop);
@@ -177,13 +191,13 @@ u8 *DecompressCopy(const u8 *stuff, u32 len, u32 *size)
 	else if(isLZ77compressed(stuff))
 	{
 		// LZ77 with no magic word
-		if(decompressLZ77content(stuff, len, &ret, &len))
+		if(decompressLZ77contentSafe(stuff, len, &ret, &len))
 			return NULL;
 	}
 	else if(*(u32*)(stuff) == 0x4C5A3737) // LZ77
 	{
 		// LZ77 with a magic word
-		if(decompressLZ77content(stuff + 4, len - 4, &ret, &len))
+		if(decompressLZ77contentSafe(stuff + 4, len - 4, &ret, &len))
 			return NULL;
 	}
 	else
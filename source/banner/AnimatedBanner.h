@@ -28,6 +28,7 @@ distribution.
 #include "Layout.h"
 #include "channel/banner.h"
 #include "loader/disc.h"
+#include "unzip/U8Archive.h"
 
 class AnimatedBanner
 {
@@ -45,6 +46,8 @@ protected:
 	Layout* LoadLayout(const u8 *bnr, u32 bnr_size, const std::string& lyt_name, const std::string &language);
 	Layout *layout_banner;
 	u8 *newBanner;
+	U8Archive bannerArc;
+	s32 resHandle;
 	u8 *sysFont1;
 	u8 *sysFont2;
 };
@@ -23,9 +23,67 @@ distribution.
 */
 
 #include <math.h>
+#include <algorithm>
 #include "Animator.h"
 #include "Layout.h"
 
+template <class Key>
+struct KeyFrameLess
+{
+	bool operator()(const Key& a, const Key& b) const
+	{
+		return a.frame < b.frame;
+	}
+};
+
+// index of the first key not before frame_number, starting from the cursor
+template <class Key>
+static u32 FindKey(const std::vector<Key>& keys, FrameNumber frame_number, u32& cursor)
+{
+	const u32 count = keys.size();
+
+	// same frame as last time or the one after it
+	for(u32 i = cursor; i <= cursor + 1 && i <= count; ++i)
+	{
+		if ((i == 0 || keys[i - 1].frame < frame_number) && (i == count || frame_number <= keys[i].frame))
+			return cursor = i;
+	}
+
+	// jumped, e.g. the loop started over
+	u32 lo = 0, hi = count;
+	while (lo < hi)
+	{
+		const u32 mid = (lo + hi) / 2;
+		if (keys[mid].frame < frame_number)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return cursor = lo;
+}
+
+template <class Handler>
+Handler& Animator::GetTrack(std::vector< Track<Handler> >& tracks, const KeyType& type)
+{
+	u32 i = 0;
+	for(; i < tracks.size(); ++i)
+	{
+		const Track<Handler>& track = tracks[i];
+		if (track.type == type.type && track.index == type.index && track.target == type.target)
+			return tracks[i].handler;
+
+		if (track.type > type.type || (track.type == type.type && (track.index > type.index
+			|| (track.index == type.index && track.target > type.target))))
+			break;
+	}
+
+	Track<Handler> track;
+	track.type = type.type;
+	track.index = type.index;
+	track.target = type.target;
+	return tracks.insert(tracks.begin() + i, track)->handler;
+}
+
 // load keyframes from a brlan file
 u32 Animator::LoadAnimators(const RLAN_Header *header, Layout& layout, u8 key_set)
 {
@@ -102,12 +160,12 @@ void Animator::LoadKeyFrames(const u8 *file, u8 tag_count, u32 offset, u8 key_se
 			{
 				// step key frame
 			case 0x01:
-				keys[key_set].step_keys[frame_type].Load((const u8 *) (keyFrame+1), keyFrame->key_count);
+				GetTrack(keys[key_set].step_keys, frame_type).Load((const u8 *) (keyFrame+1), keyFrame->key_count);
 				break;
 
 				// hermite key frame
 			case 0x02:
-				keys[key_set].hermite_keys[frame_type].Load((const u8 *) (keyFrame+1), keyFrame->key_count);
+				GetTrack(keys[key_set].hermite_keys, frame_type).Load((const u8 *) (keyFrame+1), keyFrame->key_count);
 				break;
 
 			default:
@@ -119,20 +177,22 @@ void Animator::LoadKeyFrames(const u8 *file, u8 tag_count, u32 offset, u8 key_se
 
 void Animator::SetFrame(FrameNumber frame_number, u8 key_set)
 {
-	std::map<KeyType, HermiteKeyHandler>::iterator itr;
-	for(itr = keys[key_set].hermite_keys.begin(); itr != keys[key_set].hermite_keys.end(); itr++)
+	const std::vector< Track<HermiteKeyHandler> >& hermite_keys = keys[key_set].hermite_keys;
+	for(u32 i = 0; i < hermite_keys.size(); ++i)
 	{
-		const KeyType& frame_type = itr->first;
-		const float frame_value = itr->second.GetFrame(frame_number);
+		const Track<HermiteKeyHandler>& track = hermite_keys[i];
+		const KeyType frame_type(track.type, track.index, track.target);
+		const float frame_value = track.handler.GetFrame(frame_number);
 
 		ProcessHermiteKey(frame_type, frame_value);
 	}
 
-	std::map<KeyType, StepKeyHandler>::iterator itr2;
-	for(itr2 = keys[key_set].step_keys.begin(); itr2 != keys[key_set].step_keys.end(); itr2++)
+	const std::vector< Track<StepKeyHandler> >& step_keys = keys[key_set].step_keys;
+	for(u32 i = 0; i < step_keys.size(); ++i)
 	{
-		const KeyType& frame_type = itr2->first;
-		StepKeyHandler::KeyData const frame_data = itr2->second.GetFrame(frame_number);
+		const Track<StepKeyHandler>& track = step_keys[i];
+		const KeyType frame_type(track.type, track.index, track.target);
+		StepKeyHandler::KeyData const frame_data = track.handler.GetFrame(frame_number);
 
 		ProcessStepKey(frame_type, frame_data);
 	}
@@ -140,39 +200,79 @@ void Animator::SetFrame(FrameNumber frame_number, u8 key_set)
 
 void StepKeyHandler::Load(const u8 *file, u16 count)
 {
+	keys.reserve(keys.size() + count);
 	while (count--)
 	{
-		FrameNumber frame;
-		frame = *((FrameNumber *) file);
+		Key key;
+		key.frame = *((FrameNumber *) file);
 		file += 4;
 
-		KeyData& data = keys[frame];
-		data.data1 = *file;
+		key.data.data1 = *file;
 		file++;
-		data.data2 = *file;
+		key.data.data2 = *file;
 		file++;
 
 		file += 2;
+		keys.push_back(key);
+	}
+
+	// a later key on the same frame replaces the earlier one
+	std::stable_sort(keys.begin(), keys.end(), KeyFrameLess<Key>());
+	u32 last = 0;
+	for(u32 i = 1; i < keys.size(); ++i)
+	{
+		if (keys[i].frame != keys[last].frame)
+			++last;
+		keys[last] = keys[i];
 	}
+	keys.resize(keys.empty() ? 0 : last + 1);
+	cursor = 0;
 }
 
 void HermiteKeyHandler::Load(const u8 *file, u16 count)
 {
+	keys.reserve(keys.size() + count);
 	while (count--)
 	{
-		std::pair<FrameNumber, KeyData> pair;
+		Key key;
 
 		// read the frame number, value and slope
-		pair.first = *((FrameNumber *) file);
+		key.frame = *((FrameNumber *) file);
 		file += 4;
-		pair.second.value = *((float *) file);
+		key.data.value = *((float *) file);
 		file += 4;
-		pair.second.slope = *((float *) file);
+		key.data.slope = *((float *) file);
 		file += 4;
 
-		keys.insert(pair);
+		keys.push_back(key);
+	}
+
+	std::stable_sort(keys.begin(), keys.end(), KeyFrameLess<Key>());
+	Bake();
+	cursor = 0;
+}
 
-		//std::cout << "\t\t\t" "frame: " << frame << ' ' << keys[frame] << '\n';
+void HermiteKeyHandler::Bake()
+{
+	// expand the "Cubic Hermite spline" from marcan between each key and the next:
+	// p.slope * nf * (t + t^3 - 2t^2) + n.slope * nf * (t^3 - t^2)
+	// + p.value * (1 + 2t^3 - 3t^2) + n.value * (-2t^3 + 3t^2)
+	for(u32 i = 0; i < keys.size(); ++i)
+	{
+		Key& prev = keys[i];
+		if (i + 1 == keys.size())
+		{
+			prev.c1 = prev.c2 = prev.c3 = 0.f;
+			break;
+		}
+		const Key& next = keys[i + 1];
+		const float nf = next.frame - prev.frame;
+		const float ps = prev.data.slope * nf;
+		const float ns = next.data.slope * nf;
+
+		prev.c1 = ps;
+		prev.c2 = -2 * ps - ns - 3 * prev.data.value + 3 * next.data.value;
+		prev.c3 = ps + ns + 2 * prev.data.value - 2 * next.data.value;
 	}
 }
 
@@ -181,17 +281,17 @@ StepKeyHandler::KeyData StepKeyHandler::GetFrame(FrameNumber frame_number) const
 	// assuming not empty, a safe assumption currently
 
 	// find the current frame, or the one after it
-	std::map<FrameNumber, KeyData>::const_iterator frame_it = keys.lower_bound(frame_number);
+	u32 frame_it = FindKey(keys, frame_number, cursor);
 
 	// current frame is higher than any keyframe, use the last keyframe
-	if (keys.end() == frame_it)
+	if (keys.size() == frame_it)
 		--frame_it;
 
 	// if this is after the current frame and not the first keyframe, use the previous one
-	if (frame_number < frame_it->first && keys.begin() != frame_it)
+	if (frame_number < keys[frame_it].frame && 0 != frame_it)
 		--frame_it;
 
-	return frame_it->second;
+	return keys[frame_it].data;
 }
 
 float HermiteKeyHandler::GetFrame(FrameNumber frame_number) const
@@ -199,43 +299,36 @@ float HermiteKeyHandler::GetFrame(FrameNumber frame_number) const
 	// assuming not empty, a safe assumption currently
 
 	// find the current keyframe, or the one after it
-	std::multimap<FrameNumber, KeyData>::const_iterator next = keys.lower_bound(frame_number);
+	u32 next = FindKey(keys, frame_number, cursor);
 
 	// current frame is higher than any keyframe, use the last keyframe
-	if (keys.end() == next)
+	if (keys.size() == next)
 		--next;
 
-	std::multimap<FrameNumber, KeyData>::const_iterator prev = next;
+	u32 prev = next;
 
 	// if this is after the current frame and not the first keyframe, use the previous one
-	if (frame_number < prev->first && keys.begin() != prev)
+	if (frame_number < keys[prev].frame && 0 != prev)
 		--prev;
 
-	const float nf = next->first - prev->first;
+	const Key& key = keys[prev];
+	const float nf = keys[next].frame - key.frame;
 	if (fabs(nf) < 0.01)
 	{
 		// same frame numbers, just return the first's value
-		return prev->second.value;
+		return key.data.value;
 	}
 	else
 	{
-		// different frames, blend them together
-		// this is a "Cubic Hermite spline" apparently
-
-		frame_number =	 (frame_number < prev->first) ? prev->first :
-						((frame_number > next->first) ? next->first : frame_number);
+		// different frames, blend them together with the cubic baked at load
+		// time, prev is the key right before next here
 
-		const float t = (frame_number - prev->first) / nf;
+		frame_number =	 (frame_number < key.frame) ? key.frame :
+						((frame_number > keys[next].frame) ? keys[next].frame : frame_number);
 
-		// old curve-less code
-		//return prev->second.value + (next->second.value - prev->second.value) * t;
+		const float t = (frame_number - key.frame) / nf;
 
-		// curvy code from marcan, :p
-		return
-			prev->second.slope * nf * (t + powf(t, 3) - 2 * powf(t, 2)) +
-			next->second.slope * nf * (powf(t, 3) - powf(t, 2)) +
-			prev->second.value * (1 + (2 * powf(t, 3) - 3 * powf(t, 2))) +
-			next->second.value * (-2 * powf(t, 3) + 3 * powf(t, 2));
+		return ((key.c3 * t + key.c2) * t + key.c1) * t + key.data.value;
 	}
 }
 
@@ -25,9 +25,9 @@ distribution.
 #ifndef WII_BNR_ANIMATOR_H_
 #define WII_BNR_ANIMATOR_H_
 
-#include <map>
 #include <cstring>
 #include <string>
+#include <vector>
 #include "BannerTools.h"
 
 typedef float FrameNumber;
@@ -111,6 +111,8 @@ struct KeyType
 class StepKeyHandler
 {
 public:
+	StepKeyHandler() : cursor(0) {}
+
 	void Load(const u8* file, u16 count);
 
 	struct KeyData
@@ -121,12 +123,23 @@ public:
 	KeyData GetFrame(FrameNumber frame_number) const;
 
 private:
-	std::map<FrameNumber, KeyData> keys;
+	struct Key
+	{
+		FrameNumber frame;
+		KeyData data;
+	};
+
+	// sorted by frame, a single key per frame
+	std::vector<Key> keys;
+	// lower bound of the last frame played, playback mostly moves one frame on
+	mutable u32 cursor;
 };
 
 class HermiteKeyHandler
 {
 public:
+	HermiteKeyHandler() : cursor(0) {}
+
 	void Load(const u8* file, u16 count);
 
 	struct KeyData
@@ -137,7 +150,19 @@ public:
 	float GetFrame(FrameNumber frame_number) const;
 
 private:
-	std::multimap<FrameNumber, KeyData> keys;
+	struct Key
+	{
+		FrameNumber frame;
+		KeyData data;
+		// cubic in t towards the next key, the constant term is data.value
+		float c1, c2, c3;
+	};
+
+	void Bake();
+
+	// sorted by frame, keys on the same frame keep the file order
+	std::vector<Key> keys;
+	mutable u32 cursor;
 };
 
 class Layout;
@@ -158,11 +183,22 @@ protected:
 	virtual void ProcessHermiteKey(const KeyType& type, float value);
 	virtual void ProcessStepKey(const KeyType& type, StepKeyHandler::KeyData data);
 private:
+	template <class Handler>
+	struct Track
+	{
+		AnimationType type;
+		u8 index, target;
+		Handler handler;
+	};
+
+	template <class Handler>
+	static Handler& GetTrack(std::vector< Track<Handler> >& tracks, const KeyType& type);
 
+	// sorted by KeyType, which is the order the keys are processed in
 	struct
 	{
-		std::map<KeyType, StepKeyHandler> step_keys;
-		std::map<KeyType, HermiteKeyHandler> hermite_keys;
+		std::vector< Track<StepKeyHandler> > step_keys;
+		std::vector< Track<HermiteKeyHandler> > hermite_keys;
 	} keys[2];
 };
 
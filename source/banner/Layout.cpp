@@ -214,14 +214,14 @@ bool Layout::Load(const u8 *brlyt)
 	return true;
 }
 
-bool Layout::LoadTextures(const u8 *banner_file)
+bool Layout::LoadTextures(const U8Archive *banner_file)
 {
 	bool success = false;
 
 	for(u32 i = 0; i < resources.textures.size(); ++i)
 	{
 		u32 filesize;
-		const u8 *file = u8_get_file(banner_file, resources.textures[i]->getName().c_str(), &filesize);
+		const u8 *file = u8_find(banner_file, resources.textures[i]->getName().c_str(), &filesize);
 		if (file)
 			resources.textures[i]->Load(file);
 		else
@@ -231,7 +231,7 @@ bool Layout::LoadTextures(const u8 *banner_file)
 	return success;
 }
 
-bool Layout::LoadFonts(const u8 *banner_file)
+bool Layout::LoadFonts(const U8Archive *banner_file)
 {
 	bool success = false;
 
@@ -240,7 +240,7 @@ bool Layout::LoadFonts(const u8 *banner_file)
 		if(resources.fonts[i]->IsLoaded())
 			continue;
 		u32 filesize;
-		const u8 *file = u8_get_file(banner_file, resources.fonts[i]->getName().c_str(), &filesize);
+		const u8 *file = u8_find(banner_file, resources.fonts[i]->getName().c_str(), &filesize);
 		if (file)
 			resources.fonts[i]->Load(file);
 		else
@@ -38,6 +38,8 @@ distribution.
 #include "WiiFont.h"
 #include "Textbox.h"
 
+struct U8Archive;
+
 typedef std::vector<std::string> PaletteList;
 
 struct BannerResources
@@ -64,8 +66,8 @@ public:
 	static const u32 MAGIC_GROUP_POP = MAKE_FOURCC('g', 'r', 'e', '1');
 
 	bool Load(const u8 *brlyt);
-	bool LoadTextures(const u8 *banner_file);
-	bool LoadFonts(const u8 *banner_file);
+	bool LoadTextures(const U8Archive *banner_file);
+	bool LoadFonts(const U8Archive *banner_file);
 
 	void Render(Mtx &modelview, const Vec2f &ScreenProps, bool widescreen, u8 render_alpha = 0xFF) const;
 
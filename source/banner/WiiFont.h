@@ -26,6 +26,7 @@ distribution.
 #define __WII_FONT_H_
 
 #include <list>
+#include <map>
 #include <vector>
 
 #include "Pane.h"
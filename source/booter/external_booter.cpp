@@ -24,6 +24,8 @@
 #include "channel/nand.hpp"
 #include "devicemounter/DeviceHandler.hpp"
 #include "fileOps/fileOps.h"
+#include "fileOps/copy_engine.h"
+#include "gecko/gecko.hpp"
 #include "gecko/wifi_gecko.hpp"
 #include "gui/text.hpp"
 #include "loader/fst.h"
@@ -131,6 +133,8 @@ void ExternalBooter_ChannelSetup(u64 title, bool dol)
 
 void ShutdownBeforeExit(void)
 {
+	Gecko_Flush();
+	copy_shutdown();
 	DeviceHandle.UnMountAll();
 	NandHandle.DeInit_ISFS();
 	WDVD_Close();
@@ -148,10 +148,27 @@ bool Banner::GetName(wchar_t *name, int language)
 	return false;
 }
 
+bool Banner::GetNames(u16 *names)
+{
+	if (imet == NULL) return false;
+
+	memcpy(names, imet->name_japanese, IMET_LANGUAGES * IMET_MAX_NAME_LEN * sizeof(u16));
+	return true;
+}
+
 u8 *Banner::GetFile(const char *name, u32 *size)
 {
+	if(imet == NULL)
+		return NULL;
+	/* Only an imet might have been read, the archive has to fit in what was */
 	const u8 *bnrArc = (const u8 *)(((u8 *) imet) + sizeof(IMET));
-	const u8* curfile = u8_get_file(bnrArc, name, size);
+	if((u32)(bnrArc - opening) > opening_size)
+		return NULL;
+	U8Archive arc;
+	if(!u8_open(&arc, bnrArc, opening_size - (bnrArc - opening)))
+		return NULL;
+	const u8* curfile = u8_find(&arc, name, size);
+	u8_close(&arc);
 	if(curfile == NULL || *size == 0)
 		return NULL;
 
@@ -34,6 +34,7 @@
 using namespace std;
 
 #define IMET_MAX_NAME_LEN 0x2a
+#define IMET_LANGUAGES 10
 
 typedef struct
 {
@@ -67,6 +68,8 @@ class Banner
 
 		bool GetName(u8 *name, int language);
 		bool GetName(wchar_t *name, int language);
+		/* Copies the names in all IMET_LANGUAGES languages, Japanese first */
+		bool GetNames(u16 *names);
 		u8 *GetFile(const char *name, u32 *size);
 
 		void GetBanner(char *appname, bool imetOnly = false);
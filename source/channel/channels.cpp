@@ -28,12 +28,14 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <sys/stat.h>
 
 #include "channel_launcher.h"
 #include "channels.h"
 #include "banner.h"
 #include "nand.hpp"
 #include "config/config.hpp"
+#include "fileOps/fileOps.h"
 #include "gecko/gecko.hpp"
 #include "gui/fmt.h"
 #include "gui/text.hpp"
@@ -50,13 +52,22 @@
 #define RF_NEWS_CHANNEL		0x48414741
 #define RF_FORECAST_CHANNEL	0x48414641
 
+#define CHANNEL_CACHE_MAGIC	0x43484e31 /* "CHN1" */
+
+typedef struct
+{
+	u32 magic;
+	u32 count;
+	char source[64];
+} ChannelCacheHeader;
+
 Channels ChannelHandle;
 
-void Channels::Init(string lang)
+void Channels::Init(string lang, bool rescan)
 {
 	this->langCode = lang;
 	this->clear();
-	Search();
+	Search(rescan);
 }
 
 void Channels::Cleanup()
@@ -64,6 +75,11 @@ void Channels::Cleanup()
 	this->clear();
 }
 
+void Channels::SetCacheDir(const char *dir)
+{
+	cacheDir = dir;
+}
+
 u8 Channels::GetRequestedIOS(u64 title)
 {
 	u8 IOS = 0;
@@ -108,7 +124,7 @@ u64 *Channels::GetChannelList(u32 *count)
 	return titles;
 }
 
-bool Channels::GetAppNameFromTmd(u64 title, char *app, u32 *bootcontent)
+bool Channels::GetAppNameFromTmd(u64 title, char *app, u32 *bootcontent, u16 *version)
 {
 	bool ret = false;
 	u32 size = 0;
@@ -128,6 +144,8 @@ bool Channels::GetAppNameFromTmd(u64 title, char *app, u32 *bootcontent)
 		return ret;
 	}
 	_tmd *tmd_file = (_tmd *)SIGNATURE_PAYLOAD((u32 *)data);
+	if(version != NULL)
+		*version = tmd_file->title_version;
 	u16 i;
 	for(i = 0; i < tmd_file->num_contents; ++i)
 	{
@@ -156,21 +174,49 @@ void Channels::GetBanner(u64 title, bool imetOnly)
 	CurrentBanner.GetBanner(app, imetOnly);
 }
 
-bool Channels::GetChannelNameFromApp(u64 title, wchar_t* name, int language)
+bool Channels::GetTmdStamp(u64 title, u32 *size, u32 *time)
 {
-	bool ret = false;
-
-	if (language > CONF_LANG_KOREAN)
-		language = CONF_LANG_ENGLISH;
+	*time = 0;
+	if(NANDemuView)
+	{
+		/* The time catches an updated TMD with the same number of contents */
+		struct stat tmd;
+		if(stat(fmt("%s/title/%08x/%08x/content/title.tmd", NandHandle.GetPath(),
+				TITLE_UPPER(title), TITLE_LOWER(title)), &tmd) != 0)
+			return false;
+		*size = tmd.st_size;
+		*time = tmd.st_mtime;
+		return true;
+	}
+	/* ES has no time for the TMD, its title version takes the place */
+	if(ES_GetStoredTMDSize(title, size) < 0)
+		return false;
+	signed_blob *tmd = (signed_blob*)MEM2_alloc(*size);
+	if(tmd == NULL)
+		return false;
+	s32 ret = ES_GetStoredTMD(title, tmd, *size);
+	if(ret >= 0)
+		*time = ((_tmd *)SIGNATURE_PAYLOAD(tmd))->title_version;
+	MEM2_free(tmd);
+	return ret >= 0;
+}
 
-	GetBanner(title, true);
+void Channels::ReadCacheEntry(u64 title, CacheEntry *entry)
+{
+	char app[ISFS_MAXPATH] ATTRIBUTE_ALIGN(32);
+	/* Titles without a banner keep empty names, so they are not read again */
+	memset(entry->names, 0, sizeof(entry->names));
+	entry->bootContent = 0;
+	entry->tmdVersion = 0;
+	if(!GetAppNameFromTmd(title, app, &entry->bootContent, &entry->tmdVersion))
+		return;
+	CurrentBanner.ClearBanner();
+	CurrentBanner.GetBanner(app, true);
 	if(CurrentBanner.IsValid())
 	{
-		ret = CurrentBanner.GetName(name, language);
+		CurrentBanner.GetNames(&entry->names[0][0]);
 		CurrentBanner.ClearBanner();
 	}
-
-	return ret;
 }
 
 int Channels::GetLanguage(const char *lang)
@@ -189,7 +235,7 @@ int Channels::GetLanguage(const char *lang)
 	return CONF_LANG_ENGLISH; // Default to EN
 }
 
-void Channels::Search()
+void Channels::Search(bool rescan)
 {
 	u32 count;
 	u64 *list = NULL;
@@ -201,7 +247,39 @@ void Channels::Search()
 		return;
 
 	int language = langCode.size() == 0 ? CONF_GetLanguage() : GetLanguage(langCode.c_str());
+	if (language > CONF_LANG_KOREAN)
+		language = CONF_LANG_ENGLISH;
+
+	/* The cache holds the names in every language, so it belongs to the NAND only */
+	ChannelCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = CHANNEL_CACHE_MAGIC;
+	strncpy(header.source, NANDemuView ? NandHandle.GetPath() : "nand", sizeof(header.source) - 1);
+	string cacheFile;
+	if(!cacheDir.empty())
+		cacheFile = fmt("%s/%s_channels.bin", cacheDir.c_str(), NANDemuView ? "emunand" : "nand");
+
+	u8 *cache = NULL;
+	u32 cacheSize = 0;
+	const CacheEntry *cached = NULL;
+	u32 cachedCount = 0;
+	if(!rescan && !cacheFile.empty())
+		cache = fsop_ReadFile(cacheFile.c_str(), &cacheSize);
+	if(cache != NULL)
+	{
+		ChannelCacheHeader *h = (ChannelCacheHeader *)cache;
+		if(cacheSize >= sizeof(ChannelCacheHeader) && h->magic == header.magic
+			&& memcmp(h->source, header.source, sizeof(header.source)) == 0
+			&& cacheSize == sizeof(ChannelCacheHeader) + h->count * sizeof(CacheEntry))
+		{
+			cached = (const CacheEntry *)(cache + sizeof(ChannelCacheHeader));
+			cachedCount = h->count;
+		}
+	}
 
+	vector<CacheEntry> entries;
+	entries.reserve(count);
+	u32 reread = 0;
 	for(u32 i = 0; i < count; i++)
 	{
 		u32 Type = TITLE_UPPER(list[i]);
@@ -210,17 +288,63 @@ void Channels::Search()
 			u32 Title = TITLE_LOWER(list[i]);
 			if(Title == RF_NEWS_CHANNEL || Title == RF_FORECAST_CHANNEL)
 				continue; //skip region free news and forecast channel
-			Channel CurrentChan;
-			memset(&CurrentChan, 0, sizeof(Channel));
-			if(GetChannelNameFromApp(list[i], CurrentChan.name, language))
+			u32 tmdSize = 0, tmdTime = 0;
+			if(!GetTmdStamp(list[i], &tmdSize, &tmdTime))
+				continue;
+
+			/* The titles come in the order they were cached in */
+			const CacheEntry *hit = NULL;
+			u32 next = entries.size();
+			if(next < cachedCount && cached[next].title == list[i])
+				hit = &cached[next];
+			for(u32 j = 0; hit == NULL && j < cachedCount; ++j)
+				if(cached[j].title == list[i])
+					hit = &cached[j];
+
+			if(hit != NULL && hit->tmdSize == tmdSize && hit->tmdTime == tmdTime)
+				entries.push_back(*hit);
+			else
 			{
-				CurrentChan.title = list[i];
-				memcpy(CurrentChan.id, &Title, sizeof(CurrentChan.id));
-				this->push_back(CurrentChan);
+				CacheEntry entry;
+				entry.title = list[i];
+				entry.tmdSize = tmdSize;
+				entry.tmdTime = tmdTime;
+				entry.padding = 0;
+				ReadCacheEntry(list[i], &entry);
+				entries.push_back(entry);
+				reread++;
 			}
+
+			const u16 *name = entries.back().names[language];
+			if(name[0] == 0) // Requested language is not found
+				name = entries.back().names[CONF_LANG_ENGLISH];
+			if(name[0] == 0)
+				continue;
+			Channel CurrentChan;
+			memset(&CurrentChan, 0, sizeof(Channel));
+			for(int j = 0; j < IMET_MAX_NAME_LEN; j++)
+				CurrentChan.name[j] = name[j];
+			CurrentChan.title = list[i];
+			memcpy(CurrentChan.id, &Title, sizeof(CurrentChan.id));
+			this->push_back(CurrentChan);
 		}
 	}
 	free(list);
+
+	bool changed = reread > 0 || entries.size() != cachedCount;
+	if(cache != NULL)
+		MEM2_free(cache);
+	gprintf("Channels: %u titles, %u banners read\n", (u32)entries.size(), reread);
+	if(!changed || cacheFile.empty())
+		return;
+
+	header.count = entries.size();
+	string data;
+	data.reserve(sizeof(header) + entries.size() * sizeof(CacheEntry));
+	data.append((const char *)&header, sizeof(header));
+	if(!entries.empty())
+		data.append((const char *)&entries[0], entries.size() * sizeof(CacheEntry));
+	fsop_WriteFile(cacheFile.c_str(), data.data(), data.size());
 }
 
 wchar_t * Channels::GetName(int index)
@@ -47,8 +47,10 @@ typedef struct
 class Channels : private vector<Channel>
 {
 public:
-	void Init(string lang);
+	/* rescan reads every banner again instead of trusting the name cache */
+	void Init(string lang, bool rescan = false);
 	void Cleanup();
+	void SetCacheDir(const char *dir);
 
 	u32 Load(u64 title);
 	u8 GetRequestedIOS(u64 title);
@@ -61,14 +63,30 @@ public:
 
 	void GetBanner(u64 title, bool imetOnly = false);
 private:
+	/* Everything read from a title's TMD and banner, stored in the name cache
+	   and reused while the size and time of its TMD stay the same. On the
+	   real NAND the time is the title version of the TMD. */
+	typedef struct
+	{
+		u64 title;
+		u32 bootContent;
+		u32 tmdSize;
+		u32 tmdTime;
+		u16 tmdVersion;
+		u16 padding;
+		u16 names[IMET_LANGUAGES][IMET_MAX_NAME_LEN];
+	} CacheEntry;
+
 	string langCode;
+	string cacheDir;
 
 	int GetLanguage(const char *lang);
 	u64* GetChannelList(u32* count);
-	bool GetAppNameFromTmd(u64 title, char* app, u32* bootcontent = NULL);
-	bool GetChannelNameFromApp(u64 title, wchar_t* name, int language);
+	bool GetAppNameFromTmd(u64 title, char* app, u32* bootcontent = NULL, u16* version = NULL);
+	bool GetTmdStamp(u64 title, u32* size, u32* time);
+	void ReadCacheEntry(u64 title, CacheEntry* entry);
 
-	void Search();
+	void Search(bool rescan);
 };
 
 extern Channels ChannelHandle;
@@ -34,6 +34,7 @@
 #include <stdarg.h>
 #include <dirent.h>
 #include <malloc.h>
+#include <ogc/lwp_watchdog.h>
 
 #include "nand.hpp"
 #include "identify.h"
@@ -48,6 +49,10 @@
 #include "memory/memory.h"
 #include "wiiuse/wpad.h"
 
+extern "C" {
+#include "hw/sha1.h"
+};
+
 u8 *confbuffer ATTRIBUTE_ALIGN(32);
 u8 CCode[0x1008];
 char SCode[4];
@@ -246,54 +251,173 @@ void Nand::__configshifttxt(char *str)
 	*ctr = '\0';
 }
 
-void Nand::__GetNameList(const char *source, namelist **entries, int *count)
-{
-	u32 i, j, k, l;
-	u32 numentries = 0;	
-	char *names = NULL;
-	char curentry[ISFS_MAXPATH];
-	char entrypath[ISFS_MAXPATH];
-
-	s32 ret = ISFS_ReadDir(source, NULL, &numentries);
-	names = (char *)memalign(32, ALIGN32((ISFS_MAXPATH) * numentries));
-	if(names == NULL)
-		return;
+#define NAND_DIR_GUESS	64
+#define NAND_NAME_LEN	13
 
-	ret = ISFS_ReadDir(source, names, &numentries);	
-	*count = numentries;
+void Nand::__AddEntry(const char *path, u8 type, u32 size)
+{
+	nandentry entry;
+	entry.path = ManifestNames.size();
+	entry.size = size;
+	entry.type = type;
+	entry.done = false;
+	ManifestNames.append(path, strlen(path) + 1);
+	Manifest.push_back(entry);
+	if(type == NAND_FILE)
+	{
+		NandSize += size;
+		if(showprogress)
+			dumper(NandSize, 0x1f400000, 0x1f400000, NandSize, FilesDone, FoldersDone, "", data);
+	}
+}
 
-	if(*entries != NULL)
+s32 Nand::__NandEntryType(const char *path, u32 *size)
+{
+	/* Files open, folders don't. A failed open alone is no sign of a folder,
+	   a file without read permission fails the same way, so only then ask
+	   ISFS_ReadDir which of the two it is. */
+	s32 fd = ISFS_Open(path, ISFS_OPEN_READ);
+	if(fd < 0)
 	{
-		free(*entries);
-		*entries = NULL;
+		u32 count = 0;
+		if(ISFS_ReadDir(path, NULL, &count) >= 0)
+			return NAND_FOLDER;
+		return fd;
 	}
+	s32 ret = ISFS_GetFileStats(fd, &FileStats);
+	ISFS_Close(fd);
+	if(ret < 0)
+		return ret;
+	*size = FileStats.file_length;
+	return NAND_FILE;
+}
 
-	*entries = (namelist *)malloc(sizeof(namelist) * numentries);
-	if(*entries == NULL)
+s32 Nand::__ListNandFolder(char *path, bool addFolder)
+{
+	/* Most folders fit the first guess, saving the call asking for the count */
+	u32 count = NAND_DIR_GUESS;
+	char *names = (char *)memalign(32, ALIGN32(NAND_NAME_LEN * count));
+	if(names == NULL)
+		return -1;
+	s32 ret = ISFS_ReadDir(path, names, &count);
+	if(ret >= 0 && count == NAND_DIR_GUESS)
+	{
+		ret = ISFS_ReadDir(path, NULL, &count);
+		if(ret >= 0 && count > NAND_DIR_GUESS)
+		{
+			free(names);
+			names = (char *)memalign(32, ALIGN32(NAND_NAME_LEN * count));
+			if(names == NULL)
+				return -1;
+			ret = ISFS_ReadDir(path, names, &count);
+		}
+	}
+	if(ret < 0)
 	{
 		free(names);
-		return;
+		return ret;
 	}
+	if(addFolder)
+		__AddEntry(path, NAND_FOLDER, 0);
 
-	for(i = 0, k = 0; i < numentries; i++)
+	u32 len = strlen(path);
+	const char *name = names;
+	for(u32 i = 0; i < count; i++, name += strlen(name) + 1)
 	{
-		for(j = 0; names[k] != 0; j++, k++)
-			curentry[j] = names[k];
-
-		curentry[j] = 0;
-		k++;
+		const char *sep = path[len - 1] == '/' ? "" : "/";
+		if(len + strlen(sep) + strlen(name) >= ISFS_MAXPATH)
+		{
+			gprintf("Path too long: %s%s%s\n", path, sep, name);
+			continue;
+		}
+		strcpy(path + len, sep);
+		strcat(path + len, name);
+		u32 size = 0;
+		s32 type = __NandEntryType(path, &size);
+		if(type == NAND_FILE)
+			__AddEntry(path, NAND_FILE, size);
+		else if(type != NAND_FOLDER || __ListNandFolder(path, true) < 0)
+			gprintf("Error: can't read %s\n", path);
+		path[len] = '\0';
+	}
+	free(names);
+	return 0;
+}
 
-		strcpy((*entries)[i].name, curentry);
+void Nand::__ListFatFolder(char *path)
+{
+	DIR *dir_iter = opendir(path);
+	if(dir_iter == NULL)
+		return;
 
-		if(source[strlen(source)-1] == '/')
-			snprintf(entrypath, sizeof(entrypath), "%s%s", source, curentry);
+	u32 len = strlen(path);
+	struct dirent *ent;
+	while((ent = readdir(dir_iter)) != NULL)
+	{
+		if(ent->d_name[0] == '.')
+			continue;
+		snprintf(path + len, MAX_FAT_PATH - len, "%s%s", path[len - 1] == '/' ? "" : "/", ent->d_name);
+		if(ent->d_type == DT_DIR)
+		{
+			__AddEntry(path, NAND_FOLDER, 0);
+			__ListFatFolder(path);
+		}
 		else
-			snprintf(entrypath, sizeof(entrypath), "%s/%s", source, curentry);
+		{
+			u32 size = 0;
+			if(fsop_GetFileSizeBytes(path, &size))
+				__AddEntry(path, NAND_FILE, size);
+		}
+		path[len] = '\0';
+	}
+	closedir(dir_iter);
+}
 
-		ret = ISFS_ReadDir(entrypath, NULL, &l);		
-		(*entries)[i].type = ret < 0 ? 0 : 1;
-	}	
-	free(names);
+s32 Nand::__FindRoot(const char *source, bool flash)
+{
+	for(u32 i = 0; i < ManifestRoots.size(); ++i)
+	{
+		if(ManifestRoots[i].flash == flash && strcmp(ManifestNames.c_str() + ManifestRoots[i].path, source) == 0)
+			return i;
+	}
+	return -1;
+}
+
+s32 Nand::__AddRoot(const char *source, bool flash)
+{
+	s32 i = __FindRoot(source, flash);
+	if(i >= 0)
+		return i;
+
+	nandroot root;
+	root.path = ManifestNames.size();
+	ManifestNames.append(source, strlen(source) + 1);
+	root.first = Manifest.size();
+	root.flash = flash;
+	if(flash)
+	{
+		char path[MAX_FAT_PATH];
+		strncpy(path, source, sizeof(path) - 1);
+		path[sizeof(path) - 1] = '\0';
+		__ListFatFolder(path);
+	}
+	else
+	{
+		char path[ISFS_MAXPATH] ATTRIBUTE_ALIGN(32);
+		strncpy(path, source, sizeof(path) - 1);
+		path[sizeof(path) - 1] = '\0';
+		u32 size = 0;
+		s32 type = __NandEntryType(path, &size);
+		if(type == NAND_FILE)
+			__AddEntry(path, NAND_FILE, size);
+		else if(type == NAND_FOLDER)
+			__ListNandFolder(path, false);
+		else
+			gprintf("Error: can't read %s\n", path);
+	}
+	root.count = Manifest.size() - root.first;
+	ManifestRoots.push_back(root);
+	return ManifestRoots.size() - 1;
 }
 
 s32 Nand::__configread(void)
@@ -490,92 +614,329 @@ void Nand::__NANDify(char *str)
 	*dst = '\0';
 }
 
-s32 Nand::__FlashNandFile(const char *source, const char *dest)
+/* Dump and flash pipeline: the reader thread fills the ring, the calling
+   thread writes and reports progress, when flashing the verify thread hashes
+   the written slots and reads each file back once it is closed */
+#define NAND_RING_SLOTS		4
+#define NAND_CHUNK_MIN		0x4000
+#define NAND_CHUNK_MAX		0x20000
+#define NAND_THREAD_STACK	32 * 1024
+#define NAND_PROGRESS_MS	100
+
+#define NAND_CHUNK_FIRST	1
+#define NAND_CHUNK_LAST		2
+#define NAND_CHUNK_ERROR	4
+
+enum
 {
-	s32 ret;
-	FILE *file = fopen(source, "rb");
-	if(!file) 
+	NAND_STAGE_READ = 0,
+	NAND_STAGE_WRITE,
+	NAND_STAGE_VERIFY,
+};
+
+struct nand_pipe
+{
+	buffer_ring ring;
+	Nand *nand;
+	const nandroot *root;
+	const char *dest;
+};
+
+void Nand::__EntryDest(nand_pipe *pipe, const nandentry &entry, char *ndest, u32 size)
+{
+	const char *path = ManifestNames.c_str() + entry.path;
+	if(pipe->root->flash)
 	{
-		gprintf("Error opening source: \"%s\"\n", source);
-		return 0;
+		const char *rel = path + strlen(ManifestNames.c_str() + pipe->root->path);
+		if(rel[0] == '/')
+			rel++;
+		if(pipe->dest[strlen(pipe->dest)-1] == '/')
+			snprintf(ndest, size, "%s%s", pipe->dest, rel);
+		else
+			snprintf(ndest, size, "%s/%s", pipe->dest, rel);
+		__NANDify(ndest);
+	}
+	else
+	{
+		char tdest[MAX_FAT_PATH];
+		__FATify(tdest, path);
+		snprintf(ndest, size, "%s%s", pipe->dest, tdest);
 	}
+}
 
-	fseek(file, 0, SEEK_END);
-	u32 fsize = ftell(file);
-	fseek(file, 0, SEEK_SET);
+void Nand::__Progress(const char *path, u32 size, bool force)
+{
+	if(!showprogress)
+		return;
+	u64 now = gettime();
+	if(!force && diff_msec(LastProgress, now) < NAND_PROGRESS_MS)
+		return;
+	LastProgress = now;
+	const char *file = strrchr(path, '/');
+	dumper(NandDone, NandSize, size, FileDone, FilesDone, FoldersDone, file != NULL ? file + 1 : path, data);
+}
 
-	if(fake)
+void *Nand::__ReadStage(void *arg)
+{
+	nand_pipe *pipe = (nand_pipe *)arg;
+	Nand *nand = pipe->nand;
+	const nandroot &root = *pipe->root;
+	char path[ISFS_MAXPATH] ATTRIBUTE_ALIGN(32);
+
+	for(u32 i = root.first; i < root.first + root.count && !pipe->ring.abort; ++i)
 	{
-		NandSize += fsize;
-		if(showprogress)
-			dumper(NandSize, 0x1f400000, 0x1f400000, NandSize, FilesDone, FoldersDone, "", data);
-		fclose(file);
-		return 0;
+		const nandentry &entry = nand->Manifest[i];
+		if(entry.done)
+			continue;
+		FILE *file = NULL;
+		s32 fd = -1;
+		u32 flags = NAND_CHUNK_FIRST;
+		u32 left = 0;
+		if(entry.type == NAND_FILE)
+		{
+			const char *name = nand->ManifestNames.c_str() + entry.path;
+			if(root.flash)
+				file = fopen(name, "rb");
+			else
+			{
+				strncpy(path, name, sizeof(path) - 1);
+				path[sizeof(path) - 1] = '\0';
+				fd = ISFS_Open(path, ISFS_OPEN_READ);
+			}
+			if(file == NULL && fd < 0)
+			{
+				gprintf("Error opening source: \"%s\"\n", name);
+				flags |= NAND_CHUNK_ERROR;
+			}
+			else
+				left = entry.size;
+		}
+
+		/* Start small so the writer gets going, big files soon use whole slots */
+		u32 chunk = NAND_CHUNK_MIN;
+		while(!(flags & NAND_CHUNK_LAST))
+		{
+			ring_slot *slot = ring_acquire(&pipe->ring, NAND_STAGE_READ);
+			u32 len = min(left, min(chunk, slot->size));
+			if(len > 0)
+			{
+				s32 ret = root.flash ? (s32)fread(slot->data, 1, len, file) : ISFS_Read(fd, slot->data, len);
+				if(ret != (s32)len)
+				{
+					gprintf("Error: reading %s returned %d\n", nand->ManifestNames.c_str() + entry.path, ret);
+					flags |= NAND_CHUNK_ERROR;
+					len = 0;
+				}
+			}
+			left -= len;
+			if(left == 0 || (flags & NAND_CHUNK_ERROR))
+				flags |= NAND_CHUNK_LAST;
+			slot->tag = i;
+			slot->flags = flags;
+			slot->len = len;
+			slot->last = false;
+			ring_release(&pipe->ring, NAND_STAGE_READ);
+			flags &= ~NAND_CHUNK_FIRST;
+			if(chunk < NAND_CHUNK_MAX)
+				chunk *= 2;
+		}
+		if(file != NULL)
+			fclose(file);
+		if(fd >= 0)
+			ISFS_Close(fd);
 	}
+	ring_slot *slot = ring_acquire(&pipe->ring, NAND_STAGE_READ);
+	slot->last = true;
+	ring_release(&pipe->ring, NAND_STAGE_READ);
+	return NULL;
+}
 
-	gprintf("Flashing: %s (%uKB) to nand...", dest, (fsize / 0x400)+1);
+void Nand::__WriteStage(nand_pipe *pipe)
+{
+	char ndest[MAX_FAT_PATH] ATTRIBUTE_ALIGN(32);
+	FILE *file = NULL;
+	s32 fd = -1;
+	bool failed = false;
 
-	ISFS_Delete(dest);
-	ISFS_CreateFile(dest, 0, 3, 3, 3);
-	s32 fd = ISFS_Open(dest, ISFS_OPEN_RW);
-	if(fd < 0)
+	while(1)
 	{
-		gprintf(" failed\nError: ISFS_OPEN(%s, %d) %d\n", dest, ISFS_OPEN_RW, fd);
-		fclose(file);
-		return fd;
+		ring_slot *slot = ring_acquire(&pipe->ring, NAND_STAGE_WRITE);
+		if(slot->last)
+		{
+			ring_release(&pipe->ring, NAND_STAGE_WRITE);
+			break;
+		}
+		nandentry &entry = Manifest[slot->tag];
+		const char *path = ManifestNames.c_str() + entry.path;
+		if(slot->flags & NAND_CHUNK_FIRST)
+		{
+			__EntryDest(pipe, entry, ndest, sizeof(ndest));
+			FileDone = 0;
+			failed = (slot->flags & NAND_CHUNK_ERROR) != 0;
+			if(entry.type == NAND_FOLDER)
+			{
+				if(pipe->root->flash)
+					ISFS_CreateDir(ndest, 0, 3, 3, 3);
+				else
+					CreatePath("%s", ndest);
+				FoldersDone++;
+			}
+			else if(!failed && pipe->root->flash)
+			{
+				ISFS_Delete(ndest);
+				ISFS_CreateFile(ndest, 0, 3, 3, 3);
+				fd = ISFS_Open(ndest, ISFS_OPEN_RW);
+				if(fd < 0)
+					gprintf("Error: ISFS_OPEN(%s, %d) %d\n", ndest, ISFS_OPEN_RW, fd);
+				failed = fd < 0;
+			}
+			else if(!failed)
+			{
+				if(strcmp(path, ManifestNames.c_str() + pipe->root->path) == 0)
+					CreatePath("%s", pipe->dest);
+				file = fopen(ndest, "wb");
+				if(file == NULL)
+					gprintf("Error opening destination: \"%s\"\n", ndest);
+				failed = file == NULL;
+			}
+		}
+		if(slot->flags & NAND_CHUNK_ERROR)
+			failed = true;
+		if(!failed && slot->len > 0)
+		{
+			s32 ret = pipe->root->flash ? ISFS_Write(fd, slot->data, slot->len) : (s32)fwrite(slot->data, 1, slot->len, file);
+			if(ret != (s32)slot->len)
+			{
+				gprintf("Error: writing %s returned %d\n", ndest, ret);
+				failed = true;
+			}
+		}
+		NandDone += slot->len;
+		FileDone += slot->len;
+		if(slot->flags & NAND_CHUNK_LAST)
+		{
+			if(file != NULL)
+				fclose(file);
+			if(fd >= 0)
+				ISFS_Close(fd);
+			file = NULL;
+			fd = -1;
+			if(failed)
+				slot->flags |= NAND_CHUNK_ERROR;
+			else if(entry.type == NAND_FILE)
+				FilesDone++;
+			entry.done = !failed;
+		}
+		__Progress(path, entry.size, false);
+		ring_release(&pipe->ring, NAND_STAGE_WRITE);
 	}
+}
 
-	u8 *buffer = (u8 *)memalign(32, ALIGN32(BLOCK));
-	if(buffer == NULL)
-		return -1;
+void *Nand::__VerifyStage(void *arg)
+{
+	nand_pipe *pipe = (nand_pipe *)arg;
+	Nand *nand = pipe->nand;
+	char ndest[MAX_FAT_PATH] ATTRIBUTE_ALIGN(32);
+	u8 *buffer = (u8 *)MEM2_memalign(32, NAND_CHUNK_MAX);
+	SHA1_CTX ctx;
+	sha1 hash, back;
 
-	u32 toread = fsize;
-	while(toread > 0)
+	while(1)
 	{
-		u32 size = BLOCK;
-		if(toread < BLOCK)
-			size = toread;
-
-		ret = fread(buffer, 1, size, file);
-		if(ret <= 0) 
+		ring_slot *slot = ring_acquire(&pipe->ring, NAND_STAGE_VERIFY);
+		if(slot->last)
 		{
-			gprintf(" failed\nError: fread(%p, 1, %d, %s) %d\n", buffer, size, source, ret);
-			ISFS_Close(fd);
-			fclose(file);
-			free(buffer);
-			return ret;
+			ring_release(&pipe->ring, NAND_STAGE_VERIFY);
+			break;
 		}
-
-		ret = ISFS_Write(fd, buffer, size);
-		if(ret <= 0) 
+		nandentry &entry = nand->Manifest[slot->tag];
+		if(entry.type == NAND_FILE && !(slot->flags & NAND_CHUNK_ERROR))
 		{
-			gprintf(" failed\nError: ISFS_Write(%d, %p, %d) %d\n", fd, buffer, size, ret);
-			ISFS_Close(fd);
-			fclose(file);
-			free(buffer);
-			return ret;
+			if(slot->flags & NAND_CHUNK_FIRST)
+				SHA1Init(&ctx);
+			SHA1Update(&ctx, slot->data, slot->len);
 		}
-		toread -= size;
-		NandDone += size;
-		FileDone += size;
+		if(entry.type == NAND_FILE && (slot->flags & NAND_CHUNK_LAST) && !(slot->flags & NAND_CHUNK_ERROR) && buffer != NULL)
+		{
+			SHA1Final(hash, &ctx);
+			/* The writer closed the file before handing the slot over */
+			nand->__EntryDest(pipe, entry, ndest, sizeof(ndest));
+			s32 fd = ISFS_Open(ndest, ISFS_OPEN_READ);
+			u32 left = entry.size;
+			SHA1Init(&ctx);
+			while(left > 0 && fd >= 0)
+			{
+				u32 len = min(left, (u32)NAND_CHUNK_MAX);
+				if(ISFS_Read(fd, buffer, len) != (s32)len)
+					break;
+				SHA1Update(&ctx, buffer, len);
+				left -= len;
+			}
+			SHA1Final(back, &ctx);
+			if(fd >= 0)
+				ISFS_Close(fd);
+			if(left > 0 || memcmp(hash, back, sizeof(sha1)) != 0)
+			{
+				gprintf("sha1 mismatch on %s!\n", ndest);
+				/* Left undone, calling again copies it again */
+				entry.done = false;
+				nand->VerifyErrors++;
+			}
+		}
+		ring_release(&pipe->ring, NAND_STAGE_VERIFY);
+	}
+	if(buffer != NULL)
+		MEM2_free(buffer);
+	return NULL;
+}
 
-		if(showprogress)
+void Nand::__Transfer(const nandroot &root, const char *dest)
+{
+	nand_pipe pipe;
+	pipe.nand = this;
+	pipe.root = &root;
+	pipe.dest = dest;
+	bool verify = Verify && root.flash;
+	if(!ring_init(&pipe.ring, NAND_RING_SLOTS, NAND_CHUNK_MAX, verify ? 3 : 2))
+	{
+		gprintf("Error: no memory for the nand pipeline\n");
+		ring_free(&pipe.ring);
+		return;
+	}
+	LastProgress = gettime();
+	lwp_t reader = LWP_THREAD_NULL;
+	lwp_t verifier = LWP_THREAD_NULL;
+	if(verify && LWP_CreateThread(&verifier, __VerifyStage, &pipe, NULL, NAND_THREAD_STACK, 60) < 0)
+	{
+		/* Flash without verifying rather than not at all */
+		gprintf("Error: no verify thread, flashing without verification\n");
+		verifier = LWP_THREAD_NULL;
+		ring_free(&pipe.ring);
+		if(!ring_init(&pipe.ring, NAND_RING_SLOTS, NAND_CHUNK_MAX, 2))
 		{
-			const char *file = strrchr(dest, '/')+1;
-			dumper(NandDone, NandSize, fsize, FileDone, FilesDone, FoldersDone, file, data);
+			ring_free(&pipe.ring);
+			return;
 		}
 	}
-	gprintf(" done!\n");
-	FilesDone++;
-	if(showprogress)
+	if(LWP_CreateThread(&reader, __ReadStage, &pipe, NULL, NAND_THREAD_STACK, 60) < 0)
 	{
-		const char *file = strrchr(dest, '/')+1;
-		dumper(NandDone, NandSize, fsize, FileDone, FilesDone, FoldersDone, file, data);
+		gprintf("Error: no reader thread for the nand pipeline\n");
+		reader = LWP_THREAD_NULL;
+		/* Nothing is copied, the entries stay undone. An empty stream lets
+		   the write and verify stages end. */
+		ring_slot *slot = ring_acquire(&pipe.ring, NAND_STAGE_READ);
+		slot->last = true;
+		ring_release(&pipe.ring, NAND_STAGE_READ);
 	}
-	ISFS_Close(fd);
-	free(buffer);
-	fclose(file);
-	return 1;
+
+	__WriteStage(&pipe);
+
+	if(reader != LWP_THREAD_NULL)
+		LWP_JoinThread(reader, NULL);
+	if(verifier != LWP_THREAD_NULL)
+		LWP_JoinThread(verifier, NULL);
+	ring_free(&pipe.ring);
+	__Progress("", 0, true);
 }
 
 s32 Nand::__DumpNandFile(const char *source, const char *dest)
@@ -601,16 +962,6 @@ s32 Nand::__DumpNandFile(const char *source, const char *dest)
 		return ret;
 	}
 
-	if(fake)
-	{
-		NandSize += status->file_length;
-		if(showprogress)
-			dumper(NandSize, 0x1f400000, 0x1f400000, NandSize, FilesDone, FoldersDone, "", data);
-		ISFS_Close(fd);
-		free(status);
-		return 0;
-	}
-
 	if(fsop_FileExist(dest))
 		fsop_deleteFile(dest);
 
@@ -620,7 +971,7 @@ s32 Nand::__DumpNandFile(const char *source, const char *dest)
 		gprintf("Error opening destination: \"%s\"\n", dest);
 		ISFS_Close(fd);
 		free(status);
-		return 0;
+		return -1;
 	}
 
 	gprintf("Dumping: %s (%ukb)...", source, (status->file_length / 0x400)+1);
@@ -686,91 +1037,6 @@ s32 Nand::__DumpNandFile(const char *source, const char *dest)
 }
 
 
-s32 Nand::__FlashNandFolder(const char *source, const char *dest)
-{	
-	char nsource[MAX_FAT_PATH];
-	char ndest[ISFS_MAXPATH];
-
-	DIR *dir_iter;
-	struct dirent *ent;
-
-	dir_iter = opendir(source);
-	if (!dir_iter)
-		return 1;
-
-	while((ent = readdir(dir_iter)) != NULL)
-	{
-		if(ent->d_name[0] == '.') 
-			continue;
-
-		if(dest[strlen(dest)-1] == '/')
-			snprintf(ndest, sizeof(ndest), "%s%s", dest, ent->d_name);
-		else
-			snprintf(ndest, sizeof(ndest), "%s/%s", dest, ent->d_name);	
-			
-		if(source[strlen(source)-1] == '/')
-			snprintf(nsource, sizeof(nsource), "%s%s", source, ent->d_name);
-		else
-			snprintf(nsource, sizeof(nsource), "%s/%s", source, ent->d_name);
-
-		if(ent->d_type == DT_DIR)
-		{
-			__NANDify(ndest);
-			if(!fake)
-			{
-				ISFS_CreateDir(ndest, 0, 3, 3, 3);
-				FoldersDone++;
-			}
-			__FlashNandFolder(nsource, ndest);
-		}
-		else
-		{
-			__NANDify(ndest);
-			__FlashNandFile(nsource, ndest);
-		}
-	}
-	return 0;
-}
-
-s32 Nand::__DumpNandFolder(const char *source, const char *dest)
-{
-	namelist *names = NULL;
-	int cnt, i;
-	char nsource[ISFS_MAXPATH];
-	char ndest[MAX_FAT_PATH];
-	char tdest[MAX_FAT_PATH];
-
-	__GetNameList(source, &names, &cnt);
-
-	for(i = 0; i < cnt; i++) 
-	{
-		if(source[strlen(source)-1] == '/')
-			snprintf(nsource, sizeof(nsource), "%s%s", source, names[i].name);
-		else
-			snprintf(nsource, sizeof(nsource), "%s/%s", source, names[i].name);
-
-		if(!names[i].type)
-		{
-			__FATify(tdest, nsource);
-			snprintf(ndest, sizeof(ndest), "%s%s", dest, tdest);
-			__DumpNandFile(nsource, ndest);
-		}
-		else
-		{
-			if(!fake)
-			{
-				__FATify(tdest, nsource);
-				CreatePath("%s%s", dest, tdest);
-				FoldersDone++;
-			}
-			
-			__DumpNandFolder(nsource, dest);
-		}
-	}
-	free(names);
-	return 0;
-}
-
 void Nand::CreatePath(const char *path, ...)
 {
 	char *folder = NULL;
@@ -837,9 +1103,12 @@ s32 Nand::FlashToNAND(const char *source, const char *dest, dump_callback_t i_du
 	ISFS_CreateDir(dest, 0, 3, 3, 3);
 	data = i_data;
 	dumper = i_dumper;
-	fake = false;
 	showprogress = true;
-	__FlashNandFolder(source, dest);
+	s32 r = __FindRoot(source, true);
+	if(r < 0)
+		r = __AddRoot(source, true);
+	/* Entries done by an earlier call are skipped, so calling again resumes */
+	__Transfer(ManifestRoots[r], dest);
 	return 0;
 }
 
@@ -847,20 +1116,11 @@ s32 Nand::DoNandDump(const char *source, const char *dest, dump_callback_t i_dum
 {	
 	data = i_data;
 	dumper = i_dumper;
-	fake = false;
 	showprogress = true;
-	u32 temp = 0;
-	s32 ret = ISFS_ReadDir(source, NULL, &temp);
-	if(ret < 0)
-	{
-		char ndest[MAX_FAT_PATH];
-		snprintf(ndest, sizeof(ndest), "%s%s", dest, source);
-		CreatePath(dest);
-		
-		__DumpNandFile(source, ndest);
-	}
-	else
-		__DumpNandFolder(source, dest);
+	s32 r = __FindRoot(source, false);
+	if(r < 0)
+		r = __AddRoot(source, false);
+	__Transfer(ManifestRoots[r], dest);
 	return 0;
 }
 
@@ -868,9 +1128,8 @@ s32 Nand::CalcFlashSize(const char *source, dump_callback_t i_dumper, void *i_da
 {	
 	data = i_data;
 	dumper = i_dumper;
-	fake = true;
 	showprogress = true;
-	__FlashNandFolder(source, "");
+	__AddRoot(source, true);
 	return NandSize;
 }
 
@@ -878,17 +1137,8 @@ s32 Nand::CalcDumpSpace(const char *source, dump_callback_t i_dumper, void *i_da
 {	
 	data = i_data;
 	dumper = i_dumper;
-	fake = true;
 	showprogress = true;
-
-	u32 temp = 0;
-
-	s32 ret = ISFS_ReadDir(source, NULL, &temp);
-	if(ret < 0)
-		__DumpNandFile(source, "");
-	else
-		__DumpNandFolder(source, "");
-
+	__AddRoot(source, false);
 	return NandSize;
 }
 
@@ -898,6 +1148,10 @@ void Nand::ResetCounters(void)
 	FilesDone = 0;
 	FoldersDone = 0;
 	NandDone = 0;
+	VerifyErrors = 0;
+	ManifestRoots.clear();
+	Manifest.clear();
+	ManifestNames.clear();
 }
  
 s32 Nand::CreateConfig()
@@ -910,7 +1164,6 @@ s32 Nand::CreateConfig()
 	CreatePath("%s/title/00000001/00000002", FullNANDPath);
 	CreatePath("%s/title/00000001/00000002/data", FullNANDPath);
 
-	fake = false;
 	showprogress = false;
 
 	memset(cfgpath, 0, sizeof(cfgpath));
@@ -938,7 +1191,6 @@ s32 Nand::PreNandCfg(bool miis, bool realconfig)
 
 	char dest[MAX_FAT_PATH];
 	
-	fake = false;
 	showprogress = false;
 
 	if(realconfig)
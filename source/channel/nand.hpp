@@ -7,7 +7,9 @@
 #include <string.h>
 #include <iostream>
 #include <string>
+#include <vector>
 
+#include "fileOps/buffer_ring.h"
 #include "loader/disc.h"
 
 #define REAL_NAND	0
@@ -43,11 +45,26 @@ typedef struct _config_header
 	u16		noff[];
 } config_header;
 
-typedef struct _namelist
+#define NAND_FILE	0
+#define NAND_FOLDER	1
+
+/* One file or folder found while walking a dump or flash source */
+typedef struct _nandentry
+{
+	u32 path;	// offset of the full path in the manifest names
+	u32 size;	// 0 for folders
+	u8 type;
+	bool done;
+} nandentry;
+
+/* A walked source, its entries follow each other in the manifest */
+typedef struct _nandroot
 {
-	char name[ISFS_MAXPATH];
-	int type;
-} namelist;
+	u32 path;
+	u32 first;
+	u32 count;
+	bool flash;	// FAT source to flash instead of a NAND source to dump
+} nandroot;
 
 typedef struct _uid
 {
@@ -56,6 +73,8 @@ typedef struct _uid
 	u16 uid;
 } ATTRIBUTE_PACKED uid;
 
+struct nand_pipe;
+
 using namespace std;
 
 class Nand
@@ -98,7 +117,13 @@ public:
 	s32 DoNandDump(const char *source, const char *dest, dump_callback_t i_dumper, void *i_data);
 	s32 CalcFlashSize(const char *source, dump_callback_t i_dumper, void *i_data);
 	s32 CalcDumpSpace(const char *source, dump_callback_t i_dumper, void *i_data);
+	/* Also drops the manifest the Calc functions leave for the dump and flash */
 	void ResetCounters(void);
+	/* Reads every flashed file back from NAND and compares its SHA-1. Dumps
+	   to FAT are not verified, the read back would come from the libfat
+	   cache rather than the card. */
+	void SetVerify(bool verify) { Verify = verify; };
+	u32 GetVerifyErrors(void) { return VerifyErrors; };
 
 private:
 	/* Prototypes */
@@ -112,7 +137,13 @@ private:
 
 	void __Dec_Enc_TB(void);
 	void __configshifttxt(char *str);
-	void __GetNameList(const char *source, namelist **entries, int *count);
+	s32 __AddRoot(const char *source, bool flash);
+	s32 __FindRoot(const char *source, bool flash);
+	void __AddEntry(const char *path, u8 type, u32 size);
+	/* NAND_FILE with its size, NAND_FOLDER or the ISFS error */
+	s32 __NandEntryType(const char *path, u32 *size);
+	s32 __ListNandFolder(char *path, bool addFolder);
+	void __ListFatFolder(char *path);
 	s32 __configread(void);
 	s32 __configwrite(void);
 	u32 __configsetbyte(const char *item, u8 val);
@@ -121,10 +152,13 @@ private:
 	void __NANDify(char *str);
 	void __FATify(char *dst, const char *src);
 	s32 __Unescaped2x(const char *path);
-	s32 __FlashNandFile(const char *source, const char *dest);
-	s32 __FlashNandFolder(const char *source, const char *dest);
 	s32 __DumpNandFile(const char *source, const char *dest);
-	s32 __DumpNandFolder(const char *source, const char *dest);
+	void __EntryDest(nand_pipe *pipe, const nandentry &entry, char *ndest, u32 size);
+	void __Transfer(const nandroot &root, const char *dest);
+	void __WriteStage(nand_pipe *pipe);
+	void __Progress(const char *path, u32 size, bool force);
+	static void *__ReadStage(void *arg);
+	static void *__VerifyStage(void *arg);
 	int __makedir(char *newdir);
 
 	u32 MountedDevice;
@@ -134,12 +168,18 @@ private:
 	u32 FileDone;
 	u32 FilesDone;
 	u32 FoldersDone;
-	bool fake;
+	u32 VerifyErrors;
+	u64 LastProgress;
 	bool showprogress;
+	bool Verify;
 	bool isfs_inited;
 
 	void *data;
 	dump_callback_t dumper;
+	vector<nandroot> ManifestRoots;
+	vector<nandentry> Manifest;
+	string ManifestNames;
+	fstats FileStats ATTRIBUTE_ALIGN(32);
 	u32 Partition ATTRIBUTE_ALIGN(32);
 	u32 FullMode ATTRIBUTE_ALIGN(32);
 	char NandPath[32] ATTRIBUTE_ALIGN(32);
@@ -1,11 +1,75 @@
 #include <iostream>
 #include <fstream>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include "gct.h"
+#include "fileOps/fileOps.h"
 
 #define ERRORRANGE "Error: CheatNr out of range"
 
+//Header and Footer
+static const unsigned char gctHeader[] = { 0x00, 0xd0, 0xc0, 0xde, 0x00, 0xd0, 0xc0, 0xde};
+static const unsigned char gctFooter[] = { 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+struct GCTCacheHeader {
+	unsigned int magic;
+	unsigned int srcSize;
+	unsigned int srcTime;
+	unsigned int count;
+	unsigned int textSize;
+	unsigned int codeSize;
+	unsigned int selected[(MAXCHEATS + 31) / 32];
+};
+
+static inline int hexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+//!Same rules as IsCodeEx, 0=no code, 1="X", 2=code
+static int lineCodeStatus(const char *str, unsigned int len)
+{
+	if (len < 17 || str[8] != ' ')
+		return 0;
+	int status = 2;
+	for (int i = 0; i < 17; ++i)
+	{
+		if (i == 8)
+			continue;
+		if (str[i] == 'x' || str[i] == 'X')
+		{
+			if (status >= 1)
+				status = 1;
+		}
+		else if (hexValue(str[i]) < 0)
+			return 0;
+	}
+	return status;
+}
+
+//!Reads one line like getline, returns true when the end of the data was hit
+static bool readLine(const char *&pos, const char *end, const char *&line, unsigned int &len)
+{
+	line = pos;
+	const char *nl = (const char *)memchr(pos, '\n', end - pos);
+	bool eof = nl == NULL;
+	if (eof)
+		nl = end;
+	len = nl - pos;
+	pos = eof ? end : nl + 1;
+	if (len > 0 && line[len - 1] == '\r')
+		len--;
+	return eof;
+}
+
 GCTCheats::GCTCheats(void)
 {
 	Reset();
@@ -13,8 +77,6 @@ GCTCheats::GCTCheats(void)
 
 GCTCheats::~GCTCheats(void)
 {
-	string sGameID ="";
-	string sGameTitle = "";
 }
 
 unsigned int GCTCheats::getCnt()
@@ -34,288 +96,359 @@ string GCTCheats::getGameID(void)
 
 string GCTCheats::getCheat(unsigned int nr)
 {
-	if (nr <= (iCntCheats-1))
-		return sCheats[nr];
-	return ERRORRANGE;
+	if (nr >= iCntCheats)
+		return ERRORRANGE;
+
+	static const char hexChars[] = "0123456789ABCDEF";
+	string hex;
+	hex.reserve(sCheats[nr].codeSize * 2);
+	for (unsigned int i = 0; i < sCheats[nr].codeSize; ++i)
+	{
+		unsigned char b = sCode[sCheats[nr].code + i];
+		hex.push_back(hexChars[b >> 4]);
+		hex.push_back(hexChars[b & 0xF]);
+	}
+	return hex;
 }
 
 string GCTCheats::getCheatName(unsigned int nr)
 {
-	if (nr <= (iCntCheats-1))
-		return sCheatName[nr];
+	if (nr < iCntCheats)
+		return sText.c_str() + sCheats[nr].name;
 	return ERRORRANGE;
 }
 
 string GCTCheats::getCheatComment(unsigned int nr)
 {
-	if (nr <= (iCntCheats-1))
-		return sCheatComment[nr];
+	if (nr < iCntCheats)
+		return sText.c_str() + sCheats[nr].comment;
 	return ERRORRANGE;
 }
 
-int GCTCheats::createGCT(unsigned int nr,const char * filename)
+void GCTCheats::appendGCT(string &gct, const unsigned char *code, unsigned int size)
 {
-	if (nr == 0)return 0;
+	gct.append((const char *)code, size);
+}
 
+int GCTCheats::writeGCT(const string &gct, const char * filename)
+{
 	ofstream filestr;
-	filestr.open(filename);
+	filestr.open(filename, ios::out | ios::binary);
 	if (filestr.fail()) return 0;
 
-	//Header and Footer
-	char header[] = { 0x00, 0xd0, 0xc0, 0xde, 0x00, 0xd0, 0xc0, 0xde};
-	char footer[] = { 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-
-	string buf = getCheat(nr);
-	filestr.write(header,sizeof(header));
-
-	int x = 0;
-	while (x < (int)buf.size())
-	{
-		string temp = buf.substr(x,2);
-		 long int li = strtol(temp.c_str(),NULL,16);
-		temp = li;
-		filestr.write(temp.c_str(),1);
-		x +=2;
-	}
-	filestr.write(footer,sizeof(footer));
+	filestr.write((const char *)gctHeader, sizeof(gctHeader));
+	filestr.write(gct.data(), gct.size());
+	filestr.write((const char *)gctFooter, sizeof(gctFooter));
 	filestr.close();
 
 	return 1;
 }
 
-int GCTCheats::createGCT(const char * chtbuffer,const char * filename)
+int GCTCheats::createGCT(unsigned int nr,const char * filename)
 {
-	ofstream filestr;
-	filestr.open(filename);
-	if (filestr.fail()) return 0;
-
-	//Header and Footer
-	char header[] = { 0x00, 0xd0, 0xc0, 0xde, 0x00, 0xd0, 0xc0, 0xde};
-	char footer[] = { 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+	if (nr == 0 || nr >= iCntCheats) return 0;
 
-	string buf = chtbuffer;
-	filestr.write(header,sizeof(header));
+	string gct;
+	appendGCT(gct, &sCode[sCheats[nr].code], sCheats[nr].codeSize);
+	return writeGCT(gct, filename);
+}
 
-	int x = 0;
-	while (x < (int)buf.size())
+int GCTCheats::createGCT(const char * chtbuffer,const char * filename)
+{
+	string gct;
+	unsigned int len = strlen(chtbuffer);
+	gct.reserve(len / 2);
+	for (unsigned int x = 0; x < len; x += 2)
 	{
-		string temp = buf.substr(x,2);
-		long int li = strtol(temp.c_str(),NULL,16);
-		temp = li;
-		filestr.write(temp.c_str(),1);
-		x +=2;
+		int hi = hexValue(chtbuffer[x]);
+		int lo = x + 1 < len ? hexValue(chtbuffer[x + 1]) : -1;
+		if (hi < 0)
+			gct.push_back(0);
+		else if (lo < 0)
+			gct.push_back(hi);
+		else
+			gct.push_back((hi << 4) | lo);
 	}
-	filestr.write(footer,sizeof(footer));
-	filestr.close();
-
-	return 1;
+	return writeGCT(gct, filename);
 }
 
 int GCTCheats::createGCT(int nr[],int cnt,const char * filename)
 {
 	if (cnt == 0) return 0;
 
-	ofstream filestr;
-	filestr.open(filename);
-	if (filestr.fail()) return 0;
-
-	//Header and Footer
-	char header[] = { 0x00, 0xd0, 0xc0, 0xde, 0x00, 0xd0, 0xc0, 0xde};
-	char footer[] = { 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-
-	filestr.write(header,sizeof(header));
-
-	int c = 0;
-	while (c != cnt)
+	string gct;
+	for (int c = 0; c < cnt; ++c)
 	{
-		string buf = getCheat(nr[c]);
-		
-		int x = 0;
-		while (x < (int)buf.size())
-		{
-			string temp = buf.substr(x,2);
-			long int li = strtol(temp.c_str(),NULL,16);
-			temp = li;
-			filestr.write(temp.c_str(),1);
-			x +=2;
-		}
-		c++;
+		if (nr[c] < 0 || (unsigned int)nr[c] >= iCntCheats)
+			continue;
+		appendGCT(gct, &sCode[sCheats[nr[c]].code], sCheats[nr[c]].codeSize);
 	}
-	filestr.write(footer,sizeof(footer));
-	filestr.close();
-
-	return 1;
+	return writeGCT(gct, filename);
 }
 
 //creates gct from internal array
 int GCTCheats::createGCT(const char * filename)
 {
-	ofstream filestr;
-	filestr.open(filename);
-	if (filestr.fail()) return 0;
-
-	//Header and Footer
-	char header[] = { 0x00, 0xd0, 0xc0, 0xde, 0x00, 0xd0, 0xc0, 0xde};
-	char footer[] = { 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-
-	filestr.write(header,sizeof(header));
-
+	string gct;
 	for (unsigned int i=0; i < iCntCheats; ++i)
 		if (sCheatSelected[i] == true)
-		{
-			// cheat is selected, export it
-			string buf = getCheat(i);
-
-			int x = 0;
-			while (x < (int)buf.size())
-			{
-				string temp = buf.substr(x,2);
-				long int li = strtol(temp.c_str(),NULL,16);
-				temp = li;
-				filestr.write(temp.c_str(),1);
-				x +=2;
-			}
-		}
-	filestr.write(footer,sizeof(footer));
-	filestr.close();
-
-	return 1;
+			appendGCT(gct, &sCode[sCheats[i].code], sCheats[i].codeSize);
+	return writeGCT(gct, filename);
 }
 
 //creates txt from internal array
 int GCTCheats::createTXT(const char * filename)
 {
+	string txt;
+	txt.reserve(sText.size() + sCode.size() * 3 + 64);
+	txt.append(sGameID).append("\n");
+	txt.append(sGameTitle).append("\n\n");
 
-	// save gct file
-	fstream file;
-	file.open(filename,ios::out);
-
-	file << sGameID << endl;
-	file << sGameTitle << endl << endl;
-
-	for (unsigned int i=0; i < iCntCheats; ++i)
-		if  (sCheatSelected[i])
-		{
-			file << sCheatName[i] << endl;
-			for (unsigned int j=0; j+8 < sCheats[i].size(); j+=16)
-				file << sCheats[i].substr(j,8) << " " << sCheats[i].substr(j+8,8) << endl;
-
-			file << "#selected#" << sCheatComment[i] << endl;
-			file << endl;
-		}
-			
-	for (unsigned int i=0; i < iCntCheats; ++i)
-		if  (!sCheatSelected[i])
+	char line[19];
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		// selected cheats first
+		for (unsigned int i=0; i < iCntCheats; ++i)
 		{
-			file << sCheatName[i] << endl;
-			for (unsigned int j=0; j+8 < sCheats[i].size(); j+=16)
-				file << sCheats[i].substr(j,8) << " " << sCheats[i].substr(j+8,8) << endl;
-
-			if (sCheatComment[i].size() > 1)
-				file << sCheatComment[i] << endl;
-			file << endl;
+			if (sCheatSelected[i] != (pass == 0))
+				continue;
+			txt.append(sText.c_str() + sCheats[i].name).append("\n");
+			const unsigned char *code = &sCode[sCheats[i].code];
+			for (unsigned int j = 0; j + 8 <= sCheats[i].codeSize; j += 8)
+			{
+				snprintf(line, sizeof(line), "%02X%02X%02X%02X %02X%02X%02X%02X\n",
+					code[j], code[j + 1], code[j + 2], code[j + 3], code[j + 4], code[j + 5], code[j + 6], code[j + 7]);
+				txt.append(line);
+			}
+			const char *comment = sText.c_str() + sCheats[i].comment;
+			if (pass == 0)
+				txt.append("#selected#").append(comment).append("\n");
+			else if (strlen(comment) > 1)
+				txt.append(comment).append("\n");
+			txt.append("\n");
 		}
+	}
 
-	file.close();
+	if (!fsop_WriteFile(filename, txt.data(), txt.size()))
+		return 0;
+	if (!sCacheFile.empty())
+		saveCache(filename);
 	return 1;
 }
 
-
-int GCTCheats::openTxtfile(const char * filename)
+int GCTCheats::parseTxt(const char * data, unsigned int size)
 {
 	Reset();
+	if (data == NULL || size == 0) return -1;
 
-	ifstream filestr;
-	filestr.open(filename);
-	if (filestr.fail()) return 0;
+	const char *pos = data, *end = data + size;
+	const char *line;
+	unsigned int len;
 
-	int i = 0;
-	string str;
-	int codestatus;
-	bool codedynamic = false; // cheat contains X-Codes?
-
-	filestr.seekg(0,ios_base::end);
-	int size = filestr.tellg();
-	if (size <= 0) return -1;
-	filestr.seekg(0,ios_base::beg);
-
-	getline(filestr,sGameID);
-	if (sGameID[sGameID.length() - 1] == '\r')
-		sGameID.erase(sGameID.length() - 1);
-	
-	getline(filestr,sGameTitle);
-	if (sGameTitle[sGameTitle.length() - 1] == '\r')
-		sGameTitle.erase(sGameTitle.length() - 1);
-				
-	getline(filestr,sCheatName[i]);  // skip first line if file uses CRLF
-	if (!sGameTitle[sGameTitle.length() - 1] == '\r')
-	   filestr.seekg(0,ios_base::beg);
-
-	while (!filestr.eof()) {
-		getline(filestr,sCheatName[i]); // '\n' delimiter by default
-		if (sCheatName[i][sCheatName[i].length() - 1] == '\r')
-			sCheatName[i].erase(sCheatName[i].length() - 1);
-
-		string cheatdata;
-		bool emptyline = false;
-
-		while (!emptyline)
+	bool eof = readLine(pos, end, line, len);
+	sGameID.assign(line, len);
+	if (!eof)
+	{
+		eof = readLine(pos, end, line, len);
+		sGameTitle.assign(line, len);
+	}
+	// skip the empty line after the title
+	if (!eof) eof = readLine(pos, end, line, len);
+
+	sText.reserve(size / 2);
+	sCode.reserve(size / 3);
+
+	unsigned int i = 0;
+	while (!eof && i < MAXCHEATS)
+	{
+		const char *name;
+		unsigned int nameLen;
+		eof = readLine(pos, end, name, nameLen);
+
+		const char *comment = NULL;
+		unsigned int commentLen = 0;
+		unsigned int codeStart = sCode.size();
+		bool codedynamic = false; // cheat contains X-Codes?
+
+		while (!eof)
 		{
-			getline(filestr,str);
-			if (str[str.length() - 1] == '\r')
-				str.erase(str.length() - 1);
-				 
-			if (str == "" || str[0] == '\r' || str[0] == '\n')
-			{
-				emptyline = true;
+			eof = readLine(pos, end, line, len);
+			if (len == 0 || line[0] == '\r')
 				break;
-			}
 
-			codestatus = IsCodeEx(str);
-			if (codestatus == 1) 
+			int codestatus = lineCodeStatus(line, len);
+			if (codestatus == 1)
 				// line contains X code, so whole cheat is dynamic
 				codedynamic = true;
-				
+
 			if (codestatus == 2)
 			{
-				// remove any garbage (comment) after code
-				while (str.size() > 17)
-					str.erase(str.length() - 1);
-
-				cheatdata.append(str);
-				size_t found=cheatdata.find(' ');
-				cheatdata.replace(found,1,"");
+				// anything after the 17 code characters is a comment
+				for (int b = 0; b < 8; ++b)
+				{
+					int c = b < 4 ? b * 2 : b * 2 + 1;
+					sCode.push_back((hexValue(line[c]) << 4) | hexValue(line[c + 1]));
+				}
 			}
 			else
-				sCheatComment[i] = str;
+			{
+				comment = line;
+				commentLen = len;
+			}
+		}
 
-			if (filestr.eof()) break;
-		   
+		if (codedynamic || sCode.size() == codeStart)
+		{
+			sCode.resize(codeStart);
+			continue;
 		}
 
-		if (!codedynamic && cheatdata.size() > 0)
+		sCheats[i].code = codeStart;
+		sCheats[i].codeSize = sCode.size() - codeStart;
+		sCheats[i].name = sText.size();
+		sText.append(name, nameLen).push_back('\0');
+		// if comment starts with #selected#, it is selected
+		sCheatSelected[i] = commentLen >= 10 && memcmp(comment, "#selected#", 10) == 0;
+		if (sCheatSelected[i])
 		{
-			sCheats[i] = cheatdata;
-			sCheatSelected[i] = false;
-			// if comment starts with dynamic, it is selected
-			if (sCheatComment[i].compare(0,10,"#selected#") == 0)
-			{
-				sCheatSelected[i] = true;
-				sCheatComment[i].erase(0,10);
-			}
-			i++;
+			comment += 10;
+			commentLen -= 10;
 		}
-		else
-			sCheatComment[i] = "";
-			
-		codedynamic = false;
-		if (i == MAXCHEATS) break;
+		sCheats[i].comment = sText.size();
+		if (comment != NULL)
+			sText.append(comment, commentLen);
+		sText.push_back('\0');
+		i++;
 	}
 	iCntCheats = i;
-	filestr.close();
 	return 1;
 }
 
+int GCTCheats::openTxtfile(const char * filename)
+{
+	sCacheFile.clear();
+	unsigned int size = 0;
+	char *data = (char *)fsop_ReadFile(filename, &size);
+	if (data == NULL)
+	{
+		Reset();
+		return 0;
+	}
+	int ret = parseTxt(data, size);
+	free(data);
+	return ret;
+}
+
+int GCTCheats::openTxtfile(const char * filename, const char * cachename)
+{
+	struct stat txt;
+	if (stat(filename, &txt) != 0)
+	{
+		Reset();
+		sCacheFile.clear();
+		return 0;
+	}
+	if (loadCache(cachename, txt.st_size, txt.st_mtime))
+	{
+		sCacheFile = cachename;
+		return 1;
+	}
+
+	int ret = openTxtfile(filename);
+	sCacheFile = cachename;
+	if (ret > 0)
+		saveCache(filename);
+	return ret;
+}
+
+bool GCTCheats::loadCache(const char * cachename, unsigned int srcsize, unsigned int srctime)
+{
+	unsigned int size = 0;
+	unsigned char *data = fsop_ReadFile(cachename, &size);
+	if (data == NULL)
+		return false;
+
+	GCTCacheHeader header;
+	bool valid = size >= sizeof(header);
+	if (valid)
+	{
+		memcpy(&header, data, sizeof(header));
+		valid = header.magic == CHEAT_CACHE_MAGIC && header.srcSize == srcsize && header.srcTime == srctime
+			&& header.count <= MAXCHEATS && header.textSize <= size && header.codeSize <= size
+			&& sizeof(header) + header.count * sizeof(GCTCheat) + header.textSize + header.codeSize == size;
+	}
+	if (!valid)
+	{
+		free(data);
+		return false;
+	}
+
+	Reset();
+	const unsigned char *ptr = data + sizeof(header);
+	memcpy(sCheats, ptr, header.count * sizeof(GCTCheat));
+	ptr += header.count * sizeof(GCTCheat);
+	const char *text = (const char *)ptr;
+	const char *textEnd = text + header.textSize;
+	ptr += header.textSize;
+	sCode.assign(ptr, ptr + header.codeSize);
+
+	// game ID and title come first in the text pool
+	const char *title = (const char *)memchr(text, '\0', textEnd - text);
+	const char *rest = title != NULL ? (const char *)memchr(title + 1, '\0', textEnd - title - 1) : NULL;
+	valid = rest != NULL;
+	if (valid)
+	{
+		sGameID.assign(text);
+		sGameTitle.assign(title + 1);
+		sText.assign(rest + 1, textEnd);
+		for (unsigned int i = 0; i < header.count && valid; ++i)
+		{
+			valid = sCheats[i].name < sText.size() && sCheats[i].comment < sText.size()
+				&& sCheats[i].code <= sCode.size() && sCheats[i].codeSize <= sCode.size() - sCheats[i].code;
+			sCheatSelected[i] = (header.selected[i / 32] >> (i % 32)) & 1;
+		}
+		valid = valid && (sText.empty() || sText[sText.size() - 1] == '\0');
+	}
+	free(data);
+	if (!valid)
+	{
+		Reset();
+		return false;
+	}
+	iCntCheats = header.count;
+	return true;
+}
+
+void GCTCheats::saveCache(const char * filename)
+{
+	struct stat txt;
+	if (stat(filename, &txt) != 0)
+		return;
+
+	GCTCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = CHEAT_CACHE_MAGIC;
+	header.srcSize = txt.st_size;
+	header.srcTime = txt.st_mtime;
+	header.count = iCntCheats;
+	header.textSize = sGameID.size() + sGameTitle.size() + 2 + sText.size();
+	header.codeSize = sCode.size();
+	for (unsigned int i = 0; i < iCntCheats; ++i)
+		if (sCheatSelected[i])
+			header.selected[i / 32] |= 1 << (i % 32);
+
+	string cache;
+	cache.reserve(sizeof(header) + iCntCheats * sizeof(GCTCheat) + header.textSize + header.codeSize);
+	cache.append((const char *)&header, sizeof(header));
+	cache.append((const char *)sCheats, iCntCheats * sizeof(GCTCheat));
+	cache.append(sGameID).push_back('\0');
+	cache.append(sGameTitle).push_back('\0');
+	cache.append(sText);
+	if (!sCode.empty())
+		cache.append((const char *)&sCode[0], sCode.size());
+	fsop_WriteFile(sCacheFile.c_str(), cache.data(), cache.size());
+}
+
 bool GCTCheats::IsCode(const std::string& str)
 {
 	if (str[8] == ' ' && str.size() >= 17)
@@ -334,30 +467,16 @@ bool GCTCheats::IsCode(const std::string& str)
 
 int GCTCheats::IsCodeEx(const std::string& str)
 {
-	int status = 2;
-	if (str[8] == ' ' && str.size() >= 17)
-	{
-		// accept strings longer than 17 in case there is a comment on the same line as the code
-		for (int i = 0; i < 17; ++i)
-		{
-			if (!(str[i] == '0' || str[i] == '1' || str[i] == '2' || str[i] == '3' ||
-				  str[i] == '4' || str[i] == '5' || str[i] == '6' || str[i] == '7' ||
-				  str[i] == '8' || str[i] == '9' || str[i] == 'a' || str[i] == 'b' ||
-				  str[i] == 'c' || str[i] == 'd' || str[i] == 'e' || str[i] == 'f' ||
-				  str[i] == 'A' || str[i] == 'B' || str[i] == 'C' || str[i] == 'D' ||
-				  str[i] == 'E' || str[i] == 'F' || str[i] == 'x' || str[i] == 'X') && i!=8 )
-				status  = 0; // not even x -> no code
-			if ((str[i] == 'x' || str[i] == 'X') && i!=8 && status >= 1)
-				status  = 1;
-		}
-		return status;
-	}
-	return 0; // no code
+	return lineCodeStatus(str.c_str(), str.size());
 }
 
 void GCTCheats::Reset()
 {
 	iCntCheats = 0;
-	for (int i=0;i<MAXCHEATS;++i) 
+	sGameID.clear();
+	sGameTitle.clear();
+	sText.clear();
+	sCode.clear();
+	for (int i=0;i<MAXCHEATS;++i)
 		sCheatSelected[i] = false;
-}
\ No newline at end of file
+}
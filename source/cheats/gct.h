@@ -8,20 +8,35 @@
 #define _GCT_H
 
 #include <sstream>
+#include <string>
+#include <vector>
 
 #define MAXCHEATS 100
+#define CHEAT_CACHE_MAGIC 0x43485431 /* "CHT1" */
 
 using namespace std;
 
+//!One cheat of the file, offsets point into the text and code pools
+struct GCTCheat {
+    unsigned int name;
+    unsigned int comment;
+    unsigned int code;
+    unsigned int codeSize;
+};
+
 //!Handles Ocarina TXT Cheatfiles
 class GCTCheats {
 private:
     string sGameID;
     string sGameTitle;
-    string sCheatName[MAXCHEATS];
-    string sCheats[MAXCHEATS];
-    string sCheatComment[MAXCHEATS];
+    //!Names and comments of all cheats, NUL separated
+    string sText;
+    //!Binary codes of all cheats, 8 bytes per code line
+    vector<unsigned char> sCode;
+    GCTCheat sCheats[MAXCHEATS];
     unsigned int iCntCheats;
+    //!Cache file the parsed cheats are kept in
+    string sCacheFile;
 
 public:
 	//!Array which shows which cheat is selected 
@@ -34,6 +49,16 @@ public:
     //!\param filename name of TXT file
     //!\return error code
     int openTxtfile(const char * filename);
+    //!Open txt file with cheats, reusing the parsed cache file if it is still valid
+    //!\param filename name of TXT file
+    //!\param cachename name of the cache file
+    //!\return error code
+    int openTxtfile(const char * filename, const char * cachename);
+    //!Parse cheats from a txt file in memory
+    //!\param data txt file contents
+    //!\param size size of the contents
+    //!\return error code
+    int parseTxt(const char * data, unsigned int size);
     //!Creates GCT file for one cheat
     //!\param nr selected Cheat Numbers
     //!\param filename name of GCT file
@@ -89,6 +114,14 @@ public:
 private:
 	//!Resets the internal state, as if no file was loaded
 	void Reset();
+	//!Appends the selected codes wrapped in the GCT header and footer
+	void appendGCT(string &gct, const unsigned char *code, unsigned int size);
+	//!Writes a GCT file
+	int writeGCT(const string &gct, const char * filename);
+	//!Loads the cheats from a cache file made for the given txt file
+	bool loadCache(const char * cachename, unsigned int srcsize, unsigned int srctime);
+	//!Saves the cheats to the cache file for the given txt file
+	void saveCache(const char * filename);
 };
 
-#endif  /* _GCT_H */
\ No newline at end of file
+#endif  /* _GCT_H */
\ No newline at end of file
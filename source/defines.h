@@ -19,6 +19,7 @@
 #define GAME_SETTINGS1_FILENAME	"gameconfig1.ini"
 #define GAME_SETTINGS2_FILENAME	"gameconfig2.ini"
 #define PLUGIN_CRCS_FILENAME	"plugin_crc32.ini"
+#define PLUGIN_CRCS_CACHE		"plugin_crc32.bin"
 
 #define WII_DOMAIN				"GAMES"
 #define GC_DOMAIN				"DML"
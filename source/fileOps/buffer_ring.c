@@ -0,0 +1,75 @@
+/****************************************************************************
+ * buffer_ring.c
+ *
+ * Slots start out owned by stage 0. Each stage waits on its own semaphore,
+ * works on the slot at its cursor and posts the semaphore of the next stage,
+ * the last stage gives the slot back to stage 0. Stages always walk the
+ * slots in the same order so one cursor per stage is enough.
+ ****************************************************************************/
+#include <string.h>
+#include <malloc.h>
+
+#include "buffer_ring.h"
+#include "memory/mem2.hpp"
+
+bool ring_init(buffer_ring *ring, u32 count, u32 slot_size, u32 stages)
+{
+	u32 i;
+	memset(ring, 0, sizeof(buffer_ring));
+	if(count == 0 || stages < 2 || stages > RING_MAX_STAGES)
+		return false;
+
+	ring->slots = (ring_slot*)MEM2_alloc(count * sizeof(ring_slot));
+	if(ring->slots == NULL)
+		return false;
+	memset(ring->slots, 0, count * sizeof(ring_slot));
+	ring->count = count;
+	ring->stages = stages;
+	for(i = 0; i < stages; ++i)
+		LWP_SemInit(&ring->ready[i], i == 0 ? count : 0, count);
+
+	for(i = 0; i < count; ++i)
+	{
+		ring->slots[i].data = (u8*)MEM2_memalign(32, slot_size);
+		if(ring->slots[i].data == NULL)
+		{
+			ring_free(ring);
+			return false;
+		}
+		ring->slots[i].size = slot_size;
+	}
+	return true;
+}
+
+void ring_free(buffer_ring *ring)
+{
+	u32 i;
+	if(ring->slots == NULL)
+		return;
+	for(i = 0; i < ring->count; ++i)
+	{
+		if(ring->slots[i].data != NULL)
+			MEM2_free(ring->slots[i].data);
+	}
+	for(i = 0; i < ring->stages; ++i)
+		LWP_SemDestroy(ring->ready[i]);
+	MEM2_free(ring->slots);
+	memset(ring, 0, sizeof(buffer_ring));
+}
+
+ring_slot *ring_acquire(buffer_ring *ring, u32 stage)
+{
+	LWP_SemWait(ring->ready[stage]);
+	return &ring->slots[ring->pos[stage]];
+}
+
+void ring_release(buffer_ring *ring, u32 stage)
+{
+	ring->pos[stage] = (ring->pos[stage] + 1) % ring->count;
+	LWP_SemPost(ring->ready[(stage + 1) % ring->stages]);
+}
+
+void ring_abort(buffer_ring *ring)
+{
+	ring->abort = true;
+}
@@ -0,0 +1,53 @@
+/****************************************************************************
+ * buffer_ring.h
+ *
+ * A ring of aligned buffers passed through a fixed chain of stages, every
+ * stage runs on its own thread and hands its slot over to the next one.
+ ****************************************************************************/
+#ifndef _BUFFER_RING_H_
+#define _BUFFER_RING_H_
+
+#include <gccore.h>
+#include <ogc/semaphore.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define RING_MAX_STAGES	4
+
+typedef struct
+{
+	u8 *data;
+	u32 size;		/* allocated size of data */
+	u32 len;		/* bytes used by the current stage */
+	u32 tag;		/* caller defined, e.g. file index */
+	u32 flags;		/* caller defined */
+	bool last;		/* no slots follow after this one */
+} ring_slot;
+
+typedef struct
+{
+	ring_slot *slots;
+	u32 count;
+	u32 stages;
+	u32 pos[RING_MAX_STAGES];
+	sem_t ready[RING_MAX_STAGES];
+	volatile bool abort;
+} buffer_ring;
+
+/* allocates count slots of slot_size bytes (32 byte aligned, MEM2) */
+bool ring_init(buffer_ring *ring, u32 count, u32 slot_size, u32 stages);
+void ring_free(buffer_ring *ring);
+/* blocks until the next slot is ready for the given stage */
+ring_slot *ring_acquire(buffer_ring *ring, u32 stage);
+/* hands the slot acquired by the given stage over to the next stage */
+void ring_release(buffer_ring *ring, u32 stage);
+/* any stage can request an abort, the first stage then ends the stream early */
+void ring_abort(buffer_ring *ring);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -0,0 +1,333 @@
+/****************************************************************************
+ * copy_engine.c
+ *
+ * The reader walks folders itself while copying, a chunk flagged FIRST
+ * carries the path relative to the copy root in paths[slot] and the file
+ * size in its tag, so the writer needs no listing made beforehand.
+ ****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+
+#include "copy_engine.h"
+#include "gecko/gecko.hpp"
+#include "loader/utils.h"
+#include "memory/mem2.hpp"
+
+#define COPY_WORKERS		4
+#define COPY_SLOTS			4
+#define COPY_SLOT_SIZE		0x40000
+#define COPY_STACK			(16 * 1024)
+
+#define COPY_STAGE_READ		0
+#define COPY_STAGE_WRITE	1
+
+#define COPY_CHUNK_FIRST	1
+#define COPY_CHUNK_LAST		2
+#define COPY_CHUNK_DIR		4
+#define COPY_CHUNK_ERROR	8
+
+typedef struct
+{
+	char device[16];
+	lwp_t thread;
+	mutex_t lock;
+	sem_t work;
+	copy_job *head;
+	copy_job *tail;
+} copy_worker;
+
+static copy_worker workers[COPY_WORKERS];
+static u32 workerCount = 0;
+static mutex_t workersLock = LWP_MUTEX_NULL;
+
+static inline char *copy_path(copy_job *job, u32 i)
+{
+	return job->paths + i * MAX_FAT_PATH;
+}
+
+static void copy_read_file(copy_job *job, const char *path, u32 rootLen)
+{
+	u32 flags = COPY_CHUNK_FIRST;
+	u32 left = 0;
+	FILE *f = fopen(path, "rb");
+	if(f == NULL)
+	{
+		gprintf("Error opening source: \"%s\"\n", path);
+		flags |= COPY_CHUNK_ERROR;
+	}
+	else
+	{
+		fseek(f, 0, SEEK_END);
+		left = ftell(f);
+		fseek(f, 0, SEEK_SET);
+	}
+	u32 size = left;
+	while(!(flags & COPY_CHUNK_LAST))
+	{
+		ring_slot *slot = ring_acquire(&job->ring, COPY_STAGE_READ);
+		if(flags & COPY_CHUNK_FIRST)
+			strcpy(copy_path(job, slot - job->ring.slots), path + rootLen);
+		u32 len = left < slot->size ? left : slot->size;
+		if(len > 0 && fread(slot->data, 1, len, f) != len)
+		{
+			gprintf("Error reading \"%s\"\n", path);
+			flags |= COPY_CHUNK_ERROR;
+			len = 0;
+		}
+		left -= len;
+		if(left == 0 || (flags & COPY_CHUNK_ERROR) || job->ring.abort)
+			flags |= COPY_CHUNK_LAST;
+		slot->tag = size;
+		slot->flags = flags;
+		slot->len = len;
+		slot->last = false;
+		ring_release(&job->ring, COPY_STAGE_READ);
+		flags &= ~COPY_CHUNK_FIRST;
+	}
+	if(f != NULL)
+		fclose(f);
+}
+
+static void copy_read_folder(copy_job *job, char *path, u32 rootLen)
+{
+	DIR *pdir = opendir(path);
+	ring_slot *slot = ring_acquire(&job->ring, COPY_STAGE_READ);
+	strcpy(copy_path(job, slot - job->ring.slots), path + rootLen);
+	slot->flags = COPY_CHUNK_FIRST | COPY_CHUNK_LAST | COPY_CHUNK_DIR | (pdir == NULL ? COPY_CHUNK_ERROR : 0);
+	slot->len = 0;
+	slot->last = false;
+	ring_release(&job->ring, COPY_STAGE_READ);
+	if(pdir == NULL)
+	{
+		gprintf("Error opening source folder: \"%s\"\n", path);
+		return;
+	}
+
+	u32 len = strlen(path);
+	struct dirent *pent;
+	while(!job->ring.abort && (pent = readdir(pdir)) != NULL)
+	{
+		if(pent->d_name[0] == '.')
+			continue;
+		if(len + 1 + strlen(pent->d_name) >= MAX_FAT_PATH)
+		{
+			gprintf("Path too long: \"%s/%s\"\n", path, pent->d_name);
+			continue;
+		}
+		path[len] = '/';
+		strcpy(path + len + 1, pent->d_name);
+		if(pent->d_type == DT_DIR)
+			copy_read_folder(job, path, rootLen);
+		else if(pent->d_type == DT_REG)
+			copy_read_file(job, path, rootLen);
+		path[len] = '\0';
+	}
+	closedir(pdir);
+}
+
+static void copy_read(copy_job *job)
+{
+	char *path = copy_path(job, COPY_SLOTS);
+	strncpy(path, job->source, MAX_FAT_PATH - 1);
+	path[MAX_FAT_PATH - 1] = '\0';
+	if(job->folder)
+		copy_read_folder(job, path, strlen(path));
+	else
+		copy_read_file(job, path, strlen(path));
+	ring_slot *slot = ring_acquire(&job->ring, COPY_STAGE_READ);
+	slot->last = true;
+	ring_release(&job->ring, COPY_STAGE_READ);
+}
+
+static bool copy_write(copy_job *job)
+{
+	char *target = copy_path(job, COPY_SLOTS + 1);
+	FILE *ft = NULL;
+	bool failed = false;
+	u64 found = 0;
+
+	while(1)
+	{
+		ring_slot *slot = ring_acquire(&job->ring, COPY_STAGE_WRITE);
+		if(slot->last)
+		{
+			ring_release(&job->ring, COPY_STAGE_WRITE);
+			break;
+		}
+		/* After a failure the rest is only drained until the reader stops */
+		if(!failed && (slot->flags & COPY_CHUNK_FIRST))
+		{
+			snprintf(target, MAX_FAT_PATH, "%s%s", job->target, copy_path(job, slot - job->ring.slots));
+			if(slot->flags & COPY_CHUNK_ERROR)
+				failed = true;
+			else if(slot->flags & COPY_CHUNK_DIR)
+				fsop_MakeFolder(target);
+			else
+			{
+				ft = fopen(target, "wb");
+				if(ft == NULL)
+				{
+					gprintf("Error opening destination: \"%s\"\n", target);
+					failed = true;
+				}
+				else
+					found += slot->tag;
+			}
+		}
+		if(!failed && ft != NULL)
+		{
+			if((slot->flags & COPY_CHUNK_ERROR) || fwrite(slot->data, 1, slot->len, ft) != slot->len)
+				failed = true;
+			if((slot->flags & COPY_CHUNK_LAST) && fclose(ft) != 0)
+				failed = true;
+			if(slot->flags & COPY_CHUNK_LAST)
+				ft = NULL;
+			if(failed)
+			{
+				if(ft != NULL)
+					fclose(ft);
+				ft = NULL;
+				unlink(target);
+			}
+		}
+		if(failed)
+			ring_abort(&job->ring);
+		else if(slot->len > 0)
+		{
+			job->done += slot->len;
+			if(job->spinner != NULL)
+				job->spinner(job->done, job->total > found ? job->total : found, job->spinner_data);
+		}
+		ring_release(&job->ring, COPY_STAGE_WRITE);
+	}
+	if(ft != NULL)
+		fclose(ft);
+	return !failed;
+}
+
+static void *copy_worker_thread(void *arg)
+{
+	copy_worker *w = (copy_worker *)arg;
+	while(1)
+	{
+		LWP_SemWait(w->work);
+		LWP_MutexLock(w->lock);
+		copy_job *job = w->head;
+		if(job != NULL)
+		{
+			w->head = job->next;
+			if(w->head == NULL)
+				w->tail = NULL;
+		}
+		LWP_MutexUnlock(w->lock);
+		/* Posted without a job by copy_shutdown */
+		if(job == NULL)
+			break;
+		copy_read(job);
+		LWP_SemPost(job->finished);
+	}
+	return NULL;
+}
+
+static copy_worker *copy_get_worker(const char *path)
+{
+	char device[16];
+	const char *colon = strchr(path, ':');
+	u32 len = colon != NULL ? (u32)(colon - path) : 0;
+	if(len >= sizeof(device))
+		len = sizeof(device) - 1;
+	memcpy(device, path, len);
+	device[len] = '\0';
+
+	copy_worker *w = NULL;
+	LWP_MutexLock(workersLock);
+	u32 i;
+	for(i = 0; i < workerCount && w == NULL; ++i)
+	{
+		if(strcmp(workers[i].device, device) == 0)
+			w = &workers[i];
+	}
+	if(w == NULL && workerCount < COPY_WORKERS)
+	{
+		w = &workers[workerCount];
+		memset(w, 0, sizeof(copy_worker));
+		strcpy(w->device, device);
+		LWP_MutexInit(&w->lock, 0);
+		LWP_SemInit(&w->work, 0, 64);
+		if(LWP_CreateThread(&w->thread, copy_worker_thread, w, NULL, COPY_STACK, 60) < 0)
+		{
+			LWP_SemDestroy(w->work);
+			LWP_MutexDestroy(w->lock);
+			w = NULL;
+		}
+		else
+			++workerCount;
+	}
+	/* Out of workers, the last one takes the other devices */
+	if(w == NULL && workerCount > 0)
+		w = &workers[workerCount - 1];
+	LWP_MutexUnlock(workersLock);
+	return w;
+}
+
+void copy_init(void)
+{
+	if(workersLock == LWP_MUTEX_NULL)
+		LWP_MutexInit(&workersLock, 0);
+}
+
+bool copy_run(copy_job *job)
+{
+	copy_worker *w = copy_get_worker(job->source);
+	if(w == NULL)
+		return false;
+	job->paths = (char *)MEM2_alloc((COPY_SLOTS + 2) * MAX_FAT_PATH);
+	if(job->paths == NULL)
+		return false;
+	if(!ring_init(&job->ring, COPY_SLOTS, COPY_SLOT_SIZE, 2))
+	{
+		MEM2_free(job->paths);
+		return false;
+	}
+	LWP_SemInit(&job->finished, 0, 1);
+	job->done = 0;
+	job->next = NULL;
+
+	LWP_MutexLock(w->lock);
+	if(w->tail != NULL)
+		w->tail->next = job;
+	else
+		w->head = job;
+	w->tail = job;
+	LWP_MutexUnlock(w->lock);
+	LWP_SemPost(w->work);
+
+	bool ok = copy_write(job);
+	/* The ring belongs to the reader until it is out of copy_read */
+	LWP_SemWait(job->finished);
+	LWP_SemDestroy(job->finished);
+	ring_free(&job->ring);
+	MEM2_free(job->paths);
+	job->paths = NULL;
+	return ok;
+}
+
+void copy_shutdown(void)
+{
+	u32 i;
+	if(workersLock == LWP_MUTEX_NULL)
+		return;
+	LWP_MutexLock(workersLock);
+	for(i = 0; i < workerCount; ++i)
+	{
+		LWP_SemPost(workers[i].work);
+		LWP_JoinThread(workers[i].thread, NULL);
+		LWP_SemDestroy(workers[i].work);
+		LWP_MutexDestroy(workers[i].lock);
+	}
+	workerCount = 0;
+	LWP_MutexUnlock(workersLock);
+}
@@ -0,0 +1,47 @@
+/****************************************************************************
+ * copy_engine.h
+ *
+ * Copies files and folders through a buffer_ring. Reading runs on a worker
+ * kept per source device, so jobs reading the same device queue up behind
+ * each other, writing and progress run on the thread asking for the copy.
+ ****************************************************************************/
+#ifndef _COPY_ENGINE_H_
+#define _COPY_ENGINE_H_
+
+#include <gccore.h>
+
+#include "buffer_ring.h"
+#include "fileOps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef struct copy_job
+{
+	const char *source;
+	const char *target;
+	bool folder;
+	u64 total;		/* size of the whole copy if known, else it grows as files are reached */
+	u64 done;
+	progress_callback_t spinner;
+	void *spinner_data;
+	/* engine side */
+	buffer_ring ring;
+	char *paths;	/* one relative path per slot, then the reader's and writer's paths */
+	sem_t finished;
+	struct copy_job *next;
+} copy_job;
+
+void copy_init(void);
+/* queues the reading on the worker of the source device and writes on the
+   calling thread, false if anything failed */
+bool copy_run(copy_job *job);
+/* ends the workers, none may be busy */
+void copy_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -5,6 +5,8 @@
 #include <string.h>
 #include <sys/iosupport.h>
 #include <stdarg.h>
+#include <ogc/machine/processor.h>
+#include <ogc/semaphore.h>
 
 #include "gecko.hpp"
 #include "memory/mem2.hpp"
@@ -12,6 +14,12 @@
 
 #define GPRINTF_SIZE	256
 #define SDWRITE_SIZE	1024
+/* Messages are queued as the format pointer plus the raw arguments and
+   only formatted by the drain thread, LOG_SLOTS has to be a power of 2 */
+#define LOG_SLOTS		256
+#define LOG_DATA_SIZE	GPRINTF_SIZE
+#define LOG_BATCH_SIZE	512
+#define LOG_STACK_SIZE	16384
 
 bool geckoinit = false;
 bool sd_inited = false;
@@ -20,6 +28,26 @@ bool bufferMessages = true;
 char gprintfBuffer[GPRINTF_SIZE];
 char sdwritebuffer[SDWRITE_SIZE];
 
+typedef struct
+{
+	const char *format;	/* NULL if data already holds the text */
+	volatile u8 ready;
+	u8 data[LOG_DATA_SIZE];
+} log_record;
+
+static log_record logRing[LOG_SLOTS];
+static volatile u32 logHead = 0;
+static volatile u32 logTail = 0;
+static volatile u32 logDropped = 0;
+static u8 logLevels[LOG_SUBSYS_COUNT] = { LOG_INFO, LOG_INFO, LOG_INFO, LOG_INFO, LOG_INFO, LOG_INFO };
+
+static lwp_t logThread = LWP_THREAD_NULL;
+static sem_t logSem = LWP_SEM_NULL;
+static mutex_t logMutex = LWP_MUTEX_NULL;
+static u8 logStack[LOG_STACK_SIZE] ATTRIBUTE_ALIGN(32);
+static char logBatch[LOG_BATCH_SIZE];
+static u32 logBatchLen = 0;
+
 static ssize_t __out_write(struct _reent *r __attribute__((unused)), int fd __attribute__((unused)), const char *ptr, size_t len)
 {
 	if(geckoinit && ptr)
@@ -95,6 +123,401 @@ static void WriteToFile(const char* tmp, size_t len)
 	}
 }
 
+enum
+{
+	ARG_INT,
+	ARG_LONG,
+	ARG_LLONG,
+	ARG_SIZE,
+	ARG_PTR,
+	ARG_DOUBLE,
+	ARG_STR,
+	ARG_BAD
+};
+
+typedef struct
+{
+	const char *start;
+	const char *end;
+	bool starWidth;
+	bool starPrec;
+	int prec;	/* -1 without a precision */
+	int type;
+} log_spec;
+
+/* Parses the conversion at p (pointing behind the '%') the same way for
+   packing and formatting, anything unusual is marked ARG_BAD and the
+   message is then formatted right away instead */
+static const char *LogParseSpec(const char *p, log_spec *spec)
+{
+	int len = 0;
+
+	spec->start = p - 1;
+	spec->starWidth = false;
+	spec->starPrec = false;
+	spec->prec = -1;
+	while(*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+		++p;
+	if(*p == '*')
+	{
+		spec->starWidth = true;
+		++p;
+	}
+	while(*p >= '0' && *p <= '9')
+		++p;
+	if(*p == '.')
+	{
+		++p;
+		spec->prec = 0;
+		if(*p == '*')
+		{
+			spec->starPrec = true;
+			++p;
+		}
+		while(*p >= '0' && *p <= '9')
+			spec->prec = spec->prec * 10 + *p++ - '0';
+	}
+	if(*p == 'h')
+	{
+		++p;
+		if(*p == 'h')
+			++p;
+	}
+	else if(*p == 'l')
+	{
+		len = ARG_LONG;
+		++p;
+		if(*p == 'l')
+		{
+			len = ARG_LLONG;
+			++p;
+		}
+	}
+	else if(*p == 'j')
+	{
+		len = ARG_LLONG;
+		++p;
+	}
+	else if(*p == 'z' || *p == 't')
+	{
+		len = ARG_SIZE;
+		++p;
+	}
+	else if(*p == 'L')
+	{
+		len = ARG_BAD;
+		++p;
+	}
+	switch(*p)
+	{
+		case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+			spec->type = len == 0 ? ARG_INT : len;
+			break;
+		case 'c':
+			spec->type = len == 0 ? ARG_INT : ARG_BAD;
+			break;
+		case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+			spec->type = (len == 0 || len == ARG_LONG) ? ARG_DOUBLE : ARG_BAD;
+			break;
+		case 's':
+			spec->type = len == 0 ? ARG_STR : ARG_BAD;
+			break;
+		case 'p':
+			spec->type = ARG_PTR;
+			break;
+		default:
+			spec->type = ARG_BAD;
+			break;
+	}
+	if(*p != '\0')
+		++p;
+	spec->end = p;
+	if(spec->end - spec->start >= 32)
+		spec->type = ARG_BAD;
+	return p;
+}
+
+#define LOG_PUT(type, value) \
+	do { \
+		type v = (type)(value); \
+		if(pos + sizeof(type) > LOG_DATA_SIZE) \
+			return false; \
+		memcpy(data + pos, &v, sizeof(type)); \
+		pos += sizeof(type); \
+	} while(0)
+
+static bool LogPackArgs(u8 *data, const char *format, va_list va)
+{
+	u32 pos = 0;
+	log_spec spec;
+
+	for(const char *p = format; *p != '\0'; )
+	{
+		if(*p++ != '%')
+			continue;
+		if(*p == '%')
+		{
+			++p;
+			continue;
+		}
+		p = LogParseSpec(p, &spec);
+		if(spec.starWidth)
+			LOG_PUT(int, va_arg(va, int));
+		if(spec.starPrec)
+		{
+			spec.prec = va_arg(va, int);
+			LOG_PUT(int, spec.prec);
+		}
+		switch(spec.type)
+		{
+			case ARG_INT:
+				LOG_PUT(int, va_arg(va, int));
+				break;
+			case ARG_LONG:
+				LOG_PUT(long, va_arg(va, long));
+				break;
+			case ARG_LLONG:
+				LOG_PUT(long long, va_arg(va, long long));
+				break;
+			case ARG_SIZE:
+				LOG_PUT(size_t, va_arg(va, size_t));
+				break;
+			case ARG_PTR:
+				LOG_PUT(void *, va_arg(va, void *));
+				break;
+			case ARG_DOUBLE:
+				LOG_PUT(double, va_arg(va, double));
+				break;
+			case ARG_STR:
+			{
+				/* strings may not live until the drain, copy them. With a
+				   precision they need not be terminated, as in "%.4s" */
+				const char *str = va_arg(va, const char *);
+				if(str == NULL)
+					str = "(null)";
+				u32 len = spec.prec >= 0 ? strnlen(str, spec.prec) : strlen(str);
+				if(pos + len + 1 > LOG_DATA_SIZE)
+					return false;
+				memcpy(data + pos, str, len);
+				data[pos + len] = '\0';
+				pos += len + 1;
+				break;
+			}
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+#define LOG_GET(type, var) \
+	type var; \
+	memcpy(&var, data + pos, sizeof(type)); \
+	pos += sizeof(type)
+
+static u32 LogFormat(char *out, u32 size, const char *format, const u8 *data)
+{
+	u32 pos = 0;
+	u32 len = 0;
+	log_spec spec;
+	char conv[48];
+
+	for(const char *p = format; *p != '\0' && len < size - 1; )
+	{
+		if(*p != '%')
+		{
+			out[len++] = *p++;
+			continue;
+		}
+		++p;
+		if(*p == '%')
+		{
+			out[len++] = *p++;
+			continue;
+		}
+		p = LogParseSpec(p, &spec);
+		/* rebuild the conversion with the '*' fields filled in, one too
+		   long for conv prints nothing but still takes its argument */
+		u32 c = 0;
+		bool fits = true;
+		for(const char *s = spec.start; s < spec.end; ++s)
+		{
+			if(*s == '*')
+			{
+				LOG_GET(int, star);
+				int n = snprintf(conv + c, sizeof(conv) - c, "%d", star);
+				if(n < 0 || (u32)n >= sizeof(conv) - c)
+					fits = false;
+				else
+					c += n;
+			}
+			else if(c < sizeof(conv) - 1)
+				conv[c++] = *s;
+			else
+				fits = false;
+		}
+		conv[fits ? c : 0] = '\0';
+		int ret = 0;
+		switch(spec.type)
+		{
+			case ARG_INT:
+			{
+				LOG_GET(int, v);
+				ret = snprintf(out + len, size - len, conv, v);
+				break;
+			}
+			case ARG_LONG:
+			{
+				LOG_GET(long, v);
+				ret = snprintf(out + len, size - len, conv, v);
+				break;
+			}
+			case ARG_LLONG:
+			{
+				LOG_GET(long long, v);
+				ret = snprintf(out + len, size - len, conv, v);
+				break;
+			}
+			case ARG_SIZE:
+			{
+				LOG_GET(size_t, v);
+				ret = snprintf(out + len, size - len, conv, v);
+				break;
+			}
+			case ARG_PTR:
+			{
+				LOG_GET(void *, v);
+				ret = snprintf(out + len, size - len, conv, v);
+				break;
+			}
+			case ARG_DOUBLE:
+			{
+				LOG_GET(double, v);
+				ret = snprintf(out + len, size - len, conv, v);
+				break;
+			}
+			case ARG_STR:
+			{
+				const char *v = (const char *)data + pos;
+				pos += strlen(v) + 1;
+				ret = snprintf(out + len, size - len, conv, v);
+				break;
+			}
+		}
+		if(ret > 0)
+			len = (len + ret < size - 1) ? len + ret : size - 1;
+	}
+	out[len] = '\0';
+	return len;
+}
+
+static void LogFlushBatch(void)
+{
+	if(logBatchLen == 0)
+		return;
+	__out_write(NULL, 0, logBatch, logBatchLen);
+	WiFiDebugger.Send(logBatch, logBatchLen);
+	WriteToFile(logBatch, logBatchLen);
+	logBatchLen = 0;
+	logBatch[0] = '\0';
+}
+
+static void LogAppend(const char *text, u32 len)
+{
+	if(logBatchLen + len >= LOG_BATCH_SIZE)
+		LogFlushBatch();
+	if(len >= LOG_BATCH_SIZE)
+		len = LOG_BATCH_SIZE - 1;
+	memcpy(logBatch + logBatchLen, text, len);
+	logBatchLen += len;
+	logBatch[logBatchLen] = '\0';
+}
+
+static void LogDrain(void)
+{
+	if(logMutex != LWP_MUTEX_NULL)
+		LWP_MutexLock(logMutex);
+	while(true)
+	{
+		log_record *rec = &logRing[logTail & (LOG_SLOTS - 1)];
+		if(!rec->ready)
+			break;
+		u32 len;
+		if(rec->format != NULL)
+			len = LogFormat(gprintfBuffer, GPRINTF_SIZE, rec->format, rec->data);
+		else
+		{
+			len = strnlen((const char *)rec->data, LOG_DATA_SIZE - 1);
+			memcpy(gprintfBuffer, rec->data, len);
+			gprintfBuffer[len] = '\0';
+		}
+		rec->ready = 0;
+		__sync_synchronize();
+		++logTail;
+		LogAppend(gprintfBuffer, len);
+	}
+	if(logDropped > 0)
+	{
+		u32 level;
+		_CPU_ISR_Disable(level);
+		u32 dropped = logDropped;
+		logDropped = 0;
+		_CPU_ISR_Restore(level);
+		u32 len = snprintf(gprintfBuffer, GPRINTF_SIZE, "gecko: %u messages dropped\n", dropped);
+		LogAppend(gprintfBuffer, len);
+	}
+	LogFlushBatch();
+	if(logMutex != LWP_MUTEX_NULL)
+		LWP_MutexUnlock(logMutex);
+}
+
+static void *LogThread(void *)
+{
+	while(true)
+	{
+		LWP_SemWait(logSem);
+		LogDrain();
+	}
+	return NULL;
+}
+
+static void LogRecord(const char *format, va_list va)
+{
+	u32 irq;
+	u32 slot;
+
+	_CPU_ISR_Disable(irq);
+	slot = logHead;
+	if(slot - logTail >= LOG_SLOTS)
+	{
+		/* Ring full. Draining here would take logMutex, which is not
+		   allowed from an interrupt handler, so the message is dropped and
+		   counted. The drain thread reports the count. */
+		++logDropped;
+		_CPU_ISR_Restore(irq);
+		return;
+	}
+	logHead = slot + 1;
+	_CPU_ISR_Restore(irq);
+
+	log_record *rec = &logRing[slot & (LOG_SLOTS - 1)];
+	va_list args;
+	va_copy(args, va);
+	if(LogPackArgs(rec->data, format, args))
+		rec->format = format;
+	else
+	{
+		vsnprintf((char *)rec->data, GPRINTF_SIZE - 1, format, va);
+		rec->format = NULL;
+	}
+	va_end(args);
+	__sync_synchronize();
+	rec->ready = 1;
+	/* only wake the drain thread if it is waiting for this slot */
+	if(logSem != LWP_SEM_NULL && logTail == slot)
+		LWP_SemPost(logSem);
+}
+
 void Gecko_Init(void)
 {
 	USBGeckoOutput();
@@ -109,6 +532,15 @@ void Gecko_Init(void)
 		const char *initstr = "USB Gecko inited.\n";
 		__out_write(NULL, 0, initstr, strlen(initstr));
 	}
+
+	LWP_MutexInit(&logMutex, false);
+	LWP_SemInit(&logSem, 1, LOG_SLOTS);
+	LWP_CreateThread(&logThread, LogThread, NULL, logStack, LOG_STACK_SIZE, 20);
+}
+
+void Gecko_Flush(void)
+{
+	LogDrain();
 }
 
 void LogToSD_SetBuffer(bool buf)
@@ -117,6 +549,12 @@ void LogToSD_SetBuffer(bool buf)
 	sd_inited = true;
 }
 
+void Log_SetLevel(int subsys, int level)
+{
+	if(subsys >= 0 && subsys < LOG_SUBSYS_COUNT)
+		logLevels[subsys] = level;
+}
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -124,44 +562,57 @@ extern "C"
 
 void gprintf(const char *format, ...)
 {
+	if(LOG_INFO > logLevels[LOG_GENERAL])
+		return;
 	va_list va;
 	va_start(va, format);
-	size_t len = vsnprintf(gprintfBuffer, GPRINTF_SIZE - 1, format, va);
+	LogRecord(format, va);
 	va_end(va);
+}
 
-	__out_write(NULL, 0, gprintfBuffer, len);
-	WiFiDebugger.Send(gprintfBuffer, len);
-	WriteToFile(gprintfBuffer, len);
+void glog(int subsys, int level, const char *format, ...)
+{
+	if(subsys < 0 || subsys >= LOG_SUBSYS_COUNT)
+		subsys = LOG_GENERAL;
+	if(level > logLevels[subsys])
+		return;
+	va_list va;
+	va_start(va, format);
+	LogRecord(format, va);
+	va_end(va);
 }
 
 void ghexdump(void *d, int len)
 {
 	u8 *data;
-	int i, off;
+	int i, off, pos;
+	char line[80];
 	data = (u8*)d;
 
 	gprintf("\n       0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F  0123456789ABCDEF");
 	gprintf("\n====  ===============================================  ================\n");
 
+	/* One message per line, a full ring drops messages */
 	for (off = 0; off < len; off += 16)
 	{
-		gprintf("%04x  ",off);
+		pos = sprintf(line, "%04x  ",off);
 		for(i = 0; i < 16; i++)
 		{
 			if((i+off)>=len)
-				gprintf("   ");
+				pos += sprintf(line + pos, "   ");
 			else
-				gprintf("%02x ",data[off+i]);
+				pos += sprintf(line + pos, "%02x ",data[off+i]);
 		}
-		gprintf(" ");
+		line[pos++] = ' ';
 		for(i = 0; i < 16; i++)
 		{
 			if((i+off)>=len)
-				gprintf(" ");
+				line[pos++] = ' ';
 			else
-				gprintf("%c",ascii(data[off+i]));
+				line[pos++] = ascii(data[off+i]);
 		}
-		gprintf("\n");
+		line[pos] = '\0';
+		gprintf("%s\n", line);
 	}
 }
 
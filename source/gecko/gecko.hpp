@@ -4,14 +4,39 @@
 
 #include <gccore.h>
 
+/* Subsystems with their own log level, see Log_SetLevel */
+enum
+{
+	LOG_GENERAL = 0,
+	LOG_GUI,
+	LOG_NET,
+	LOG_PLUGIN,
+	LOG_SOUND,
+	LOG_DISC,
+	LOG_SUBSYS_COUNT
+};
+
+enum
+{
+	LOG_ERROR = 0,
+	LOG_INFO,
+	LOG_DEBUG
+};
+
 void Gecko_Init(void);
+/* Writes out everything still queued, call before unmounting or booting */
+void Gecko_Flush(void);
 void LogToSD_SetBuffer(bool buf);
+void Log_SetLevel(int subsys, int level);
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* Both only queue the message, formatting and output happen on a
+   separate thread (gprintf logs as LOG_GENERAL, LOG_INFO) */
 void gprintf(const char *format, ...);
+void glog(int subsys, int level, const char *format, ...);
 void ghexdump(void *d, int len);
 
 #ifdef __cplusplus
@@ -27,6 +27,10 @@ FreeTypeGX::FreeTypeGX()
 	FT_Init_FreeType(&this->ftLibrary);
     reset();
 	this->ftFace = 0;
+	this->glyphHashCount = 0;
+	this->kerningTable = NULL;
+	memset(this->denseGlyphs, 0, sizeof(this->denseGlyphs));
+	memset(&this->missingGlyph, 0, sizeof(this->missingGlyph));
 }
 
 FreeTypeGX::~FreeTypeGX()
@@ -69,6 +73,8 @@ uint16_t FreeTypeGX::loadFont(FT_Byte *fontBuffer, FT_Long bufferSize, FT_UInt p
 
 	this->ftSlot = this->ftFace->glyph;
 	this->ftKerningEnabled = FT_HAS_KERNING(this->ftFace);
+	if(this->ftKerningEnabled)
+		this->cacheKerning();
 	
 	if (cacheAll)
 		return this->cacheGlyphDataComplete();
@@ -78,13 +84,77 @@ uint16_t FreeTypeGX::loadFont(FT_Byte *fontBuffer, FT_Long bufferSize, FT_UInt p
 
 void FreeTypeGX::unloadFont()
 {
-	if(this->fontData.size() == 0)
-		return;
-
-	std::map<wchar_t, ftgxCharData>::iterator itr;
+	std::deque<ftgxCharData>::iterator itr;
 	for(itr = this->fontData.begin(); itr != this->fontData.end(); itr++)
-		MEM2_free(itr->second.glyphDataTexture);
+	{
+		if(itr->glyphDataTexture != NULL)
+			MEM2_free(itr->glyphDataTexture);
+	}
 	this->fontData.clear();
+	memset(this->denseGlyphs, 0, sizeof(this->denseGlyphs));
+	this->glyphHashKeys.clear();
+	this->glyphHashValues.clear();
+	this->glyphHashCount = 0;
+
+	for(u32 i = 0; i < this->atlasPages.size(); ++i)
+		MEM2_free(this->atlasPages[i].data);
+	this->atlasPages.clear();
+
+	if(this->kerningTable != NULL)
+		MEM2_free(this->kerningTable);
+	this->kerningTable = NULL;
+
+	this->textRuns.clear();
+}
+
+ftgxCharData **FreeTypeGX::findGlyphSlot(wchar_t charCode)
+{
+	if((uint32_t)charCode < FTGX_DENSE_GLYPHS)
+		return &this->denseGlyphs[charCode];
+
+	/* Keep the open addressed table at most 3/4 full */
+	if((this->glyphHashCount + 1) * 4 > this->glyphHashKeys.size() * 3)
+	{
+		std::vector<wchar_t> oldKeys;
+		std::vector<ftgxCharData *> oldValues;
+		oldKeys.swap(this->glyphHashKeys);
+		oldValues.swap(this->glyphHashValues);
+		u32 size = oldKeys.size() == 0 ? 64 : oldKeys.size() * 2;
+		this->glyphHashKeys.assign(size, 0);
+		this->glyphHashValues.assign(size, (ftgxCharData *)NULL);
+		for(u32 i = 0; i < oldKeys.size(); ++i)
+		{
+			if(oldKeys[i] == 0)
+				continue;
+			u32 pos = ((uint32_t)oldKeys[i] * 2654435761u) & (size - 1);
+			while(this->glyphHashKeys[pos] != 0)
+				pos = (pos + 1) & (size - 1);
+			this->glyphHashKeys[pos] = oldKeys[i];
+			this->glyphHashValues[pos] = oldValues[i];
+		}
+	}
+
+	u32 mask = this->glyphHashKeys.size() - 1;
+	u32 pos = ((uint32_t)charCode * 2654435761u) & mask;
+	while(this->glyphHashKeys[pos] != 0 && this->glyphHashKeys[pos] != charCode)
+		pos = (pos + 1) & mask;
+	if(this->glyphHashKeys[pos] == 0)
+	{
+		this->glyphHashKeys[pos] = charCode;
+		this->glyphHashCount++;
+	}
+	return &this->glyphHashValues[pos];
+}
+
+ftgxCharData *FreeTypeGX::getGlyphData(wchar_t charCode)
+{
+	ftgxCharData **slot = this->findGlyphSlot(charCode);
+	if(*slot == NULL)
+	{
+		ftgxCharData *charData = this->cacheGlyphData(charCode);
+		*slot = charData != NULL ? charData : &this->missingGlyph;
+	}
+	return *slot != &this->missingGlyph ? *slot : NULL;
 }
 
 ftgxCharData *FreeTypeGX::cacheGlyphData(wchar_t charCode)
@@ -103,7 +173,7 @@ ftgxCharData *FreeTypeGX::cacheGlyphData(wchar_t charCode)
 			textureWidth = glyphBitmap->width % 8 == 0 ? glyphBitmap->width : 8 + glyphBitmap->width - (glyphBitmap->width % 8);
 			textureHeight = glyphBitmap->rows % 8 == 0 ? glyphBitmap->rows : 8 + glyphBitmap->rows - (glyphBitmap->rows % 8);
 
-			this->fontData[charCode] = (ftgxCharData)
+			this->fontData.push_back((ftgxCharData)
 			{
 				this->ftSlot->advance.x >> 6,
 				gIndex,
@@ -112,11 +182,24 @@ ftgxCharData *FreeTypeGX::cacheGlyphData(wchar_t charCode)
 				this->ftSlot->bitmap_top,
 				this->ftSlot->bitmap_top,
 				textureHeight - this->ftSlot->bitmap_top,
+				-1,
+				0,
+				0,
 				NULL
-			};
-			this->loadGlyphData(glyphBitmap, &this->fontData[charCode]);
+			});
+			ftgxCharData *charData = &this->fontData.back();
 
-			return &this->fontData[charCode];
+			/* Keep at least one empty texel right and below the glyph so
+			   filtering never picks up its neighbours in the atlas */
+			if(glyphBitmap->width > 0 && glyphBitmap->rows > 0)
+			{
+				uint16_t cellWidth = (glyphBitmap->width + 8) & ~7;
+				uint16_t cellHeight = (glyphBitmap->rows + 8) & ~7;
+				this->allocAtlasCell(cellWidth, cellHeight, charData);
+				this->loadGlyphData(glyphBitmap, charData);
+			}
+
+			return charData;
 		}
 	}
 
@@ -130,7 +213,7 @@ uint16_t FreeTypeGX::cacheGlyphDataComplete()
 	FT_ULong charCode = FT_Get_First_Char( this->ftFace, &gIndex );
 	while( gIndex != 0 )
 	{
-		if(this->cacheGlyphData(charCode) != NULL)
+		if(this->getGlyphData(charCode) != NULL)
 			i++;
 
 		charCode = FT_Get_Next_Char( this->ftFace, charCode, &gIndex );
@@ -139,41 +222,186 @@ uint16_t FreeTypeGX::cacheGlyphDataComplete()
 	return i;
 }
 
+bool FreeTypeGX::allocAtlasCell(uint16_t width, uint16_t height, ftgxCharData *charData)
+{
+	if(width > FTGX_ATLAS_WIDTH || height > FTGX_ATLAS_HEIGHT)
+		return false;
+
+	/* Simple shelf packing, glyphs of one font have similar heights */
+	ftgxAtlasPage *page = this->atlasPages.empty() ? NULL : &this->atlasPages.back();
+	if(page != NULL && page->shelfX + width > FTGX_ATLAS_WIDTH)
+	{
+		page->shelfY += page->shelfHeight;
+		page->shelfX = 0;
+		page->shelfHeight = 0;
+	}
+	if(page == NULL || page->shelfY + height > FTGX_ATLAS_HEIGHT)
+	{
+		uint32_t pageSize = (FTGX_ATLAS_WIDTH * FTGX_ATLAS_HEIGHT) >> 1;
+		uint8_t *pageData = (uint8_t *)MEM2_memalign(32, pageSize);
+		if(pageData == NULL)
+			return false;
+		memset(pageData, 0, pageSize);
+		DCFlushRange(pageData, pageSize);
+
+		ftgxAtlasPage newPage;
+		memset(&newPage, 0, sizeof(newPage));
+		newPage.data = pageData;
+		GX_InitTexObj(&newPage.texObj, pageData, FTGX_ATLAS_WIDTH, FTGX_ATLAS_HEIGHT, GX_TF_I4, GX_CLAMP, GX_CLAMP, GX_FALSE);
+		this->atlasPages.push_back(newPage);
+		page = &this->atlasPages.back();
+	}
+
+	charData->atlasPage = this->atlasPages.size() - 1;
+	charData->atlasX = page->shelfX;
+	charData->atlasY = page->shelfY;
+	page->shelfX += width;
+	if(height > page->shelfHeight)
+		page->shelfHeight = height;
+	return true;
+}
+
+/* Writes an 8 bit coverage bitmap into an I4 texture made of 8x8 texel tiles */
+static void blitGlyphI4(uint8_t *texture, uint16_t texWidth, uint16_t texX, uint16_t texY, const FT_Bitmap *bmp)
+{
+	uint32_t tileRowSize = (texWidth >> 3) << 5;
+	int32_t pitch = bmp->pitch < 0 ? -bmp->pitch : bmp->pitch;
+
+	for(int32_t y = 0; y < (int32_t)bmp->rows; y++)
+	{
+		const uint8_t *src = bmp->buffer + y * pitch;
+		uint8_t *dst = texture + ((texY + y) >> 3) * tileRowSize + (((texY + y) & 7) << 2);
+		for(int32_t x = 0; x < (int32_t)bmp->width; x += 2)
+		{
+			uint8_t texel = src[x] & 0xF0;
+			if(x + 1 < (int32_t)bmp->width)
+				texel |= src[x + 1] >> 4;
+			dst[(((texX + x) >> 3) << 5) + (((texX + x) & 7) >> 1)] = texel;
+		}
+	}
+}
+
 void FreeTypeGX::loadGlyphData(FT_Bitmap *bmp, ftgxCharData *charData)
 {
-    int glyphSize = (charData->textureWidth * charData->textureHeight) >> 1;
+	if(charData->atlasPage >= 0)
+	{
+		/* Draws queued earlier in the frame may still sample the page, let
+		   the GPU finish them before writing to it */
+		if(this->atlasPages[charData->atlasPage].drawn)
+		{
+			GX_DrawDone();
+			for(u32 i = 0; i < this->atlasPages.size(); ++i)
+				this->atlasPages[i].drawn = false;
+		}
+		uint8_t *pageData = this->atlasPages[charData->atlasPage].data;
+		blitGlyphI4(pageData, FTGX_ATLAS_WIDTH, charData->atlasX, charData->atlasY, bmp);
+
+		/* The tile rows touched by the glyph are contiguous in memory */
+		uint32_t tileRowSize = (FTGX_ATLAS_WIDTH >> 3) << 5;
+		uint32_t firstRow = charData->atlasY >> 3;
+		uint32_t lastRow = (charData->atlasY + charData->textureHeight + 7) >> 3;
+		if(lastRow > (FTGX_ATLAS_HEIGHT >> 3))
+			lastRow = FTGX_ATLAS_HEIGHT >> 3;
+		DCFlushRange(pageData + firstRow * tileRowSize, (lastRow - firstRow) * tileRowSize);
+		GX_InvalidateTexAll();
+		return;
+	}
+
+	int glyphSize = (charData->textureWidth * charData->textureHeight) >> 1;
+
+	uint8_t *glyphData = (uint8_t *) MEM2_memalign(32, glyphSize);
+	if(glyphData == NULL)
+		return;
+	memset(glyphData, 0x00, glyphSize);
+	blitGlyphI4(glyphData, charData->textureWidth, 0, 0, bmp);
+	DCFlushRange(glyphData, glyphSize);
+	charData->glyphDataTexture = glyphData;
+}
 
-    uint8_t *glyphData = (uint8_t *) MEM2_alloc(glyphSize);
-	if(glyphData < 0)
+void FreeTypeGX::cacheKerning()
+{
+	this->kerningTable = (int16_t *)MEM2_alloc(FTGX_KERNING_COUNT * FTGX_KERNING_COUNT * sizeof(int16_t));
+	if(this->kerningTable == NULL)
 		return;
-    memset(glyphData, 0x00, glyphSize);
-
-    uint8_t *src = (uint8_t *)bmp->buffer;
-    uint8_t *dst = glyphData;
-    int32_t pos, x1, y1, x, y;
-
-    for(y1 = 0; y1 < bmp->rows; y1 += 8)
-    {
-            for(x1 = 0; x1 < bmp->width; x1 += 8)
-            {
-                    for(y = y1; y < (y1 + 8); y++)
-                    {
-                            for(x = x1; x < (x1 + 8); x += 2, dst++)
-                            {
-                                    if(x >= bmp->width || y >= bmp->rows)
-                                            continue;
-
-                                    pos = y * bmp->width + x;
-                                    *dst = (src[pos] & 0xF0);
-
-                                        if(x+1 < bmp->width)
-                                            *dst |= (src[pos + 1] >> 4);
-                            }
-                    }
-            }
-    }
-    DCFlushRange(glyphData, glyphSize);
-    charData->glyphDataTexture = glyphData;
+
+	FT_UInt indices[FTGX_KERNING_COUNT];
+	for(u32 i = 0; i < FTGX_KERNING_COUNT; ++i)
+		indices[i] = FT_Get_Char_Index(this->ftFace, FTGX_KERNING_FIRST + i);
+
+	FT_Vector pairDelta;
+	for(u32 i = 0; i < FTGX_KERNING_COUNT; ++i)
+	{
+		for(u32 j = 0; j < FTGX_KERNING_COUNT; ++j)
+		{
+			int16_t kerning = 0;
+			if(indices[i] != 0 && indices[j] != 0 &&
+				!FT_Get_Kerning(this->ftFace, indices[i], indices[j], FT_KERNING_DEFAULT, &pairDelta))
+				kerning = pairDelta.x >> 6;
+			this->kerningTable[i * FTGX_KERNING_COUNT + j] = kerning;
+		}
+	}
+}
+
+int16_t FreeTypeGX::getKerning(wchar_t prevCode, const ftgxCharData *prevGlyph, wchar_t charCode, const ftgxCharData *glyph)
+{
+	uint32_t prev = (uint32_t)prevCode - FTGX_KERNING_FIRST;
+	uint32_t cur = (uint32_t)charCode - FTGX_KERNING_FIRST;
+	if(this->kerningTable != NULL && prev < FTGX_KERNING_COUNT && cur < FTGX_KERNING_COUNT)
+		return this->kerningTable[prev * FTGX_KERNING_COUNT + cur];
+
+	FT_Vector pairDelta;
+	if(FT_Get_Kerning(this->ftFace, prevGlyph->glyphIndex, glyph->glyphIndex, FT_KERNING_DEFAULT, &pairDelta))
+		return 0;
+	return pairDelta.x >> 6;
+}
+
+const ftgxTextRun &FreeTypeGX::getTextRun(const wchar_t *text)
+{
+	/* FNV-1a over the characters */
+	uint32_t hash = 2166136261u;
+	size_t strLength = 0;
+	for(; text[strLength] != 0; strLength++)
+		hash = (hash ^ (uint32_t)text[strLength]) * 16777619u;
+
+	std::map<uint32_t, ftgxTextRun>::iterator itr = this->textRuns.find(hash);
+	if(itr != this->textRuns.end())
+	{
+		if(itr->second.text.size() == strLength && wmemcmp(itr->second.text.c_str(), text, strLength) == 0)
+			return itr->second;
+	}
+	else if(this->textRuns.size() >= FTGX_MAX_TEXT_RUNS)
+		this->textRuns.clear();
+
+	/* New string or hash collision, lay it out again */
+	ftgxTextRun &run = this->textRuns[hash];
+	run.text.assign(text, strLength);
+	run.glyphs.clear();
+	run.glyphs.reserve(strLength);
+
+	uint16_t x_pos = 0, strMax = 0, strMin = 0;
+	ftgxCharData *prevGlyph = NULL;
+	wchar_t prevCode = 0;
+	for(size_t i = 0; i < strLength; i++)
+	{
+		ftgxCharData *glyphData = this->getGlyphData(text[i]);
+		if(glyphData == NULL)
+			continue;
+
+		if(this->ftKerningEnabled && prevGlyph != NULL)
+			x_pos += this->getKerning(prevCode, prevGlyph, text[i], glyphData);
+
+		ftgxRunGlyph runGlyph = { x_pos, glyphData };
+		run.glyphs.push_back(runGlyph);
+
+		x_pos += glyphData->glyphAdvanceX;
+		strMax = glyphData->renderOffsetMax > strMax ? glyphData->renderOffsetMax : strMax;
+		strMin = glyphData->renderOffsetMin > strMin ? glyphData->renderOffsetMin : strMin;
+		prevGlyph = glyphData;
+		prevCode = text[i];
+	}
+	run.width = x_pos;
+	run.offset = (ftgxDataOffset){strMax, strMin};
+	return run;
 }
 
 uint16_t FreeTypeGX::getStyleOffsetWidth(uint16_t width, uint16_t format)
@@ -200,48 +428,86 @@ uint16_t FreeTypeGX::getStyleOffsetHeight(ftgxDataOffset offset, uint16_t format
 
 uint16_t FreeTypeGX::drawText(uint16_t x, uint16_t y, const wchar_t *text, GXColor color, uint16_t textStyle)
 {
-	uint16_t strLength = wcslen(text);
-	uint16_t x_pos = x, printed = 0;
+	const ftgxTextRun &run = this->getTextRun(text);
 	uint16_t x_offset = 0, y_offset = 0;
 	GXTexObj glyphTexture;
-	FT_Vector pairDelta;
 	
 	if(textStyle & FTGX_JUSTIFY_MASK)
-		x_offset = this->getStyleOffsetWidth(this->getWidth(text), textStyle);
+		x_offset = this->getStyleOffsetWidth(run.width, textStyle);
 	if(textStyle & FTGX_ALIGN_MASK) 
-		y_offset = this->getStyleOffsetHeight(this->getOffset(text), textStyle);
+		y_offset = this->getStyleOffsetHeight(run.offset, textStyle);
 
 	GX_SetBlendMode(GX_BM_BLEND, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA, GX_LO_CLEAR);
 
-	for (uint16_t i = 0; i < strLength; i++) 
+	const f32 atlasScaleX = 1.0f / FTGX_ATLAS_WIDTH;
+	const f32 atlasScaleY = 1.0f / FTGX_ATLAS_HEIGHT;
+	size_t count = run.glyphs.size();
+	size_t i = 0;
+	while(i < count)
 	{
-		ftgxCharData* glyphData = NULL;
-		if( this->fontData.find(text[i]) != this->fontData.end())
-			glyphData = &this->fontData[text[i]];
+		/* Draw consecutive glyphs of the same atlas page as one batch */
+		const ftgxCharData *first = run.glyphs[i].glyph;
+		size_t end = i + 1;
+		if(first->atlasPage >= 0)
+		{
+			while(end < count && end - i < FTGX_MAX_BATCH && run.glyphs[end].glyph->atlasPage == first->atlasPage)
+				end++;
+			GX_LoadTexObj(&this->atlasPages[first->atlasPage].texObj, GX_TEXMAP0);
+			this->atlasPages[first->atlasPage].drawn = true;
+		}
 		else
-			glyphData = this->cacheGlyphData(text[i]);
-
-		if(glyphData != NULL)
 		{
-			
-			if(this->ftKerningEnabled && i)
+			if(first->glyphDataTexture == NULL)
 			{
-				FT_Get_Kerning( this->ftFace, this->fontData[text[i - 1]].glyphIndex, glyphData->glyphIndex, FT_KERNING_DEFAULT, &pairDelta);
-				x_pos += pairDelta.x >> 6;
+				i++;
+				continue;
 			}
+			GX_InitTexObj(&glyphTexture, first->glyphDataTexture, first->textureWidth, first->textureHeight, GX_TF_I4, GX_CLAMP, GX_CLAMP, GX_FALSE);
+			GX_LoadTexObj(&glyphTexture, GX_TEXMAP0);
+		}
 
-			GX_InitTexObj(&glyphTexture, glyphData->glyphDataTexture, glyphData->textureWidth, glyphData->textureHeight, GX_TF_I4, GX_CLAMP, GX_CLAMP, GX_FALSE);
-			this->copyTextureToFramebuffer(&glyphTexture, glyphData->textureWidth, glyphData->textureHeight, x_pos - x_offset, y - glyphData->renderOffsetY - y_offset, color);
-
-			x_pos += glyphData->glyphAdvanceX;
-			printed++;
+		GX_Begin(GX_QUADS, GX_VTXFMT0, (end - i) * 4);
+		for(; i < end; i++)
+		{
+			const ftgxCharData *glyphData = run.glyphs[i].glyph;
+			f32 s0 = 0.0f, t0 = 0.0f, s1 = 1.0f, t1 = 1.0f;
+			if(glyphData->atlasPage >= 0)
+			{
+				s0 = glyphData->atlasX * atlasScaleX;
+				t0 = glyphData->atlasY * atlasScaleY;
+				s1 = (glyphData->atlasX + glyphData->textureWidth) * atlasScaleX;
+				t1 = (glyphData->atlasY + glyphData->textureHeight) * atlasScaleY;
+			}
+			int16_t screenX = (uint16_t)(x + run.glyphs[i].x) - x_offset;
+			int16_t screenY = y - glyphData->renderOffsetY - y_offset;
+			float x0 = ((float)screenX + xPos) * xScale;
+			float y0 = ((float)screenY + yPos) * yScale;
+			float x1 = ((float)screenX + xPos + glyphData->textureWidth) * xScale;
+			float y1 = ((float)screenY + yPos + glyphData->textureHeight) * yScale;
+
+			GX_Position3f32(x0, y0, 0);
+			GX_Color4u8(color.r, color.g, color.b, color.a);
+			GX_TexCoord2f32(s0, t0);
+
+			GX_Position3f32(x1, y0, 0);
+			GX_Color4u8(color.r, color.g, color.b, color.a);
+			GX_TexCoord2f32(s1, t0);
+
+			GX_Position3f32(x1, y1, 0);
+			GX_Color4u8(color.r, color.g, color.b, color.a);
+			GX_TexCoord2f32(s1, t1);
+
+			GX_Position3f32(x0, y1, 0);
+			GX_Color4u8(color.r, color.g, color.b, color.a);
+			GX_TexCoord2f32(s0, t1);
 		}
+		GX_End();
 	}
 	
 	if(textStyle & FTGX_STYLE_MASK)
-		this->drawTextFeature(x - x_offset, y, this->getWidth(text), this->getOffset(text), textStyle, color);
+		this->drawTextFeature(x - x_offset, y, run.width, run.offset, textStyle, color);
 	
-	return printed;
+	return count;
 }
 
 void FreeTypeGX::drawTextFeature(uint16_t x, uint16_t y, uint16_t width,  ftgxDataOffset offsetData, uint16_t format, GXColor color)
@@ -257,30 +523,7 @@ void FreeTypeGX::drawTextFeature(uint16_t x, uint16_t y, uint16_t width,  ftgxDa
 
 uint16_t FreeTypeGX::getWidth(const wchar_t *text)
 {
-	uint16_t strLength = wcslen(text);
-	uint16_t strWidth = 0;
-	FT_Vector pairDelta;
-	
-	for (uint16_t i = 0; i < strLength; i++)
-	{
-		ftgxCharData* glyphData = NULL;
-		if( this->fontData.find(text[i]) != this->fontData.end())
-			glyphData = &this->fontData[text[i]];
-		else
-			glyphData = this->cacheGlyphData(text[i]);
-		if(glyphData != NULL)
-		{
-			if(this->ftKerningEnabled && (i > 0))
-			{
-				FT_Get_Kerning( this->ftFace, this->fontData[text[i - 1]].glyphIndex, glyphData->glyphIndex, FT_KERNING_DEFAULT, &pairDelta);
-				strWidth += pairDelta.x >> 6;
-			}
-
-			strWidth += glyphData->glyphAdvanceX;
-		}
-	}
-
-	return strWidth;
+	return this->getTextRun(text).width;
 }
 
 uint16_t FreeTypeGX::getHeight(const wchar_t *text)
@@ -291,52 +534,7 @@ uint16_t FreeTypeGX::getHeight(const wchar_t *text)
 
 ftgxDataOffset FreeTypeGX::getOffset(const wchar_t *text)
 {
-	uint16_t strLength = wcslen(text);
-	uint16_t strMax = 0, strMin = 0;
-	
-	for (uint16_t i = 0; i < strLength; i++)
-	{
-		ftgxCharData* glyphData = NULL;
-		if( this->fontData.find(text[i]) != this->fontData.end())
-			glyphData = &this->fontData[text[i]];
-		else
-			glyphData = this->cacheGlyphData(text[i]);
-
-		if(glyphData != NULL)
-		{
-			strMax = glyphData->renderOffsetMax > strMax ? glyphData->renderOffsetMax : strMax;
-			strMin = glyphData->renderOffsetMin > strMin ? glyphData->renderOffsetMin : strMin;
-		}
-	}
-	return (ftgxDataOffset){strMax, strMin};
-}
-
-void FreeTypeGX::copyTextureToFramebuffer(GXTexObj *texObj, uint16_t texWidth, uint16_t texHeight, int16_t screenX, int16_t screenY, GXColor color)
-{
-	f32	f32TexWidth = texWidth,	f32TexHeight = texHeight;
-	float x = (float)screenX + xPos;
-	float y = (float)screenY + yPos;
-
-	GX_LoadTexObj(texObj, GX_TEXMAP0);
-	GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
-
-	GX_Position3f32(x * xScale, y * yScale, 0);
-	GX_Color4u8(color.r, color.g, color.b, color.a);
-	GX_TexCoord2f32(0.0f, 0.0f);
-	
-	GX_Position3f32((f32TexWidth + x) * xScale, y * yScale, 0);
-	GX_Color4u8(color.r, color.g, color.b, color.a);
-	GX_TexCoord2f32(1.0f, 0.0f);
-	
-	GX_Position3f32((f32TexWidth + x) * xScale, (f32TexHeight + y) * yScale, 0);
-	GX_Color4u8(color.r, color.g, color.b, color.a);
-	GX_TexCoord2f32(1.0f, 1.0f);
-	
-	GX_Position3f32(x * xScale, (f32TexHeight + y) * yScale, 0);
-	GX_Color4u8(color.r, color.g, color.b, color.a);
-	GX_TexCoord2f32(0.0f, 1.0f);
-
-	GX_End();
+	return this->getTextRun(text).offset;
 }
 
 void FreeTypeGX::copyFeatureToFramebuffer(uint16_t featureWidth, uint16_t featureHeight, int16_t screenX, int16_t screenY, GXColor color)
@@ -32,6 +32,9 @@
 #include <string.h>
 #include <wchar.h>
 #include <map>
+#include <deque>
+#include <vector>
+#include <string>
 
 typedef struct ftgxCharData_ {
 	uint16_t glyphAdvanceX;		/**< Character glyph X coordinate advance in pixels. */
@@ -44,7 +47,11 @@ typedef struct ftgxCharData_ {
 	uint16_t renderOffsetMax;	/**< Texture Y axis bearing maximum value. */
 	uint16_t renderOffsetMin;	/**< Texture Y axis bearing minimum value. */
 
-	uint8_t* glyphDataTexture;	/**< Glyph texture bitmap data buffer. */
+	int16_t atlasPage;			/**< Atlas page holding the glyph, -1 if it has its own texture. */
+	uint16_t atlasX;			/**< X position of the glyph in its atlas page. */
+	uint16_t atlasY;			/**< Y position of the glyph in its atlas page. */
+
+	uint8_t* glyphDataTexture;	/**< Glyph texture bitmap data buffer, only used outside the atlas. */
 } ftgxCharData;
 
 typedef struct ftgxDataOffset_ {
@@ -52,6 +59,35 @@ typedef struct ftgxDataOffset_ {
 	uint16_t min;	/**< Minimum data offset. */
 } ftgxDataOffset;
 
+typedef struct ftgxAtlasPage_ {
+	uint8_t *data;			/**< I4 texture data shared by the glyphs of the page. */
+	GXTexObj texObj;		/**< Texture object bound to the page data. */
+	uint16_t shelfX;		/**< Next free X position on the current shelf. */
+	uint16_t shelfY;		/**< Y position of the current shelf. */
+	uint16_t shelfHeight;	/**< Height of the tallest glyph on the current shelf. */
+	bool drawn;				/**< Set when queued draws may still sample the page. */
+} ftgxAtlasPage;
+
+typedef struct ftgxRunGlyph_ {
+	uint16_t x;				/**< Pen position of the glyph relative to the start of the run. */
+	ftgxCharData *glyph;	/**< Cached glyph drawn at that position. */
+} ftgxRunGlyph;
+
+typedef struct ftgxTextRun_ {
+	std::wstring text;					/**< String the run was laid out for. */
+	uint16_t width;						/**< Width of the string including kerning. */
+	ftgxDataOffset offset;				/**< Vertical extents of the string. */
+	std::vector<ftgxRunGlyph> glyphs;	/**< Glyphs of the string with their pen positions. */
+} ftgxTextRun;
+
+#define FTGX_ATLAS_WIDTH		512		/**< Width of an atlas page, multiple of 8. */
+#define FTGX_ATLAS_HEIGHT		256		/**< Height of an atlas page, multiple of 8. */
+#define FTGX_DENSE_GLYPHS		0x180	/**< Character codes below this are looked up in a flat table. */
+#define FTGX_KERNING_FIRST		0x20	/**< First character of the precomputed kerning table. */
+#define FTGX_KERNING_COUNT		0x5F	/**< Number of characters in the precomputed kerning table. */
+#define FTGX_MAX_TEXT_RUNS		256		/**< Run cache entries kept before the cache is flushed. */
+#define FTGX_MAX_BATCH			1024	/**< Maximum number of glyph quads per GX_Begin. */
+
 #define FTGX_NULL				0x0000
 #define FTGX_JUSTIFY_LEFT		0x0001
 #define FTGX_JUSTIFY_CENTER		0x0002
@@ -83,18 +119,34 @@ class FreeTypeGX {
 		float xPos;
 		float yPos;
 
-		std::map<wchar_t, ftgxCharData> fontData; /**< Map which holds the glyph data structures for the corresponding characters. */
+		std::deque<ftgxCharData> fontData;				/**< Storage for the cached glyphs, entries never move once added. */
+		ftgxCharData *denseGlyphs[FTGX_DENSE_GLYPHS];	/**< Glyph lookup table for the common character codes. */
+		std::vector<wchar_t> glyphHashKeys;				/**< Open addressed keys for the remaining character codes, 0 is empty. */
+		std::vector<ftgxCharData *> glyphHashValues;	/**< Glyphs matching glyphHashKeys. */
+		uint32_t glyphHashCount;						/**< Number of used entries in the glyph hash. */
+		ftgxCharData missingGlyph;						/**< Marker for characters the font cannot render. */
+
+		std::vector<ftgxAtlasPage> atlasPages;	/**< Shared textures the glyphs are packed into. */
+
+		int16_t *kerningTable;	/**< Precomputed kerning between printable ASCII characters, NULL without kerning. */
+
+		std::map<uint32_t, ftgxTextRun> textRuns;	/**< Laid out strings keyed by the hash of their text. */
 
 		static uint16_t getStyleOffsetWidth(uint16_t width, uint16_t format);
 		static uint16_t getStyleOffsetHeight(ftgxDataOffset offset, uint16_t format);
 
-		void copyTextureToFramebuffer(GXTexObj *texObj, uint16_t texWidth, uint16_t texHeight, int16_t screenX, int16_t screenY, GXColor color);
 		void copyFeatureToFramebuffer(uint16_t featureWidth, uint16_t featureHeight, int16_t screenX, int16_t screenY, GXColor color);
 
 		void unloadFont();
+		ftgxCharData **findGlyphSlot(wchar_t charCode);
+		ftgxCharData *getGlyphData(wchar_t charCode);
 		ftgxCharData *cacheGlyphData(wchar_t charCode);
 		uint16_t cacheGlyphDataComplete();
+		bool allocAtlasCell(uint16_t width, uint16_t height, ftgxCharData *charData);
 		void loadGlyphData(FT_Bitmap *bmp, ftgxCharData *charData);
+		void cacheKerning();
+		int16_t getKerning(wchar_t prevCode, const ftgxCharData *prevGlyph, wchar_t charCode, const ftgxCharData *glyph);
+		const ftgxTextRun &getTextRun(const wchar_t *text);
 		void drawTextFeature(uint16_t x, uint16_t y, uint16_t width, ftgxDataOffset offsetData, uint16_t format, GXColor color);
 		
 	public:
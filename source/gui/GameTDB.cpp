@@ -958,6 +958,35 @@ int GameTDB::GetCaseVersions(const char *id)
 	return altcase;
 }
 
+int GameTDB::GetRomCRCs(const char *id, vector<u32> & crc_list)
+{
+	crc_list.clear();
+	if(!id)
+		return -1;
+
+	char *data = GetGameNode(id);
+	if(!data)
+		return -1;
+
+	char *RomNode = strstr(data, "<rom ");
+	while(RomNode)
+	{
+		char *end = strstr(RomNode, "/>");
+		if(!end)
+			break;
+		*end = '\0';
+
+		char *crcField = strstr(RomNode, "crc=\"");
+		if(crcField)
+			crc_list.push_back(strtoul(crcField + strlen("crc=\""), NULL, 16));
+
+		RomNode = strstr(end + 2, "<rom ");
+	}
+	MEM2_free(data);
+
+	return crc_list.size();
+}
+
 bool GameTDB::IsLoaded()
 {
 	return isLoaded;
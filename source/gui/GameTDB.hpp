@@ -112,6 +112,8 @@ public:
 	//! Returns the color in RGB (first 3 bytes)
 	unsigned int GetCaseColor(const char * id);
 	int GetCaseVersions(const char * id);
+	//! Get the CRC32 of every known dump of a disc from its rom entries
+	int GetRomCRCs(const char * id, vector<u32> & crc_list);
 	//! Convert a specific game rating to a string
 	static const char * RatingToString(int rating);
 	//! Get the version of the gametdb xml database
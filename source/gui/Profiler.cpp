@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <ogc/machine/processor.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "Profiler.hpp"
+#include "gecko/gecko.hpp"
+
+#ifdef PROFILER
+
+CProfiler Profiler;
+
+static const char *zoneNames[PROF_ZONES] = {
+	"cf tick", "btn tick", "fanart", "bg", "scene", "text",
+	"overlay", "render", "covers", "sound", "frame"
+};
+
+void CProfiler::Init(bool is50hz)
+{
+	for(u32 i = 0; i < PROF_ZONES; ++i)
+		m_acc[i] = 0;
+	m_head = 0;
+	m_count = 0;
+	m_frames = 0;
+	m_dropped = 0;
+	m_periodUs = is50hz ? 20000 : 16683;
+	m_lastFrame = 0;
+}
+
+void CProfiler::NextFrame(void)
+{
+	u64 now = gettime();
+	u64 acc[PROF_ZONES];
+	u32 level;
+
+	/* Other threads add into the accumulators, take them in one go */
+	_CPU_ISR_Disable(level);
+	for(u32 i = 0; i < PROF_ZONES; ++i)
+	{
+		acc[i] = m_acc[i];
+		m_acc[i] = 0;
+	}
+	_CPU_ISR_Restore(level);
+
+	if(m_lastFrame != 0)
+	{
+		u32 *sample = m_samples[m_head];
+		for(u32 i = 0; i < PROF_FRAME; ++i)
+			sample[i] = ticks_to_microsecs(acc[i]);
+		sample[PROF_FRAME] = ticks_to_microsecs(diff_ticks(m_lastFrame, now));
+		/* Anything well past one retrace means at least one missed vsync */
+		if(sample[PROF_FRAME] > m_periodUs + m_periodUs / 2)
+			m_dropped += (sample[PROF_FRAME] + m_periodUs / 2) / m_periodUs - 1;
+		m_head = (m_head + 1) % PROF_FRAMES;
+		if(m_count < PROF_FRAMES)
+			++m_count;
+		++m_frames;
+	}
+	m_lastFrame = now;
+}
+
+void CProfiler::Add(u32 zone, u64 ticks)
+{
+	u32 level;
+
+	_CPU_ISR_Disable(level);
+	m_acc[zone] += ticks;
+	_CPU_ISR_Restore(level);
+}
+
+void CProfiler::GetStats(u32 zone, u32 &p50, u32 &p99)
+{
+	u32 values[PROF_FRAMES];
+
+	p50 = p99 = 0;
+	if(m_count == 0)
+		return;
+	for(u32 i = 0; i < m_count; ++i)
+		values[i] = m_samples[i][zone];
+	std::nth_element(values, values + m_count / 2, values + m_count);
+	p50 = values[m_count / 2];
+	u32 n = m_count * 99 / 100;
+	std::nth_element(values, values + n, values + m_count);
+	p99 = values[n];
+}
+
+void CProfiler::Dump(void)
+{
+	u32 p50, p99;
+
+	gprintf("Profiler: %u frames, %u dropped\n", m_frames, m_dropped);
+	for(u32 i = 0; i < PROF_ZONES; ++i)
+	{
+		GetStats(i, p50, p99);
+		gprintf("  %-8s p50 %6uus p99 %6uus\n", zoneNames[i], p50, p99);
+	}
+}
+
+const char *CProfiler::ZoneName(u32 zone)
+{
+	return zone < PROF_ZONES ? zoneNames[zone] : "";
+}
+
+#endif
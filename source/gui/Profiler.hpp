@@ -0,0 +1,75 @@
+#ifndef _PROFILER_HPP
+#define _PROFILER_HPP
+//#define PROFILER
+
+#include <gctypes.h>
+
+/* Zones timed by the profiler, PROF_FRAME holds the whole frame time */
+enum ProfZone
+{
+	PROF_CF_TICK = 0,
+	PROF_BTN_TICK,
+	PROF_FANART,
+	PROF_BG,
+	PROF_SCENE,
+	PROF_TEXT,
+	PROF_OVERLAY,
+	PROF_RENDER,
+	PROF_COVERS,
+	PROF_SOUND,
+	PROF_FRAME,
+	PROF_ZONES
+};
+
+#define PROF_FRAMES		256
+
+class CProfiler
+{
+public:
+	void Init(bool is50hz);
+	/* Closes the current frame and starts recording the next one */
+	void NextFrame(void);
+	/* Adds ticks to a zone of the current frame, safe to call from any thread */
+	void Add(u32 zone, u64 ticks);
+	/* Median and 99th percentile in microseconds over the recorded frames */
+	void GetStats(u32 zone, u32 &p50, u32 &p99);
+	u32 Frames(void) const { return m_frames; }
+	u32 DroppedFrames(void) const { return m_dropped; }
+	void Dump(void);
+	static const char *ZoneName(u32 zone);
+private:
+	u64 m_acc[PROF_ZONES];
+	u32 m_samples[PROF_FRAMES][PROF_ZONES];
+	u32 m_head;
+	u32 m_count;
+	u32 m_frames;
+	u32 m_dropped;
+	u32 m_periodUs;
+	u64 m_lastFrame;
+};
+
+extern CProfiler Profiler;
+
+#ifdef PROFILER
+#include <ogc/lwp_watchdog.h>
+
+class CProfileZone
+{
+public:
+	CProfileZone(u32 zone) : m_zone(zone), m_start(gettime()) { }
+	~CProfileZone() { Profiler.Add(m_zone, gettime() - m_start); }
+private:
+	u32 m_zone;
+	u64 m_start;
+};
+
+#define PROFILE_JOIN2(a, b)	a##b
+#define PROFILE_JOIN(a, b)	PROFILE_JOIN2(a, b)
+#define PROFILE_ZONE(z)		CProfileZone PROFILE_JOIN(profZone, __LINE__)(z)
+#define PROFILE_FRAME()		Profiler.NextFrame()
+#else
+#define PROFILE_ZONE(z)
+#define PROFILE_FRAME()
+#endif
+
+#endif
@@ -46,6 +46,11 @@ WiiMovie::WiiMovie(const char * filepath)
 	volume = 128;
 	ThreadStack = NULL;
 	PlayThread = LWP_THREAD_NULL;
+	LoadSlot = -1;
+	ShownFrame = -1;
+	LoadedFrame = (u32)-1;
+	for(u32 i = 0; i < FRAME_POOL; ++i)
+		FreeFrames.Push(i);
 
 	gprintf("Opening video '%s'\n", filepath);
 
@@ -112,7 +117,9 @@ WiiMovie::~WiiMovie()
 
 	soundBuffer = NULL;
 
-	Frames.clear();
+	for(u32 i = 0; i < FRAME_POOL; ++i)
+		TexHandle.Cleanup(FramePool[i]);
+	VideoF.dealloc();
 
 	if(Video)
 		closeVideo(Video);
@@ -152,6 +159,7 @@ void WiiMovie::Stop()
 
 	if(PlayThreadStack != NULL)
 		free(PlayThreadStack);
+	PlayThreadStack = NULL;
 }
 
 void WiiMovie::SetVolume(int vol)
@@ -227,8 +235,7 @@ void WiiMovie::FrameLoadLoop()
 {
 	while(!ExitRequested)
 	{
-		LoadNextFrame();
-		while(Frames.size() > FRAME_BUFFERS && !ExitRequested)
+		if(!LoadNextFrame())
 			usleep(100);
 	}
 }
@@ -300,18 +307,33 @@ void WiiMovie::ReadNextFrame()
 	}
 }
 
-void WiiMovie::LoadNextFrame()
+bool WiiMovie::LoadNextFrame()
 {
 	if(!Video || !Playing)
-		return;
+		return false;
+
+	/* Only GetNextFrame gives textures back, keep the slot until it holds a frame */
+	if(LoadSlot < 0)
+	{
+		u32 slot;
+		if(!FreeFrames.Pop(slot))
+			return false;
+		LoadSlot = slot;
+	}
 
-	VideoFrame VideoF;
 	LWP_MutexLock(mutex);
+	u32 frameNr = VideoFrameCount;
+	/* Nothing new until the read thread moves on */
+	if(frameNr == LoadedFrame)
+	{
+		LWP_MutexUnlock(mutex);
+		return false;
+	}
 	Video->getCurrentFrame(VideoF);
 	LWP_MutexUnlock(mutex);
 
 	if(!VideoF.getData())
-		return;
+		return false;
 
 	if(width != VideoF.getWidth())
 	{
@@ -327,17 +349,33 @@ void WiiMovie::LoadNextFrame()
 		}
 	}
 
-	TexData frame;
-	if(TexHandle.fromTHP(frame, VideoF.getData(), VideoF.getWidth(), VideoF.getHeight()) == TE_OK)
-		Frames.push_back(frame);
-	VideoF.dealloc();
+	if(TexHandle.fromTHP(FramePool[LoadSlot], VideoF.getData(), VideoF.getWidth(), VideoF.getHeight()) != TE_OK)
+		return false;
+	LoadedFrame = frameNr;
+	ReadyFrames.Push(LoadSlot);
+	LoadSlot = -1;
+	return true;
 }
 
 bool WiiMovie::GetNextFrame(TexData *tex)
 {
-	if(!Video || !Playing || Frames.size() == 0)
+	if(!Video || !Playing)
 		return false;
-	*tex = Frames.at(0);
-	Frames.erase(Frames.begin());
+
+	/* Skip to the newest frame. The last frame has been rendered and the
+	   older ones never will be, so they can all be loaded into again */
+	u32 slot;
+	while(ReadyFrames.Pop(slot))
+	{
+		if(ShownFrame >= 0)
+			FreeFrames.Push(ShownFrame);
+		ShownFrame = slot;
+	}
+	/* Nothing decoded yet, tex keeps what it shows. The first frame gets
+	   half a second */
+	if(ShownFrame < 0)
+		return PlayTime.elapsed() < 0.5f;
+	/* Until the next frame is ready the current one is shown again */
+	*tex = FramePool[ShownFrame];
 	return true;
 }
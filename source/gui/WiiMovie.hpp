@@ -8,6 +8,40 @@
 
 using namespace std;
 
+#define FRAME_POOL	4
+
+/* Single producer, single consumer ring of frame pool indices. Only Push
+   moves the tail and only Pop the head, so the two threads need no lock */
+class FrameQueue
+{
+public:
+	FrameQueue() : head(0), tail(0) { }
+	bool Push(u32 frame)
+	{
+		if(tail - head >= FRAME_POOL)
+			return false;
+		slots[tail % FRAME_POOL] = frame;
+		__sync_synchronize();
+		tail = tail + 1;
+		return true;
+	}
+	bool Pop(u32 &frame)
+	{
+		if(head == tail)
+			return false;
+		__sync_synchronize();
+		frame = slots[head % FRAME_POOL];
+		__sync_synchronize();
+		head = head + 1;
+		return true;
+	}
+	u32 Size() const { return tail - head; }
+private:
+	u32 slots[FRAME_POOL];
+	volatile u32 head;
+	volatile u32 tail;
+};
+
 class WiiMovie
 {
 public:
@@ -20,13 +54,14 @@ public:
 	void SetFullscreen();
 	void SetFrameSize(int w, int h);
 	void SetAspectRatio(float Aspect);
+	/* Never waits, tex is left alone until the first frame is ready */
 	bool GetNextFrame(TexData *tex);
 protected:
 	static void * UpdateThread(void *arg);
 	static void * PlayingThread(void *arg);
 	void FrameLoadLoop();
 	void ReadNextFrame();
-	void LoadNextFrame();
+	bool LoadNextFrame();
 
 	u8 * ThreadStack;
 	u8 * PlayThreadStack;
@@ -39,7 +74,15 @@ protected:
 	float fps;
 	Timer PlayTime;
 	u32 VideoFrameCount;
-	vector<TexData> Frames;
+	/* Textures are converted into by the playing thread and shown through
+	   GetNextFrame, they go back to FreeFrames once the next one is shown */
+	TexData FramePool[FRAME_POOL];
+	FrameQueue FreeFrames;
+	FrameQueue ReadyFrames;
+	s32 LoadSlot;
+	s32 ShownFrame;
+	u32 LoadedFrame;
+	VideoFrame VideoF;
 	bool Playing;
 	bool ExitRequested;
 	bool fullScreen;
@@ -10,6 +10,7 @@
 
 #include "coverflow.hpp"
 #include "pngu.h"
+#include "Profiler.hpp"
 #include "boxmesh.hpp"
 #include "lockMutex.hpp"
 #include "fonts.h"
@@ -66,7 +67,10 @@ CCoverFlow::CItem::CItem(dir_discHdr *itemHdr, int playcount, unsigned int lastP
 	playcount(playcount),
 	lastPlayed(lastPlayed),
 	boxTexture(false),
-	state(STATE_Loading)
+	hqTexture(false),
+	lowTexture(false),
+	state(STATE_Loading),
+	resHandle(-1)
 {
 
 }
@@ -175,6 +179,7 @@ CCoverFlow::CCoverFlow(void)
 	m_defcovers_loaded = false;
 	m_loadingCovers = false;
 	m_coverThrdBusy = false;
+	m_coverNeed = 0;
 	m_renderTex = false;
 	m_renderingTex = NULL;
 	m_moved = false;
@@ -633,9 +638,10 @@ void CCoverFlow::stopCoverLoader(bool empty)
 		coverLoaderThread = LWP_THREAD_NULL;
 		if(empty)
 		{
+			LockMutex lock(m_mutex);
 			for(u32 i = 0; i < m_items.size(); ++i)
 			{
-				TexHandle.Cleanup(m_items[i].texture);
+				_freeCoverTexture(i);
 				m_items[i].state = STATE_Loading;
 			}
 		}
@@ -650,6 +656,7 @@ void CCoverFlow::startCoverLoader(void)
 
 	m_loadingCovers = true;
 	m_moved = true;
+	m_queue.reset();
 
 	LWP_CreateThread(&coverLoaderThread, (void*(*)(void*))CCoverFlow::_coverLoader, (void*)this, NULL, 0, 30);
 	//gprintf("Coverflow started!\n");
@@ -661,7 +668,11 @@ void CCoverFlow::clear(void)
 	if(m_covers != NULL)
 		MEM2_free(m_covers);
 	m_covers = NULL;
+	LWP_MutexLock(m_mutex);
+	for(u32 i = 0; i < m_items.size(); ++i)
+		_freeCoverTexture(i);
 	m_items.clear();
+	LWP_MutexUnlock(m_mutex);
 }
 
 void CCoverFlow::shutdown(void)
@@ -1292,6 +1303,7 @@ const TexData *CCoverFlow::_coverTexture(int i)
 {
 	if(m_items[i].texture.data == NULL)
 		return (m_items[i].state == STATE_Loading) ? m_loadingTexture : m_noCoverTexture;
+	Residency.Touch(m_items[i].resHandle);
 	return &m_items[i].texture;
 }
 
@@ -1945,6 +1957,7 @@ void CCoverFlow::_left(int repeatDelay, u32 step)
 	if (m_delay > 0) return;
 
 	m_moved = true;
+	m_queue.moved(-(int)step, m_tickCount);
 	m_delay = repeatDelay;
 	m_covers[m_range / 2].angle += _coverMovesA();
 	m_covers[m_range / 2].pos += _coverMovesP();
@@ -1986,6 +1999,7 @@ void CCoverFlow::_right(int repeatDelay, u32 step)
 	if (m_delay > 0) return;
 
 	m_moved = true;
+	m_queue.moved((int)step, m_tickCount);
 	m_delay = repeatDelay;
 	m_covers[m_range / 2].angle += _coverMovesA();
 	m_covers[m_range / 2].pos += _coverMovesP();
@@ -2625,8 +2639,7 @@ bool CCoverFlow::_loadCoverTexPNG(u32 i, bool box, bool hq, bool blankBoxCover)
 		return false;
 
 	LWP_MutexLock(m_mutex);
-	TexHandle.Cleanup(m_items[i].texture);
-	m_items[i].texture = tex;
+	_setCoverTexture(i, tex);
 	m_items[i].boxTexture = box;
 	m_items[i].state = STATE_Ready;
 	LWP_MutexUnlock(m_mutex);
@@ -2748,15 +2761,81 @@ void CCoverFlow::_dropHQLOD(int i)
 
 	if (!CCoverFlow::_calcTexLQLOD(newTex)) return;
 
+	_keepLowerLODs(i, newTex);
+}
+
+/* Replaces the texture with its mip levels from newTex size down, m_mutex held.
+   The levels are copied out, the old texture may still be drawn this frame. */
+bool CCoverFlow::_keepLowerLODs(u32 i, TexData &newTex)
+{
+	const TexData &prevTex = m_items[i].texture;
 	u32 prevTexLen = fixGX_GetTexBufferSize(prevTex.width, prevTex.height, prevTex.format, prevTex.maxLOD > 0 ? GX_TRUE : GX_FALSE, prevTex.maxLOD);
 	u32 newTexLen = fixGX_GetTexBufferSize(newTex.width, newTex.height, newTex.format, newTex.maxLOD > 0 ? GX_TRUE : GX_FALSE, newTex.maxLOD);
 	newTex.data = (u8*)MEM2_alloc(newTexLen);
 	if(newTex.data == NULL)
-		return;
+		return false;
 	memcpy(newTex.data, prevTex.data + (prevTexLen - newTexLen), newTexLen);
+	newTex.dataSize = newTexLen;
 	DCFlushRange(newTex.data, newTexLen);
+	_setCoverTexture(i, newTex);
+	return true;
+}
+
+/* Callers hold m_mutex */
+void CCoverFlow::_setCoverTexture(u32 i, const TexData &tex)
+{
+	TexHandle.Cleanup(m_items[i].texture);
+	m_items[i].texture = tex;
+	m_items[i].lowTexture = false;
+	u32 size = CResidency::TexSize(tex);
+	if(m_items[i].resHandle < 0)
+		m_items[i].resHandle = Residency.Add(RES_COVER, size, this, i, CCoverFlow::_reclaimCover);
+	else
+		Residency.Resize(m_items[i].resHandle, size);
+}
+
+void CCoverFlow::_freeCoverTexture(u32 i)
+{
 	TexHandle.Cleanup(m_items[i].texture);
-	m_items[i].texture = newTex;
+	Residency.Remove(m_items[i].resHandle);
+	m_items[i].resHandle = -1;
+	m_items[i].hqTexture = false;
+	m_items[i].lowTexture = false;
+}
+
+bool CCoverFlow::_reclaimCover(void *owner, u32 id, s32 handle, ResAction action)
+{
+	CCoverFlow *cf = (CCoverFlow *)owner;
+	LockMutex lock(cf->m_mutex);
+
+	if(id >= cf->m_items.size() || cf->m_items[id].resHandle != handle)
+		return false;
+	CItem &item = cf->m_items[id];
+	if(action == RES_DOWNGRADE)
+	{
+		/* Keep a blurry cover on screen, the loader brings it back later */
+		TexData newTex;
+		newTex.maxLOD = item.texture.maxLOD;
+		newTex.width = item.texture.width;
+		newTex.height = item.texture.height;
+		newTex.format = item.texture.format;
+		if(newTex.maxLOD == 0 || newTex.width <= 64 || newTex.height <= 64)
+			return false;
+		--newTex.maxLOD;
+		newTex.width >>= 1;
+		newTex.height >>= 1;
+		if(!cf->_keepLowerLODs(id, newTex))
+			return false;
+		item.hqTexture = false;
+		item.lowTexture = true;
+	}
+	else
+	{
+		cf->_freeCoverTexture(id);
+		item.state = STATE_Loading;
+	}
+	cf->m_moved = true;
+	return true;
 }
 
 CCoverFlow::CLRet CCoverFlow::_loadCoverTex(u32 i, bool box, bool hq, bool blankBoxCover)
@@ -2796,7 +2875,10 @@ CCoverFlow::CLRet CCoverFlow::_loadCoverTex(u32 i, bool box, bool hq, bool blank
 		{
 			char *full_path = (char*)MEM2_alloc(MAX_FAT_PATH+1);
 			if(full_path == NULL)
+			{
+				m_coverNeed = MAX_FAT_PATH+1;
 				return CL_NOMEM;
+			}
 			memset(full_path, 0, MAX_FAT_PATH+1);
 			if(coverDir == NULL || strlen(coverDir) == 0)
 				strncpy(full_path, fmt("%s/%s.wfc", m_cachePath.c_str(), gamePath), MAX_FAT_PATH);
@@ -2833,7 +2915,12 @@ CCoverFlow::CLRet CCoverFlow::_loadCoverTex(u32 i, bool box, bool hq, bool blank
 					tex.data = (u8*)MEM2_alloc(texLen);
 					u8 *ptrTex = (header.zipped != 0) ? (u8*)MEM2_alloc(bufSize) : tex.data;
 					if(ptrTex == NULL || tex.data == NULL)
+					{
 						allocFailed = true;
+						m_coverNeed = texLen + (header.zipped != 0 ? bufSize + fileSize - sizeof(header) : 0);
+						if(header.zipped != 0)
+							free(ptrTex);
+					}
 					else
 					{
 						u8 *zBuffer = (header.zipped != 0) ? (u8*)MEM2_alloc(fileSize - sizeof(header)) : tex.data;
@@ -2852,8 +2939,7 @@ CCoverFlow::CLRet CCoverFlow::_loadCoverTex(u32 i, bool box, bool hq, bool blank
 								if(header.zipped != 0)
 									memcpy(tex.data, ptrTex + bufSize - texLen, texLen);
 								LockMutex lock(m_mutex);
-								TexHandle.Cleanup(m_items[i].texture);
-								m_items[i].texture = tex;
+								_setCoverTexture(i, tex);
 								DCFlushRange(tex.data, texLen);
 								m_items[i].state = STATE_Ready;
 								m_items[i].boxTexture = header.full != 0;
@@ -2887,52 +2973,150 @@ CCoverFlow::CLRet CCoverFlow::_loadCoverTex(u32 i, bool box, bool hq, bool blank
 	return _loadCoverTexPNG(i, box, hq, blankBoxCover) ? CL_OK : CL_ERROR;
 }
 
+CCoverFlow::CLRet CCoverFlow::_loadCoverJob(u32 i, bool hq)
+{
+	PROFILE_ZONE(PROF_COVERS);
+	CLRet ret;
+
+	if((ret = _loadCoverTex(i, m_box, hq, false)) == CL_ERROR)
+	{
+		if((ret = _loadCoverTex(i, !m_box, hq, false)) == CL_ERROR)
+		{
+			if((ret = _loadCoverTex(i, m_box, hq, true)) == CL_ERROR)
+				m_items[i].state = STATE_NoCover;
+		}
+	}
+	return ret;
+}
+
+bool CCoverFlow::_evictCovers(const CCoverQueue &queue, u32 center, int jump, u32 window, u32 budget, bool force, int tick)
+{
+	vector<pair<float, u32> > resident;
+	u32 used = 0;
+	int count = m_items.size();
+
+	for(int i = 0; i < count; ++i)
+	{
+		const TexData &tex = m_items[i].texture;
+		if(tex.data == NULL)
+			continue;
+		used += fixGX_GetTexBufferSize(tex.width, tex.height, tex.format, tex.maxLOD > 0 ? GX_TRUE : GX_FALSE, tex.maxLOD);
+		int dist = i - (int)center;
+		if(dist > count / 2)
+			dist -= count;
+		else if(dist < -count / 2)
+			dist += count;
+		resident.push_back(make_pair(queue.enterTime(dist, window, jump, tick), (u32)i));
+	}
+	if(used <= budget && !force)
+		return false;
+
+	// Drop the covers expected on screen last, never the visible ones
+	sort(resident.begin(), resident.end());
+	bool evicted = false;
+	for(int k = (int)resident.size() - 1; k >= 0 && (force || used > budget); --k)
+	{
+		if(resident[k].first == 0.f)
+			break;
+		u32 i = resident[k].second;
+		LockMutex lock(m_mutex);
+		const TexData &tex = m_items[i].texture;
+		used -= fixGX_GetTexBufferSize(tex.width, tex.height, tex.format, tex.maxLOD > 0 ? GX_TRUE : GX_FALSE, tex.maxLOD);
+		_freeCoverTexture(i);
+		m_items[i].state = STATE_Loading;
+		evicted = true;
+		force = false;
+	}
+	return evicted;
+}
+
 int CCoverFlow::_coverLoader(CCoverFlow *cf)
 {
 	cf->m_coverThrdBusy = true;
 	CLRet ret;
-	u32 firstItem;
+	u32 i;
+	u32 center = 0;
+	int jump = 0;
+	int tick = 0;
+	int start;
 	bool update;
-	u32 i, j;
+	bool pending = false;
 	bool hq_req = cf->m_useHQcover;
-	bool cur_pos_hq = false;
+	u32 hqItem = cf->m_items.size();
 	u32 bufferSize = min(cf->m_numBufCovers * max(2u, cf->m_rows), 80u);
+	u32 window = max(1u, cf->m_range / 2);
+	u32 budget = min(Residency.Budget(RES_COVER), MEM2_freesize() / 4);
+	float loadFrames = 2.f;
+	CCoverQueue queue;
+	CCoverQueue::SJob job;
+	vector<CCoverQueue::SJob> jobs;
 
 	while(cf->m_loadingCovers)
 	{
 		update = cf->m_moved;
 		cf->m_moved = false;
-		for(j = cf->m_items.size(); j >= bufferSize && cf->m_loadingCovers && !cf->m_moved && update; --j)
+		if(!update && !pending)
+		{
+			usleep(1000);
+			continue;
+		}
+		// Retry skipped or failed covers once the prediction has settled
+		if(!update)
+			usleep(16000);
+		pending = false;
+		{
+			LockMutex lock(cf->m_mutex);
+			center = cf->m_covers[cf->m_range / 2].index;
+			jump = cf->m_jump;
+			tick = cf->m_tickCount;
+			queue = cf->m_queue;
+		}
+		queue.plan(jobs, center, jump, window, bufferSize, cf->m_items.size(), tick);
+		// Only the center cover keeps its HQ texture
+		if(hqItem < cf->m_items.size() && hqItem != center)
+		{
+			Residency.Pin(cf->m_items[hqItem].resHandle, false);
+			cf->_dropHQLOD(hqItem);
+			cf->m_items[hqItem].hqTexture = false;
+			hqItem = cf->m_items.size();
+		}
+		while(!jobs.empty() && cf->m_loadingCovers && !cf->m_moved)
 		{
-			firstItem = cf->m_covers[cf->m_range / 2].index;
-			i = loopNum((j & 1) ? firstItem - (j + 1) / 2 : firstItem + j / 2, cf->m_items.size());
-			if(cf->m_items[i].state != STATE_Loading)
+			// The rest is stale, it would be gone again before being loaded
+			if(CCoverQueue::next(jobs, (float)(cf->m_tickCount - tick), loadFrames, job) < 0)
 			{
-				LWP_MutexLock(cf->m_mutex);
-				TexHandle.Cleanup(cf->m_items[i].texture);
-				cf->m_items[i].state = STATE_Loading;
-				LWP_MutexUnlock(cf->m_mutex);
+				pending = true;
+				break;
+			}
+			i = job.index;
+			// Downgraded covers get their full LQ texture back too
+			if(cf->m_items[i].state != STATE_Loading && !cf->m_items[i].lowTexture)
+				continue;
+			cf->_evictCovers(queue, center, jump, window, budget, false, tick);
+			start = cf->m_tickCount;
+			// Out of MEM2, take it back from the other textures first
+			if((ret = cf->_loadCoverJob(i, false)) == CL_NOMEM && Residency.Reserve(RES_COVER, cf->m_coverNeed))
+				ret = cf->_loadCoverJob(i, false);
+			if(ret == CL_NOMEM && cf->_evictCovers(queue, center, jump, window, budget, true, tick))
+				ret = cf->_loadCoverJob(i, false);
+			if(ret == CL_NOMEM)
+			{
+				pending = true;
+				break;
 			}
+			loadFrames = loadFrames * 0.75f + (float)(cf->m_tickCount - start) * 0.25f;
 		}
-		ret = CL_OK;
-		for(j = 0; j <= bufferSize && cf->m_loadingCovers && !cf->m_moved && update && ret != CL_NOMEM; ++j)
+		// Everything has its LQ texture, now refine the center cover
+		if(hq_req && jobs.empty() && cf->m_loadingCovers && !cf->m_moved
+			&& cf->m_items[center].state == STATE_Ready && !cf->m_items[center].hqTexture)
 		{
-			firstItem = cf->m_covers[cf->m_range / 2].index;
-			i = loopNum((j & 1) ? firstItem - (j + 1) / 2 : firstItem + j / 2, cf->m_items.size());
-			cur_pos_hq = (hq_req && i == firstItem);
-			if((!hq_req || !cur_pos_hq) && cf->m_items[i].state != STATE_Loading)
-				continue;
-			if((ret = cf->_loadCoverTex(i, cf->m_box, cur_pos_hq, false)) == CL_ERROR)
+			if(cf->_loadCoverJob(center, true) == CL_OK)
 			{
-				if ((ret = cf->_loadCoverTex(i, !cf->m_box, cur_pos_hq, false)) == CL_ERROR)
-				{
-					if((ret = cf->_loadCoverTex(i, cf->m_box, cur_pos_hq, true)) == CL_ERROR)
-						cf->m_items[i].state = STATE_NoCover;
-				}
+				cf->m_items[center].hqTexture = true;
+				Residency.Pin(cf->m_items[center].resHandle, true);
+				hqItem = center;
 			}
 		}
-		if(ret == CL_NOMEM && bufferSize > 3)
-			bufferSize -= 2;
 	}
 	cf->m_coverThrdBusy = false;
 	return 0;
@@ -11,6 +11,8 @@
 #include <ogc/pad.h>
 
 #include "video.hpp"
+#include "coverqueue.hpp"
+#include "residency.hpp"
 #include "FreeTypeGX.h"
 #include "text.hpp"
 #include "config/config.hpp"
@@ -202,7 +204,10 @@ private:
 		unsigned int lastPlayed;
 		TexData texture;
 		volatile bool boxTexture;
+		volatile bool hqTexture;
+		volatile bool lowTexture;
 		volatile enum TexState state;
+		s32 resHandle;
 	} ATTRIBUTE_PACKED;
 	struct CCover
 	{
@@ -243,7 +248,10 @@ private:
 	mutex_t m_mutex;
 	volatile bool m_loadingCovers;
 	volatile bool m_coverThrdBusy;
+	/* What the last cover load that returned CL_NOMEM needed */
+	u32 m_coverNeed;
 	volatile bool m_moved;
+	CCoverQueue m_queue;
 	//
 	volatile bool m_renderTex;
 	TexData *m_renderingTex;
@@ -339,8 +347,14 @@ private:
 	void _loadAllCovers(int i);
 	static bool _calcTexLQLOD(TexData &tex);
 	void _dropHQLOD(int i);
+	bool _keepLowerLODs(u32 i, TexData &newTex);
+	void _setCoverTexture(u32 i, const TexData &tex);
+	void _freeCoverTexture(u32 i);
+	static bool _reclaimCover(void *owner, u32 id, s32 handle, ResAction action);
 	bool _loadCoverTexPNG(u32 i, bool box, bool hq, bool blankBoxCover);
 	CLRet _loadCoverTex(u32 i, bool box, bool hq, bool blankBoxCover);
+	CLRet _loadCoverJob(u32 i, bool hq);
+	bool _evictCovers(const CCoverQueue &queue, u32 center, int jump, u32 window, u32 budget, bool force, int tick);
 	bool _invisibleCover(u32 x, u32 y);
 	void _instantTarget(int i);
 	void _transposeCover(CCover* &dst, u32 rows, u32 columns, int pos);
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <stdlib.h>
+
+#include "coverqueue.hpp"
+
+// Frames per item a cover is assumed away when nothing moves
+static const float g_stillCost = 6.f;
+// Extra cost for covers behind the scrolling direction
+static const float g_behindCost = 120.f;
+static const float g_never = 1e9f;
+// How far ahead a cover on screen is worth more than one loaded now
+static const float g_horizon = 30.f;
+
+static inline int loopNum(int i, int s)
+{
+	return i < 0 ? (s - (-i % s)) % s : i % s;
+}
+
+CCoverQueue::CCoverQueue(void)
+{
+	reset();
+}
+
+void CCoverQueue::reset(void)
+{
+	m_dir = 0;
+	m_speed = 0.f;
+	m_interval = 0.f;
+	m_lastTick = 0;
+}
+
+void CCoverQueue::moved(int step, int tick)
+{
+	int dir = step < 0 ? -1 : 1;
+	float dt = (float)max(1, tick - m_lastTick);
+	float speed = (float)abs(step) / dt;
+
+	// A single move after a pause or turning around says little about the
+	// speed, start from a slow one until the next move
+	if(dir != m_dir || dt > 30.f)
+	{
+		m_speed = (float)abs(step) / 30.f;
+		m_interval = 30.f;
+	}
+	else
+	{
+		m_speed = m_speed * 0.5f + speed * 0.5f;
+		m_interval = m_interval * 0.5f + dt * 0.5f;
+	}
+	m_dir = dir;
+	m_lastTick = tick;
+}
+
+float CCoverQueue::_velocity(int tick) const
+{
+	// No move for a while, the user stopped
+	if(m_dir == 0 || (float)(tick - m_lastTick) > max(20.f, m_interval * 3.f))
+		return 0.f;
+	return (float)m_dir * m_speed;
+}
+
+void CCoverQueue::_times(int dist, float window, float velocity, float &enter, float &leave) const
+{
+	float d = (float)abs(dist);
+
+	if(velocity == 0.f)
+	{
+		enter = d <= window ? 0.f : (d - window) * g_stillCost;
+		leave = g_never;
+		return;
+	}
+	float speed = velocity < 0.f ? -velocity : velocity;
+	// Distance ahead in the scrolling direction
+	float x = velocity < 0.f ? -(float)dist : (float)dist;
+	if(x >= -window)
+	{
+		enter = x <= window ? 0.f : (x - window) / speed;
+		leave = (x + window) / speed;
+	}
+	else
+	{
+		// Already passed, only loaded again once the user stops
+		enter = g_behindCost + (-x - window) * g_stillCost;
+		leave = 0.f;
+	}
+}
+
+void CCoverQueue::plan(vector<SJob> &jobs, u32 center, int jump, u32 window, u32 count, u32 items, int tick) const
+{
+	jobs.clear();
+	if(items == 0)
+		return;
+
+	float velocity = jump != 0 ? 0.f : _velocity(tick);
+	int anchor = (int)center + jump;
+	int first = -(int)count;
+	int last = (int)count;
+	if(last - first + 1 > (int)items)
+	{
+		first = -(int)(items - 1) / 2;
+		last = first + (int)items - 1;
+	}
+	jobs.reserve(last - first + 1);
+	for(int d = first; d <= last; ++d)
+	{
+		SJob job;
+		job.index = loopNum(anchor + d, (int)items);
+		job.dist = d;
+		_times(d, (float)window, velocity, job.enter, job.leave);
+		jobs.push_back(job);
+	}
+	sort(jobs.begin(), jobs.end());
+	if(jobs.size() > count)
+		jobs.resize(count);
+}
+
+int CCoverQueue::next(vector<SJob> &jobs, float elapsed, float loadFrames, SJob &job)
+{
+	float done = elapsed + loadFrames;
+	float best = 0.f;
+	int pick = -1;
+
+	for(u32 k = 0; k < jobs.size(); ++k)
+	{
+		// Frames on screen with a texture, covers far ahead count for less
+		float shown = min(jobs[k].leave - max(jobs[k].enter, done), g_horizon);
+		shown *= g_horizon / max(g_horizon, jobs[k].enter);
+		if(shown > best || (shown == best && pick >= 0 && jobs[k] < jobs[pick]))
+		{
+			best = shown;
+			pick = k;
+		}
+	}
+	if(pick < 0)
+		return -1;
+	job = jobs[pick];
+	jobs.erase(jobs.begin() + pick);
+	return pick;
+}
+
+float CCoverQueue::enterTime(int dist, u32 window, int jump, int tick) const
+{
+	float enter, leave;
+
+	_times(dist - jump, (float)window, jump != 0 ? 0.f : _velocity(tick), enter, leave);
+	return enter;
+}
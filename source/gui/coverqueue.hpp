@@ -0,0 +1,51 @@
+// Cover loader scheduling
+
+#ifndef __COVERQUEUE_HPP
+#define __COVERQUEUE_HPP
+
+#include <gctypes.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace std;
+
+/* Orders the covers the loader thread should work on by how soon they are
+   expected on screen, from the direction and speed of the last moves.
+   All times are in frames (CCoverFlow::tick calls). */
+class CCoverQueue
+{
+public:
+	struct SJob
+	{
+		u32 index;
+		int dist;
+		float enter;	// until the cover shows up, 0 if already visible
+		float leave;	// until it has scrolled out again
+		bool operator<(const SJob &o) const
+		{
+			return enter < o.enter || (enter == o.enter && abs(dist) < abs(o.dist));
+		}
+	};
+	CCoverQueue(void);
+	void reset(void);
+	/* step is negative when moving left/up */
+	void moved(int step, int tick);
+	/* The count covers around center (center + jump while jumping) that are
+	   expected on screen first, window is the number of visible covers on
+	   each side of the center */
+	void plan(vector<SJob> &jobs, u32 center, int jump, u32 window, u32 count, u32 items, int tick) const;
+	/* Takes the job gaining the most frames on screen with its texture, the
+	   first to show up on ties; -1 if the remaining ones are stale */
+	static int next(vector<SJob> &jobs, float elapsed, float loadFrames, SJob &job);
+	/* Expected time until the cover dist items away from the center shows up */
+	float enterTime(int dist, u32 window, int jump, int tick) const;
+private:
+	float _velocity(int tick) const;
+	void _times(int dist, float window, float velocity, float &enter, float &leave) const;
+	int m_dir;
+	float m_speed;
+	float m_interval;
+	int m_lastTick;
+};
+
+#endif // !defined(__COVERQUEUE_HPP)
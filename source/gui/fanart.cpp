@@ -4,6 +4,7 @@
 #include "text.hpp"
 #include "gecko/gecko.hpp"
 #include "memory/mem2.hpp"
+#include "residency.hpp"
 using namespace std;
 
 static  guVector  _GRRaxisx = (guVector){1, 0, 0}; // DO NOT MODIFY!!!
@@ -11,7 +12,7 @@ static  guVector  _GRRaxisy = (guVector){0, 1, 0}; // Even at runtime
 static  guVector  _GRRaxisz = (guVector){0, 0, 1}; // NOT ever!
 
 CFanart::CFanart(void)
-	: m_animationComplete(false), m_loaded(false), m_cfg(), m_bg(), m_bglq()
+	: m_animationComplete(false), m_loaded(false), m_cfg(), m_bg(), m_bglq(), m_resHandle(-1)
 {
 }
 
@@ -28,6 +29,8 @@ void CFanart::unload()
 	m_elms.clear();
 	TexHandle.Cleanup(m_bg);
 	TexHandle.Cleanup(m_bglq);
+	Residency.Remove(m_resHandle);
+	m_resHandle = -1;
 }
 
 bool CFanart::load(Config &m_globalConfig, const char *path, const char *id)
@@ -43,6 +46,8 @@ bool CFanart::load(Config &m_globalConfig, const char *path, const char *id)
 	dir[63] = '\0';
 	strncpy(dir, fmt("%s/%s", path, id), 63);
 
+	/* Room for a full screen RGBA8 background, taken from the covers if needed */
+	Residency.Reserve(RES_FANART, 640 * 480 * 4);
 	TexErr texErr = TexHandle.fromImageFile(m_bg, fmt("%s/background.png", dir));
 	if(texErr == TE_ERROR)
 	{
@@ -66,6 +71,10 @@ bool CFanart::load(Config &m_globalConfig, const char *path, const char *id)
 			CFanartElement elm(m_cfg, dir, i);
 			if (elm.IsValid()) m_elms.push_back(elm);
 		}
+		u32 size = CResidency::TexSize(m_bg) + CResidency::TexSize(m_bglq);
+		for(vector<CFanartElement>::iterator Elm = m_elms.begin(); Elm != m_elms.end(); Elm++)
+			size += CResidency::TexSize(Elm->Texture());
+		m_resHandle = Residency.Add(RES_FANART, size);
 		m_loaded = true;
 		retval = true;
 		m_defaultDelay = m_globalConfig.getInt("FANART", "delay_after_animation", 200);
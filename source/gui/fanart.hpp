@@ -23,6 +23,7 @@ public:
 	bool IsValid();
 	bool IsAnimationComplete();
 	bool ShowOnTop();
+	const TexData &Texture() const { return m_art; }
 private:
 	TexData m_art;
 	int m_artwork;
@@ -86,6 +87,7 @@ private:
 
 	TexData m_bg;
 	TexData m_bglq;
+	s32 m_resHandle;
 };
 
 #endif // __FANART_HPP
\ No newline at end of file
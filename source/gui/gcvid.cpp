@@ -708,17 +708,21 @@ extern "C"
 //the following functions are needed to let
 //libjpeg read from memory instead of from a file...
 //it's a little clumsy to do :-|
-const u8* g_jpegBuffer;
-int g_jpegSize;
-bool g_isLoading = false;
+//each reader keeps its buffer in client_data, so several can decode at once
+struct JpegSource
+{
+	const u8* data;
+	int size;
+};
 
 void jpegInitSource(j_decompress_ptr)
 {}
 
 boolean jpegFillInputBuffer(j_decompress_ptr cinfo)
 {
-	cinfo->src->next_input_byte = g_jpegBuffer;
-	cinfo->src->bytes_in_buffer = g_jpegSize;
+	const JpegSource* src = (const JpegSource*)cinfo->client_data;
+	cinfo->src->next_input_byte = src->data;
+	cinfo->src->bytes_in_buffer = src->size;
 	return TRUE;
 }
 
@@ -744,27 +748,34 @@ void jpegErrorHandler(j_common_ptr cinfo)
 	//MessageBox(g_hWnd, buff, "JpegLib error:", MB_OK);
 }
 
-void decodeRealJpeg(const u8* data, int size, VideoFrame& dest, bool fancy)
+struct JpegReader::State
 {
-	if(g_isLoading)
-		return;
-	g_isLoading = true;
-
 	//decompressor state
 	jpeg_decompress_struct cinfo;
 	jpeg_error_mgr errorMgr;
 
 	//read from memory manager
 	jpeg_source_mgr sourceMgr;
+	JpegSource source;
+};
+
+bool JpegReader::open(const u8* data, int size, bool fancy)
+{
+	close();
 
-	cinfo.err = jpeg_std_error(&errorMgr);
-	errorMgr.error_exit = jpegErrorHandler;
+	_state = new State;
+	jpeg_decompress_struct& cinfo = _state->cinfo;
+	jpeg_source_mgr& sourceMgr = _state->sourceMgr;
+
+	cinfo.err = jpeg_std_error(&_state->errorMgr);
+	_state->errorMgr.error_exit = jpegErrorHandler;
 
 	jpeg_create_decompress(&cinfo);
 
 	//setup read-from-memory
-	g_jpegBuffer = data;
-	g_jpegSize = size;
+	_state->source.data = data;
+	_state->source.size = size;
+	cinfo.client_data = &_state->source;
 	sourceMgr.bytes_in_buffer = size;
 	sourceMgr.next_input_byte = data;
 	sourceMgr.init_source = jpegInitSource;
@@ -780,41 +791,72 @@ void decodeRealJpeg(const u8* data, int size, VideoFrame& dest, bool fancy)
 		cinfo.do_fancy_upsampling = TRUE;
 		cinfo.do_block_smoothing = TRUE;
 		cinfo.dct_method = JDCT_ISLOW;
-		jpeg_start_decompress(&cinfo);
-		dest.resize(ALIGN(4, cinfo.output_width), ALIGN(4, cinfo.output_height));
 	}
 	else
 	{
 		cinfo.do_fancy_upsampling = FALSE;
 		cinfo.do_block_smoothing = FALSE;
-		jpeg_start_decompress(&cinfo);
-		dest.resize(cinfo.output_width, cinfo.output_height);
 	}
-	if(cinfo.num_components == 3)
+	jpeg_start_decompress(&cinfo);
+	if(cinfo.output_components != 3 && cinfo.output_components != 1)
 	{
-		int y = 0;
-		while(cinfo.output_scanline < cinfo.output_height)
-		{
-			//invert image because windows wants it downside up
-			u8* destBuffer =	&dest.getData()[(dest.getHeight() - y - 1)*dest.getPitch()];
+		//MessageBox(g_hWnd, "Only RGB videos are currently supported.", "oops?", MB_OK);
+		close();
+		return false;
+	}
+	return true;
+}
 
-			//NO idea why jpeglib wants a pointer to a pointer
-			jpeg_read_scanlines(&cinfo, &destBuffer, 1);
-			++y;
-		}
+void JpegReader::close()
+{
+	if(_state == NULL)
+		return;
+
+	//jpeglib gives an error in jpeg_finish_decompress() if no all
+	//scanlines are read by the application... :-|
+	if(_state->cinfo.output_scanline >= _state->cinfo.output_height)
+		jpeg_finish_decompress(&_state->cinfo);
+	jpeg_destroy_decompress(&_state->cinfo);
+	delete _state;
+	_state = NULL;
+}
 
-		//jpeglib gives an error in jpeg_finish_decompress() if no all
-		//scanlines are read by the application... :-|
-		//(but because we read all scanlines, it's not really needed)
-		cinfo.output_scanline = cinfo.output_height;
+int JpegReader::getWidth() const
+{ return _state != NULL ? _state->cinfo.output_width : 0; }
 
-	}
+int JpegReader::getHeight() const
+{ return _state != NULL ? _state->cinfo.output_height : 0; }
+
+bool JpegReader::readRow(u8* dest)
+{
+	if(_state == NULL || _state->cinfo.output_scanline >= _state->cinfo.output_height)
+		return false;
+
+	//NO idea why jpeglib wants a pointer to a pointer
+	if(jpeg_read_scanlines(&_state->cinfo, &dest, 1) != 1)
+		return false;
+
+	//grayscale, spread each sample to RGB starting from the end
+	if(_state->cinfo.output_components == 1)
+		for(int x = _state->cinfo.output_width - 1; x >= 0; --x)
+			dest[x*3] = dest[x*3 + 1] = dest[x*3 + 2] = dest[x];
+	return true;
+}
+
+void decodeRealJpeg(const u8* data, int size, VideoFrame& dest, bool fancy)
+{
+	JpegReader reader;
+	if(!reader.open(data, size, fancy))
+		return;
+
+	if(fancy)
+		dest.resize(ALIGN(4, reader.getWidth()), ALIGN(4, reader.getHeight()));
 	else
+		dest.resize(reader.getWidth(), reader.getHeight());
+
+	for(int y = 0; y < reader.getHeight(); ++y)
 	{
-		//MessageBox(g_hWnd, "Only RGB videos are currently supported.", "oops?", MB_OK);
+		//invert image because windows wants it downside up
+		reader.readRow(&dest.getData()[(dest.getHeight() - y - 1)*dest.getPitch()]);
 	}
-
-	jpeg_finish_decompress(&cinfo);
-	jpeg_destroy_decompress(&cinfo);
-	g_isLoading = false;
 }
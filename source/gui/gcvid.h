@@ -332,4 +332,30 @@ class JpgVideoFile : public VideoFile
 
 void decodeRealJpeg(const u8* data, int size, VideoFrame& dest, bool fancy = false);
 
+//decodes a jpeg one 24 bpp scanline at a time, top row first,
+//so callers don't need a buffer for the whole image
+class JpegReader
+{
+ public:
+  JpegReader() : _state(NULL) { };
+  ~JpegReader() { close(); };
+
+  //false if the jpeg is not RGB or grayscale
+  bool open(const u8* data, int size, bool fancy = false);
+  void close();
+
+  int getWidth() const;
+  int getHeight() const;
+
+  //reads the next scanline, getWidth() * 3 bytes
+  bool readRow(u8* dest);
+
+ private:
+  struct State;
+  State* _state;
+
+  JpegReader(const JpegReader& r);
+  JpegReader& operator=(const JpegReader& r);
+};
+
 #endif //THAKIS_GCVID_H
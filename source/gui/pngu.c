@@ -25,6 +25,9 @@ More info : http://frontier-dev.net
 // Prototypes of helper functions
 int pngu_info (IMGCTX ctx);
 int pngu_decode (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, PNGU_u32 stripAlpha, int force32bits);
+typedef void (*pngu_strip_fn) (png_bytep *rows, PNGU_u32 strip, void *data);
+int pngu_decode_strips (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, PNGU_u32 stripAlpha, int force32bits, PNGU_u32 stripRows, pngu_strip_fn fn, void *data);
+void pngu_set_transforms (IMGCTX ctx, PNGU_u32 stripAlpha, int force32bit);
 void pngu_free_info (IMGCTX ctx);
 void pngu_read_data_from_buffer (png_structp png_ptr, png_bytep data, png_size_t length);
 void pngu_write_data_to_buffer (png_structp png_ptr, png_bytep data, png_size_t length);
@@ -187,102 +190,125 @@ int PNGU_DecodeToRGB565 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, void *buff
 }
 
 
-int PNGU_DecodeToRGBA8 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, void *buffer, PNGU_u32 stride, PNGU_u8 default_alpha)
+struct pngu_linear
 {
-	
-	int result = pngu_decode (ctx, width, height, 0, 0);
-	if (result != PNGU_OK)
-		return result;
+	void *buffer;
+	PNGU_u32 width;
+	PNGU_u32 buffWidth;
+	PNGU_u8 default_alpha;
+	int hasAlpha;
+};
 
-	PNGU_u32 x, y, buffWidth = width + stride;
-	// Check is source image has an alpha channel
-	if ( (ctx->prop.imgColorType == PNGU_COLOR_TYPE_GRAY_ALPHA) || (ctx->prop.imgColorType == PNGU_COLOR_TYPE_RGB_ALPHA) )
+static void pngu_strip_RGBA8 (png_bytep *rows, PNGU_u32 y, void *data)
+{
+	struct pngu_linear *l = (struct pngu_linear *) data;
+	PNGU_u32 x;
+
+	if (l->hasAlpha)
 	{
-		// Alpha channel present, copy image to the output buffer
-		for (y = 0; y < height; y++)
-			memcpy (buffer + (y * buffWidth * 4), ctx->row_pointers[y], width * 4);
+		// Alpha channel present, copy the row to the output buffer
+		memcpy (l->buffer + (y * l->buffWidth * 4), rows[0], l->width * 4);
+		return;
 	}
-	else
+	// No alpha channel present, copy the row to the output buffer
+	for (x = 0; x < l->width; x++)
+		((PNGU_u32 *)l->buffer)[y*l->buffWidth+x] = 
+			(((PNGU_u32) rows[0][x*3]) << 24) | 
+			(((PNGU_u32) rows[0][x*3+1]) << 16) | 
+			(((PNGU_u32) rows[0][x*3+2]) << 8) | 
+			((PNGU_u32) l->default_alpha);
+}
+
+
+int PNGU_DecodeToRGBA8 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, void *buffer, PNGU_u32 stride, PNGU_u8 default_alpha)
+{
+	struct pngu_linear l;
+
+	l.buffer = buffer;
+	l.width = width;
+	l.buffWidth = width + stride;
+	l.default_alpha = default_alpha;
+	l.hasAlpha = 0;
+	if (!ctx->infoRead)
 	{
-		// No alpha channel present, copy image to the output buffer
-		for (y = 0; y < height; y++)
-			for (x = 0; x < width; x++)
-				((PNGU_u32 *)buffer)[y*buffWidth+x] = 
-					(((PNGU_u32) ctx->row_pointers[y][x*3]) << 24) | 
-					(((PNGU_u32) ctx->row_pointers[y][x*3+1]) << 16) | 
-					(((PNGU_u32) ctx->row_pointers[y][x*3+2]) << 8) | 
-					((PNGU_u32) default_alpha);
+		int result = pngu_info (ctx);
+		if (result != PNGU_OK) return result;
 	}
-	
-	// Free resources
-	free(ctx->img_data);
-	free(ctx->row_pointers);
+	// Check is source image has an alpha channel
+	if ( (ctx->prop.imgColorType == PNGU_COLOR_TYPE_GRAY_ALPHA) || (ctx->prop.imgColorType == PNGU_COLOR_TYPE_RGB_ALPHA) )
+		l.hasAlpha = 1;
 
-	// Success
-	return PNGU_OK;
+	return pngu_decode_strips (ctx, width, height, 0, 0, 1, pngu_strip_RGBA8, &l);
 }
 
 
-int PNGU_DecodeTo4x4RGB565 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, void *buffer)
+struct pngu_blocks
 {
+	void *buffer;
+	PNGU_u32 qwidth;
+	PNGU_u64 alphaMask;
+	int hasAlpha;
+};
 
-	// width and height need to be divisible by four
-//	if ((width % 4) || (height % 4))
-//		return PNGU_INVALID_WIDTH_OR_HEIGHT;
-
-	int result = pngu_decode (ctx, width, height, 1, 0);
-	if (result != PNGU_OK) return result;
+static void pngu_strip_4x4RGB565 (png_bytep *rows, PNGU_u32 y, void *data)
+{
+	struct pngu_blocks *b = (struct pngu_blocks *) data;
+	void *buffer = b->buffer;
+	PNGU_u32 x, qwidth = b->qwidth;
 
-	PNGU_u32 x, y, qwidth = width / 4, qheight = height / 4;
-	// Copy image to the output buffer
-	for (y = 0; y < qheight; y++)
+	if (((y + 0xFF) & 0xFF) == 0)
+		usleep(100);
+	for (x = 0; x < qwidth; x++)
 	{
-		if (((y + 0xFF) & 0xFF) == 0)
-			usleep(100);
-		for (x = 0; x < qwidth; x++)
-		{
-			int blockbase = (y * qwidth + x) * 4;
-
-			PNGU_u64 field64 = *((PNGU_u64 *)(ctx->row_pointers[y*4]+x*12));
-			PNGU_u64 field32 = (PNGU_u64) *((PNGU_u32 *)(ctx->row_pointers[y*4]+x*12+8));
-			((PNGU_u64 *) buffer)[blockbase] = 
-				(((field64 & 0xF800000000000000ULL) | ((field64 & 0xFC000000000000ULL) << 3) | ((field64 & 0xF80000000000ULL) << 5)) | 
-				(((field64 & 0xF800000000ULL) << 8) | ((field64 & 0xFC000000ULL) << 11) | ((field64 & 0xF80000ULL) << 13)) | 
-				(((field64 & 0xF800ULL) << 16) | ((field64 & 0xFCULL) << 19) | ((field32 & 0xF8000000ULL) >> 11)) |
-				(((field32 & 0xF80000ULL) >> 8) | ((field32 & 0xFC00ULL) >> 5) | ((field32 & 0xF8ULL) >> 3)));
-
-			field64 = *((PNGU_u64 *)(ctx->row_pointers[y*4+1]+x*12));
-			field32 = (PNGU_u64) *((PNGU_u32 *)(ctx->row_pointers[y*4+1]+x*12+8));
-			((PNGU_u64 *) buffer)[blockbase+1] = 
-				(((field64 & 0xF800000000000000ULL) | ((field64 & 0xFC000000000000ULL) << 3) | ((field64 & 0xF80000000000ULL) << 5)) | 
-				(((field64 & 0xF800000000ULL) << 8) | ((field64 & 0xFC000000ULL) << 11) | ((field64 & 0xF80000ULL) << 13)) | 
-				(((field64 & 0xF800ULL) << 16) | ((field64 & 0xFCULL) << 19) | ((field32 & 0xF8000000ULL) >> 11)) |
-				(((field32 & 0xF80000ULL) >> 8) | ((field32 & 0xFC00ULL) >> 5) | ((field32 & 0xF8ULL) >> 3)));
+		int blockbase = (y * qwidth + x) * 4;
+
+		PNGU_u64 field64 = *((PNGU_u64 *)(rows[0]+x*12));
+		PNGU_u64 field32 = (PNGU_u64) *((PNGU_u32 *)(rows[0]+x*12+8));
+		((PNGU_u64 *) buffer)[blockbase] = 
+			(((field64 & 0xF800000000000000ULL) | ((field64 & 0xFC000000000000ULL) << 3) | ((field64 & 0xF80000000000ULL) << 5)) | 
+			(((field64 & 0xF800000000ULL) << 8) | ((field64 & 0xFC000000ULL) << 11) | ((field64 & 0xF80000ULL) << 13)) | 
+			(((field64 & 0xF800ULL) << 16) | ((field64 & 0xFCULL) << 19) | ((field32 & 0xF8000000ULL) >> 11)) |
+			(((field32 & 0xF80000ULL) >> 8) | ((field32 & 0xFC00ULL) >> 5) | ((field32 & 0xF8ULL) >> 3)));
+
+		field64 = *((PNGU_u64 *)(rows[1]+x*12));
+		field32 = (PNGU_u64) *((PNGU_u32 *)(rows[1]+x*12+8));
+		((PNGU_u64 *) buffer)[blockbase+1] = 
+			(((field64 & 0xF800000000000000ULL) | ((field64 & 0xFC000000000000ULL) << 3) | ((field64 & 0xF80000000000ULL) << 5)) | 
+			(((field64 & 0xF800000000ULL) << 8) | ((field64 & 0xFC000000ULL) << 11) | ((field64 & 0xF80000ULL) << 13)) | 
+			(((field64 & 0xF800ULL) << 16) | ((field64 & 0xFCULL) << 19) | ((field32 & 0xF8000000ULL) >> 11)) |
+			(((field32 & 0xF80000ULL) >> 8) | ((field32 & 0xFC00ULL) >> 5) | ((field32 & 0xF8ULL) >> 3)));
+
+		field64 = *((PNGU_u64 *)(rows[2]+x*12));
+		field32 = (PNGU_u64) *((PNGU_u32 *)(rows[2]+x*12+8));
+		((PNGU_u64 *) buffer)[blockbase+2] = 
+			(((field64 & 0xF800000000000000ULL) | ((field64 & 0xFC000000000000ULL) << 3) | ((field64 & 0xF80000000000ULL) << 5)) | 
+			(((field64 & 0xF800000000ULL) << 8) | ((field64 & 0xFC000000ULL) << 11) | ((field64 & 0xF80000ULL) << 13)) | 
+			(((field64 & 0xF800ULL) << 16) | ((field64 & 0xFCULL) << 19) | ((field32 & 0xF8000000ULL) >> 11)) |
+			(((field32 & 0xF80000ULL) >> 8) | ((field32 & 0xFC00ULL) >> 5) | ((field32 & 0xF8ULL) >> 3)));
+
+		field64 = *((PNGU_u64 *)(rows[3]+x*12));
+		field32 = (PNGU_u64) *((PNGU_u32 *)(rows[3]+x*12+8));
+		((PNGU_u64 *) buffer)[blockbase+3] = 
+			(((field64 & 0xF800000000000000ULL) | ((field64 & 0xFC000000000000ULL) << 3) | ((field64 & 0xF80000000000ULL) << 5)) | 
+			(((field64 & 0xF800000000ULL) << 8) | ((field64 & 0xFC000000ULL) << 11) | ((field64 & 0xF80000ULL) << 13)) | 
+			(((field64 & 0xF800ULL) << 16) | ((field64 & 0xFCULL) << 19) | ((field32 & 0xF8000000ULL) >> 11)) |
+			(((field32 & 0xF80000ULL) >> 8) | ((field32 & 0xFC00ULL) >> 5) | ((field32 & 0xF8ULL) >> 3)));
+	}
+}
 
-			field64 = *((PNGU_u64 *)(ctx->row_pointers[y*4+2]+x*12));
-			field32 = (PNGU_u64) *((PNGU_u32 *)(ctx->row_pointers[y*4+2]+x*12+8));
-			((PNGU_u64 *) buffer)[blockbase+2] = 
-				(((field64 & 0xF800000000000000ULL) | ((field64 & 0xFC000000000000ULL) << 3) | ((field64 & 0xF80000000000ULL) << 5)) | 
-				(((field64 & 0xF800000000ULL) << 8) | ((field64 & 0xFC000000ULL) << 11) | ((field64 & 0xF80000ULL) << 13)) | 
-				(((field64 & 0xF800ULL) << 16) | ((field64 & 0xFCULL) << 19) | ((field32 & 0xF8000000ULL) >> 11)) |
-				(((field32 & 0xF80000ULL) >> 8) | ((field32 & 0xFC00ULL) >> 5) | ((field32 & 0xF8ULL) >> 3)));
 
-			field64 = *((PNGU_u64 *)(ctx->row_pointers[y*4+3]+x*12));
-			field32 = (PNGU_u64) *((PNGU_u32 *)(ctx->row_pointers[y*4+3]+x*12+8));
-			((PNGU_u64 *) buffer)[blockbase+3] = 
-				(((field64 & 0xF800000000000000ULL) | ((field64 & 0xFC000000000000ULL) << 3) | ((field64 & 0xF80000000000ULL) << 5)) | 
-				(((field64 & 0xF800000000ULL) << 8) | ((field64 & 0xFC000000ULL) << 11) | ((field64 & 0xF80000ULL) << 13)) | 
-				(((field64 & 0xF800ULL) << 16) | ((field64 & 0xFCULL) << 19) | ((field32 & 0xF8000000ULL) >> 11)) |
-				(((field32 & 0xF80000ULL) >> 8) | ((field32 & 0xFC00ULL) >> 5) | ((field32 & 0xF8ULL) >> 3)));
-		}
-	}
+int PNGU_DecodeTo4x4RGB565 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, void *buffer)
+{
+	struct pngu_blocks b;
 
-	// Free resources
-	free(ctx->img_data);
-	free(ctx->row_pointers);
+	// width and height need to be divisible by four
+//	if ((width % 4) || (height % 4))
+//		return PNGU_INVALID_WIDTH_OR_HEIGHT;
 
-	// Success
-	return PNGU_OK;
+	b.buffer = buffer;
+	b.qwidth = width / 4;
+	// Convert the image 4 rows at a time as libpng hands them out
+	return pngu_decode_strips (ctx, width, height, 1, 0, 4, pngu_strip_4x4RGB565, &b);
 }
 
 
@@ -533,127 +559,136 @@ int PNGU_DecodeTo4x4RGB5A3 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, void *b
 }
 
 
-int PNGU_DecodeTo4x4RGBA8 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, void *buffer, PNGU_u8 default_alpha)
+static void pngu_strip_4x4RGBA8 (png_bytep *rows, PNGU_u32 y, void *data)
 {
-	// width and height need to be divisible by four
-//	if ((width % 4) || (height % 4))
-//		return PNGU_INVALID_WIDTH_OR_HEIGHT;
+	struct pngu_blocks *b = (struct pngu_blocks *) data;
+	void *buffer = b->buffer;
+	PNGU_u32 x, qwidth = b->qwidth;
+	PNGU_u64 alphaMask = b->alphaMask;
 
-	int result = pngu_decode (ctx, width, height, 0, 0);
-	if (result != PNGU_OK) return result;
-
-	// Init some variables
-	PNGU_u32 x, y, qwidth = width / 4, qheight = height / 4;
+	if (b->hasAlpha)
+	{
+		// Alpha channel present, copy the strip to the output buffer
+		for (x = 0; x < qwidth; x++)
+		{
+			int blockbase = (y * qwidth + x) * 8;
 
-	// Check is source image has an alpha channel
-	if ( (ctx->prop.imgColorType == PNGU_COLOR_TYPE_GRAY_ALPHA) || (ctx->prop.imgColorType == PNGU_COLOR_TYPE_RGB_ALPHA) )
+			PNGU_u64 fieldA = *((PNGU_u64 *)(rows[0]+x*16));
+			PNGU_u64 fieldB = *((PNGU_u64 *)(rows[0]+x*16+8));
+			((PNGU_u64 *) buffer)[blockbase] = 
+				((fieldA & 0xFF00000000ULL) << 24) | ((fieldA & 0xFF00000000000000ULL) >> 8) | 
+				((fieldA & 0xFFULL) << 40) | ((fieldA & 0xFF000000ULL) << 8) | 
+				((fieldB & 0xFF00000000ULL) >> 8) | ((fieldB & 0xFF00000000000000ULL) >> 40) | 
+				((fieldB & 0xFFULL) << 8) | ((fieldB & 0xFF000000ULL) >> 24);
+			((PNGU_u64 *) buffer)[blockbase+4] =
+				((fieldA & 0xFFFF0000000000ULL) << 8) | ((fieldA & 0xFFFF00ULL) << 24) |
+				((fieldB & 0xFFFF0000000000ULL) >> 24) | ((fieldB & 0xFFFF00ULL) >> 8);
+
+			fieldA = *((PNGU_u64 *)(rows[1]+x*16));
+			fieldB = *((PNGU_u64 *)(rows[1]+x*16+8));
+			((PNGU_u64 *) buffer)[blockbase+1] = 
+				((fieldA & 0xFF00000000ULL) << 24) | ((fieldA & 0xFF00000000000000ULL) >> 8) | 
+				((fieldA & 0xFFULL) << 40) | ((fieldA & 0xFF000000ULL) << 8) | 
+				((fieldB & 0xFF00000000ULL) >> 8) | ((fieldB & 0xFF00000000000000ULL) >> 40) | 
+				((fieldB & 0xFFULL) << 8) | ((fieldB & 0xFF000000ULL) >> 24);
+			((PNGU_u64 *) buffer)[blockbase+5] =
+				((fieldA & 0xFFFF0000000000ULL) << 8) | ((fieldA & 0xFFFF00ULL) << 24) |
+				((fieldB & 0xFFFF0000000000ULL) >> 24) | ((fieldB & 0xFFFF00ULL) >> 8);
+
+			fieldA = *((PNGU_u64 *)(rows[2]+x*16));
+			fieldB = *((PNGU_u64 *)(rows[2]+x*16+8));
+			((PNGU_u64 *) buffer)[blockbase+2] = 
+				((fieldA & 0xFF00000000ULL) << 24) | ((fieldA & 0xFF00000000000000ULL) >> 8) | 
+				((fieldA & 0xFFULL) << 40) | ((fieldA & 0xFF000000ULL) << 8) | 
+				((fieldB & 0xFF00000000ULL) >> 8) | ((fieldB & 0xFF00000000000000ULL) >> 40) | 
+				((fieldB & 0xFFULL) << 8) | ((fieldB & 0xFF000000ULL) >> 24);
+			((PNGU_u64 *) buffer)[blockbase+6] =
+				((fieldA & 0xFFFF0000000000ULL) << 8) | ((fieldA & 0xFFFF00ULL) << 24) |
+				((fieldB & 0xFFFF0000000000ULL) >> 24) | ((fieldB & 0xFFFF00ULL) >> 8);
+
+			fieldA = *((PNGU_u64 *)(rows[3]+x*16));
+			fieldB = *((PNGU_u64 *)(rows[3]+x*16+8));
+			((PNGU_u64 *) buffer)[blockbase+3] = 
+				((fieldA & 0xFF00000000ULL) << 24) | ((fieldA & 0xFF00000000000000ULL) >> 8) | 
+				((fieldA & 0xFFULL) << 40) | ((fieldA & 0xFF000000ULL) << 8) | 
+				((fieldB & 0xFF00000000ULL) >> 8) | ((fieldB & 0xFF00000000000000ULL) >> 40) | 
+				((fieldB & 0xFFULL) << 8) | ((fieldB & 0xFF000000ULL) >> 24);
+			((PNGU_u64 *) buffer)[blockbase+7] =
+				((fieldA & 0xFFFF0000000000ULL) << 8) | ((fieldA & 0xFFFF00ULL) << 24) |
+				((fieldB & 0xFFFF0000000000ULL) >> 24) | ((fieldB & 0xFFFF00ULL) >> 8);
+		}
+		return;
+	}
+	// No alpha channel present, copy the strip to the output buffer
+	for (x = 0; x < qwidth; x++)
 	{
-		// Alpha channel present, copy image to the output buffer
-		for (y = 0; y < qheight; y++)
-			for (x = 0; x < qwidth; x++)
-			{
-				int blockbase = (y * qwidth + x) * 8;
+		int blockbase = (y * qwidth + x) * 8;
+
+		PNGU_u64 field64 = *((PNGU_u64 *)(rows[0]+x*12));
+		PNGU_u64 field32 = (PNGU_u64) *((PNGU_u32 *)(rows[0]+x*12+8));
+		((PNGU_u64 *) buffer)[blockbase] = 
+			(((field64 & 0xFF00000000000000ULL) >> 8) | (field64 & 0xFF00000000ULL) | 
+			((field64 & 0xFF00ULL) << 8) | ((field32 & 0xFF0000ULL) >> 16) | alphaMask);
+		((PNGU_u64 *) buffer)[blockbase+4] =
+			(((field64 & 0xFFFF0000000000ULL) << 8) | ((field64 & 0xFFFF0000ULL) << 16) |
+			((field64 & 0xFFULL) << 24) | ((field32 & 0xFF000000ULL) >> 8) | (field32 & 0xFFFFULL));
+
+		field64 = *((PNGU_u64 *)(rows[1]+x*12));
+		field32 = (PNGU_u64) *((PNGU_u32 *)(rows[1]+x*12+8));
+		((PNGU_u64 *) buffer)[blockbase+1] = 
+			(((field64 & 0xFF00000000000000ULL) >> 8) | (field64 & 0xFF00000000ULL) | 
+			((field64 & 0xFF00ULL) << 8) | ((field32 & 0xFF0000ULL) >> 16) | alphaMask);
+		((PNGU_u64 *) buffer)[blockbase+5] =
+			(((field64 & 0xFFFF0000000000ULL) << 8) | ((field64 & 0xFFFF0000ULL) << 16) |
+			((field64 & 0xFFULL) << 24) | ((field32 & 0xFF000000ULL) >> 8) | (field32 & 0xFFFFULL));
+
+		field64 = *((PNGU_u64 *)(rows[2]+x*12));
+		field32 = (PNGU_u64) *((PNGU_u32 *)(rows[2]+x*12+8));
+		((PNGU_u64 *) buffer)[blockbase+2] = 
+			(((field64 & 0xFF00000000000000ULL) >> 8) | (field64 & 0xFF00000000ULL) | 
+			((field64 & 0xFF00ULL) << 8) | ((field32 & 0xFF0000ULL) >> 16) | alphaMask);
+		((PNGU_u64 *) buffer)[blockbase+6] =
+			(((field64 & 0xFFFF0000000000ULL) << 8) | ((field64 & 0xFFFF0000ULL) << 16) |
+			((field64 & 0xFFULL) << 24) | ((field32 & 0xFF000000ULL) >> 8) | (field32 & 0xFFFFULL));
+
+		field64 = *((PNGU_u64 *)(rows[3]+x*12));
+		field32 = (PNGU_u64) *((PNGU_u32 *)(rows[3]+x*12+8));
+		((PNGU_u64 *) buffer)[blockbase+3] = 
+			(((field64 & 0xFF00000000000000ULL) >> 8) | (field64 & 0xFF00000000ULL) | 
+			((field64 & 0xFF00ULL) << 8) | ((field32 & 0xFF0000ULL) >> 16) | alphaMask);
+		((PNGU_u64 *) buffer)[blockbase+7] =
+			(((field64 & 0xFFFF0000000000ULL) << 8) | ((field64 & 0xFFFF0000ULL) << 16) |
+			((field64 & 0xFFULL) << 24) | ((field32 & 0xFF000000ULL) >> 8) | (field32 & 0xFFFFULL));
+	}
+}
 
-				PNGU_u64 fieldA = *((PNGU_u64 *)(ctx->row_pointers[y*4]+x*16));
-				PNGU_u64 fieldB = *((PNGU_u64 *)(ctx->row_pointers[y*4]+x*16+8));
-				((PNGU_u64 *) buffer)[blockbase] = 
-					((fieldA & 0xFF00000000ULL) << 24) | ((fieldA & 0xFF00000000000000ULL) >> 8) | 
-					((fieldA & 0xFFULL) << 40) | ((fieldA & 0xFF000000ULL) << 8) | 
-					((fieldB & 0xFF00000000ULL) >> 8) | ((fieldB & 0xFF00000000000000ULL) >> 40) | 
-					((fieldB & 0xFFULL) << 8) | ((fieldB & 0xFF000000ULL) >> 24);
-				((PNGU_u64 *) buffer)[blockbase+4] =
-					((fieldA & 0xFFFF0000000000ULL) << 8) | ((fieldA & 0xFFFF00ULL) << 24) |
-					((fieldB & 0xFFFF0000000000ULL) >> 24) | ((fieldB & 0xFFFF00ULL) >> 8);
 
-				fieldA = *((PNGU_u64 *)(ctx->row_pointers[y*4+1]+x*16));
-				fieldB = *((PNGU_u64 *)(ctx->row_pointers[y*4+1]+x*16+8));
-				((PNGU_u64 *) buffer)[blockbase+1] = 
-					((fieldA & 0xFF00000000ULL) << 24) | ((fieldA & 0xFF00000000000000ULL) >> 8) | 
-					((fieldA & 0xFFULL) << 40) | ((fieldA & 0xFF000000ULL) << 8) | 
-					((fieldB & 0xFF00000000ULL) >> 8) | ((fieldB & 0xFF00000000000000ULL) >> 40) | 
-					((fieldB & 0xFFULL) << 8) | ((fieldB & 0xFF000000ULL) >> 24);
-				((PNGU_u64 *) buffer)[blockbase+5] =
-					((fieldA & 0xFFFF0000000000ULL) << 8) | ((fieldA & 0xFFFF00ULL) << 24) |
-					((fieldB & 0xFFFF0000000000ULL) >> 24) | ((fieldB & 0xFFFF00ULL) >> 8);
+int PNGU_DecodeTo4x4RGBA8 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, void *buffer, PNGU_u8 default_alpha)
+{
+	struct pngu_blocks b;
 
-				fieldA = *((PNGU_u64 *)(ctx->row_pointers[y*4+2]+x*16));
-				fieldB = *((PNGU_u64 *)(ctx->row_pointers[y*4+2]+x*16+8));
-				((PNGU_u64 *) buffer)[blockbase+2] = 
-					((fieldA & 0xFF00000000ULL) << 24) | ((fieldA & 0xFF00000000000000ULL) >> 8) | 
-					((fieldA & 0xFFULL) << 40) | ((fieldA & 0xFF000000ULL) << 8) | 
-					((fieldB & 0xFF00000000ULL) >> 8) | ((fieldB & 0xFF00000000000000ULL) >> 40) | 
-					((fieldB & 0xFFULL) << 8) | ((fieldB & 0xFF000000ULL) >> 24);
-				((PNGU_u64 *) buffer)[blockbase+6] =
-					((fieldA & 0xFFFF0000000000ULL) << 8) | ((fieldA & 0xFFFF00ULL) << 24) |
-					((fieldB & 0xFFFF0000000000ULL) >> 24) | ((fieldB & 0xFFFF00ULL) >> 8);
+	// width and height need to be divisible by four
+//	if ((width % 4) || (height % 4))
+//		return PNGU_INVALID_WIDTH_OR_HEIGHT;
 
-				fieldA = *((PNGU_u64 *)(ctx->row_pointers[y*4+3]+x*16));
-				fieldB = *((PNGU_u64 *)(ctx->row_pointers[y*4+3]+x*16+8));
-				((PNGU_u64 *) buffer)[blockbase+3] = 
-					((fieldA & 0xFF00000000ULL) << 24) | ((fieldA & 0xFF00000000000000ULL) >> 8) | 
-					((fieldA & 0xFFULL) << 40) | ((fieldA & 0xFF000000ULL) << 8) | 
-					((fieldB & 0xFF00000000ULL) >> 8) | ((fieldB & 0xFF00000000000000ULL) >> 40) | 
-					((fieldB & 0xFFULL) << 8) | ((fieldB & 0xFF000000ULL) >> 24);
-				((PNGU_u64 *) buffer)[blockbase+7] =
-					((fieldA & 0xFFFF0000000000ULL) << 8) | ((fieldA & 0xFFFF00ULL) << 24) |
-					((fieldB & 0xFFFF0000000000ULL) >> 24) | ((fieldB & 0xFFFF00ULL) >> 8);
-			}
-	}
-	else
+	if (!ctx->infoRead)
 	{
-		// No alpha channel present, copy image to the output buffer
-		PNGU_u64 alphaMask = (((PNGU_u64)default_alpha) << 56) | (((PNGU_u64)default_alpha) << 40) |
-					(((PNGU_u64)default_alpha) << 24) | (((PNGU_u64)default_alpha) << 8);
-
-		for (y = 0; y < qheight; y++)
-			for (x = 0; x < qwidth; x++)
-			{
-				int blockbase = (y * qwidth + x) * 8;
-
-				PNGU_u64 field64 = *((PNGU_u64 *)(ctx->row_pointers[y*4]+x*12));
-				PNGU_u64 field32 = (PNGU_u64) *((PNGU_u32 *)(ctx->row_pointers[y*4]+x*12+8));
-				((PNGU_u64 *) buffer)[blockbase] = 
-					(((field64 & 0xFF00000000000000ULL) >> 8) | (field64 & 0xFF00000000ULL) | 
-					((field64 & 0xFF00ULL) << 8) | ((field32 & 0xFF0000ULL) >> 16) | alphaMask);
-				((PNGU_u64 *) buffer)[blockbase+4] =
-					(((field64 & 0xFFFF0000000000ULL) << 8) | ((field64 & 0xFFFF0000ULL) << 16) |
-					((field64 & 0xFFULL) << 24) | ((field32 & 0xFF000000ULL) >> 8) | (field32 & 0xFFFFULL));
-
-				field64 = *((PNGU_u64 *)(ctx->row_pointers[y*4+1]+x*12));
-				field32 = (PNGU_u64) *((PNGU_u32 *)(ctx->row_pointers[y*4+1]+x*12+8));
-				((PNGU_u64 *) buffer)[blockbase+1] = 
-					(((field64 & 0xFF00000000000000ULL) >> 8) | (field64 & 0xFF00000000ULL) | 
-					((field64 & 0xFF00ULL) << 8) | ((field32 & 0xFF0000ULL) >> 16) | alphaMask);
-				((PNGU_u64 *) buffer)[blockbase+5] =
-					(((field64 & 0xFFFF0000000000ULL) << 8) | ((field64 & 0xFFFF0000ULL) << 16) |
-					((field64 & 0xFFULL) << 24) | ((field32 & 0xFF000000ULL) >> 8) | (field32 & 0xFFFFULL));
-
-				field64 = *((PNGU_u64 *)(ctx->row_pointers[y*4+2]+x*12));
-				field32 = (PNGU_u64) *((PNGU_u32 *)(ctx->row_pointers[y*4+2]+x*12+8));
-				((PNGU_u64 *) buffer)[blockbase+2] = 
-					(((field64 & 0xFF00000000000000ULL) >> 8) | (field64 & 0xFF00000000ULL) | 
-					((field64 & 0xFF00ULL) << 8) | ((field32 & 0xFF0000ULL) >> 16) | alphaMask);
-				((PNGU_u64 *) buffer)[blockbase+6] =
-					(((field64 & 0xFFFF0000000000ULL) << 8) | ((field64 & 0xFFFF0000ULL) << 16) |
-					((field64 & 0xFFULL) << 24) | ((field32 & 0xFF000000ULL) >> 8) | (field32 & 0xFFFFULL));
-
-				field64 = *((PNGU_u64 *)(ctx->row_pointers[y*4+3]+x*12));
-				field32 = (PNGU_u64) *((PNGU_u32 *)(ctx->row_pointers[y*4+3]+x*12+8));
-				((PNGU_u64 *) buffer)[blockbase+3] = 
-					(((field64 & 0xFF00000000000000ULL) >> 8) | (field64 & 0xFF00000000ULL) | 
-					((field64 & 0xFF00ULL) << 8) | ((field32 & 0xFF0000ULL) >> 16) | alphaMask);
-				((PNGU_u64 *) buffer)[blockbase+7] =
-					(((field64 & 0xFFFF0000000000ULL) << 8) | ((field64 & 0xFFFF0000ULL) << 16) |
-					((field64 & 0xFFULL) << 24) | ((field32 & 0xFF000000ULL) >> 8) | (field32 & 0xFFFFULL));
-			}
+		int result = pngu_info (ctx);
+		if (result != PNGU_OK) return result;
 	}
-	
-	// Free resources
-	free(ctx->img_data);
-	free(ctx->row_pointers);
 
-	// Success
-	return PNGU_OK;
+	b.buffer = buffer;
+	b.qwidth = width / 4;
+	b.alphaMask = 0;
+	b.hasAlpha = 0;
+	// Check is source image has an alpha channel
+	if ( (ctx->prop.imgColorType == PNGU_COLOR_TYPE_GRAY_ALPHA) || (ctx->prop.imgColorType == PNGU_COLOR_TYPE_RGB_ALPHA) )
+		b.hasAlpha = 1;
+	else
+		b.alphaMask = (((PNGU_u64)default_alpha) << 56) | (((PNGU_u64)default_alpha) << 40) |
+				(((PNGU_u64)default_alpha) << 24) | (((PNGU_u64)default_alpha) << 8);
+
+	return pngu_decode_strips (ctx, width, height, 0, 0, 4, pngu_strip_4x4RGBA8, &b);
 }
 
 
@@ -735,43 +770,50 @@ static PNGU_u32 colorIndices(const PNGU_u8 *color0, const PNGU_u8 *color1, const
 }
 
 
-int PNGU_DecodeToCMPR(IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, void *buffer)
+struct pngu_cmpr
+{
+	PNGU_u8 *outBuf;
+	PNGU_u32 width;
+};
+
+static void pngu_strip_CMPR (png_bytep *rows, PNGU_u32 strip, void *data)
 {
+	struct pngu_cmpr *c = (struct pngu_cmpr *) data;
 	PNGU_u8 srcBlock[16 * 4];
 	PNGU_u8 color0[4];
 	PNGU_u8 color1[4];
-	PNGU_u8 *outBuf = (PNGU_u8 *)buffer;
-	int ii, jj, k;
+	PNGU_u8 *outBuf = c->outBuf;
+	int ii, k;
 
-	int result = pngu_decode (ctx, width, height, 0, 1);
-	if (result != PNGU_OK) return result;
-	width = width & ~7u;
-	height = height & ~7u;
-	// Alpha channel present, copy image to the output buffer
-	for (jj = 0; jj < (int)height; jj += 8)
-		for (ii = 0; ii < (int)width; ii += 8)
-			for (k = 0; k < 4; ++k)
-			{
-				int j = jj + ((k >> 1) << 2);
-				int i = ii + ((k & 1) << 2);
-				memcpy(srcBlock, ctx->row_pointers[j] + i * 4, 16);
-				memcpy(srcBlock + 4 * 4, ctx->row_pointers[j + 1] + i * 4, 16);
-				memcpy(srcBlock + 8 * 4, ctx->row_pointers[j + 2] + i * 4, 16);
-				memcpy(srcBlock + 12 * 4, ctx->row_pointers[j + 3] + i * 4, 16);
-				getBaseColors(color0, color1, srcBlock);
-				*(PNGU_u16 *)outBuf = rgb8ToRGB565(color0);
-				outBuf += 2;
-				*(PNGU_u16 *)outBuf = rgb8ToRGB565(color1);
-				outBuf += 2;
-				*(PNGU_u32 *)outBuf = colorIndices(color0, color1, srcBlock);
-				outBuf += 4;
-			}
-	// Free resources
-	free(ctx->img_data);
-	free(ctx->row_pointers);
+	for (ii = 0; ii < (int)c->width; ii += 8)
+		for (k = 0; k < 4; ++k)
+		{
+			int j = (k >> 1) << 2;
+			int i = ii + ((k & 1) << 2);
+			memcpy(srcBlock, rows[j] + i * 4, 16);
+			memcpy(srcBlock + 4 * 4, rows[j + 1] + i * 4, 16);
+			memcpy(srcBlock + 8 * 4, rows[j + 2] + i * 4, 16);
+			memcpy(srcBlock + 12 * 4, rows[j + 3] + i * 4, 16);
+			getBaseColors(color0, color1, srcBlock);
+			*(PNGU_u16 *)outBuf = rgb8ToRGB565(color0);
+			outBuf += 2;
+			*(PNGU_u16 *)outBuf = rgb8ToRGB565(color1);
+			outBuf += 2;
+			*(PNGU_u32 *)outBuf = colorIndices(color0, color1, srcBlock);
+			outBuf += 4;
+		}
+	c->outBuf = outBuf;
+}
 
-	// Success
-	return PNGU_OK;
+
+int PNGU_DecodeToCMPR(IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, void *buffer)
+{
+	struct pngu_cmpr c;
+
+	c.outBuf = (PNGU_u8 *)buffer;
+	c.width = width & ~7u;
+	// A row of 8x8 tiles at a time, rows past the last full tile are dropped
+	return pngu_decode_strips (ctx, width, height, 0, 1, 8, pngu_strip_CMPR, &c);
 }
 
 void user_error(png_structp png_ptr, png_const_charp c)
@@ -1118,6 +1160,9 @@ int pngu_decode (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, PNGU_u32 stripAlph
 	if ( (ctx->prop.imgColorType == PNGU_COLOR_TYPE_PALETTE) || (ctx->prop.imgColorType == PNGU_COLOR_TYPE_UNKNOWN) )
 		return PNGU_UNSUPPORTED_COLOR_TYPE;
 
+	ctx->img_data = NULL;
+	ctx->row_pointers = NULL;
+
 	 // error handling
 	jmp_buf save_jmp;
 	memcpy(save_jmp, png_jmpbuf(ctx->png_ptr), sizeof(save_jmp));
@@ -1132,6 +1177,64 @@ int pngu_decode (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, PNGU_u32 stripAlph
 		return mem_err ? PNGU_LIB_ERROR : -666;
 	}
 	png_set_error_fn(ctx->png_ptr, NULL, user_error, user_error);
+
+	pngu_set_transforms (ctx, stripAlpha, force32bit);
+
+	// Flush transformations
+	png_read_update_info (ctx->png_ptr, ctx->info_ptr);
+
+	// Allocate memory to store the image
+	png_uint_32 rowbytes = png_get_rowbytes (ctx->png_ptr, ctx->info_ptr);
+	if (rowbytes % 4)
+		rowbytes = ((rowbytes / 4) + 1) * 4; // Add extra padding so each row starts in a 4 byte boundary
+
+	ctx->img_data = malloc(rowbytes * ctx->prop.imgHeight);
+	if (!ctx->img_data)
+	{
+		mem_err = 1;
+		goto error;
+	}
+
+	ctx->row_pointers = malloc(sizeof (png_bytep) * ctx->prop.imgHeight);
+	if (!ctx->row_pointers)
+	{
+		mem_err = 1;
+		goto error;
+	}
+
+	for (i = 0; i < ctx->prop.imgHeight; i++)
+		ctx->row_pointers[i] = ctx->img_data + (i * rowbytes);
+
+	// Transform the image and copy it to our allocated memory
+	if (png_get_interlace_type(ctx->png_ptr, ctx->info_ptr) != PNG_INTERLACE_NONE)
+	png_read_image (ctx->png_ptr, ctx->row_pointers);
+	else
+	{
+		int rowsLeft = ctx->prop.imgHeight;
+		png_bytep *curRow = ctx->row_pointers;
+		while (rowsLeft > 0)
+		{
+			int chunk = rowsLeft > 0x80 ? 0x80 : rowsLeft;
+			png_read_rows(ctx->png_ptr, curRow, NULL, chunk);
+			usleep(1000);
+			curRow += chunk;
+			rowsLeft -= chunk;
+		}
+	}
+
+	// restore default error handling
+	memcpy(png_jmpbuf(ctx->png_ptr), save_jmp, sizeof(save_jmp));
+
+	// Free resources
+	pngu_free_info(ctx);
+
+	// Success
+	return PNGU_OK;
+}
+
+
+void pngu_set_transforms (IMGCTX ctx, PNGU_u32 stripAlpha, int force32bit)
+{
 	// Scale 16 bit samples to 8 bit
 	if (ctx->prop.imgBitDepth == 16)
 		png_set_strip_16 (ctx->png_ptr);
@@ -1151,46 +1254,95 @@ int pngu_decode (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, PNGU_u32 stripAlph
 	// Transform RBG images to RGBA
 	if (force32bit && (ctx->prop.imgColorType == PNGU_COLOR_TYPE_GRAY || ctx->prop.imgColorType == PNGU_COLOR_TYPE_RGB))
 		png_set_filler(ctx->png_ptr, 0xFF, PNG_FILLER_AFTER);
+}
+
+
+int pngu_decode_strips (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, PNGU_u32 stripAlpha, int force32bit, PNGU_u32 stripRows, pngu_strip_fn fn, void *data)
+{
+	PNGU_u32 i, strip, rowsRead = 0;
+	int mem_err = 0;
+
+	// Read info if it hasn't been read before
+	if (!ctx->infoRead)
+	{
+		i = pngu_info (ctx);
+		if (i != PNGU_OK) return i;
+	}
+
+	// Check if the user has specified the real width and height of the image
+	if ( (ctx->prop.imgWidth != width) || (ctx->prop.imgHeight != height) )
+		return PNGU_INVALID_WIDTH_OR_HEIGHT;
+
+	// Check if color type is supported by PNGU
+	if ( (ctx->prop.imgColorType == PNGU_COLOR_TYPE_PALETTE) || (ctx->prop.imgColorType == PNGU_COLOR_TYPE_UNKNOWN) )
+		return PNGU_UNSUPPORTED_COLOR_TYPE;
+
+	// Interlaced rows are only complete after the last pass, decode the whole image
+	if (png_get_interlace_type(ctx->png_ptr, ctx->info_ptr) != PNG_INTERLACE_NONE)
+	{
+		int result = pngu_decode (ctx, width, height, stripAlpha, force32bit);
+		if (result != PNGU_OK) return result;
+		for (strip = 0; strip < height / stripRows; strip++)
+			fn (ctx->row_pointers + strip * stripRows, strip, data);
+		free(ctx->img_data);
+		free(ctx->row_pointers);
+		return PNGU_OK;
+	}
+
+	ctx->img_data = NULL;
+	ctx->row_pointers = NULL;
+
+	 // error handling
+	jmp_buf save_jmp;
+	memcpy(save_jmp, png_jmpbuf(ctx->png_ptr), sizeof(save_jmp));
+	if (setjmp(png_jmpbuf(ctx->png_ptr)))
+	{
+		error:
+		memcpy(png_jmpbuf(ctx->png_ptr), save_jmp, sizeof(save_jmp));
+		free(ctx->row_pointers);
+		free(ctx->img_data);
+		pngu_free_info (ctx);
+		return mem_err ? PNGU_LIB_ERROR : -666;
+	}
+	png_set_error_fn(ctx->png_ptr, NULL, user_error, user_error);
+
+	pngu_set_transforms (ctx, stripAlpha, force32bit);
 
 	// Flush transformations
 	png_read_update_info (ctx->png_ptr, ctx->info_ptr);
 
-	// Allocate memory to store the image
+	// Only one strip is kept in memory, the caller converts it before the next one is read
 	png_uint_32 rowbytes = png_get_rowbytes (ctx->png_ptr, ctx->info_ptr);
 	if (rowbytes % 4)
 		rowbytes = ((rowbytes / 4) + 1) * 4; // Add extra padding so each row starts in a 4 byte boundary
 
-	ctx->img_data = malloc(rowbytes * ctx->prop.imgHeight);
+	ctx->img_data = malloc(rowbytes * stripRows);
 	if (!ctx->img_data)
 	{
 		mem_err = 1;
 		goto error;
 	}
 
-	ctx->row_pointers = malloc(sizeof (png_bytep) * ctx->prop.imgHeight);
+	ctx->row_pointers = malloc(sizeof (png_bytep) * stripRows);
 	if (!ctx->row_pointers)
 	{
 		mem_err = 1;
 		goto error;
 	}
 
-	for (i = 0; i < ctx->prop.imgHeight; i++)
+	for (i = 0; i < stripRows; i++)
 		ctx->row_pointers[i] = ctx->img_data + (i * rowbytes);
 
-	// Transform the image and copy it to our allocated memory
-	if (png_get_interlace_type(ctx->png_ptr, ctx->info_ptr) != PNG_INTERLACE_NONE)
-	png_read_image (ctx->png_ptr, ctx->row_pointers);
-	else
+	for (strip = 0; strip < height / stripRows; strip++)
 	{
-		int rowsLeft = ctx->prop.imgHeight;
-		png_bytep *curRow = ctx->row_pointers;
-		while (rowsLeft > 0)
+		png_read_rows(ctx->png_ptr, ctx->row_pointers, NULL, stripRows);
+		fn (ctx->row_pointers, strip, data);
+		// Same pause as pngu_decode every 128 rows
+		rowsRead += stripRows;
+		if (rowsRead >= 0x80)
 		{
-			int chunk = rowsLeft > 0x80 ? 0x80 : rowsLeft;
-			png_read_rows(ctx->png_ptr, curRow, NULL, chunk);
 			usleep(1000);
-			curRow += chunk;
-			rowsLeft -= chunk;
+			rowsRead -= 0x80;
 		}
 	}
 
@@ -1198,6 +1350,8 @@ int pngu_decode (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, PNGU_u32 stripAlph
 	memcpy(png_jmpbuf(ctx->png_ptr), save_jmp, sizeof(save_jmp));
 
 	// Free resources
+	free(ctx->img_data);
+	free(ctx->row_pointers);
 	pngu_free_info(ctx);
 
 	// Success
@@ -0,0 +1,198 @@
+#include <string.h>
+
+#include "residency.hpp"
+#include "gecko/gecko.hpp"
+#include "memory/mem2.hpp"
+
+CResidency Residency;
+
+static const char *categoryNames[RES_CATEGORIES] = {
+	"covers", "fanart", "banner", "theme"
+};
+
+void CResidency::Init(void)
+{
+	memset(m_entries, 0, sizeof(m_entries));
+	for(u32 i = 0; i < RES_CATEGORIES; ++i)
+		m_used[i] = 0;
+	m_budget[RES_COVER] = 16 * 1024 * 1024;
+	m_budget[RES_FANART] = 8 * 1024 * 1024;
+	m_budget[RES_BANNER] = 4 * 1024 * 1024;
+	m_budget[RES_THEME] = 12 * 1024 * 1024;
+	m_next = 0;
+	m_clock = 0;
+	m_stamp = 0;
+	LWP_MutexInit(&m_mutex, 0);
+}
+
+void CResidency::SetBudget(u32 cat, u32 bytes)
+{
+	if(cat < RES_CATEGORIES)
+		m_budget[cat] = bytes;
+}
+
+CResidency::SEntry *CResidency::_entry(s32 handle)
+{
+	if(handle < 0 || (handle & 0xFFFF) >= RES_ENTRIES)
+		return NULL;
+	SEntry *e = &m_entries[handle & 0xFFFF];
+	if(!e->used || e->gen != (u32)handle >> 16)
+		return NULL;
+	return e;
+}
+
+s32 CResidency::Add(u32 cat, u32 bytes, void *owner, u32 id, ResReclaim reclaim)
+{
+	if(cat >= RES_CATEGORIES)
+		return -1;
+	LWP_MutexLock(m_mutex);
+	for(u32 k = 0; k < RES_ENTRIES; ++k)
+	{
+		/* Continue after the last entry taken, freed ones are usually older */
+		u32 i = (m_next + k) % RES_ENTRIES;
+		SEntry &e = m_entries[i];
+		if(e.used)
+			continue;
+		e.owner = owner;
+		e.reclaim = reclaim;
+		e.id = id;
+		e.bytes = bytes;
+		e.lastUse = ++m_clock;
+		e.tried = 0;
+		e.gen = (e.gen + 1) & 0x7FFF;
+		e.cat = cat;
+		e.pinned = reclaim == NULL;
+		e.used = true;
+		m_used[cat] += bytes;
+		m_next = i + 1;
+		LWP_MutexUnlock(m_mutex);
+		return (s32)(e.gen << 16 | i);
+	}
+	LWP_MutexUnlock(m_mutex);
+	gprintf("Residency: no free entry for %u bytes of %s\n", bytes, categoryNames[cat]);
+	return -1;
+}
+
+void CResidency::Resize(s32 handle, u32 bytes)
+{
+	LWP_MutexLock(m_mutex);
+	SEntry *e = _entry(handle);
+	if(e != NULL)
+	{
+		m_used[e->cat] = m_used[e->cat] - e->bytes + bytes;
+		e->bytes = bytes;
+	}
+	LWP_MutexUnlock(m_mutex);
+}
+
+void CResidency::Remove(s32 handle)
+{
+	LWP_MutexLock(m_mutex);
+	SEntry *e = _entry(handle);
+	if(e != NULL)
+	{
+		m_used[e->cat] -= e->bytes;
+		e->used = false;
+	}
+	LWP_MutexUnlock(m_mutex);
+}
+
+void CResidency::Pin(s32 handle, bool pinned)
+{
+	LWP_MutexLock(m_mutex);
+	SEntry *e = _entry(handle);
+	if(e != NULL && e->reclaim != NULL)
+		e->pinned = pinned;
+	LWP_MutexUnlock(m_mutex);
+}
+
+void CResidency::Touch(s32 handle)
+{
+	/* A race on the clock only blurs the order, no need for the lock */
+	if(handle >= 0 && (handle & 0xFFFF) < RES_ENTRIES)
+		m_entries[handle & 0xFFFF].lastUse = ++m_clock;
+}
+
+bool CResidency::_fits(u32 cat, u32 bytes) const
+{
+	return m_used[cat] + bytes <= m_budget[cat] && MEM2_freesize() >= bytes + RES_MARGIN;
+}
+
+s32 CResidency::_victim(u32 cat, u32 bytes, u32 stamp)
+{
+	/* Over its own budget a category only makes room from itself, when MEM2
+	   runs short the categories over budget go first, then the asking one */
+	bool own = m_used[cat] + bytes > m_budget[cat];
+	u32 bestTier = 3;
+	u32 bestAge = 0;
+	s32 best = -1;
+
+	for(u32 i = 0; i < RES_ENTRIES; ++i)
+	{
+		const SEntry &e = m_entries[i];
+		if(!e.used || e.pinned || e.tried == stamp || e.bytes == 0)
+			continue;
+		if(own && e.cat != cat)
+			continue;
+		u32 tier = m_used[e.cat] > m_budget[e.cat] ? 0 : (e.cat == cat ? 1 : 2);
+		u32 age = m_clock - e.lastUse;
+		if(tier < bestTier || (tier == bestTier && age > bestAge))
+		{
+			bestTier = tier;
+			bestAge = age;
+			best = i;
+		}
+	}
+	if(best >= 0)
+		m_entries[best].tried = stamp;
+	return best;
+}
+
+bool CResidency::Reserve(u32 cat, u32 bytes)
+{
+	if(cat >= RES_CATEGORIES)
+		return false;
+	ResAction action = RES_DOWNGRADE;
+	LWP_MutexLock(m_mutex);
+	u32 stamp = ++m_stamp;
+	while(!_fits(cat, bytes))
+	{
+		s32 i = _victim(cat, bytes, stamp);
+		if(i < 0)
+		{
+			if(action == RES_EVICT)
+				break;
+			/* Nothing left to downgrade, go over the entries again */
+			action = RES_EVICT;
+			stamp = ++m_stamp;
+			continue;
+		}
+		SEntry e = m_entries[i];
+		/* The owner takes its own lock and calls back into Resize or Remove */
+		LWP_MutexUnlock(m_mutex);
+		e.reclaim(e.owner, e.id, (s32)(e.gen << 16 | i), action);
+		LWP_MutexLock(m_mutex);
+	}
+	bool fits = _fits(cat, bytes);
+	LWP_MutexUnlock(m_mutex);
+	return fits;
+}
+
+void CResidency::Dump(void)
+{
+	gprintf("Residency: MEM2 free %u\n", MEM2_freesize());
+	for(u32 i = 0; i < RES_CATEGORIES; ++i)
+		gprintf("  %-6s %8u / %8u\n", categoryNames[i], m_used[i], m_budget[i]);
+}
+
+u32 CResidency::TexSize(const TexData &tex)
+{
+	if(tex.data == NULL)
+		return 0;
+	return fixGX_GetTexBufferSize(tex.width, tex.height, tex.format, tex.maxLOD > 0 ? GX_TRUE : GX_FALSE, tex.maxLOD);
+}
+
+const char *CResidency::CategoryName(u32 cat)
+{
+	return cat < RES_CATEGORIES ? categoryNames[cat] : "";
+}
@@ -0,0 +1,85 @@
+// Texture memory residency
+
+#ifndef __RESIDENCY_HPP
+#define __RESIDENCY_HPP
+
+#include <ogc/mutex.h>
+#include <gctypes.h>
+
+#include "texture.hpp"
+
+enum ResCategory
+{
+	RES_COVER = 0,
+	RES_FANART,
+	RES_BANNER,
+	RES_THEME,
+	RES_CATEGORIES
+};
+
+enum ResAction
+{
+	RES_DOWNGRADE = 0,	// keep the lower mip levels only
+	RES_EVICT			// free the whole texture
+};
+
+/* Asks an owner to give memory back, called without the residency lock held.
+   The owner updates its entry with Resize or Remove and returns false if it
+   had nothing to give. */
+typedef bool (*ResReclaim)(void *owner, u32 id, s32 handle, ResAction action);
+
+#define RES_ENTRIES		1024
+#define RES_MARGIN		(1024 * 1024)
+
+/* Tracks the MEM2 used by textures per category. When a category needs room
+   the least recently drawn entries are downgraded first, then evicted,
+   starting with the categories over their budget. Entries without a reclaim
+   callback or pinned ones are never touched. */
+class CResidency
+{
+public:
+	void Init(void);
+	void SetBudget(u32 cat, u32 bytes);
+	u32 Budget(u32 cat) const { return m_budget[cat]; }
+	u32 Used(u32 cat) const { return m_used[cat]; }
+	/* Returns the entry handle, -1 if the table is full */
+	s32 Add(u32 cat, u32 bytes, void *owner = NULL, u32 id = 0, ResReclaim reclaim = NULL);
+	void Resize(s32 handle, u32 bytes);
+	void Remove(s32 handle);
+	void Pin(s32 handle, bool pinned);
+	/* Marks the entry as drawn, cheap enough for every frame */
+	void Touch(s32 handle);
+	/* Makes room for bytes more in cat, true if they fit afterwards */
+	bool Reserve(u32 cat, u32 bytes);
+	void Dump(void);
+	static u32 TexSize(const TexData &tex);
+	static const char *CategoryName(u32 cat);
+private:
+	struct SEntry
+	{
+		void *owner;
+		ResReclaim reclaim;
+		u32 id;
+		u32 bytes;
+		u32 lastUse;
+		u32 tried;
+		u16 gen;
+		u8 cat;
+		bool pinned;
+		bool used;
+	};
+	SEntry *_entry(s32 handle);
+	bool _fits(u32 cat, u32 bytes) const;
+	s32 _victim(u32 cat, u32 bytes, u32 stamp);
+	SEntry m_entries[RES_ENTRIES];
+	u32 m_budget[RES_CATEGORIES];
+	u32 m_used[RES_CATEGORIES];
+	u32 m_next;
+	u32 m_clock;
+	u32 m_stamp;
+	mutex_t m_mutex;
+};
+
+extern CResidency Residency;
+
+#endif // !defined(__RESIDENCY_HPP)
@@ -316,7 +316,10 @@ void CText::setFrame(float width, u16 style, bool ignoreNewlines, bool instant)
 
 		for (u32 i = 0; i < words.size(); ++i)
 		{
-			float wordWidth = m_font.font->getWidth(words[i].text.c_str());
+			// Words keep their width, relayouts don't measure them again
+			if (words[i].width < 0.f)
+				words[i].width = m_font.font->getWidth(words[i].text.c_str());
+			float wordWidth = words[i].width;
 			if (posX == 0.f || posX + (float)wordWidth + space * 2 <= width)
 			{
 				words[i].targetPos = Vector3D(posX, posY, 0.f);
@@ -33,9 +33,11 @@ private:
 
 struct SWord
 {
+	SWord(void) : width(-1.f) { }
 	wstringEx text;
 	Vector3D pos;
 	Vector3D targetPos;
+	float width;
 };
 typedef vector<SWord> CLine;
 
@@ -41,30 +41,6 @@ static inline u32 coordsRGB565(u32 x, u32 y, u32 w)
 	return (((y >> 2) * (w >> 2) + (x >> 2)) << 4) + ((y & 3) << 2) + (x & 3);
 }
 
-static inline void _convertToFlippedRGBA(u8 *dst, const u8 *src, u32 width, u32 height)
-{
-	for(u32 block = 0; block < height; block += 4)
-	{
-		for(u32 i = 0; i < width; i += 4)
-		{
-			for(u32 c = 0; c < 4; ++c)
-			{
-				for(u32 rgb = 0; rgb < 4; ++rgb)
-				{
-					u32 y = height - 1 - (c + block);
-					u32 x = rgb + i;
-					u32 dst_offset = (x + y * width) * 4;
-					u32 src_offset = (x + ((block + c) * width)) * 3;
-					/* RGB */
-					memcpy(&dst[dst_offset], &src[src_offset], 3);
-					/* Alpha */
-					dst[dst_offset + 3] = 0xFF;
-				}
-			}
-		}
-	}
-}
-
 static inline void _convertToRGBA(u8 *dst, const u8 *src, u32 width, u32 height)
 {
 	for (u32 y = 0; y < height; ++y)
@@ -204,6 +180,35 @@ static inline void _convertToCMPR(u8 *dst, const u8 *src, u32 width, u32 height)
 			}
 }
 
+/* Reads the next rows of a JPEG as RGBA, the columns up to pitch and the rows
+   past the bottom repeat the last ones */
+static bool _readJpegRows(JpegReader &jpeg, u8 *dst, u32 y, u32 rows, u32 pitch)
+{
+	u32 width = jpeg.getWidth();
+
+	for(u32 r = 0; r < rows; ++r, ++y, dst += pitch * 4)
+	{
+		if(y >= (u32)jpeg.getHeight())
+		{
+			memcpy(dst, dst - pitch * 4, pitch * 4);
+			continue;
+		}
+		if(!jpeg.readRow(dst))
+			return false;
+		/* Expand in place from the end, pixel x is never written over before it is read */
+		for(u32 x = width; x-- > 0; )
+		{
+			dst[x * 4 + 3] = 0xFF;
+			dst[x * 4 + 2] = dst[x * 3 + 2];
+			dst[x * 4 + 1] = dst[x * 3 + 1];
+			dst[x * 4] = dst[x * 3];
+		}
+		for(u32 x = width; x < pitch; ++x)
+			memcpy(&dst[x * 4], &dst[(width - 1) * 4], 4);
+	}
+	return true;
+}
+
 void STexture::Cleanup(TexData &tex)
 {
 	if(tex.data != NULL)
@@ -236,6 +241,32 @@ bool STexture::CopyTexture(const TexData &src, TexData &dest)
 	return true;
 }
 
+/* A file buffer, an RGBA8 copy of the image and the texture at most */
+static u32 imageNeed(const u8 *img, u32 size)
+{
+	u32 w = 0;
+	u32 h = 0;
+	if(size >= 24 && *(vu32*)img == 0x89504E47)
+	{
+		w = *(vu32*)(img + 16);
+		h = *(vu32*)(img + 20);
+	}
+	else
+	{
+		/* Walk the JPEG segments up to the frame header */
+		for(u32 i = 2; i + 9 < size && img[i] == 0xFF; i += 2 + (img[i + 2] << 8 | img[i + 3]))
+		{
+			if(img[i + 1] >= 0xC0 && img[i + 1] <= 0xC2)
+			{
+				h = img[i + 5] << 8 | img[i + 6];
+				w = img[i + 7] << 8 | img[i + 8];
+				break;
+			}
+		}
+	}
+	return size + w * h * 8;
+}
+
 TexErr STexture::fromImageFile(TexData &dest, const char *filename, u8 f, u32 minMipSize, u32 maxMipSize)
 {
 	Cleanup(dest);
@@ -256,6 +287,8 @@ TexErr STexture::fromImageFile(TexData &dest, const char *filename, u8 f, u32 mi
 		result = fromPNG(dest, Image, f, minMipSize, maxMipSize);
 	else
 		result = fromJPG(dest, Image, fileSize, f, minMipSize, maxMipSize);
+	if(result == TE_NOMEM)
+		dest.dataSize = imageNeed(Image, fileSize);
 	free(Image);
 
 	return result;
@@ -263,36 +296,53 @@ TexErr STexture::fromImageFile(TexData &dest, const char *filename, u8 f, u32 mi
 
 TexErr STexture::fromTHP(TexData &dest, const u8 *src, u32 w, u32 h)
 {
-	dest.width = w;
-	dest.height = h;
-	dest.format = GX_TF_RGBA8;
-	dest.dataSize = GX_GetTexBufferSize(dest.width, dest.height, dest.format, GX_FALSE, 0);
-	dest.data = (u8*)MEM2_alloc(dest.dataSize);
-	if(dest.data == NULL)
+	/* Video frames of the same size are converted into the same texture */
+	if(dest.data == NULL || dest.width != w || dest.height != h || dest.format != GX_TF_RGBA8)
 	{
 		Cleanup(dest);
-		return TE_NOMEM;
+		dest.width = w;
+		dest.height = h;
+		dest.format = GX_TF_RGBA8;
+		dest.maxLOD = 0;
+		dest.dataSize = GX_GetTexBufferSize(dest.width, dest.height, dest.format, GX_FALSE, 0);
+		dest.data = (u8*)MEM2_alloc(dest.dataSize);
+		if(dest.data == NULL)
+		{
+			Cleanup(dest);
+			return TE_NOMEM;
+		}
 	}
-	for(u32 block = 0; block < dest.height; block += 4)
+	/* The frame is bottom up with rows padded to 4 bytes. Each 4x4 tile is
+	   written as 8 words of AR pairs followed by 8 words of GB pairs. */
+	u32 pitch = (w * 3 + 3) & ~3u;
+	u32 *dst = (u32 *)dest.data;
+	u8 edge[4][12];
+	for(u32 block = 0; block < h; block += 4)
 	{
-		for(u32 i = 0; i < dest.width; i += 4)
+		const u8 *rows[4];
+		for(u32 c = 0; c < 4; ++c)
+			rows[c] = src + (h - 1 - min(block + c, h - 1)) * pitch;
+		for(u32 i = 0; i < w; i += 4, dst += 16)
 		{
-			for(u32 c = 0; c < 4; ++c)
+			const u8 *px[4] = { rows[0] + i * 3, rows[1] + i * 3, rows[2] + i * 3, rows[3] + i * 3 };
+			if(i + 4 > w)
 			{
-				for(u32 argb = 0; argb < 4; ++argb)
+				/* Last tile of an odd width, repeat the last column */
+				for(u32 c = 0; c < 4; ++c)
 				{
-					u32 y = h - 1 - (c + block);
-					u32 x = argb + i;
-					u32 src_offset = ((i + argb) + ((block + c) * dest.width)) * 3;
-					u32 dst_offset = coordsRGBA8(x, y, dest.width);
-					/* Alpha */
-					dest.data[dst_offset] = 0xFF;
-					/* RGB */
-					dest.data[dst_offset + 1] = src[src_offset];
-					dest.data[dst_offset + 32] = src[src_offset + 1];
-					dest.data[dst_offset + 33] = src[src_offset + 2];
+					for(u32 x = 0; x < 4; ++x)
+						memcpy(&edge[c][x * 3], px[c] + min(x, w - 1 - i) * 3, 3);
+					px[c] = edge[c];
 				}
 			}
+			for(u32 c = 0; c < 4; ++c)
+			{
+				const u8 *p = px[c];
+				dst[c * 2] = 0xFF00FF00 | p[0] << 16 | p[3];
+				dst[c * 2 + 1] = 0xFF00FF00 | p[6] << 16 | p[9];
+				dst[c * 2 + 8] = p[1] << 24 | p[2] << 16 | p[4] << 8 | p[5];
+				dst[c * 2 + 9] = p[7] << 24 | p[8] << 16 | p[10] << 8 | p[11];
+			}
 		}
 	}
 	DCFlushRange(dest.data, dest.dataSize);
@@ -303,27 +353,12 @@ TexErr STexture::fromJPG(TexData &dest, const u8 *buffer, const u32 buffer_size,
 {
 	Cleanup(dest);
 
-	// Decode our JPG to raw
-	VideoFrame VideoF;
-	decodeRealJpeg(buffer, buffer_size, VideoF, true);
-	if(!VideoF.getData())
+	// Rows come out of the decoder one by one, no full RGB copy of the image
+	JpegReader jpeg;
+	if(!jpeg.open(buffer, buffer_size, true))
 		return TE_ERROR;
-	dest.data = VideoF.getData();
-	dest.width = VideoF.getWidth();
-	dest.height = VideoF.getHeight();
-
-	// Convert our raw stuff to a usable format
-	u8 *rawData = (u8*)MEM2_alloc(dest.width * dest.height * 4);
-	if(rawData == NULL)
-	{
-		Cleanup(dest);
-		return TE_NOMEM;
-	}
-	_convertToFlippedRGBA(rawData, dest.data, dest.width, dest.height);
-
-	//Free our raw stuff
-	VideoF.dealloc();
-	dest.data = NULL;
+	dest.width = ALIGN(4, jpeg.getWidth());
+	dest.height = ALIGN(4, jpeg.getHeight());
 
 	//Let the real work begin
 	u8 maxLODTmp = 0;
@@ -346,81 +381,67 @@ TexErr STexture::fromJPG(TexData &dest, const u8 *buffer, const u32 buffer_size,
 		_calcMipMaps(maxLODTmp, minLODTmp, baseWidth, baseHeight, dest.width, dest.height, minMipSize, maxMipSize);
 	if (maxLODTmp > 0)
 	{
-		rawData = _genMipMaps(rawData, dest.width, dest.height, maxLODTmp, baseWidth, baseHeight);
+		// The mipmaps are resized from the whole image
+		u8 *rawData = (u8*)MEM2_alloc(dest.width * dest.height * 4);
 		if(rawData == NULL)
 		{
 			Cleanup(dest);
 			return TE_NOMEM;
 		}
-		u32 newWidth = baseWidth;
-		u32 newHeight = baseHeight;
-		for(int i = 0; i < minLODTmp; ++i)
+		if(!_readJpegRows(jpeg, rawData, 0, dest.height, dest.width))
+		{
+			free(rawData);
+			Cleanup(dest);
+			return TE_ERROR;
+		}
+		jpeg.close();
+		TexErr err = _genMipMaps(dest, rawData, dest.width, dest.height, minLODTmp, maxLODTmp, baseWidth, baseHeight);
+		if(err != TE_OK)
 		{
-			newWidth >>= 1;
-			newHeight >>= 1;
+			Cleanup(dest);
+			return err;
 		}
-		dest.dataSize = fixGX_GetTexBufferSize(newWidth, newHeight, dest.format, GX_TRUE, maxLODTmp - minLODTmp);
+	}
+	else
+	{
+		dest.dataSize = GX_GetTexBufferSize(dest.width, dest.height, dest.format, GX_FALSE, 0);
 		dest.data = (u8*)MEM2_alloc(dest.dataSize);
-		if(dest.data == NULL)
+		// Converted a row of tiles at a time, CMPR tiles are 8x8
+		u32 bandRows = f == GX_TF_CMPR ? 8 : 4;
+		u32 bandWidth = ALIGN(bandRows, dest.width);
+		u8 *band = (u8*)MEM2_alloc(bandWidth * bandRows * 4);
+		if(dest.data == NULL || band == NULL)
 		{
+			free(band);
 			Cleanup(dest);
-			free(rawData);
 			return TE_NOMEM;
 		}
-		u32 nWidth = newWidth;
-		u32 nHeight = newHeight;
-		u8 *pSrc = rawData;
-		if (minLODTmp > 0)
-			pSrc += fixGX_GetTexBufferSize(baseWidth, baseHeight, dest.format, minLODTmp > 1 ? GX_TRUE : GX_FALSE, minLODTmp - 1);
-		u8 *pDst = dest.data;
-		for (u8 i = minLODTmp; i <= maxLODTmp; ++i)
+		u32 bandSize = GX_GetTexBufferSize(bandWidth, bandRows, f, GX_FALSE, 0);
+		u8 *dst = dest.data;
+		for(u32 y = 0; y < dest.height; y += bandRows, dst += bandSize)
 		{
+			if(!_readJpegRows(jpeg, band, y, bandRows, bandWidth))
+			{
+				free(band);
+				Cleanup(dest);
+				return TE_ERROR;
+			}
 			switch(f)
 			{
 				case GX_TF_RGBA8:
-					_convertToRGBA8(pDst, pSrc, nWidth, nHeight);
+					_convertToRGBA8(dst, band, bandWidth, bandRows);
 					break;
 				case GX_TF_RGB565:
-					_convertToRGB565(pDst, pSrc, nWidth, nHeight);
+					_convertToRGB565(dst, band, bandWidth, bandRows);
 					break;
 				case GX_TF_CMPR:
-					_convertToCMPR(pDst, pSrc, nWidth, nHeight);
+					_convertToCMPR(dst, band, bandWidth, bandRows);
 					break;
 			}
-			pSrc += nWidth * nHeight * 4;
-			pDst += GX_GetTexBufferSize(nWidth, nHeight, dest.format, GX_FALSE, 0);
-			nWidth >>= 1;
-			nHeight >>= 1;
-		}
-		dest.maxLOD = maxLODTmp - minLODTmp;
-		dest.width = newWidth;
-		dest.height = newHeight;
-	}
-	else
-	{
-		dest.dataSize = GX_GetTexBufferSize(dest.width, dest.height, dest.format, GX_FALSE, 0);
-		dest.data = (u8*)MEM2_alloc(dest.dataSize);
-		if(dest.data == NULL)
-		{
-			Cleanup(dest);
-			free(rawData);
-			return TE_NOMEM;
-		}
-		switch(f)
-		{
-			case GX_TF_RGBA8:
-				_convertToRGBA8(dest.data, rawData, dest.width, dest.height);
-				break;
-			case GX_TF_RGB565:
-				_convertToRGB565(dest.data, rawData, dest.width, dest.height);
-				break;
-			case GX_TF_CMPR:
-				_convertToCMPR(dest.data, rawData, dest.width, dest.height);
-				break;
 		}
+		free(band);
 	}
 	DCFlushRange(dest.data, dest.dataSize);
-	free(rawData);
 	return TE_OK;
 }
 
@@ -461,13 +482,6 @@ TexErr STexture::fromPNG(TexData &dest, const u8 *buffer, u8 f, u32 minMipSize,
 		_calcMipMaps(maxLODTmp, minLODTmp, baseWidth, baseHeight, imgProp.imgWidth, imgProp.imgHeight, minMipSize, maxMipSize);
 	if (maxLODTmp > 0)
 	{
-		u32 newWidth = baseWidth;
-		u32 newHeight = baseHeight;
-		for (int i = 0; i < minLODTmp; ++i)
-		{
-			newWidth >>= 1;
-			newHeight >>= 1;
-		}
 		u32 Size2 = imgProp.imgWidth * imgProp.imgHeight * 4;
 		u8 *tmpData2 = (u8*)MEM2_alloc(Size2);
 		if(tmpData2 == NULL)
@@ -496,51 +510,13 @@ TexErr STexture::fromPNG(TexData &dest, const u8 *buffer, u8 f, u32 minMipSize,
 			DCFlushRange(tmpData2, Size2);
 			Cleanup(dest);
 		}
-		tmpData2 = _genMipMaps(tmpData2, imgProp.imgWidth, imgProp.imgHeight, maxLODTmp, baseWidth, baseHeight);
-		if(tmpData2 == NULL)
-		{
-			Cleanup(dest);
-			return TE_NOMEM;
-		}
-		u32 nWidth = newWidth;
-		u32 nHeight = newHeight;
-		u8 *pSrc = tmpData2;
-		if(minLODTmp > 0)
-			pSrc += fixGX_GetTexBufferSize(baseWidth, baseHeight, f, minLODTmp > 1 ? GX_TRUE : GX_FALSE, minLODTmp - 1);
-		dest.dataSize = fixGX_GetTexBufferSize(newWidth, newHeight, f, GX_TRUE, maxLODTmp - minLODTmp);
-		dest.data = (u8*)MEM2_alloc(dest.dataSize);
-		if(dest.data == NULL)
+		dest.format = f;
+		TexErr err = _genMipMaps(dest, tmpData2, imgProp.imgWidth, imgProp.imgHeight, minLODTmp, maxLODTmp, baseWidth, baseHeight);
+		if(err != TE_OK)
 		{
 			Cleanup(dest);
-			free(tmpData2);
-			return TE_NOMEM;
-		}
-		memset(dest.data, 0, dest.dataSize);
-		u8 *pDst = dest.data;
-		for(u8 i = minLODTmp; i <= maxLODTmp; ++i)
-		{
-			switch(f)
-			{
-				case GX_TF_RGBA8:
-					_convertToRGBA8(pDst, pSrc, nWidth, nHeight);
-					break;
-				case GX_TF_RGB565:
-					_convertToRGB565(pDst, pSrc, nWidth, nHeight);
-					break;
-				case GX_TF_CMPR:
-					_convertToCMPR(pDst, pSrc, nWidth, nHeight);
-					break;
-			}
-			pSrc += nWidth * nHeight * 4;
-			pDst += GX_GetTexBufferSize(nWidth, nHeight, f, GX_FALSE, 0);
-			nWidth >>= 1;
-			nHeight >>= 1;
+			return err;
 		}
-		free(tmpData2);
-		dest.maxLOD = maxLODTmp - minLODTmp;
-		dest.format = f;
-		dest.width = newWidth;
-		dest.height = newHeight;
 	}
 	else
 	{
@@ -590,97 +566,97 @@ void STexture::_reduceAlpha(TexData &dest, bool reduce_alpha)
 	DCFlushRange(dest.data, dest.dataSize);
 }
 
-void STexture::_resize(u8 *dst, u32 dstWidth, u32 dstHeight, const u8 *src, u32 srcWidth, u32 srcHeight)
+bool STexture::_resize(u8 *dst, u32 dstWidth, u32 dstHeight, const u8 *src, u32 srcWidth, u32 srcHeight)
 {
-	float wc = (float)srcWidth / (float)dstWidth;
-	float hc = (float)srcHeight / (float)dstHeight;
-	float ax1;
-	float ay1;
-	
-	for (u32 y = 0; y < dstHeight; ++y)
+	/* Bilinear in 16.16 fixed point, separable: the two source rows are blended
+	   into one row of 8.8 values, then each column is taken from that row */
+	u16 *row = (u16*)MEM2_alloc(srcWidth * 3 * sizeof(u16));
+	u16 *colX = (u16*)MEM2_alloc(dstWidth * 2 * sizeof(u16));
+	if(row == NULL || colX == NULL)
 	{
-		for (u32 x = 0; x < dstWidth; ++x)
+		free(row);
+		free(colX);
+		return false;
+	}
+	u16 *colW = colX + dstWidth;
+	u32 xStep = (srcWidth << 16) / dstWidth;
+	u32 yStep = (srcHeight << 16) / dstHeight;
+
+	for(u32 x = 0; x < dstWidth; ++x)
+	{
+		s32 pos = (s32)(x * xStep + (xStep >> 1)) - 0x8000;
+		u32 x0 = pos < 0 ? 0 : (u32)pos >> 16;
+		u32 w = pos < 0 ? 0 : ((u32)pos >> 8) & 0xFF;
+		if(x0 >= srcWidth - 1)
 		{
-			float xf = ((float)x + 0.5f) * wc - 0.5f;
-			float yf = ((float)y + 0.5f) * hc - 0.5f;
-			u32 x0 = (int)xf;
-			u32 y0 = (int)yf;
-			if (x0 >= srcWidth - 1)
-			{
-				x0 = srcWidth - 2;
-				ax1 = 1.f;
-			}
-			else
-				ax1 = xf - (float)x0;
-			float ax0 = 1.f - ax1;
-			if (y0 >= srcHeight - 1)
-			{
-				y0 = srcHeight - 2;
-				ay1 = 1.f;
-			}
-			else
-				ay1 = yf - (float)y0;
-			float ay0 = 1.f - ay1;
-			u8 *pdst = dst + (x + y * dstWidth) * 4;
-			const u8 *psrc0 = src + (x0 + y0 * srcWidth) * 4;
-			const u8 *psrc1 = psrc0 + srcWidth * 4;
-			for (int c = 0; c < 3; ++c)
-				pdst[c] = (u8)((((float)psrc0[c] * ax0) + ((float)psrc0[4 + c] * ax1)) * ay0 + (((float)psrc1[c] * ax0) + ((float)psrc1[4 + c] * ax1)) * ay1 + 0.5f);
+			x0 = srcWidth - 2;
+			w = 256;
+		}
+		colX[x] = x0 * 3;
+		colW[x] = w;
+	}
+	for(u32 y = 0; y < dstHeight; ++y)
+	{
+		s32 pos = (s32)(y * yStep + (yStep >> 1)) - 0x8000;
+		u32 y0 = pos < 0 ? 0 : (u32)pos >> 16;
+		u32 wy1 = pos < 0 ? 0 : ((u32)pos >> 8) & 0xFF;
+		if(y0 >= srcHeight - 1)
+		{
+			y0 = srcHeight - 2;
+			wy1 = 256;
+		}
+		u32 wy0 = 256 - wy1;
+		const u8 *psrc0 = src + y0 * srcWidth * 4;
+		const u8 *psrc1 = psrc0 + srcWidth * 4;
+		u16 *prow = row;
+		for(u32 x = 0; x < srcWidth; ++x)
+		{
+			prow[0] = psrc0[0] * wy0 + psrc1[0] * wy1;
+			prow[1] = psrc0[1] * wy0 + psrc1[1] * wy1;
+			prow[2] = psrc0[2] * wy0 + psrc1[2] * wy1;
+			prow += 3;
+			psrc0 += 4;
+			psrc1 += 4;
+		}
+		u8 *pdst = dst + y * dstWidth * 4;
+		for(u32 x = 0; x < dstWidth; ++x)
+		{
+			const u16 *p = row + colX[x];
+			u32 wx1 = colW[x];
+			u32 wx0 = 256 - wx1;
+			pdst[0] = (p[0] * wx0 + p[3] * wx1 + 0x8000) >> 16;
+			pdst[1] = (p[1] * wx0 + p[4] * wx1 + 0x8000) >> 16;
+			pdst[2] = (p[2] * wx0 + p[5] * wx1 + 0x8000) >> 16;
 			pdst[3] = 0xFF;	// Alpha not handled, it would require using it in the weights for color channels, easy but slower and useless so far.
+			pdst += 4;
 		}
 	}
+	free(row);
+	free(colX);
+	return true;
 }
 
-// For powers of two
+// For powers of two, dst can be src to halve a level in place
 void STexture::_resizeD2x2(u8 *dst, const u8 *src, u32 srcWidth, u32 srcHeight)
 {
-#if 0
 	u32 *dst32 = (u32 *)dst;
-	const u32 *src32 = (const u32 *)src;
-	u32 i = 0, i0 = 0, i1 = 1, i2 = srcWidth, i3 = srcWidth + 1, dstWidth = srcWidth >> 1, dstHeight = srcHeight >> 1;
-
-	for (u32 y = 0; y < dstHeight; ++y)
-	{
-		for (u32 x = 0; x < dstWidth; ++x)
-		{
-			dst32[i] = (((src32[i0] & 0xFCFCFCFC) >> 2)
-				+ ((src32[i1] & 0xFCFCFCFC) >> 2)
-				+ ((src32[i2] & 0xFCFCFCFC) >> 2)
-				+ ((src32[i3] & 0xFCFCFCFC) >> 2)) | 0x000000FF;
-			++i;
-			i0 += 2;
-			i1 += 2;
-			i2 += 2;
-			i3 += 2;
-		}
-		i0 += srcWidth;
-		i1 += srcWidth;
-		i2 += srcWidth;
-		i3 += srcWidth;
-	}
-#else
-	u32 i = 0, i0 = 0, i1 = 4, i2 = srcWidth * 4, i3 = (srcWidth + 1) * 4, dstWidth = srcWidth >> 1, dstHeight = srcHeight >> 1, w4 = srcWidth * 4;
+	u32 dstWidth = srcWidth >> 1, dstHeight = srcHeight >> 1;
 
 	for (u32 y = 0; y < dstHeight; ++y)
 	{
+		const u32 *row0 = (const u32 *)src + y * 2 * srcWidth;
+		const u32 *row1 = row0 + srcWidth;
 		for (u32 x = 0; x < dstWidth; ++x)
 		{
-			dst[i] = ((u32)src[i0] + src[i1] + src[i2] + src[i3]) >> 2;
-			dst[i + 1] = ((u32)src[i0 + 1] + src[i1 + 1] + src[i2 + 1] + src[i3 + 1]) >> 2;
-			dst[i + 2] = ((u32)src[i0 + 2] + src[i1 + 2] + src[i2 + 2] + src[i3 + 2]) >> 2;
-			dst[i + 3] = ((u32)src[i0 + 3] + src[i1 + 3] + src[i2 + 3] + src[i3 + 3]) >> 2;
-			i += 4;
-			i0 += 8;
-			i1 += 8;
-			i2 += 8;
-			i3 += 8;
+			u32 a = row0[0], b = row0[1], c = row1[0], d = row1[1];
+			// Even and odd bytes summed in 16 bit lanes, no carry crosses a channel
+			u32 even = (a & 0x00FF00FF) + (b & 0x00FF00FF) + (c & 0x00FF00FF) + (d & 0x00FF00FF);
+			u32 odd = ((a >> 8) & 0x00FF00FF) + ((b >> 8) & 0x00FF00FF) + ((c >> 8) & 0x00FF00FF) + ((d >> 8) & 0x00FF00FF);
+			*dst32++ = ((even >> 2) & 0x00FF00FF) | (((odd >> 2) & 0x00FF00FF) << 8);
+			row0 += 2;
+			row1 += 2;
 		}
-		i0 += w4;
-		i1 += w4;
-		i2 += w4;
-		i3 += w4;
 	}
-#endif
 }
 
 void STexture::_calcMipMaps(u8 &maxLOD, u8 &minLOD, u32 &lod0Width, u32 &lod0Height, u32 width, u32 height, u32 minSize, u32 maxSize)
@@ -703,30 +679,58 @@ void STexture::_calcMipMaps(u8 &maxLOD, u8 &minLOD, u32 &lod0Width, u32 &lod0Hei
 		maxLOD = minLOD;
 }
 
-u8 *STexture::_genMipMaps(u8 *src, u32 width, u32 height, u8 maxLOD, u32 lod0Width, u32 lod0Height)
+TexErr STexture::_genMipMaps(TexData &dest, u8 *src, u32 width, u32 height, u8 minLOD, u8 maxLOD, u32 lod0Width, u32 lod0Height)
 {
-	u32 bufSize = fixGX_GetTexBufferSize(lod0Width, lod0Height, GX_TF_RGBA8, GX_TRUE, maxLOD);
-	u8 *dstData = (u8*)MEM2_alloc(bufSize);
-	if(dstData == NULL)
-		return NULL;
-
-	memset(dstData, 0, bufSize);
-	_resize(dstData, lod0Width, lod0Height, src, width, height);
-	DCFlushRange(dstData, lod0Width * lod0Height * 4);
+	// Only lod 0 needs an RGBA8 buffer, each level is converted then halved in place
+	u8 *rgba = (u8*)MEM2_alloc(lod0Width * lod0Height * 4);
+	if(rgba == NULL || !_resize(rgba, lod0Width, lod0Height, src, width, height))
+	{
+		free(rgba);
+		free(src);
+		return TE_NOMEM;
+	}
 	free(src);
-	src = NULL;
 
-	u32 nWidth = lod0Width;
-	u32 nHeight = lod0Height;
-	u8 *pDst = dstData;
-	for(u8 i = 0; i < maxLOD; ++i)
+	u32 nWidth = lod0Width >> minLOD;
+	u32 nHeight = lod0Height >> minLOD;
+	dest.dataSize = fixGX_GetTexBufferSize(nWidth, nHeight, dest.format, GX_TRUE, maxLOD - minLOD);
+	dest.data = (u8*)MEM2_alloc(dest.dataSize);
+	if(dest.data == NULL)
 	{
-		u8 *pSrc = pDst;
-		pDst += nWidth * nHeight * 4;
-		_resizeD2x2(pDst, pSrc, nWidth, nHeight);
-		DCFlushRange(pDst, nWidth * nWidth);
+		free(rgba);
+		return TE_NOMEM;
+	}
+	dest.width = nWidth;
+	dest.height = nHeight;
+	dest.maxLOD = maxLOD - minLOD;
+
+	nWidth = lod0Width;
+	nHeight = lod0Height;
+	u8 *pDst = dest.data;
+	for(u8 i = 0; i <= maxLOD; ++i)
+	{
+		if(i >= minLOD)
+		{
+			switch(dest.format)
+			{
+				case GX_TF_RGBA8:
+					_convertToRGBA8(pDst, rgba, nWidth, nHeight);
+					break;
+				case GX_TF_RGB565:
+					_convertToRGB565(pDst, rgba, nWidth, nHeight);
+					break;
+				case GX_TF_CMPR:
+					_convertToCMPR(pDst, rgba, nWidth, nHeight);
+					break;
+			}
+			pDst += GX_GetTexBufferSize(nWidth, nHeight, dest.format, GX_FALSE, 0);
+		}
+		if(i < maxLOD)
+			_resizeD2x2(rgba, rgba, nWidth, nHeight);
 		nWidth >>= 1;
 		nHeight >>= 1;
 	}
-	return dstData;
+	memset(pDst, 0, dest.data + dest.dataSize - pDst);
+	free(rgba);
+	return TE_OK;
 }
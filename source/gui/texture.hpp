@@ -29,17 +29,19 @@ public:
 	void Cleanup(TexData &tex);
 	bool CopyTexture(const TexData &src, TexData &dest);
 	// Get from PNG, if not found from JPG
+	// On TE_NOMEM dest.dataSize is about what the load needed
 	TexErr fromImageFile(TexData &dest, const char *filename, u8 f = -1, u32 minMipSize = 0, u32 maxMipSize = 0);
 	// This function doesn't use MEM2 if the PNG is loaded from memory and there's no mip mapping
 	TexErr fromPNG(TexData &dest, const u8 *buffer, u8 f = -1, u32 minMipSize = 0, u32 maxMipSize = 0, bool reduce_alpha = false);
 	TexErr fromJPG(TexData &dest, const u8 *buffer, const u32 buffer_size, u8 f = -1, u32 minMipSize = 0, u32 maxMipSize = 0);
-	/* Just for THP */
+	/* Just for THP, reuses dest when it already holds a w x h RGBA8 texture */
 	TexErr fromTHP(TexData &dest, const u8 *buffer, u32 w, u32 h);
 private:
 	void _reduceAlpha(TexData &dest, bool reduce_alpha);
-	void _resize(u8 *dst, u32 dstWidth, u32 dstHeight, const u8 *src, u32 srcWidth, u32 srcHeight);
+	bool _resize(u8 *dst, u32 dstWidth, u32 dstHeight, const u8 *src, u32 srcWidth, u32 srcHeight);
 	void _resizeD2x2(u8 *dst, const u8 *src, u32 srcWidth, u32 srcHeight);
-	u8 *_genMipMaps(u8 *src, u32 width, u32 height, u8 maxLOD, u32 lod0Width, u32 lod0Height);
+	// Takes ownership of src, fills dest with levels minLOD to maxLOD in dest.format
+	TexErr _genMipMaps(TexData &dest, u8 *src, u32 width, u32 height, u8 minLOD, u8 maxLOD, u32 lod0Width, u32 lod0Height);
 	void _calcMipMaps(u8 &maxLOD, u8 &minLOD, u32 &lod0Width, u32 &lod0Height, u32 width, u32 height, u32 minSize, u32 maxSize);
 };
 
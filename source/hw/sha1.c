@@ -21,6 +21,7 @@ A million repetitions of "a"
 #include <ogc/system.h>
 #include <ogc/machine/processor.h>
 #include "loader/utils.h"
+#include "loader/sys.h"
 #include "memory/memory.h"
 #include "sha1.h"
 
@@ -32,10 +33,77 @@ A million repetitions of "a"
 #define SHA_CMD_FLAG_ERR  (1<<29)
 #define SHA_CMD_AREA_BLOCK ((1<<10) - 1)
 
+#define rol(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
+
+/* blk0() and blk() perform the initial expand. */
+#define blk0(i) (block[i] = ((u32)buffer[(i)*4] << 24) | ((u32)buffer[(i)*4+1] << 16) | \
+	((u32)buffer[(i)*4+2] << 8) | (u32)buffer[(i)*4+3])
+#define blk(i) (block[i&15] = rol(block[(i+13)&15]^block[(i+8)&15] \
+	^block[(i+2)&15]^block[i&15],1))
+
+/* (R0+R1), R2, R3, R4 are the different operations used in SHA1 */
+#define R0(v,w,x,y,z,i) z+=((w&(x^y))^y)+blk0(i)+0x5A827999+rol(v,5);w=rol(w,30);
+#define R1(v,w,x,y,z,i) z+=((w&(x^y))^y)+blk(i)+0x5A827999+rol(v,5);w=rol(w,30);
+#define R2(v,w,x,y,z,i) z+=(w^x^y)+blk(i)+0x6ED9EBA1+rol(v,5);w=rol(w,30);
+#define R3(v,w,x,y,z,i) z+=(((w|x)&y)|(w&x))+blk(i)+0x8F1BBCDC+rol(v,5);w=rol(w,30);
+#define R4(v,w,x,y,z,i) z+=(w^x^y)+blk(i)+0xCA62C1D6+rol(v,5);w=rol(w,30);
+
+/* Software fallback without AHBPROT, hash a single 512-bit block. */
+
+static void SHA1TransformSoft(unsigned long state[5], const unsigned char buffer[64])
+{
+	u32 a, b, c, d, e;
+	u32 block[16];
+
+	/* Copy context->state[] to working vars */
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+	/* 4 rounds of 20 operations each. Loop unrolled. */
+	R0(a,b,c,d,e, 0); R0(e,a,b,c,d, 1); R0(d,e,a,b,c, 2); R0(c,d,e,a,b, 3);
+	R0(b,c,d,e,a, 4); R0(a,b,c,d,e, 5); R0(e,a,b,c,d, 6); R0(d,e,a,b,c, 7);
+	R0(c,d,e,a,b, 8); R0(b,c,d,e,a, 9); R0(a,b,c,d,e,10); R0(e,a,b,c,d,11);
+	R0(d,e,a,b,c,12); R0(c,d,e,a,b,13); R0(b,c,d,e,a,14); R0(a,b,c,d,e,15);
+	R1(e,a,b,c,d,16); R1(d,e,a,b,c,17); R1(c,d,e,a,b,18); R1(b,c,d,e,a,19);
+	R2(a,b,c,d,e,20); R2(e,a,b,c,d,21); R2(d,e,a,b,c,22); R2(c,d,e,a,b,23);
+	R2(b,c,d,e,a,24); R2(a,b,c,d,e,25); R2(e,a,b,c,d,26); R2(d,e,a,b,c,27);
+	R2(c,d,e,a,b,28); R2(b,c,d,e,a,29); R2(a,b,c,d,e,30); R2(e,a,b,c,d,31);
+	R2(d,e,a,b,c,32); R2(c,d,e,a,b,33); R2(b,c,d,e,a,34); R2(a,b,c,d,e,35);
+	R2(e,a,b,c,d,36); R2(d,e,a,b,c,37); R2(c,d,e,a,b,38); R2(b,c,d,e,a,39);
+	R3(a,b,c,d,e,40); R3(e,a,b,c,d,41); R3(d,e,a,b,c,42); R3(c,d,e,a,b,43);
+	R3(b,c,d,e,a,44); R3(a,b,c,d,e,45); R3(e,a,b,c,d,46); R3(d,e,a,b,c,47);
+	R3(c,d,e,a,b,48); R3(b,c,d,e,a,49); R3(a,b,c,d,e,50); R3(e,a,b,c,d,51);
+	R3(d,e,a,b,c,52); R3(c,d,e,a,b,53); R3(b,c,d,e,a,54); R3(a,b,c,d,e,55);
+	R3(e,a,b,c,d,56); R3(d,e,a,b,c,57); R3(c,d,e,a,b,58); R3(b,c,d,e,a,59);
+	R4(a,b,c,d,e,60); R4(e,a,b,c,d,61); R4(d,e,a,b,c,62); R4(c,d,e,a,b,63);
+	R4(b,c,d,e,a,64); R4(a,b,c,d,e,65); R4(e,a,b,c,d,66); R4(d,e,a,b,c,67);
+	R4(c,d,e,a,b,68); R4(b,c,d,e,a,69); R4(a,b,c,d,e,70); R4(e,a,b,c,d,71);
+	R4(d,e,a,b,c,72); R4(c,d,e,a,b,73); R4(b,c,d,e,a,74); R4(a,b,c,d,e,75);
+	R4(e,a,b,c,d,76); R4(d,e,a,b,c,77); R4(c,d,e,a,b,78); R4(b,c,d,e,a,79);
+	/* Add the working vars back into context.state[] */
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+static bool sha1_hw = true;
+
 /* Hash a single 512-bit block. This is the core of the algorithm. */
 
 static void SHA1Transforml(unsigned long state[5], unsigned char buffer[64], u32 len)
 {
+	if(!sha1_hw)
+	{
+		u32 i;
+		for(i = 0; i < len; ++i)
+			SHA1TransformSoft(state, buffer + i * 64);
+		return;
+	}
+
 	/* Copy context->state[] to working vars */
 	write32(HW_SHA1_H0, state[0]);
 	write32(HW_SHA1_H1, state[1]);
@@ -87,9 +155,14 @@ static void SHA1Transform(unsigned long state[5], unsigned char buffer[64])
 
 void SHA1Init(SHA1_CTX* context)
 {
-	/* reset sha-1 engine */
-	write32(HW_SHA1_CMD, read32(HW_SHA1_CMD) & ~(SHA_CMD_FLAG_EXEC));
-	while ((read32(HW_SHA1_CMD) & SHA_CMD_FLAG_EXEC) != 0);
+	/* without AHBPROT the engine registers are not reachable */
+	sha1_hw = Sys_HW_Access();
+	if(sha1_hw)
+	{
+		/* reset sha-1 engine */
+		write32(HW_SHA1_CMD, read32(HW_SHA1_CMD) & ~(SHA_CMD_FLAG_EXEC));
+		while ((read32(HW_SHA1_CMD) & SHA_CMD_FLAG_EXEC) != 0);
+	}
 
 	/* SHA1 initialization constants */
 	context->state[0] = 0x67452301;
@@ -260,8 +260,8 @@ int wbfs_disc_read(wbfs_disc_t *d, u32 offset, u32 len, u8 *data)
 	while(likely(len>=p->hd_sec_sz))
 	{
 		u32 nlb = len>>(p->hd_sec_sz_s);
-		if(unlikely(lba + nlb > p->wbfs_sec_sz)) // dont cross wbfs sectors..
-			nlb = p->wbfs_sec_sz-lba;
+		if(unlikely(lba + nlb > lba_mask + 1)) // dont cross wbfs sectors..
+			nlb = lba_mask + 1 - lba;
 		err = p->read_hdsector(p->callback_data, p->part_lba + (iwlba<<iwlba_shift) + lba, nlb, ptr);
 		if(err)
 			return err;
@@ -21,13 +21,13 @@ extern "C" {
 extern int wd_last_error;
 static inline void wbfs_fatal(const char *x)
 {
-	gprintf(x);
+	gprintf("%s", x);
 	wd_last_error = 1;
 }
 
 static inline void wbfs_error(const char *x)
 {
-	gprintf(x);
+	gprintf("%s", x);
 	wd_last_error = 2;
 }
 
@@ -36,6 +36,10 @@ static u8 rbsub[256];
 static u8 ptab[256], ltab[256];
 static u32 ftable[256];
 static u32 rtable[256];
+/* rtable pre-rotated by 8, 16 and 24 bits for the AES-128 decrypt path */
+static u32 rtable8[256];
+static u32 rtable16[256];
+static u32 rtable24[256];
 static u32 rco[30];
 
 /* Parameter-dependent data */
@@ -179,6 +183,9 @@ void gentables(void)
 		b[1] = bmul(InCo[2], y);
 		b[0] = bmul(InCo[3], y);
 		rtable[i] = pack(b);
+		rtable8[i] = ROTL8( rtable[i] );
+		rtable16[i] = ROTL16( rtable[i] );
+		rtable24[i] = ROTL24( rtable[i] );
 	}
 }
 
@@ -358,43 +365,92 @@ void decrypt(char *buff)
 	return;
 }
 
+/* AES-128 only (Nb = Nk = 4), rounds unrolled with the pre-rotated tables */
+static void decrypt128(const u8 *in, u8 *out)
+{
+	int i;
+	u32 a0, a1, a2, a3, b0, b1, b2, b3;
+	const u32 *k = rkey + 4;
+
+	a0 = pack((u8 *) in) ^ rkey[0];
+	a1 = pack((u8 *) in + 4) ^ rkey[1];
+	a2 = pack((u8 *) in + 8) ^ rkey[2];
+	a3 = pack((u8 *) in + 12) ^ rkey[3];
+
+	for (i = 1; i < Nr; i++, k += 4)
+	{
+		b0 = k[0] ^ rtable[(u8 ) a0] ^ rtable8[(u8 )(a3 >> 8)] ^ rtable16[(u8 )(a2 >> 16)] ^ rtable24[a1 >> 24];
+		b1 = k[1] ^ rtable[(u8 ) a1] ^ rtable8[(u8 )(a0 >> 8)] ^ rtable16[(u8 )(a3 >> 16)] ^ rtable24[a2 >> 24];
+		b2 = k[2] ^ rtable[(u8 ) a2] ^ rtable8[(u8 )(a1 >> 8)] ^ rtable16[(u8 )(a0 >> 16)] ^ rtable24[a3 >> 24];
+		b3 = k[3] ^ rtable[(u8 ) a3] ^ rtable8[(u8 )(a2 >> 8)] ^ rtable16[(u8 )(a1 >> 16)] ^ rtable24[a0 >> 24];
+		a0 = b0;
+		a1 = b1;
+		a2 = b2;
+		a3 = b3;
+	}
+
+	/* Last Round */
+	b0 = k[0] ^ (u32 ) rbsub[(u8 ) a0] ^ ((u32 ) rbsub[(u8 )(a3 >> 8)] << 8)
+			^ ((u32 ) rbsub[(u8 )(a2 >> 16)] << 16) ^ ((u32 ) rbsub[a1 >> 24] << 24);
+	b1 = k[1] ^ (u32 ) rbsub[(u8 ) a1] ^ ((u32 ) rbsub[(u8 )(a0 >> 8)] << 8)
+			^ ((u32 ) rbsub[(u8 )(a3 >> 16)] << 16) ^ ((u32 ) rbsub[a2 >> 24] << 24);
+	b2 = k[2] ^ (u32 ) rbsub[(u8 ) a2] ^ ((u32 ) rbsub[(u8 )(a1 >> 8)] << 8)
+			^ ((u32 ) rbsub[(u8 )(a0 >> 16)] << 16) ^ ((u32 ) rbsub[a3 >> 24] << 24);
+	b3 = k[3] ^ (u32 ) rbsub[(u8 ) a3] ^ ((u32 ) rbsub[(u8 )(a2 >> 8)] << 8)
+			^ ((u32 ) rbsub[(u8 )(a1 >> 16)] << 16) ^ ((u32 ) rbsub[a0 >> 24] << 24);
+
+	unpack(b0, out);
+	unpack(b1, out + 4);
+	unpack(b2, out + 8);
+	unpack(b3, out + 12);
+}
+
+static int tables_ready = 0;
+static int key_ready = 0;
+static u8 cur_key[16];
+
 void aes_set_key(const u8 *key)
 {
-	gentables();
+	/* the tables never change and wiidisc sets the same partition key for every block */
+	if (!tables_ready)
+	{
+		gentables();
+		tables_ready = 1;
+	}
+	if (key_ready && memcmp(cur_key, key, sizeof(cur_key)) == 0)
+		return;
 	gkey(4, 4, (char*) key);
+	memcpy(cur_key, key, sizeof(cur_key));
+	key_ready = 1;
 }
 
 // CBC mode decryption
 void aes_decrypt(u8 *iv, u8 *inbuf, u8 *outbuf, u64 len)
 {
-	u8 block[16];
-	u32 blockno = 0, i;
+	u8 chain[16], cipher[16], block[16];
+	u32 blockno, i;
+	u32 blocks = len / sizeof(block);
+	u32 fraction = len % sizeof(block);
 
 	//printf("aes_decrypt(%p, %p, %p, %lld)\n", iv, inbuf, outbuf, len);
 
-	for (blockno = 0; blockno <= (len / sizeof(block)); blockno++)
+	memcpy(chain, iv, sizeof(chain));
+	for (blockno = 0; blockno < blocks; blockno++)
 	{
-		u32 fraction;
-		if (blockno == (len / sizeof(block))) // last block
-		{
-			fraction = len % sizeof(block);
-			if (fraction == 0) break;
-			memset(block, 0, sizeof(block));
-		}
-		else fraction = 16;
-
-		//	debug_printf("block %d: fraction = %d\n", blockno, fraction);
-		memcpy(block, inbuf + blockno * sizeof(block), fraction);
-		decrypt((char*) block);
-		u8 *ctext_ptr;
-		if (blockno == 0)
-			ctext_ptr = iv;
-		else ctext_ptr = inbuf + (blockno - 1) * sizeof(block);
-
+		/* keep the ciphertext for the next block, inbuf may be outbuf */
+		memcpy(cipher, inbuf + blockno * sizeof(block), sizeof(cipher));
+		decrypt128(cipher, block);
+		for (i = 0; i < sizeof(block); i++)
+			outbuf[blockno * sizeof(block) + i] = chain[i] ^ block[i];
+		memcpy(chain, cipher, sizeof(chain));
+	}
+	if (fraction != 0) // last partial block
+	{
+		memset(cipher, 0, sizeof(cipher));
+		memcpy(cipher, inbuf + blocks * sizeof(block), fraction);
+		decrypt128(cipher, block);
 		for (i = 0; i < fraction; i++)
-			outbuf[blockno * sizeof(block) + i] = ctext_ptr[i] ^ block[i];
-		//	debug_printf("Block %d output: ", blockno);
-		//	hexdump(outbuf + blockno*sizeof(block), 16);
+			outbuf[blocks * sizeof(block) + i] = chain[i] ^ block[i];
 	}
 }
 
@@ -437,8 +493,7 @@ void aes_encrypt(u8 *iv, u8 *inbuf, u8 *outbuf, u64 len)
 
 void aes_decrypt_partial(u8 *inbuf, u8 *outbuf, u8 block[16], u8 *ctext_ptr, u32 tmp_blockno)
 {
-	memcpy(block, inbuf + tmp_blockno * 16, 16);
-	decrypt((char*)block);
+	decrypt128(inbuf + tmp_blockno * 16, block);
 	u32 i;
 	for(i = 0; i < 16; i++)
 		outbuf[tmp_blockno * 16 + i] = ctext_ptr[i] ^ block[i];
@@ -0,0 +1,21 @@
+#ifndef RIJNDAEL_H
+#define RIJNDAEL_H
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+	// software AES-128, used when the hardware engine is not accessible
+	void aes_set_key(const u8 *key);
+	// CBC mode, inbuf and outbuf may be the same buffer
+	void aes_decrypt(u8 *iv, u8 *inbuf, u8 *outbuf, u64 len);
+	void aes_encrypt(u8 *iv, u8 *inbuf, u8 *outbuf, u64 len);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -4,13 +4,11 @@
 // http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
 
 #include "wiidisc.h"
+#include "rijndael.h"
 #include "hw/aes.h"
 #include "loader/nk.h"
 #include "loader/sys.h"
 
-void aes_set_key(const u8 *key);
-void aes_decrypt(u8 *iv, u8 *inbuf, u8 *outbuf, u64 len);
-
 int wd_last_error = 0;
 
 int wd_get_last_error(void)
@@ -89,29 +87,37 @@ static int partition_raw_read(wiidisc_t *d, u32 offset, u8 *data, u32 len)
 	return disc_read(d, d->partition_raw_offset + offset, data, len);
 }
 
-static int partition_read_block(wiidisc_t *d, u32 blockno, u8 *block)
+// reads count consecutive blocks with one disc read and decrypts them to 0x7c00 byte blocks
+static int partition_read_blocks(wiidisc_t *d, u32 blockno, u32 count, u8 *block)
 {
 	u8*raw = d->tmp_buffer;
 	u8 iv[16];
 	u32 offset;
-	if (d->sector_usage_table) d->sector_usage_table[d->partition_block+blockno] = 1;
+	u32 i;
+	if (d->sector_usage_table)
+	{
+		for (i = 0; i < count; i++)
+			d->sector_usage_table[d->partition_block+blockno+i] = 1;
+	}
 	offset = d->partition_data_offset + ((0x8000 >> 2) * blockno);
-	if(partition_raw_read(d,offset, raw, 0x8000) < 0)
+	if(partition_raw_read(d,offset, raw, 0x8000 * count) < 0)
 		return -1;
 
-	memcpy(iv, raw + 0x3d0, 16);
-
-	// decrypt data
-	if(Sys_HW_Access())
-	{
-		AES_ResetEngine();
-		AES_EnableDecrypt(d->disc_key, iv);
-		AES_Decrypt(raw + 0x400, block, 0x7c0);
-	}
-	else
-	{
+	if(!Sys_HW_Access())
 		aes_set_key(d->disc_key);
-		aes_decrypt(iv, raw + 0x400, block, 0x7c00);
+	for (i = 0; i < count; i++, raw += 0x8000, block += 0x7c00)
+	{
+		memcpy(iv, raw + 0x3d0, 16);
+
+		// decrypt data
+		if(Sys_HW_Access())
+		{
+			AES_ResetEngine();
+			AES_EnableDecrypt(d->disc_key, iv);
+			AES_Decrypt(raw + 0x400, block, 0x7c0);
+		}
+		else
+			aes_decrypt(iv, raw + 0x400, block, 0x7c00);
 	}
 	return 0;
 }
@@ -121,6 +127,7 @@ static void partition_read(wiidisc_t *d, u32 offset, u8 *data, u32 len, int fake
 	u8 *block = d->tmp_buffer2;
 	u32 offset_in_block;
 	u32 len_in_block;
+	u32 count;
 	if (fake &&  d->sector_usage_table == 0) return;
 
 	while (len)
@@ -130,9 +137,21 @@ static void partition_read(wiidisc_t *d, u32 offset, u8 *data, u32 len, int fake
 		if (len_in_block > len) len_in_block = len;
 		if (!fake)
 		{
-			if(partition_read_block(d,offset / (0x7c00 >> 2), block) < 0)
-				break;
-			wbfs_memcpy(data, block + (offset_in_block << 2), len_in_block);
+			if (offset_in_block == 0 && len >= 0x7c00)
+			{
+				// run of whole blocks, decrypt straight into the destination
+				count = len / 0x7c00;
+				if (count > WD_READ_BLOCKS) count = WD_READ_BLOCKS;
+				if(partition_read_blocks(d,offset / (0x7c00 >> 2), count, data) < 0)
+					break;
+				len_in_block = count * 0x7c00;
+			}
+			else
+			{
+				if(partition_read_blocks(d,offset / (0x7c00 >> 2), 1, block) < 0)
+					break;
+				wbfs_memcpy(data, block + (offset_in_block << 2), len_in_block);
+			}
 		}
 		else d->sector_usage_table[d->partition_block + (offset / (0x7c00 >> 2))] = 1;
 		data += len_in_block;
@@ -345,7 +364,7 @@ wiidisc_t *wd_open_disc(read_wiidisc_callback_t read, void *fp)
 	d->read = read;
 	d->fp = fp;
 	d->part_sel = ALL_PARTITIONS;
-	d->tmp_buffer = wbfs_malloc(0x8000);
+	d->tmp_buffer = wbfs_malloc(0x8000 * WD_READ_BLOCKS);
 	d->tmp_buffer2 = wbfs_malloc(0x8000);
 	return d;
 }
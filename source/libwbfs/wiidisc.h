@@ -9,6 +9,9 @@ extern "C"
 {
 #endif /* __cplusplus */
 
+	// consecutive 32KB blocks read and decrypted in one go by partition_read
+#define WD_READ_BLOCKS 8
+
 	// callback definition. Return 1 on fatal error (callback is supposed to make retries until no hopes..)
 	// offset points 32bit words, count counts bytes
 	typedef int (*read_wiidisc_callback_t)(void *fp, u32 offset, u32 count, void *iobuf);
@@ -262,7 +262,7 @@ void ListGenerator::CreateList(u32 Flow, u32 Device, const string& Path, const v
 	}
 	else if(Flow == COVERFLOW_CHANNEL)
 	{
-		ChannelHandle.Init(gameTDB_Language);
+		ChannelHandle.Init(gameTDB_Language, UpdateCache);
 		Create_Channel_List();
 	}
 	else if(DeviceHandle.GetFSType(Device) != PART_FS_WBFS)
@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <ctype.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "dirlist.hpp"
+#include "gecko/gecko.hpp"
+#include "memory/mem2.hpp"
+
+bool CDirList::SCompare::operator()(const SEntry &a, const SEntry &b) const
+{
+	if(a.key != b.key)
+		return a.key < b.key;
+	/* Same four bytes and one of them the terminator, both names are done */
+	if((a.key & 0xFF) == 0)
+		return false;
+	return strcmp(pool + a.fold + 4, pool + b.fold + 4) < 0;
+}
+
+CDirList::CDirList(void)
+{
+	m_cur = NULL;
+	m_clock = 0;
+}
+
+CDirList::~CDirList(void)
+{
+	Clear();
+}
+
+void CDirList::_free(SDir *d)
+{
+	if(d->pdir != NULL)
+		closedir(d->pdir);
+	if(d->pool != NULL)
+		MEM2_free(d->pool);
+	if(d == m_cur)
+		m_cur = NULL;
+	delete d;
+}
+
+void CDirList::Clear(void)
+{
+	for(u32 i = 0; i < m_dirs.size(); ++i)
+		_free(m_dirs[i]);
+	m_dirs.clear();
+	m_cur = NULL;
+}
+
+void CDirList::_evict(void)
+{
+	/* Makes room for a new listing, the one being left is kept whatever its
+	   size since going back to it is the most likely next move */
+	while(true)
+	{
+		u32 bytes = 0;
+		s32 oldest = -1;
+		for(u32 i = 0; i < m_dirs.size(); ++i)
+		{
+			bytes += m_dirs[i]->poolSize + (m_dirs[i]->dirs.size() + m_dirs[i]->files.size()) * sizeof(SEntry);
+			if(m_dirs[i] != m_cur && (oldest < 0 || m_dirs[i]->lastUse < m_dirs[oldest]->lastUse))
+				oldest = i;
+		}
+		if(oldest < 0 || (m_dirs.size() < DIRLIST_CACHED && bytes <= DIRLIST_BUDGET))
+			break;
+		_free(m_dirs[oldest]);
+		m_dirs.erase(m_dirs.begin() + oldest);
+	}
+}
+
+void CDirList::Open(const char *path, u32 max)
+{
+	struct stat st;
+	time_t mtime = stat(path, &st) == 0 ? st.st_mtime : 0;
+
+	for(u32 i = 0; i < m_dirs.size(); ++i)
+	{
+		SDir *d = m_dirs[i];
+		if(d->path != path)
+			continue;
+		/* A listing still being read is only kept while it is shown */
+		if((d->pdir == NULL && d->mtime == mtime) || (d->pdir != NULL && d == m_cur))
+		{
+			m_cur = d;
+			d->lastUse = ++m_clock;
+			return;
+		}
+		_free(d);
+		m_dirs.erase(m_dirs.begin() + i);
+		break;
+	}
+	if(m_cur != NULL && m_cur->pdir != NULL)
+	{
+		m_dirs.erase(find(m_dirs.begin(), m_dirs.end(), m_cur));
+		_free(m_cur);
+	}
+	_evict();
+
+	SDir *d = new SDir;
+	d->path = path;
+	d->mtime = mtime;
+	d->lastUse = ++m_clock;
+	d->pool = NULL;
+	d->poolSize = 0;
+	d->poolUsed = 0;
+	d->pdir = opendir(path);
+	m_dirs.push_back(d);
+	m_cur = d;
+	Fill(max);
+}
+
+bool CDirList::_add(SDir &d, vector<SEntry> &list, const char *name)
+{
+	u32 len = strlen(name) + 1;
+	if(d.poolUsed + len * 2 > d.poolSize)
+	{
+		u32 size = max(d.poolSize * 2, d.poolUsed + len * 2 + 4096);
+		char *pool = (char *)MEM2_realloc(d.pool, size);
+		if(pool == NULL)
+		{
+			gprintf("Dir list: out of memory at %u entries of %s\n", (u32)(d.dirs.size() + d.files.size()), d.path.c_str());
+			return false;
+		}
+		d.pool = pool;
+		d.poolSize = size;
+	}
+	SEntry e;
+	e.name = d.poolUsed;
+	e.fold = d.poolUsed + len;
+	memcpy(d.pool + e.name, name, len);
+	char *fold = d.pool + e.fold;
+	for(u32 i = 0; i < len; ++i)
+		fold[i] = tolower((u8)name[i]);
+	e.key = 0;
+	for(u32 i = 0; i < 4; ++i)
+		e.key = e.key << 8 | (i < len ? (u8)fold[i] : 0);
+	d.poolUsed += len * 2;
+	list.push_back(e);
+	return true;
+}
+
+u32 CDirList::_merge(SDir &d, vector<SEntry> &list, u32 sorted)
+{
+	if(sorted == list.size())
+		return DIRLIST_NONE;
+	SCompare cmp(d.pool);
+	sort(list.begin() + sorted, list.end(), cmp);
+	/* Stable merge, the new entries go after equal ones already shown */
+	u32 first = upper_bound(list.begin(), list.begin() + sorted, list[sorted], cmp) - list.begin();
+	inplace_merge(list.begin(), list.begin() + sorted, list.end(), cmp);
+	return first;
+}
+
+u32 CDirList::Fill(u32 max)
+{
+	if(m_cur == NULL || m_cur->pdir == NULL)
+		return DIRLIST_NONE;
+	SDir &d = *m_cur;
+	u32 dirs = d.dirs.size();
+	u32 files = d.files.size();
+	bool done = false;
+	u32 read = 0;
+
+	while(read < max)
+	{
+		dirent *pent = readdir(d.pdir);
+		if(pent == NULL)
+		{
+			done = true;
+			break;
+		}
+		if(pent->d_name[0] == '.')
+			continue;
+		if(pent->d_type == DT_DIR)
+			done = !_add(d, d.dirs, pent->d_name);
+		else if(pent->d_type == DT_REG)
+			done = !_add(d, d.files, pent->d_name);
+		else
+			continue;
+		if(done)
+			break;
+		++read;
+	}
+	if(done)
+	{
+		closedir(d.pdir);
+		d.pdir = NULL;
+		/* Cached from now on, give back what the doubling left over */
+		char *pool = d.poolUsed > 0 ? (char *)MEM2_realloc(d.pool, d.poolUsed) : NULL;
+		if(pool != NULL)
+		{
+			d.pool = pool;
+			d.poolSize = d.poolUsed;
+		}
+	}
+	u32 changed = _merge(d, d.dirs, dirs);
+	u32 changedFiles = _merge(d, d.files, files);
+	if(changedFiles != DIRLIST_NONE)
+		changed = min(changed, (u32)d.dirs.size() + changedFiles);
+	return changed;
+}
+
+bool CDirList::Complete(void) const
+{
+	return m_cur == NULL || m_cur->pdir == NULL;
+}
+
+u32 CDirList::Dirs(void) const
+{
+	return m_cur != NULL ? m_cur->dirs.size() : 0;
+}
+
+u32 CDirList::Files(void) const
+{
+	return m_cur != NULL ? m_cur->files.size() : 0;
+}
+
+const char *CDirList::Name(u32 pos) const
+{
+	if(m_cur == NULL)
+		return "";
+	if(pos < m_cur->dirs.size())
+		return m_cur->pool + m_cur->dirs[pos].name;
+	pos -= m_cur->dirs.size();
+	if(pos < m_cur->files.size())
+		return m_cur->pool + m_cur->files[pos].name;
+	return "";
+}
@@ -0,0 +1,71 @@
+// Explorer directory listings
+
+#ifndef __DIRLIST_HPP
+#define __DIRLIST_HPP
+
+#include <dirent.h>
+#include <gctypes.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define DIRLIST_CACHED		4
+#define DIRLIST_BUDGET		(2 * 1024 * 1024)
+#define DIRLIST_NONE		0xFFFFFFFF
+
+/* Sorted folders and files of a directory, read in a single readdir pass that
+   can be spread over several frames. The last few complete listings stay
+   cached and are reused as long as the directory mtime did not change. */
+class CDirList
+{
+public:
+	CDirList(void);
+	~CDirList(void);
+	/* Lists path, reading at most max entries right away when not cached */
+	void Open(const char *path, u32 max);
+	/* Reads at most max more entries, returns the first position that
+	   changed or DIRLIST_NONE */
+	u32 Fill(u32 max);
+	bool Complete(void) const;
+	u32 Dirs(void) const;
+	u32 Files(void) const;
+	/* Folders come first, then files */
+	const char *Name(u32 pos) const;
+	void Clear(void);
+private:
+	struct SEntry
+	{
+		u32 key;	// first four case folded bytes, big endian
+		u32 name;	// offsets in the pool
+		u32 fold;
+	};
+	struct SCompare
+	{
+		const char *pool;
+		SCompare(const char *p) : pool(p) { }
+		bool operator()(const SEntry &a, const SEntry &b) const;
+	};
+	struct SDir
+	{
+		string path;
+		time_t mtime;
+		u32 lastUse;
+		DIR *pdir;
+		char *pool;
+		u32 poolSize;
+		u32 poolUsed;
+		vector<SEntry> dirs;
+		vector<SEntry> files;
+	};
+	void _free(SDir *d);
+	void _evict(void);
+	bool _add(SDir &d, vector<SEntry> &list, const char *name);
+	u32 _merge(SDir &d, vector<SEntry> &list, u32 sorted);
+	vector<SDir *> m_dirs;
+	SDir *m_cur;
+	u32 m_clock;
+};
+
+#endif // !defined(__DIRLIST_HPP)
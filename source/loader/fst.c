@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <gccore.h>
 #include <sys/unistd.h>
 #include <ogc/ipc.h>
@@ -55,194 +56,582 @@ extern const u32 axnextframehooks[4];
 extern const u32 wpadbuttonsdownhooks[4];
 extern const u32 wpadbuttonsdown2hooks[4];
 
-int app_gameconfig_load(const char *discid, u8 *tempgameconf, u32 tempgameconfsize)
+#define GAMECONF_MAX_SIZE			65536
+
+/* Record types of the pre-parsed code stream */
+#define GAMECONFIG_CODELISTSTART	1
+#define GAMECONFIG_CODELISTEND		2
+#define GAMECONFIG_WORDS			3
+
+typedef struct _gameconfig_code
 {
-	if (gameconf == NULL)
+	u32 *data;
+	u32 count;
+	u32 alloc;
+	bool failed;
+} gameconfig_code;
+
+static void gameconfig_push(gameconfig_code *code, u32 value)
+{
+	if (code->failed)
+		return;
+	if (code->count == code->alloc)
 	{
-		gameconf = (u32*) MEM2_alloc(65536);
-		if (gameconf == NULL)
-			return -1;
+		u32 newalloc = code->alloc ? code->alloc * 2 : 4096;
+		u32 *newdata = (u32 *) MEM2_realloc(code->data, newalloc * 4);
+		if (newdata == NULL)
+		{
+			code->failed = true;
+			return;
+		}
+		code->data = newdata;
+		code->alloc = newalloc;
 	}
-	u32 ret;
-	s32 gameidmatch, maxgameidmatch = -1, maxgameidmatch2 = -1;
-	u32 i, numnonascii, parsebufpos;
-	u32 codeaddr, codeval, codeaddr2, codeval2, codeoffset;
-	u32 temp, tempoffset = 0;
-	char parsebuffer[18];
+	code->data[code->count++] = value;
+}
 
-	// Remove non-ASCII characters
-	numnonascii = 0;
-	for (i = 0; i < tempgameconfsize; i++)
+static u32 gameconfig_hash(const char *key)
+{
+	u32 i, hash = 2166136261u;
+	for (i = 0; i < GAMECONFIG_TOKEN_LEN; i++)
+		hash = (hash ^ (u8) key[i]) * 16777619u;
+	return hash;
+}
+
+/* Bucket key of a header ID: the upper case characters before the first wildcard */
+static void gameconfig_key(const char *id, u32 len, char *key)
+{
+	u32 i;
+	memset(key, 0, GAMECONFIG_TOKEN_LEN);
+	for (i = 0; i < len && i < GAMECONFIG_TOKEN_LEN && id[i] != 0 && id[i] != '?'; i++)
+		key[i] = toupper((u8) id[i]);
+}
+
+static gameconfig_bucket *gameconfig_find_bucket(gameconfig_bucket *buckets, u32 bucketcount, const char *key, bool insert)
+{
+	u32 mask = bucketcount - 1;
+	u32 pos = gameconfig_hash(key) & mask;
+	while (buckets[pos].count != 0)
 	{
-		if (tempgameconf[i] < 9 || tempgameconf[i] > 126)
-			numnonascii++;
-		else
-			tempgameconf[i - numnonascii] = tempgameconf[i];
+		if (memcmp(buckets[pos].key, key, GAMECONFIG_TOKEN_LEN) == 0)
+			return &buckets[pos];
+		pos = (pos + 1) & mask;
 	}
-	tempgameconfsize -= numnonascii;
+	if (!insert)
+		return NULL;
+	memcpy(buckets[pos].key, key, GAMECONFIG_TOKEN_LEN);
+	return &buckets[pos];
+}
 
-	*(tempgameconf + tempgameconfsize) = 0;
-	//gameconf = (tempgameconf + tempgameconfsize) + (4 - (((u32) (tempgameconf + tempgameconfsize)) % 4));
+/* Wildcard IDs like DEF?ULT can turn into DEFAULT after substitution */
+static bool gameconfig_maybe_default(const char *token)
+{
+	u32 i;
+	bool wildcard = false;
+	for (i = 0; i < 7; i++)
+	{
+		if (token[i] == '?')
+			wildcard = true;
+		else if (toupper((u8) token[i]) != "DEFAULT"[i])
+			return false;
+	}
+	return wildcard && token[7] == 0;
+}
 
-	for (maxgameidmatch = 0; maxgameidmatch <= 6; maxgameidmatch++)
+/* Parses the code lines following a header exactly like the old text scanner did */
+static u32 gameconfig_compile_codes(const char *tempgameconf, u32 tempgameconfsize, u32 i, gameconfig_code *code)
+{
+	u32 ret, parsebufpos, start;
+	u32 codeaddr, codeval, codeaddr2, codeval2, codeoffset;
+	u32 temp, tempoffset = 0;
+	char parsebuffer[18];
+
+	while (i != tempgameconfsize && tempgameconf[i] != ':')
 	{
-		i = 0;
-		while (i < tempgameconfsize)
+		parsebufpos = 0;
+		while ((i != tempgameconfsize) && (tempgameconf[i] != 10 && tempgameconf[i] != 13))
+		{
+			if (tempgameconf[i] != 0 && tempgameconf[i] != ' ' && tempgameconf[i] != '(' && tempgameconf[i] != ':')
+				parsebuffer[parsebufpos++] = tempgameconf[i++];
+			else if (tempgameconf[i] == ' ' || tempgameconf[i] == '(' || tempgameconf[i] == ':')
+				break;
+			else i++;
+			if (parsebufpos == 17) break;
+		}
+		parsebuffer[parsebufpos] = 0;
+
+		if (strcasecmp("codeliststart", parsebuffer) == 0)
 		{
-			maxgameidmatch2 = -1;
-			while (maxgameidmatch != maxgameidmatch2)
+			if (sscanf(tempgameconf + i, " = %x", &codeval) == 1)
 			{
-				while (i != tempgameconfsize && tempgameconf[i] != ':')
-					i++;
-				if (i == tempgameconfsize) break;
-				while ((tempgameconf[i] != 10 && tempgameconf[i] != 13) && (i != 0))
-					i--;
-				if (i != 0) i++;
-				parsebufpos = 0;
-				gameidmatch = 0;
-				while (tempgameconf[i] != ':')
-				{
-					if (tempgameconf[i] == '?')
-					{
-						parsebuffer[parsebufpos] = discid[parsebufpos];
-						parsebufpos++;
-						gameidmatch--;
-						i++;
-					}
-					else if (tempgameconf[i] != 0 && tempgameconf[i] != ' ')
-						parsebuffer[parsebufpos++] = tempgameconf[i++];
-					else if (tempgameconf[i] == ' ')
-						break;
-					else i++;
-					if (parsebufpos == 8) break;
-				}
-				parsebuffer[parsebufpos] = 0;
-				if (strncasecmp("DEFAULT", parsebuffer, strlen(parsebuffer)) == 0 && strlen(parsebuffer) == 7)
-				{
-					gameidmatch = 0;
-					goto idmatch;
-				}
-				if (strncasecmp(discid, parsebuffer, strlen(parsebuffer)) == 0)
-				{
-					gameidmatch += strlen(parsebuffer);
-					idmatch: if (gameidmatch > maxgameidmatch2)
-					{
-						maxgameidmatch2 = gameidmatch;
-					}
-				}
-				while ((i != tempgameconfsize) && (tempgameconf[i] != 10 && tempgameconf[i] != 13))
-					i++;
+				gameconfig_push(code, GAMECONFIG_CODELISTSTART);
+				gameconfig_push(code, codeval);
+			}
+		}
+		else if (strcasecmp("codelistend", parsebuffer) == 0)
+		{
+			if (sscanf(tempgameconf + i, " = %x", &codeval) == 1)
+			{
+				gameconfig_push(code, GAMECONFIG_CODELISTEND);
+				gameconfig_push(code, codeval);
+			}
+		}
+		else if (strcasecmp("poke", parsebuffer) == 0)
+		{
+			ret = sscanf(tempgameconf + i, "( %x , %x", &codeaddr, &codeval);
+			if (ret == 2)
+			{
+				gameconfig_push(code, GAMECONFIG_WORDS);
+				gameconfig_push(code, 5);
+				gameconfig_push(code, 0);
+				gameconfig_push(code, 0);
+				gameconfig_push(code, 0);
+				gameconfig_push(code, codeaddr);
+				gameconfig_push(code, codeval);
+			}
+		}
+		else if (strcasecmp("pokeifequal", parsebuffer) == 0)
+		{
+			ret = sscanf(tempgameconf + i, "( %x , %x , %x , %x", &codeaddr, &codeval, &codeaddr2, &codeval2);
+			if (ret == 4)
+			{
+				gameconfig_push(code, GAMECONFIG_WORDS);
+				gameconfig_push(code, 5);
+				gameconfig_push(code, 0);
+				gameconfig_push(code, codeaddr);
+				gameconfig_push(code, codeval);
+				gameconfig_push(code, codeaddr2);
+				gameconfig_push(code, codeval2);
 			}
-			while (i != tempgameconfsize && tempgameconf[i] != ':')
+		}
+		else if (strcasecmp("searchandpoke", parsebuffer) == 0)
+		{
+			ret = sscanf(tempgameconf + i, "( %x%n", &codeval, &tempoffset);
+			if (ret == 1)
 			{
-				parsebufpos = 0;
-				while ((i != tempgameconfsize) && (tempgameconf[i] != 10 && tempgameconf[i] != 13))
+				start = code->count;
+				gameconfig_push(code, GAMECONFIG_WORDS);
+				gameconfig_push(code, 0);
+				gameconfig_push(code, 0);
+				temp = 0;
+				while (ret == 1)
 				{
-					if (tempgameconf[i] != 0 && tempgameconf[i] != ' ' && tempgameconf[i] != '(' && tempgameconf[i]
-							!= ':')
-						parsebuffer[parsebufpos++] = tempgameconf[i++];
-					else if (tempgameconf[i] == ' ' || tempgameconf[i] == '(' || tempgameconf[i] == ':')
-						break;
-					else i++;
-					if (parsebufpos == 17) break;
+					gameconfig_push(code, codeval);
+					temp++;
+					i += tempoffset;
+					ret = sscanf(tempgameconf + i, " %x%n", &codeval, &tempoffset);
 				}
-				parsebuffer[parsebufpos] = 0;
-				//if (!autobootcheck)
+				ret = sscanf(tempgameconf + i, " , %x , %x , %x , %x", &codeaddr, &codeaddr2, &codeoffset, &codeval2);
+				if (ret == 4 && !code->failed)
 				{
-					if (strncasecmp("codeliststart", parsebuffer, strlen(parsebuffer)) == 0 && strlen(parsebuffer)
-							== 13)
-					{
-						sscanf((char *) (tempgameconf + i), " = %x", (unsigned int *) &codelist);
-					}
-					if (strncasecmp("codelistend", parsebuffer, strlen(parsebuffer)) == 0 && strlen(parsebuffer) == 11)
-					{
-						sscanf((char *) (tempgameconf + i), " = %x", (unsigned int *) &codelistend);
-					}
-					if (strncasecmp("poke", parsebuffer, strlen(parsebuffer)) == 0 && strlen(parsebuffer) == 4)
-					{
-						ret = sscanf((char *) tempgameconf + i, "( %x , %x", &codeaddr, &codeval);
-						if (ret == 2)
-						{
-							*(gameconf + (gameconfsize / 4)) = 0;
-							gameconfsize += 4;
-							*(gameconf + (gameconfsize / 4)) = 0;
-							gameconfsize += 8;
-							*(gameconf + (gameconfsize / 4)) = codeaddr;
-							gameconfsize += 4;
-							*(gameconf + (gameconfsize / 4)) = codeval;
-							gameconfsize += 4;
-							DCFlushRange((void *) (gameconf + (gameconfsize / 4) - 5), 20);
-						}
-					}
-					if (strncasecmp("pokeifequal", parsebuffer, strlen(parsebuffer)) == 0 && strlen(parsebuffer) == 11)
-					{
-						ret = sscanf((char *) (tempgameconf + i), "( %x , %x , %x , %x", &codeaddr, &codeval,
-								&codeaddr2, &codeval2);
-						if (ret == 4)
-						{
-							*(gameconf + (gameconfsize / 4)) = 0;
-							gameconfsize += 4;
-							*(gameconf + (gameconfsize / 4)) = codeaddr;
-							gameconfsize += 4;
-							*(gameconf + (gameconfsize / 4)) = codeval;
-							gameconfsize += 4;
-							*(gameconf + (gameconfsize / 4)) = codeaddr2;
-							gameconfsize += 4;
-							*(gameconf + (gameconfsize / 4)) = codeval2;
-							gameconfsize += 4;
-							DCFlushRange((void *) (gameconf + (gameconfsize / 4) - 5), 20);
-						}
-					}
-					if (strncasecmp("searchandpoke", parsebuffer, strlen(parsebuffer)) == 0 && strlen(parsebuffer)
-							== 13)
-					{
-						ret = sscanf((char *) (tempgameconf + i), "( %x%n", &codeval, &tempoffset);
-						if (ret == 1)
-						{
-							gameconfsize += 4;
-							temp = 0;
-							while (ret == 1)
-							{
-								*(gameconf + (gameconfsize / 4)) = codeval;
-								gameconfsize += 4;
-								temp++;
-								i += tempoffset;
-								ret = sscanf((char *) (tempgameconf + i), " %x%n", &codeval, &tempoffset);
-							}
-							*(gameconf + (gameconfsize / 4) - temp - 1) = temp;
-							ret = sscanf((char *) (tempgameconf + i), " , %x , %x , %x , %x", &codeaddr, &codeaddr2,
-									&codeoffset, &codeval2);
-							if (ret == 4)
-							{
-								*(gameconf + (gameconfsize / 4)) = codeaddr;
-								gameconfsize += 4;
-								*(gameconf + (gameconfsize / 4)) = codeaddr2;
-								gameconfsize += 4;
-								*(gameconf + (gameconfsize / 4)) = codeoffset;
-								gameconfsize += 4;
-								*(gameconf + (gameconfsize / 4)) = codeval2;
-								gameconfsize += 4;
-								DCFlushRange((void *) (gameconf + (gameconfsize / 4) - temp - 5), temp * 4 + 20);
-							}
-							else gameconfsize -= temp * 4 + 4;
-						}
-
-					}
+					gameconfig_push(code, codeaddr);
+					gameconfig_push(code, codeaddr2);
+					gameconfig_push(code, codeoffset);
+					gameconfig_push(code, codeval2);
+					code->data[start + 1] = temp + 5;
+					code->data[start + 2] = temp;
 				}
-				if (tempgameconf[i] != ':')
+				else if (!code->failed)
+					code->count = start;
+			}
+		}
+		if (tempgameconf[i] != ':')
+		{
+			while ((i != tempgameconfsize) && (tempgameconf[i] != 10 && tempgameconf[i] != 13))
+				i++;
+			if (i != tempgameconfsize) i++;
+		}
+	}
+	return i;
+}
+
+u8 *app_gameconfig_compile(const u8 *gameconfig, u32 gameconfigsize, u32 srcsize, u32 srctime, u32 *indexsize)
+{
+	u32 i, j, n, lo, hi, tempgameconfsize, nodecount, colons, bucketcount, listcount, parsebufpos;
+	gameconfig_index *header;
+	u32 *nodepos = NULL, *nodeend = NULL, *lists = NULL;
+	char *tempgameconf = NULL;
+	gameconfig_node *nodes = NULL;
+	gameconfig_bucket *buckets = NULL;
+	gameconfig_code code;
+	char key[GAMECONFIG_TOKEN_LEN];
+	u8 *index = NULL;
+
+	*indexsize = 0;
+	memset(&code, 0, sizeof(code));
+
+	// Remove non-ASCII characters
+	tempgameconf = (char *) MEM2_alloc(gameconfigsize + 1);
+	if (tempgameconf == NULL)
+		return NULL;
+	tempgameconfsize = 0;
+	colons = 0;
+	for (i = 0; i < gameconfigsize; i++)
+	{
+		if (gameconfig[i] < 9 || gameconfig[i] > 126)
+			continue;
+		if (gameconfig[i] == ':')
+			colons++;
+		tempgameconf[tempgameconfsize++] = gameconfig[i];
+	}
+	tempgameconf[tempgameconfsize] = 0;
+
+	/* Every line holding a ':' is a header candidate, in file order */
+	nodes = (gameconfig_node *) MEM2_alloc((colons + 1) * sizeof(gameconfig_node));
+	nodepos = (u32 *) MEM2_alloc((colons + 1) * 4);
+	nodeend = (u32 *) MEM2_alloc((colons + 1) * 4);
+	if (nodes == NULL || nodepos == NULL || nodeend == NULL)
+		goto out;
+	memset(nodes, 0, (colons + 1) * sizeof(gameconfig_node));
+
+	nodecount = 0;
+	i = 0;
+	while (true)
+	{
+		while (i != tempgameconfsize && tempgameconf[i] != ':')
+			i++;
+		if (i == tempgameconfsize) break;
+		nodepos[nodecount] = i;
+		while ((tempgameconf[i] != 10 && tempgameconf[i] != 13) && (i != 0))
+			i--;
+		if (i != 0) i++;
+		parsebufpos = 0;
+		while (tempgameconf[i] != ':')
+		{
+			if (tempgameconf[i] != 0 && tempgameconf[i] != ' ')
+				nodes[nodecount].token[parsebufpos++] = tempgameconf[i++];
+			else if (tempgameconf[i] == ' ')
+				break;
+			else i++;
+			if (parsebufpos == GAMECONFIG_TOKEN_LEN) break;
+		}
+		while ((i != tempgameconfsize) && (tempgameconf[i] != 10 && tempgameconf[i] != 13))
+			i++;
+		nodeend[nodecount++] = i;
+	}
+
+	/* Pre-parse the codes of each header and find the header that follows them */
+	for (n = 0; n < nodecount; n++)
+	{
+		nodes[n].code = code.count;
+		i = gameconfig_compile_codes(tempgameconf, tempgameconfsize, nodeend[n], &code);
+		nodes[n].codelen = code.count - nodes[n].code;
+		nodes[n].next = GAMECONFIG_NO_NODE;
+		if (i == tempgameconfsize)
+			continue;
+		while ((tempgameconf[i] != 10 && tempgameconf[i] != 13) && (i != 0))
+			i--;
+		while (i != tempgameconfsize && tempgameconf[i] != ':')
+			i++;
+		lo = n + 1;
+		hi = nodecount;
+		while (lo < hi)
+		{
+			j = (lo + hi) / 2;
+			if (nodepos[j] < i)
+				lo = j + 1;
+			else
+				hi = j;
+		}
+		if (lo < nodecount && nodepos[lo] == i)
+			nodes[n].next = lo;
+	}
+	if (code.failed)
+		goto out;
+
+	/* Bucket the headers by the literal part of their ID */
+	bucketcount = 64;
+	while (bucketcount < nodecount * 4)
+		bucketcount <<= 1;
+	buckets = (gameconfig_bucket *) MEM2_alloc(bucketcount * sizeof(gameconfig_bucket));
+	if (buckets == NULL)
+		goto out;
+	memset(buckets, 0, bucketcount * sizeof(gameconfig_bucket));
+	listcount = 0;
+	for (n = 0; n < nodecount; n++)
+	{
+		gameconfig_key(nodes[n].token, GAMECONFIG_TOKEN_LEN, key);
+		gameconfig_find_bucket(buckets, bucketcount, key, true)->count++;
+		listcount++;
+		if (gameconfig_maybe_default(nodes[n].token))
+		{
+			gameconfig_key("DEFAULT", 7, key);
+			gameconfig_find_bucket(buckets, bucketcount, key, true)->count++;
+			listcount++;
+		}
+	}
+	/* Point each bucket past its list, they are filled back to front */
+	j = 0;
+	for (i = 0; i < bucketcount; i++)
+	{
+		j += buckets[i].count;
+		buckets[i].list = j;
+	}
+
+	*indexsize = sizeof(gameconfig_index) + nodecount * sizeof(gameconfig_node)
+		+ bucketcount * sizeof(gameconfig_bucket) + listcount * 4 + code.count * 4;
+	index = (u8 *) MEM2_alloc(*indexsize);
+	if (index == NULL)
+	{
+		*indexsize = 0;
+		goto out;
+	}
+	lists = (u32 *) (index + sizeof(gameconfig_index) + nodecount * sizeof(gameconfig_node)
+		+ bucketcount * sizeof(gameconfig_bucket));
+	for (n = nodecount; n-- > 0;)
+	{
+		gameconfig_bucket *bucket;
+		gameconfig_key(nodes[n].token, GAMECONFIG_TOKEN_LEN, key);
+		bucket = gameconfig_find_bucket(buckets, bucketcount, key, false);
+		lists[--bucket->list] = n;
+		if (gameconfig_maybe_default(nodes[n].token))
+		{
+			gameconfig_key("DEFAULT", 7, key);
+			bucket = gameconfig_find_bucket(buckets, bucketcount, key, false);
+			lists[--bucket->list] = n;
+		}
+	}
+
+	header = (gameconfig_index *) index;
+	header->magic = GAMECONFIG_INDEX_MAGIC;
+	header->srcsize = srcsize;
+	header->srctime = srctime;
+	header->size = *indexsize;
+	header->nodecount = nodecount;
+	header->bucketcount = bucketcount;
+	header->listcount = listcount;
+	header->codecount = code.count;
+	memcpy(index + sizeof(gameconfig_index), nodes, nodecount * sizeof(gameconfig_node));
+	memcpy(index + sizeof(gameconfig_index) + nodecount * sizeof(gameconfig_node), buckets, bucketcount * sizeof(gameconfig_bucket));
+	if (code.count > 0)
+		memcpy(lists + listcount, code.data, code.count * 4);
+
+out:
+	MEM2_free(tempgameconf);
+	if (nodes != NULL) MEM2_free(nodes);
+	if (nodepos != NULL) MEM2_free(nodepos);
+	if (nodeend != NULL) MEM2_free(nodeend);
+	if (buckets != NULL) MEM2_free(buckets);
+	if (code.data != NULL) MEM2_free(code.data);
+	return index;
+}
+
+bool app_gameconfig_check_index(const u8 *index, u32 indexsize, u32 srcsize, u32 srctime)
+{
+	const gameconfig_index *header = (const gameconfig_index *) index;
+	const gameconfig_node *nodes;
+	const gameconfig_bucket *buckets;
+	const u32 *lists;
+	u32 i;
+
+	if (index == NULL || indexsize < sizeof(gameconfig_index) || header->magic != GAMECONFIG_INDEX_MAGIC)
+		return false;
+	if (header->srcsize != srcsize || header->srctime != srctime || header->size != indexsize)
+		return false;
+	if (header->bucketcount == 0 || (header->bucketcount & (header->bucketcount - 1)) != 0)
+		return false;
+	if (header->nodecount > indexsize / sizeof(gameconfig_node) || header->bucketcount > indexsize / sizeof(gameconfig_bucket)
+		|| header->listcount > indexsize / 4 || header->codecount > indexsize / 4)
+		return false;
+	if (sizeof(gameconfig_index) + header->nodecount * sizeof(gameconfig_node) + header->bucketcount * sizeof(gameconfig_bucket)
+		+ header->listcount * 4 + header->codecount * 4 != indexsize)
+		return false;
+
+	nodes = (const gameconfig_node *) (index + sizeof(gameconfig_index));
+	buckets = (const gameconfig_bucket *) (nodes + header->nodecount);
+	lists = (const u32 *) (buckets + header->bucketcount);
+	for (i = 0; i < header->nodecount; i++)
+	{
+		if (nodes[i].code > header->codecount || nodes[i].codelen > header->codecount - nodes[i].code)
+			return false;
+		if (nodes[i].next != GAMECONFIG_NO_NODE && (nodes[i].next <= i || nodes[i].next >= header->nodecount))
+			return false;
+	}
+	for (i = 0; i < header->bucketcount; i++)
+	{
+		if (buckets[i].list > header->listcount || buckets[i].count > header->listcount - buckets[i].list)
+			return false;
+	}
+	for (i = 0; i < header->listcount; i++)
+	{
+		if (lists[i] >= header->nodecount)
+			return false;
+	}
+	return true;
+}
+
+/* Scores a header ID against the disc ID, -1 if it doesn't apply */
+static s32 gameconfig_match(const char *discid, const char *token)
+{
+	char parsebuffer[GAMECONFIG_TOKEN_LEN + 1];
+	s32 gameidmatch = 0;
+	u32 parsebufpos;
+
+	for (parsebufpos = 0; parsebufpos < GAMECONFIG_TOKEN_LEN && token[parsebufpos] != 0; parsebufpos++)
+	{
+		if (token[parsebufpos] == '?')
+		{
+			parsebuffer[parsebufpos] = discid[parsebufpos];
+			gameidmatch--;
+		}
+		else
+			parsebuffer[parsebufpos] = token[parsebufpos];
+	}
+	parsebuffer[parsebufpos] = 0;
+	if (strcasecmp("DEFAULT", parsebuffer) == 0)
+		return 0;
+	if (strncasecmp(discid, parsebuffer, strlen(parsebuffer)) == 0)
+		return gameidmatch + strlen(parsebuffer);
+	return -1;
+}
+
+static void gameconfig_apply(const u32 *code, u32 codelen)
+{
+	u32 i = 0, count;
+	while (i + 2 <= codelen)
+	{
+		switch (code[i])
+		{
+			case GAMECONFIG_CODELISTSTART:
+				codelist = (void *) code[i + 1];
+				i += 2;
+				break;
+			case GAMECONFIG_CODELISTEND:
+				codelistend = (u8 *) code[i + 1];
+				i += 2;
+				break;
+			case GAMECONFIG_WORDS:
+				count = code[i + 1];
+				if (count > codelen - i - 2)
+					return;
+				if (gameconfsize + count * 4 <= GAMECONF_MAX_SIZE)
 				{
-					while ((i != tempgameconfsize) && (tempgameconf[i] != 10 && tempgameconf[i] != 13))
-						i++;
-					if (i != tempgameconfsize) i++;
+					memcpy(gameconf + (gameconfsize / 4), code + i + 2, count * 4);
+					gameconfsize += count * 4;
 				}
+				i += count + 2;
+				break;
+			default:
+				return;
+		}
+	}
+}
+
+int app_gameconfig_load_index(const char *discid, const u8 *index, u32 indexsize)
+{
+	const gameconfig_index *header = (const gameconfig_index *) index;
+	const gameconfig_node *nodes;
+	const gameconfig_bucket *buckets, *bucket;
+	const u32 *lists, *code;
+	u32 i, j, k, idlen, count, next, *candidates;
+	s32 *scores, maxgameidmatch;
+	const gameconfig_bucket *probes[GAMECONFIG_TOKEN_LEN + 2];
+	char key[GAMECONFIG_TOKEN_LEN];
+
+	if (index == NULL || indexsize < sizeof(gameconfig_index))
+		return -1;
+	if (!app_gameconfig_check_index(index, indexsize, header->srcsize, header->srctime))
+		return -1;
+	if (gameconf == NULL)
+	{
+		gameconf = (u32*) MEM2_alloc(GAMECONF_MAX_SIZE);
+		if (gameconf == NULL)
+			return -1;
+	}
+
+	nodes = (const gameconfig_node *) (index + sizeof(gameconfig_index));
+	buckets = (const gameconfig_bucket *) (nodes + header->nodecount);
+	lists = (const u32 *) (buckets + header->bucketcount);
+	code = lists + header->listcount;
+
+	/* Headers can only apply if their literal part is a prefix of the ID or DEFAULT */
+	idlen = strlen(discid);
+	if (idlen > GAMECONFIG_TOKEN_LEN)
+		idlen = GAMECONFIG_TOKEN_LEN;
+	count = 0;
+	for (k = 0; k <= idlen + 1; k++)
+	{
+		if (k <= idlen)
+			gameconfig_key(discid, k, key);
+		else
+			gameconfig_key("DEFAULT", 7, key);
+		bucket = gameconfig_find_bucket((gameconfig_bucket *) buckets, header->bucketcount, key, false);
+		probes[k] = bucket;
+		if (bucket != NULL)
+			count += bucket->count;
+	}
+	if (count == 0)
+		return 0;
+
+	candidates = (u32 *) MEM2_alloc(count * 4);
+	scores = (s32 *) MEM2_alloc(count * 4);
+	if (candidates == NULL || scores == NULL)
+	{
+		if (candidates != NULL) MEM2_free(candidates);
+		if (scores != NULL) MEM2_free(scores);
+		return -1;
+	}
+
+	/* Merge the buckets back into file order */
+	count = 0;
+	for (k = 0; k <= idlen + 1; k++)
+	{
+		if (probes[k] == NULL)
+			continue;
+		for (j = 0; j < probes[k]->count; j++)
+		{
+			next = lists[probes[k]->list + j];
+			for (i = count; i > 0 && candidates[i - 1] > next; i--)
+				candidates[i] = candidates[i - 1];
+			candidates[i] = next;
+			count++;
+		}
+	}
+	for (i = 0, j = 0; i < count; i++)
+	{
+		if (j == 0 || candidates[j - 1] != candidates[i])
+			candidates[j++] = candidates[i];
+	}
+	count = j;
+	for (i = 0; i < count; i++)
+		scores[i] = gameconfig_match(discid, nodes[candidates[i]].token);
+
+	/* Same passes as the text scanner: the best matching blocks are applied last,
+	   and a pass stops at the first header that matches better than its level */
+	for (maxgameidmatch = 0; maxgameidmatch <= 6; maxgameidmatch++)
+	{
+		next = 0;
+		for (i = 0; i < count; i++)
+		{
+			if (candidates[i] < next)
+				continue;
+			if (scores[i] > maxgameidmatch)
+				break;
+			if (scores[i] == maxgameidmatch)
+			{
+				gameconfig_apply(code + nodes[candidates[i]].code, nodes[candidates[i]].codelen);
+				next = nodes[candidates[i]].next;
 			}
-			if (i != tempgameconfsize) while ((tempgameconf[i] != 10 && tempgameconf[i] != 13) && (i != 0))
-				i--;
 		}
 	}
+	DCFlushRange(gameconf, gameconfsize);
+
+	MEM2_free(candidates);
+	MEM2_free(scores);
 	return 0;
 }
 
+int app_gameconfig_load(const char *discid, u8 *tempgameconf, u32 tempgameconfsize)
+{
+	u32 indexsize = 0;
+	u8 *index = app_gameconfig_compile(tempgameconf, tempgameconfsize, 0, 0, &indexsize);
+	if (index == NULL)
+		return -1;
+	int ret = app_gameconfig_load_index(discid, index, indexsize);
+	MEM2_free(index);
+	return ret;
+}
+
 u8 *code_buf = NULL;
 u32 code_size = 0;
 
@@ -30,6 +30,44 @@ extern u8 debuggerselect;
 
 #define MAX_GCT_SIZE 2056
 
+#define GAMECONFIG_INDEX_MAGIC	0x47435831	/* "GCX1" */
+#define GAMECONFIG_TOKEN_LEN	8
+#define GAMECONFIG_NO_NODE		0xFFFFFFFF
+
+/* Compiled gameconfig.txt, followed by the nodes, buckets,
+   bucket node lists and the pre-parsed code stream */
+typedef struct _gameconfig_index
+{
+	u32 magic;
+	u32 srcsize;		/* size of gameconfig.txt the index was built from */
+	u32 srctime;		/* modification time of gameconfig.txt */
+	u32 size;			/* size of the whole index */
+	u32 nodecount;
+	u32 bucketcount;	/* power of two */
+	u32 listcount;
+	u32 codecount;
+} gameconfig_index;
+
+/* A line with a ':' in it, i.e. a possible game ID header */
+typedef struct _gameconfig_node
+{
+	char token[GAMECONFIG_TOKEN_LEN];	/* ID as written, '?' wildcards included */
+	u32 code;							/* first word of its codes in the code stream */
+	u32 codelen;
+	u32 next;							/* header following its codes, GAMECONFIG_NO_NODE at the end */
+} gameconfig_node;
+
+/* Headers sharing the upper case ID part before the first wildcard */
+typedef struct _gameconfig_bucket
+{
+	char key[GAMECONFIG_TOKEN_LEN];
+	u32 list;
+	u32 count;
+} gameconfig_bucket;
+
+u8 *app_gameconfig_compile(const u8 *gameconfig, u32 gameconfigsize, u32 srcsize, u32 srctime, u32 *indexsize);
+bool app_gameconfig_check_index(const u8 *index, u32 indexsize, u32 srcsize, u32 srctime);
+int app_gameconfig_load_index(const char *discid, const u8 *index, u32 indexsize);
 int app_gameconfig_load(const char *discid, u8 *tempgameconf, u32 tempgameconfsize);
 int ocarina_load_code(const u8 *cheat, u32 cheatSize);
 int ocarina_do_code();
@@ -24,6 +24,7 @@
  * gc_disc_dump.cpp
  *
  ***************************************************************************/
+#include <algorithm>
 #include <stdio.h>
 #include <unistd.h>
 #include <ogcsys.h>
@@ -34,15 +35,36 @@
 #include "utils.h"
 #include "wdvd.h"
 #include "devicemounter/DeviceHandler.hpp"
+#include "fileOps/buffer_ring.h"
 #include "fileOps/fileOps.h"
 #include "gecko/gecko.hpp"
 #include "hw/Gekko.h"
+#include "gui/GameTDB.hpp"
 #include "gui/text.hpp"
 #include "memory/mem2.hpp"
 #include "menu/menu.hpp"
+#include "plugin/crc32.h"
 #include "defines.h"
 using namespace std;
 
+/* Reads stay this far ahead of the writes, in gc_readsize slots */
+#define GC_DUMP_AHEAD		(4 * 1024 * 1024)
+#define GC_DUMP_SLOTS_MIN	3
+#define GC_DUMP_SLOTS_MAX	32
+#define GC_DUMP_STACK		(16 * 1024)
+
+#define GC_STAGE_READ		0
+#define GC_STAGE_HASH		1
+
+struct gc_pipe
+{
+	GCDump *dump;
+	const vector<gc_extent> *extents;
+	buffer_ring ring;
+	u32 crc;
+	s32 error;
+};
+
 static u8 *FSTable ATTRIBUTE_ALIGN(32);
 
 void GCDump::__AnalizeMultiDisc()
@@ -66,6 +88,15 @@ void GCDump::__AnalizeMultiDisc()
 	MEM2_free(Buffer);
 }
 
+s32 GCDriveReader::Read(void *outbuf, u64 offset, u32 length)
+{
+	if(WDVD_UnencryptedRead(outbuf, length, offset) == 0)
+		return 0;
+	u32 error = 0;
+	WDVD_LowRequestError(&error);
+	return error != 0 ? error : -1;
+}
+
 s32 GCDump::__DiscReadRaw(void *outbuf, u64 offset, u32 length)
 {
 	length = ALIGN32(length);
@@ -73,10 +104,10 @@ s32 GCDump::__DiscReadRaw(void *outbuf, u64 offset, u32 length)
 	while(1)
 	{
 		gc_error = 0;
-		s32 ret = WDVD_UnencryptedRead(outbuf, length, offset);
+		s32 ret = reader->Read(outbuf, offset, length);
 		if(ret != 0)
 		{
-			WDVD_LowRequestError(&gc_error);
+			gc_error = ret;
 			if(gc_error == 0x30200 || gc_error == 0x30201 || gc_error == 0x31100)
 			{
 				if(gc_retry >= gc_nbrretry && waitonerror)
@@ -130,37 +161,168 @@ s32 GCDump::__DiscReadRaw(void *outbuf, u64 offset, u32 length)
 	return -1;
 }
 
-s32 GCDump::__DiscWrite(char * path, u64 offset, u32 length, u8 *ReadBuffer)
+s32 GCDump::__ReadHeader(void)
+{
+	u8 *Buffer = (u8 *)MEM2_memalign(32, ALIGN32(sizeof(gc_discHdr)));
+	if(Buffer == NULL)
+		return -1;
+	s32 ret = reader->Read(Buffer, 0, ALIGN32(sizeof(gc_discHdr)));
+	memcpy(&gc_hdr, Buffer, sizeof(gc_discHdr));
+	MEM2_free(Buffer);
+	return ret;
+}
+
+s32 GCDump::__DiscWrite(char * path, u64 offset, u32 length, u32 *crc)
 {
 	gprintf("__DiscWrite(%s, 0x%08x, %x)\n", path, offset, length);
-	u32 wrote = 0;
 	FILE *f = fopen(path, "wb");
-
-	wrote = __DiscWriteFile(f, offset, length, ReadBuffer);
-	
+	if(f == NULL)
+	{
+		gprintf("Error opening %s\n", path);
+		gc_error = -1;
+		return -1;
+	}
+	gc_extent extent = { offset, length, false };
+	s32 wrote = __Transfer(f, vector<gc_extent>(1, extent), crc);
 	fclose(f);
 	return wrote;
 }
 
-s32 GCDump::__DiscWriteFile(FILE *f, u64 offset, u32 length, u8 *ReadBuffer)
+void *GCDump::__ReadStage(void *arg)
+{
+	gc_pipe *pipe = (gc_pipe *)arg;
+	GCDump *dump = pipe->dump;
+	const vector<gc_extent> &extents = *pipe->extents;
+
+	for(u32 i = 0; i < extents.size() && !pipe->ring.abort; ++i)
+	{
+		u64 offset = extents[i].offset;
+		u32 left = extents[i].length;
+		while(left > 0 && !pipe->ring.abort)
+		{
+			ring_slot *slot = ring_acquire(&pipe->ring, GC_STAGE_READ);
+			u32 len = min(left, dump->gc_readsize);
+			if(extents[i].zero)
+				memset(slot->data, 0, len);
+			else
+			{
+				s32 ret = dump->__DiscReadRaw(slot->data, offset, len);
+				if(ret == 1)
+					memset(slot->data, 0, len);
+				else if(ret != 0)
+				{
+					pipe->error = ret;
+					ring_abort(&pipe->ring);
+					len = 0;
+				}
+			}
+			slot->len = len;
+			slot->last = false;
+			ring_release(&pipe->ring, GC_STAGE_READ);
+			offset += len;
+			left -= len;
+		}
+	}
+	ring_slot *slot = ring_acquire(&pipe->ring, GC_STAGE_READ);
+	slot->len = 0;
+	slot->last = true;
+	ring_release(&pipe->ring, GC_STAGE_READ);
+	return NULL;
+}
+
+void *GCDump::__HashStage(void *arg)
 {
-	u32 toread = 0;
-	u32 wrote = 0;
+	gc_pipe *pipe = (gc_pipe *)arg;
+	bool last = false;
+	while(!last)
+	{
+		ring_slot *slot = ring_acquire(&pipe->ring, GC_STAGE_HASH);
+		last = slot->last;
+		pipe->crc = crc32buffer(slot->data, slot->len, pipe->crc);
+		ring_release(&pipe->ring, GC_STAGE_HASH);
+	}
+	return NULL;
+}
+
+s32 GCDump::__Transfer(FILE *f, const vector<gc_extent> &extents, u32 *crc)
+{
+	/* The disc is read on one thread and hashed on another while this one
+	   writes, so each step only waits when the ring is full or empty */
+	gc_pipe pipe;
+	pipe.dump = this;
+	pipe.extents = &extents;
+	pipe.crc = 0xFFFFFFFF;
+	pipe.error = 0;
+	u32 stages = crc != NULL ? 3 : 2;
+	u32 slots = min(max(GC_DUMP_AHEAD / gc_readsize, (u32)GC_DUMP_SLOTS_MIN), (u32)GC_DUMP_SLOTS_MAX);
+	if(!ring_init(&pipe.ring, slots, ALIGN32(gc_readsize), stages))
+	{
+		gprintf("Not enough memory for %d read buffers\n", slots);
+		gc_error = -1;
+		return -1;
+	}
 
-	while(length)
+	lwp_t readThread = LWP_THREAD_NULL;
+	lwp_t hashThread = LWP_THREAD_NULL;
+	if(crc != NULL && LWP_CreateThread(&hashThread, __HashStage, &pipe, NULL, GC_DUMP_STACK, 60) < 0)
 	{
-		toread = min(length, gc_readsize);
-		s32 ret = __DiscReadRaw(ReadBuffer, offset, toread);
-		if (ret == 1)
-			memset(ReadBuffer, 0, gc_readsize);
-		else if (ret > 1)
-			return 0;
-		fwrite(ReadBuffer, 1, toread, f);
-		wrote += toread;
-		offset += toread;
-		length -= toread;
-		gc_done += toread;
-		mainMenu.update_pThread(toread);
+		gprintf("Error: no hash thread for the dump\n");
+		ring_free(&pipe.ring);
+		gc_error = -1;
+		return -1;
+	}
+	if(LWP_CreateThread(&readThread, __ReadStage, &pipe, NULL, GC_DUMP_STACK, 60) < 0)
+	{
+		gprintf("Error: no read thread for the dump\n");
+		readThread = LWP_THREAD_NULL;
+		pipe.error = -1;
+		/* Nothing was read, an empty stream lets the hash stage and the
+		   loop below end */
+		ring_slot *slot = ring_acquire(&pipe.ring, GC_STAGE_READ);
+		slot->len = 0;
+		slot->last = true;
+		ring_release(&pipe.ring, GC_STAGE_READ);
+	}
+
+	u32 write = stages - 1;
+	s32 wrote = 0;
+	bool failed = false;
+	while(1)
+	{
+		ring_slot *slot = ring_acquire(&pipe.ring, write);
+		if(slot->last)
+		{
+			ring_release(&pipe.ring, write);
+			break;
+		}
+		if(!failed && fwrite(slot->data, 1, slot->len, f) != slot->len)
+		{
+			gprintf("Write error at 0x%08x\n", wrote);
+			failed = true;
+			ring_abort(&pipe.ring);
+		}
+		wrote += slot->len;
+		gc_done += slot->len;
+		mainMenu.update_pThread(slot->len);
+		ring_release(&pipe.ring, write);
+	}
+	if(readThread != LWP_THREAD_NULL)
+		LWP_JoinThread(readThread, NULL);
+	if(hashThread != LWP_THREAD_NULL)
+		LWP_JoinThread(hashThread, NULL);
+	ring_free(&pipe.ring);
+
+	if(crc != NULL)
+		*crc = ~pipe.crc;
+	if(pipe.error != 0)
+	{
+		gc_error = pipe.error;
+		return -1;
+	}
+	if(failed)
+	{
+		gc_error = -1;
+		return -1;
 	}
 	return wrote;
 }
@@ -276,11 +438,17 @@ bool GCDump::__CheckMDHack(u32 ID)
 
 s32 GCDump::DumpGame()
 {
-	u8 *ReadBuffer = (u8 *)MEM2_memalign(32, ALIGN32(gc_readsize));
+	/* Only headers go through here, the data has its own read buffers */
+	u8 *ReadBuffer = (u8 *)MEM2_memalign(32, ALIGN32(0x440));
 	if(ReadBuffer == NULL)
 		return 0x31100;
 
+	GameTDB gameTDB;
+	if(!verify_tdb.empty() && !compressed)
+		gameTDB.OpenFile(verify_tdb.c_str());
+
 	gc_done = 0;
+	gc_mismatch = 0;
 	gamedone = false;
 	multigamedisc = false;
 	MultiGameDump = 0;
@@ -303,7 +471,7 @@ s32 GCDump::DumpGame()
 		u8 *FSTBuffer;
 		u32 wrote = 0;
 		memset(&gc_hdr, 0, sizeof(gc_hdr));
-		s32 ret = Disc_ReadGCHeader(&gc_hdr);
+		s32 ret = __ReadHeader();
 		if(memcmp(gc_hdr.id, "GCOPDV", 6) == 0)
 		{
 			multigamedisc = true;
@@ -393,15 +561,15 @@ s32 GCDump::DumpGame()
 
 			gprintf("Writing %s/boot.bin\n", folder);
 			snprintf(gamepath, sizeof(gamepath), "%s/boot.bin", folder);
-			gc_done += __DiscWrite(gamepath, NextOffset, 0x440, ReadBuffer);
+			__DiscWrite(gamepath, NextOffset, 0x440);
 
 			gprintf("Writing %s/bi2.bin\n", folder);
 			snprintf(gamepath, sizeof(gamepath), "%s/bi2.bin", folder);
-			gc_done += __DiscWrite(gamepath, 0x440+NextOffset, 0x2000, ReadBuffer);
+			__DiscWrite(gamepath, 0x440+NextOffset, 0x2000);
 
 			gprintf("Writing %s/apploader.img\n", folder);
 			snprintf(gamepath, sizeof(gamepath), "%s/apploader.img", folder);
-			gc_done += __DiscWrite(gamepath, 0x2440+NextOffset, ApploaderSize, ReadBuffer);
+			__DiscWrite(gamepath, 0x2440+NextOffset, ApploaderSize);
 		}
 
 		snprintf(gamepath, sizeof(gamepath), "%s/%s [%.06s]/game.iso", basedir, gc_hdr.title, gc_hdr.id);
@@ -416,13 +584,21 @@ s32 GCDump::DumpGame()
 		{
 			u32 align;
 			u32 correction;
-			u32 toread;
 
 			FILE *f = fopen(gamepath, "wb");
+			if(f == NULL)
+			{
+				gprintf("Error opening %s\n", gamepath);
+				MEM2_free(ReadBuffer);
+				MEM2_free(FSTBuffer);
+				return -1;
+			}
 
-			ret = __DiscWriteFile(f, NextOffset, (FSTOffset + FSTSize), ReadBuffer);
+			/* Lay out the files first, then stream the whole list */
+			vector<gc_extent> extents;
+			gc_extent extent = { NextOffset, FSTOffset + FSTSize, false };
+			extents.push_back(extent);
 			wrote += (FSTOffset + FSTSize);
-			gc_done += wrote;
 	
 			u32 i;
 
@@ -440,34 +616,31 @@ s32 GCDump::DumpGame()
 							while(((wrote+correction) & (align-1)) != 0)
 								correction++;
 							wrote += correction;
-							while(correction)
+							if(correction)
 							{
-								toread=min(correction, gc_readsize);
-								memset(ReadBuffer, 0, toread);
-								fwrite(ReadBuffer, 1, toread, f);
-								correction -= toread;
-								gc_done += toread;
+								gc_extent padding = { 0, correction, true };
+								extents.push_back(padding);
 							}
 							break;
 						}
 					}
-					ret = __DiscWriteFile(f, fst[i].FileOffset+NextOffset, fst[i].FileLength, ReadBuffer);
-					gprintf("Writing: %d/%d: %s from 0x%08x to 0x%08x(%i)\n", i, FSTEnt, FSTNameOff + fst[i].NameOffset, fst[i].FileOffset, wrote, align);
-					if( ret >= 0 )
-					{
-						fst[i].FileOffset = wrote;
-						wrote += ret;
-					}
-					else
-					{
-						MEM2_free(ReadBuffer);
-						MEM2_free(FSTBuffer);
-						fclose(f);
-						return gc_error;
-					}
+					gc_extent file = { fst[i].FileOffset+NextOffset, fst[i].FileLength, false };
+					extents.push_back(file);
+					gprintf("Placing: %d/%d: %s from 0x%08x to 0x%08x(%i)\n", i, FSTEnt, FSTNameOff + fst[i].NameOffset, fst[i].FileOffset, wrote, align);
+					fst[i].FileOffset = wrote;
+					wrote += fst[i].FileLength;
 				}
 			}
 
+			ret = __Transfer(f, extents, NULL);
+			if(ret < 0)
+			{
+				MEM2_free(ReadBuffer);
+				MEM2_free(FSTBuffer);
+				fclose(f);
+				return gc_error;
+			}
+
 			gprintf("Updating FST\n");
 			fseek(f, FSTOffset, SEEK_SET);
 			fwrite(fst, 1, FSTSize, f);
@@ -477,7 +650,8 @@ s32 GCDump::DumpGame()
 		}
 		else
 		{
-			ret = __DiscWrite(gamepath, NextOffset, DiscSize, ReadBuffer);
+			u32 crc = 0;
+			ret = __DiscWrite(gamepath, NextOffset, DiscSize, gameTDB.IsLoaded() ? &crc : NULL);
 			if( ret < 0 )
 			{
 				MEM2_free(ReadBuffer);
@@ -485,6 +659,18 @@ s32 GCDump::DumpGame()
 				return gc_error;
 			}
 			gprintf("Done!! Disc size: %d\n", DiscSize);
+			if(gameTDB.IsLoaded())
+			{
+				char id[7];
+				memcpy(id, gc_hdr.id, 6);
+				id[6] = '\0';
+				vector<u32> known;
+				gameTDB.GetRomCRCs(id, known);
+				bool match = find(known.begin(), known.end(), crc) != known.end();
+				gprintf("CRC32 %08x, %s\n", crc, known.empty() ? "no known dump" : (match ? "matches a known dump" : "does not match any known dump"));
+				if(!known.empty() && !match)
+					gc_mismatch++;
+			}
 		}
 		MEM2_free(FSTBuffer);
 
@@ -540,7 +726,7 @@ s32 GCDump::CheckSpace(u32 *needed, bool comp)
 	{
 		u32 multisize = 0;
 		memset(&gc_hdr, 0, sizeof(gc_hdr));
-		Disc_ReadGCHeader(&gc_hdr);
+		__ReadHeader();
 		if(memcmp(gc_hdr.id, "GCOPDV", 6) == 0)
 		{
 			multigamedisc = true;
@@ -28,6 +28,9 @@
 #ifndef GC_DISC_DUMP_H_
 #define GC_DISC_DUMP_H_
 
+#include <string>
+#include <vector>
+
 typedef void (*progress_callback_t)(int status,int total,void *user_data);
 typedef void (*message_callback_t)(int message, int info, char *cinfo, void *user_data);
 
@@ -66,6 +69,30 @@ struct FST
 	};
 };
 
+/* Where the disc is read from */
+class GCDiscReader
+{
+public:
+	virtual ~GCDiscReader() { }
+	/* 0 when read, the DVD error otherwise */
+	virtual s32 Read(void *outbuf, u64 offset, u32 length) = 0;
+};
+
+/* The disc in the drive, used unless another reader is set */
+class GCDriveReader : public GCDiscReader
+{
+public:
+	s32 Read(void *outbuf, u64 offset, u32 length);
+};
+
+/* A run of the output file, read from the disc or zero filled */
+struct gc_extent
+{
+	u64 offset;
+	u32 length;
+	bool zero;
+};
+
 class GCDump
 {
 public:
@@ -81,7 +108,18 @@ public:
 		usb_dml_game_dir = m_DMLgameDir;
 		gc_skipped = 0;
 		waitonerror = true;
+		reader = &drive;
+		verify_tdb.clear();
+		gc_mismatch = 0;
 	}
+	/* Read from r instead of the drive, a disc image for example. Init
+	   goes back to the drive. */
+	void SetReader(GCDiscReader *r) { reader = r != NULL ? r : &drive; }
+	/* Full dumps get their CRC32 checked against the rom entries of this
+	   wiitdb.xml, empty to skip it */
+	void SetVerify(const char *gametdb) { verify_tdb = gametdb != NULL ? gametdb : ""; }
+	/* Images that did not match any known dump in the last DumpGame */
+	u32 Mismatches() const { return gc_mismatch; }
 	s32 DumpGame( );
 	s32 CheckSpace(u32 *needed, bool comp);
 	u32 GetFreeSpace(char *path, u32 Value);
@@ -96,6 +134,9 @@ private:
 	bool multigamedisc;
 	const char *gamepartition;
 	const char *usb_dml_game_dir;
+	GCDriveReader drive;
+	GCDiscReader *reader;
+	std::string verify_tdb;
 	char minfo[74];
 	u8 Disc;
 	u8 Disc2;
@@ -105,6 +146,7 @@ private:
 	u32 gc_skipped;
 	u32 gc_readsize;
 	u32 gc_done;
+	u32 gc_mismatch;
 	u32 ID;
 	u32 ID2;	
 	u32 ApploaderSize;
@@ -123,8 +165,11 @@ private:
 	u32 Gamesize[10];
 	u64 NextOffset;
 	s32 __DiscReadRaw(void *outbuf, u64 offset, u32 length);
-	s32 __DiscWrite(char * path, u64 offset, u32 length, u8 *ReadBuffer);
-	s32 __DiscWriteFile(FILE *f, u64 offset, u32 length, u8 *ReadBuffer);
+	s32 __ReadHeader(void);
+	s32 __DiscWrite(char * path, u64 offset, u32 length, u32 *crc = NULL);
+	s32 __Transfer(FILE *f, const std::vector<gc_extent> &extents, u32 *crc);
+	static void *__ReadStage(void *arg);
+	static void *__HashStage(void *arg);
 	void __AnalizeMultiDisc();
 	bool __WaitForDisc(u8 dsc, u32 msg);
 	bool __CheckMDHack(u32 ID);
@@ -13,11 +13,14 @@
 
 #include "splits.h"
 #include "gecko/gecko.hpp"
+#include "memory/mem2.hpp"
 
 #define off64_t off_t
 #define FMT_llu "%llu"
 #define FMT_lld "%lld"
 
+#define SPLIT_POS_UNKNOWN ((u64)-1)
+
 static inline void split_error(const char *x)
 {
 	gprintf("\nsplit error: %s\n\n",x);
@@ -44,10 +47,31 @@ void split_get_fname(split_info_t *s, int idx, char *fname)
 	}
 }
 
+static void split_close_file(split_info_t *s, int idx)
+{
+	if (s->fd[idx] < 0) return;
+	close(s->fd[idx]);
+	s->fd[idx] = -1;
+	s->fpos[idx] = SPLIT_POS_UNKNOWN;
+	s->open_cnt--;
+}
+
 int split_open_file(split_info_t *s, int idx)
 {
 	int fd = s->fd[idx];
+	s->fused[idx] = ++s->clock;
 	if (fd >= 0) return fd;
+	if (s->open_cnt >= SPLIT_OPEN_MAX)
+	{
+		// libfat has few file handles, give back the least recently used
+		int i, oldest = -1;
+		for (i = 0; i < s->max_split; i++)
+		{
+			if (s->fd[i] >= 0 && (oldest < 0 || s->fused[i] < s->fused[oldest]))
+				oldest = i;
+		}
+		if (oldest >= 0) split_close_file(s, oldest);
+	}
 	char fname[1024];
 	split_get_fname(s, idx, fname);
 	//char *mode = s->create_mode ? "wb+" : "rb+";
@@ -61,6 +85,11 @@ int split_open_file(split_info_t *s, int idx)
 		//gprintf("%s Split: %d %s		\n", s->create_mode ? "Create" : "Read", idx, fname);
 	}
 	s->fd[idx] = fd;
+	s->open_cnt++;
+	// only seek to the end once, the size is tracked from here on
+	off64_t fsize = lseek(fd, 0, SEEK_END);
+	s->fsize[idx] = fsize < 0 ? 0 : fsize;
+	s->fpos[idx] = s->fsize[idx];
 	return fd;
 }
 
@@ -88,14 +117,17 @@ int write_zero(int fd, off_t size)
 
 int split_fill(split_info_t *s, int idx, u64 size)
 {
+	// a split opened before has a known size, no need to open it again
+	if (s->fd[idx] < 0 && s->fsize[idx] >= size) return 0;
 	int fd = split_open_file(s, idx);
-	
-	off64_t fsize = lseek(fd, 0, SEEK_END);
-	if((u64)fsize < size)
+	if (fd < 0) return 0;
+
+	if(s->fsize[idx] < size)
 	{
-//		gprintf("TRUNC %d "FMT_lld" "FMT_lld"\n", idx, size, fsize); // Wpad_WaitButtons();
+//		gprintf("TRUNC %d "FMT_lld" "FMT_lld"\n", idx, size, s->fsize[idx]); // Wpad_WaitButtons();
 		ftruncate(fd, size);
-//		write_zero(fd, size - fsize);
+//		write_zero(fd, size - s->fsize[idx]);
+		s->fsize[idx] = size;
 		return 1;
 	}
 	return 0;
@@ -114,8 +146,7 @@ int split_get_file(split_info_t *s, u32 lba, u32 *sec_count, int fill)
 		gprintf( "SPLIT: invalid split %d / %d\n", idx, s->max_split - 1);
 		return -1;
 	}
-	fd = s->fd[idx];
-	if (fd<0) {
+	if (s->fd[idx]<0) {
 		// opening new, make sure all previous are full
 		int i;
 		for (i=0; i<idx; i++) {
@@ -123,8 +154,8 @@ int split_get_file(split_info_t *s, u32 lba, u32 *sec_count, int fill)
 				printf("FILL %d\n", i);
 			}
 		}
-		fd = split_open_file(s, idx);
 	}
+	fd = split_open_file(s, idx);
 	if (fd<0) {
 		gprintf( "SPLIT %d: no file\n", idx);
 		return -1;
@@ -145,75 +176,146 @@ int split_get_file(split_info_t *s, u32 lba, u32 *sec_count, int fill)
 			split_fill(s, idx, off);
 		}
 	}
-	lseek(fd, off, SEEK_SET);
+	// sequential transfers are already at the right place
+	if (s->fpos[idx] != (u64)off) {
+		if (lseek(fd, off, SEEK_SET) < 0) {
+			s->fpos[idx] = SPLIT_POS_UNKNOWN;
+			gprintf( "SPLIT %d: seek to "FMT_lld" failed\n", idx, off);
+			return -1;
+		}
+		s->fpos[idx] = off;
+	}
 	return fd;
 }
 
+// reads or writes count sectors at lba, crossing into the next split as needed
+static int split_io(split_info_t *s, u32 lba, u32 count, u8 *buf, int wr)
+{
+	u32 i;
+	u32 chunk;
+	int fd;
+	for (i = 0; i < count; i += chunk)
+	{
+		chunk = count - i;
+		fd = split_get_file(s, lba+i, &chunk, !wr);
+		if (fd < 0 || !chunk)
+			return -1;
+		int idx = (lba+i) / s->split_sec;
+		u32 len = chunk * 512;
+		ssize_t ret = wr ? write(fd, buf+i*512, len) : read(fd, buf+i*512, len);
+		if (ret != (ssize_t)len)
+		{
+			gprintf( "error %s %u %u [%u] %u = %d\n", wr ? "writing" : "reading", lba, count, i, chunk, ret);
+			s->fpos[idx] = SPLIT_POS_UNKNOWN;
+			return -1;
+		}
+		s->fpos[idx] += len;
+		if (s->fpos[idx] > s->fsize[idx])
+			s->fsize[idx] = s->fpos[idx];
+	}
+	return 0;
+}
+
+// writes out what split_write_sector has merged so far, returns 1 if that
+// or any write before failed
+int split_flush(split_info_t *s)
+{
+	if (!s->wbuf_cnt) return s->write_error;
+	u32 lba = s->wbuf_lba;
+	u32 count = s->wbuf_cnt;
+	s->wbuf_cnt = 0;
+	if (split_io(s, lba, count, s->wbuf, 1))
+	{
+		s->write_error = 1;
+		split_error("error writing disc\n");
+		return 1;
+	}
+	return 0;
+}
+
 int split_read_sector(void *_fp, u32 lba, u32 count, void *buf)
 {
 	split_info_t *s = _fp;
-	int fd;
 	u64 off = lba;
 	off *= 512ULL;
-	int i;
-	u32 chunk;
-	size_t ret;
 	//gprintf("READ %d %d\n", lba, count);
-	for (i=0; i<(int)count; i+=chunk)
+	// the disc has to see pending writes
+	if (s->wbuf_cnt && lba < s->wbuf_lba + s->wbuf_cnt && lba + count > s->wbuf_lba)
 	{
-		chunk = count - i;
-		fd = split_get_file(s, lba+i, &chunk, 1);
-		if (fd<0) 
-		{
-			gprintf("\n\n"FMT_lld" %d %p\n",off,count,_fp);
-			split_error("error seeking in disc partition\n");
-			return 1;
-		}
-		//ret = fread(buf+i*512, 512ULL, chunk, f);
-		ret = read(fd, buf+i*512, chunk * 512);
-		if (ret != chunk * 512)
+		if (split_flush(s)) return 1;
+	}
+	// libwbfs reads the partial sectors around a larger read one at a
+	// time, the last one is often the first of the next read. Small reads
+	// are kept, and read ahead when they follow each other. Not while
+	// creating, reads there extend the files.
+	if (!s->create_mode && count <= SPLIT_RBUF_SECS / 2 && lba + count <= s->total_sec)
+	{
+		if (s->rbuf == NULL)
+			s->rbuf = MEM2_memalign(32, SPLIT_RBUF_SECS * 512);
+		if (s->rbuf != NULL)
 		{
-			gprintf( "error reading %u %u [%u] %u = %u\n", lba, count, i, chunk, ret);
-			split_error("error reading disc\n");
-			return 1;
+			if (lba < s->rbuf_lba || lba + count > s->rbuf_lba + s->rbuf_cnt)
+			{
+				u32 cnt = count;
+				if (lba == s->rbuf_next)
+				{
+					cnt = s->total_sec - lba;
+					if (cnt > SPLIT_RBUF_SECS) cnt = SPLIT_RBUF_SECS;
+				}
+				s->rbuf_cnt = 0;
+				if (s->wbuf_cnt && lba < s->wbuf_lba + s->wbuf_cnt && lba + cnt > s->wbuf_lba)
+				{
+					if (split_flush(s)) return 1;
+				}
+				if (split_io(s, lba, cnt, s->rbuf, 0))
+					goto error;
+				s->rbuf_lba = lba;
+				s->rbuf_cnt = cnt;
+			}
+			memcpy(buf, s->rbuf + (lba - s->rbuf_lba) * 512, count * 512);
+			s->rbuf_next = lba + count;
+			return 0;
 		}
 	}
-	return 0;
+	s->rbuf_next = (u32)-1;
+	if (split_io(s, lba, count, buf, 0) == 0)
+		return 0;
+error:
+	gprintf("\n\n"FMT_lld" %d %p\n",off,count,_fp);
+	split_error("error reading disc\n");
+	return 1;
 }
 
 int split_write_sector(void *_fp, u32 lba, u32 count, void *buf)
 {
 	split_info_t *s = _fp;
-	int fd;                                 
 	u64 off = lba;
 	off*=512ULL;
-	int i;
-	u32 chunk;
-	size_t ret;
 //	gprintf("WRITE %d %d %p \n", lba, count, buf);
-	for (i=0; i<(int)count; i+=chunk)
+	if (s->rbuf_cnt && lba < s->rbuf_lba + s->rbuf_cnt && lba + count > s->rbuf_lba)
+		s->rbuf_cnt = 0;
+	// libwbfs writes one wii sector at a time, merge the adjacent ones
+	if (s->wbuf_cnt && (lba != s->wbuf_lba + s->wbuf_cnt || s->wbuf_cnt + count > SPLIT_WBUF_SECS))
 	{
-		chunk = count - i;
-		fd = split_get_file(s, lba+i, &chunk, 0);
-//		gprintf("WRITE Got file: %d\n", fd);
-		//if (chunk != count)
-		//	gprintf( "WRITE CHUNK %d %d/%d\n", lba+i, chunk, count);
-		if (fd<0 || !chunk)
-		{
-			gprintf("\n\n"FMT_lld" %d %p\n",off,count,_fp);
-			split_error("error seeking in disc partition\n");
-			return 1;
-		}
-		//if (fwrite(buf+i*512, 512ULL, chunk, f) != chunk) {
-//		gprintf("write %d %p %d \n", fd, buf+i*512, chunk * 512);
-		ret = write(fd, buf+i*512, chunk * 512);
-//		gprintf("write ret = %d \n", ret);
-		if (ret != chunk * 512)
-		{
-			split_error("error writing disc\n");
-			return 1;
-		}
+		if (split_flush(s)) return 1;
+	}
+	if (s->wbuf == NULL && count < SPLIT_WBUF_SECS)
+		s->wbuf = MEM2_memalign(32, SPLIT_WBUF_SECS * 512);
+	if (s->wbuf == NULL || count >= SPLIT_WBUF_SECS)
+	{
+		if (split_io(s, lba, count, buf, 1) == 0)
+			return 0;
+		s->write_error = 1;
+		gprintf("\n\n"FMT_lld" %d %p\n",off,count,_fp);
+		split_error("error writing disc\n");
+		return 1;
 	}
+	if (!s->wbuf_cnt)
+		s->wbuf_lba = lba;
+	memcpy(s->wbuf + s->wbuf_cnt * 512, buf, count * 512);
+	s->wbuf_cnt += count;
+	if (s->wbuf_cnt == SPLIT_WBUF_SECS)
+		return split_flush(s);
 	return 0;
 }
 
@@ -226,6 +328,7 @@ void split_init(split_info_t *s, char *fname)
 	for (i = 0; i < MAX_SPLIT; i++)
 	{
 		s->fd[i] = -1;
+		s->fpos[i] = SPLIT_POS_UNKNOWN;
 	}
 	strcpy(s->fname, fname);
 	s->max_split = 1;
@@ -244,22 +347,25 @@ void split_set_size(split_info_t *s, u64 split_size, u64 total_size)
 	s->split_sec  = split_size / 512;
 }
 
-void split_close(split_info_t *s)
+// returns 1 if the last flush or any write before it failed
+int split_close(split_info_t *s)
 {
 	int i;
 //	char fname[1024];
 //	char tmpname[1024];
+	int ret = split_flush(s);
 	for (i=0; i<s->max_split; i++) {
-		if (s->fd[i] >= 0) {
-			close(s->fd[i]);
-		}
+		split_close_file(s, i);
 	}
+	if (s->wbuf) MEM2_free(s->wbuf);
+	if (s->rbuf) MEM2_free(s->rbuf);
 //	if (s->create_mode) {
 //		split_get_fname(s, -1, fname);
 //		split_get_fname(s, 0, tmpname);
 //		rename(tmpname, fname);
 //	}
 	memset(s, 0, sizeof(*s));
+	return ret;
 }
 
 int split_create(split_info_t *s, char *fname,
@@ -319,7 +425,7 @@ int split_open(split_info_t *s, char *fname)
 		// get size
 		//fseeko(f, 0, SEEK_END);
 		//size = ftello(f);
-		size = lseek(fd, 0, SEEK_END);
+		size = s->fsize[i];
 		// check sector alignment
 		if (size % 512)
 			gprintf("split %i: size (%ld) not sector (512) aligned!", i, size);
@@ -6,13 +6,31 @@ extern "C" {
 #include "libwbfs/libwbfs.h"
 
 #define MAX_SPLIT 10
+// split files kept open at once, the least recently used one is closed first
+#define SPLIT_OPEN_MAX 3
+// adjacent writes are merged up to this many sectors (1mb)
+#define SPLIT_WBUF_SECS 2048
+// small reads are kept in, and read ahead into, this many sectors (8kb)
+#define SPLIT_RBUF_SECS 16
 
 typedef struct split_info
 {
 	char fname[1024];
 	//FILE *f[MAX_SPLIT];
 	int fd[MAX_SPLIT];
-	//u64 fsize[MAX_SPLIT];
+	u64 fsize[MAX_SPLIT];	// kept up to date while writing
+	u64 fpos[MAX_SPLIT];	// file position, to skip redundant seeks
+	u32 fused[MAX_SPLIT];	// last use of the handle
+	u32 clock;
+	int open_cnt;
+	u8 *wbuf;				// pending sequential writes
+	u32 wbuf_lba;
+	u32 wbuf_cnt;
+	int write_error;		// a write failed since the split was opened
+	u8 *rbuf;				// last read window
+	u32 rbuf_lba;
+	u32 rbuf_cnt;
+	u32 rbuf_next;			// where the last small read ended
 	u32 split_sec;
 	u32 total_sec;
 	u64 split_size;
@@ -32,9 +50,10 @@ int   split_get_file(split_info_t *s, u32 lba, u32 *sec_count, int fill);
 int   split_fill(split_info_t *s, int idx, u64 size);
 int	  split_read_sector(void *_fp, u32 lba, u32 count, void *buf);
 int   split_write_sector(void *_fp, u32 lba, u32 count, void *buf);
+int   split_flush(split_info_t *s);
 void  split_init(split_info_t *s, char *fname);
 void  split_set_size(split_info_t *s, u64 split_size, u64 total_size);
-void  split_close(split_info_t *s);
+int   split_close(split_info_t *s);
 int   split_open(split_info_t *s, char *fname);
 int   split_create(split_info_t *s, char *fname,
 		u64 split_size, u64 total_size, bool overwrite);
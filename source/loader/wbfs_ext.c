@@ -134,12 +134,14 @@ wbfs_t* WBFS_Ext_OpenPart(char *fname)
 	return part;
 }
 
-void WBFS_Ext_ClosePart(wbfs_t* part)
+s32 WBFS_Ext_ClosePart(wbfs_t* part)
 {
-	if (!part) return;
+	if (!part) return 0;
 	split_info_t *s = (split_info_t*)part->callback_data;
 	wbfs_close(part);
-	if (s) split_close(s);
+	// wbfs_close can still write the header, it is flushed here
+	if (s && split_close(s)) return -1;
+	return 0;
 }
 
 s32 WBFS_Ext_RemoveGame(u8 *discid, char *gamepath)
@@ -222,7 +224,9 @@ s32 WBFS_Ext_AddGame(progress_callback_t spinner, void *spinner_data)
 
 	if(ret == 0) wbfs_trim(part);
 
-	WBFS_Ext_ClosePart(part);
+	// libwbfs does not check its writes, a failed one shows up when the
+	// header written by wbfs_close is flushed
+	if(WBFS_Ext_ClosePart(part) < 0 && ret == 0) ret = -1;
 	
 	if(ret < 0) WBFS_Ext_RemoveGame(NULL, gamepath);
 
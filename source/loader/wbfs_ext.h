@@ -10,7 +10,7 @@ extern "C" {
 #endif
 
 wbfs_t* WBFS_Ext_OpenPart(char *fname);
-void WBFS_Ext_ClosePart(wbfs_t* part);
+s32 WBFS_Ext_ClosePart(wbfs_t* part);
 wbfs_disc_t* WBFS_Ext_OpenDisc(u8 *discid, char *fname);
 void WBFS_Ext_CloseDisc(wbfs_disc_t* disc);
 s32  WBFS_Ext_DiskSpace(f32 *used, f32 *free);
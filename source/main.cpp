@@ -7,6 +7,7 @@
 #include "channel/nand.hpp"
 #include "channel/nand_save.hpp"
 #include "devicemounter/DeviceHandler.hpp"
+#include "fileOps/copy_engine.h"
 #include "gecko/gecko.hpp"
 #include "gui/video.hpp"
 #include "gui/text.hpp"
@@ -37,6 +38,7 @@ int main(int argc, char **argv)
 	m_vid.init(); // Init video
 	DeviceHandle.Init();
 	NandHandle.Init();
+	copy_init();
 
 	char *gameid = NULL;
 	bool Emulator_boot = false;
@@ -176,6 +176,20 @@ void *MemManager::ReAlloc(void *mem, u32 size)
 		return Alloc(size);
 
 	//gprintf("Realloc %x, %i\n", mem, size);
+	u32 blocks = MemBlockSize(mem) / MEM_BLOCK_SIZE;
+	u32 keep = ALIGN(MEM_BLOCK_SIZE, size) / MEM_BLOCK_SIZE;
+	if(keep > 0 && keep <= blocks)
+	{
+		/* Shrinking stays in place, the tail blocks are freed */
+		LWP_MutexLock(memMutex);
+		u8 *addr = memList + (((u8*)mem - startAddr) / MEM_BLOCK_SIZE);
+		ICInvalidateRange(addr, blocks);
+		memset(addr + keep - 1, ALLOC_END, 1);
+		memset(addr + keep, MEM_FREE, blocks - keep);
+		DCFlushRange(addr, blocks);
+		LWP_MutexUnlock(memMutex);
+		return mem;
+	}
 	void *new_m = Alloc(size);
 	if(new_m == NULL)
 	{
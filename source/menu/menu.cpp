@@ -16,6 +16,7 @@
 #include "gc/gc.hpp"
 #include "hw/Gekko.h"
 #include "gui/GameTDB.hpp"
+#include "gui/residency.hpp"
 #include "loader/alt_ios.h"
 #include "loader/cios.h"
 #include "loader/fs.h"
@@ -40,6 +41,7 @@ CMenu::CMenu()
 {
 	m_aa = 0;
 	m_thrdWorking = false;
+	m_thrdFailed = false;
 	m_thrdStop = false;
 	m_thrdProgress = 0.f;
 	m_thrdStep = 0.f;
@@ -54,6 +56,7 @@ CMenu::CMenu()
 	m_numCFVersions = 0;
 	m_bgCrossFade = 0;
 	m_bnrSndVol = 0;
+	m_themeResHandle = -1;
 	m_bnr_settings = true;
 	m_directLaunch = false;
 	m_exit = false;
@@ -110,6 +113,7 @@ CMenu::CMenu()
 void CMenu::init()
 {
 	SoundHandle.Init();
+	Residency.Init();
 	m_gameSound.SetVoice(1);
 	const char *drive = "empty";
 	const char *check = "empty";
@@ -169,6 +173,25 @@ void CMenu::init()
 	/* Check if we want SD Gecko */
 	m_use_sd_logging = m_cfg.getBool("DEBUG", "sd_write_log", false);
 	LogToSD_SetBuffer(m_use_sd_logging);
+	/* Per subsystem log levels, 0 errors only, 1 info, 2 debug */
+	Log_SetLevel(LOG_GENERAL, m_cfg.getInt("DEBUG", "log_level_general", LOG_INFO));
+	Log_SetLevel(LOG_GUI, m_cfg.getInt("DEBUG", "log_level_gui", LOG_INFO));
+	Log_SetLevel(LOG_NET, m_cfg.getInt("DEBUG", "log_level_net", LOG_INFO));
+	Log_SetLevel(LOG_PLUGIN, m_cfg.getInt("DEBUG", "log_level_plugin", LOG_INFO));
+	Log_SetLevel(LOG_SOUND, m_cfg.getInt("DEBUG", "log_level_sound", LOG_INFO));
+	Log_SetLevel(LOG_DISC, m_cfg.getInt("DEBUG", "log_level_disc", LOG_INFO));
+	/* Texture memory budgets in MB */
+	Residency.SetBudget(RES_COVER, m_cfg.getUInt("GENERAL", "cover_budget_mb", 16) << 20);
+	Residency.SetBudget(RES_FANART, m_cfg.getUInt("GENERAL", "fanart_budget_mb", 8) << 20);
+	Residency.SetBudget(RES_BANNER, m_cfg.getUInt("GENERAL", "banner_budget_mb", 4) << 20);
+	Residency.SetBudget(RES_THEME, m_cfg.getUInt("GENERAL", "theme_budget_mb", 12) << 20);
+#ifdef PROFILER
+	/* Frame profiler, HUD on the main screen and optional log dumps */
+	Profiler.Init(m_vid.vid_50hz());
+	m_profilerHud = m_cfg.getBool("DEBUG", "profiler_hud", true);
+	m_profilerLogFrames = m_cfg.getUInt("DEBUG", "profiler_log_frames", 0);
+	m_profilerLastFrame = 0;
+#endif
 	/* Check if we want FTP */
 	m_init_ftp = m_cfg.getBool(FTP_DOMAIN, "auto_start", false);
 	ftp_allow_active = m_cfg.getBool(FTP_DOMAIN, "allow_active_mode", false);
@@ -340,6 +363,7 @@ void CMenu::init()
 
 	fsop_MakeFolder(m_cacheDir.c_str());
 	fsop_MakeFolder(m_listCacheDir.c_str());
+	ChannelHandle.SetCacheDir(m_listCacheDir.c_str());
 	fsop_MakeFolder(m_bnrCacheDir.c_str());
 
 	fsop_MakeFolder(m_txtCheatDir.c_str());
@@ -506,6 +530,8 @@ void CMenu::cleanup()
 
 void CMenu::_Theme_Cleanup(void)
 {
+	Residency.Remove(m_themeResHandle);
+	m_themeResHandle = -1;
 	/* Backgrounds */
 	TexHandle.Cleanup(theme.bg);
 	m_prevBg = NULL;
@@ -1285,6 +1311,16 @@ void CMenu::_buildMenus(void)
 	_initPathsMenu();
 
 	_loadCFCfg();
+
+	/* The theme textures are accounted as one pinned entry. Their sizes are
+	   summed, MEM2_freesize would also count what other threads allocate. */
+	u32 themeUsed = 0;
+	for(TexSet::iterator i = theme.texSet.begin(); i != theme.texSet.end(); ++i)
+		themeUsed += CResidency::TexSize(i->second);
+	if(m_themeResHandle < 0)
+		m_themeResHandle = Residency.Add(RES_THEME, themeUsed);
+	else
+		Residency.Resize(m_themeResHandle, themeUsed);
 }
 
 typedef struct
@@ -1367,7 +1403,11 @@ vector<TexData> CMenu::_textures(const char *domain, const char *key)
 				if (i != theme.texSet.end())
 					textures.push_back(i->second);
 				TexData tex;
-				if(TexHandle.fromImageFile(tex, fmt("%s/%s", m_themeDataDir.c_str(), filename.c_str())) == TE_OK)
+				TexErr ret = TexHandle.fromImageFile(tex, fmt("%s/%s", m_themeDataDir.c_str(), filename.c_str()));
+				/* Out of MEM2, covers make room for what the load needed */
+				if(ret == TE_NOMEM && Residency.Reserve(RES_THEME, tex.dataSize))
+					ret = TexHandle.fromImageFile(tex, fmt("%s/%s", m_themeDataDir.c_str(), filename.c_str()));
+				if(ret == TE_OK)
 				{
 					theme.texSet[filename] = tex;
 					textures.push_back(tex);
@@ -1391,9 +1431,12 @@ TexData CMenu::_texture(const char *domain, const char *key, TexData &def, bool
 			TexSet::iterator i = theme.texSet.find(filename);
 			if(i != theme.texSet.end())
 				return i->second;
-			/* Load from image file */
+			/* Load from image file, covers make room if MEM2 runs short */
 			TexData tex;
-			if(TexHandle.fromImageFile(tex, fmt("%s/%s", m_themeDataDir.c_str(), filename.c_str())) == TE_OK)
+			TexErr ret = TexHandle.fromImageFile(tex, fmt("%s/%s", m_themeDataDir.c_str(), filename.c_str()));
+			if(ret == TE_NOMEM && Residency.Reserve(RES_THEME, tex.dataSize))
+				ret = TexHandle.fromImageFile(tex, fmt("%s/%s", m_themeDataDir.c_str(), filename.c_str()));
+			if(ret == TE_OK)
 			{
 				if(freeDef && def.data != NULL)
 				{
@@ -1424,7 +1467,8 @@ GuiSound *CMenu::_sound(CMenu::SoundSet &soundSet, const char *domain, const cha
 		{
 			u32 size = 0;
 			u8 *mem = fsop_ReadFile(fmt("%s/%s", m_themeDataDir.c_str(), filename), &size);
-			soundSet[upperCase(filename)] = new GuiSound(mem, size, filename, true);
+			soundSet[upperCase(filename)] = new GuiSound();
+			soundSet[upperCase(filename)]->LoadThemeSound(mem, size, filename);
 		}
 		else
 			soundSet[upperCase(filename)] = new GuiSound(snd, len, filename, isAllocated);
@@ -1451,7 +1495,8 @@ GuiSound *CMenu::_sound(CMenu::SoundSet &soundSet, const char *domain, const cha
 		{
 			u32 size = 0;
 			u8 *mem = fsop_ReadFile(fmt("%s/%s", m_themeDataDir.c_str(), filename), &size);
-			soundSet[upperCase(filename)] = new GuiSound(mem, size, filename, true);
+			soundSet[upperCase(filename)] = new GuiSound();
+			soundSet[upperCase(filename)]->LoadThemeSound(mem, size, filename);
 		}
 		else
 			soundSet[upperCase(filename)] = new GuiSound();
@@ -1906,23 +1951,37 @@ void CMenu::_initCF(void)
 
 void CMenu::_mainLoopCommon(bool withCF, bool adjusting)
 {
+	PROFILE_FRAME();
 	if(withCF)
+	{
+		PROFILE_ZONE(PROF_CF_TICK);
 		CoverFlow.tick();
-	m_btnMgr.tick();
-	m_fa.tick();
+	}
+	{
+		PROFILE_ZONE(PROF_BTN_TICK);
+		m_btnMgr.tick();
+	}
+	{
+		PROFILE_ZONE(PROF_FANART);
+		m_fa.tick();
+	}
 	m_fa.hideCover() ? 	CoverFlow.hideCover() : CoverFlow.showCover();
 	CoverFlow.setFanartPlaying(m_fa.isLoaded());
 	CoverFlow.setFanartTextColor(m_fa.getTextColor(m_theme.getColor("_COVERFLOW", "font_color", CColor(0xFFFFFFFF))));
 
 	m_vid.prepare();
 	m_vid.setup2DProjection(false, true);
-	_updateBg();
-	if(CoverFlow.getRenderTex())
-		CoverFlow.RenderTex();
-	if(withCF && m_lqBg != NULL)
-		CoverFlow.makeEffectTexture(m_lqBg);
+	{
+		PROFILE_ZONE(PROF_BG);
+		_updateBg();
+		if(CoverFlow.getRenderTex())
+			CoverFlow.RenderTex();
+		if(withCF && m_lqBg != NULL)
+			CoverFlow.makeEffectTexture(m_lqBg);
+	}
 	if(withCF && m_aa > 0)
 	{
+		PROFILE_ZONE(PROF_SCENE);
 		m_vid.setAA(m_aa, true);
 		for(int i = 0; i < m_aa; ++i)
 		{
@@ -1934,7 +1993,10 @@ void CMenu::_mainLoopCommon(bool withCF, bool adjusting)
 			m_vid.setup2DProjection(false, true);
 			CoverFlow.drawEffect();
 			if(!m_banner.GetSelectedGame())
+			{
+				PROFILE_ZONE(PROF_TEXT);
 				CoverFlow.drawText(adjusting);
+			}
 			m_vid.renderAAPass(i);
 		}
 		m_vid.setup2DProjection();
@@ -1942,6 +2004,7 @@ void CMenu::_mainLoopCommon(bool withCF, bool adjusting)
 	}
 	else
 	{
+		PROFILE_ZONE(PROF_SCENE);
 		m_vid.setup2DProjection();
 		_drawBg();
 		m_fa.draw(false);
@@ -1951,20 +2014,27 @@ void CMenu::_mainLoopCommon(bool withCF, bool adjusting)
 			m_vid.setup2DProjection();
 			CoverFlow.drawEffect();
 			if(!m_banner.GetSelectedGame())
+			{
+				PROFILE_ZONE(PROF_TEXT);
 				CoverFlow.drawText(adjusting);
+			}
 		}
 	}
-	if(m_fa.isLoaded())
-		m_fa.draw();
-	else if(m_banner.GetSelectedGame() && (!m_banner.GetInGameSettings() || (m_banner.GetInGameSettings() && m_bnr_settings)))
-		m_banner.Draw();
+	{
+		PROFILE_ZONE(PROF_OVERLAY);
+		if(m_fa.isLoaded())
+			m_fa.draw();
+		else if(m_banner.GetSelectedGame() && (!m_banner.GetInGameSettings() || (m_banner.GetInGameSettings() && m_bnr_settings)))
+			m_banner.Draw();
 
-	m_btnMgr.draw();
+		m_btnMgr.draw();
+	}
 	ScanInput();
 	if(!m_vid.showingWaitMessage())
 	{
 		if(!m_cfg.getBool("GENERAL", "screensaver_disabled", false))
 			m_vid.screensaver(NoInputTime(), m_cfg.getInt("GENERAL", "screensaver_idle_seconds", 60));
+		PROFILE_ZONE(PROF_RENDER);
 		m_vid.render();
 	}
 	if(Sys_Exiting())
@@ -2014,6 +2084,8 @@ void CMenu::_mainLoopCommon(bool withCF, bool adjusting)
 #ifdef SHOWMEM
 	m_btnMgr.setText(m_mem1FreeSize, wfmt(L"Mem1 lo Free:%u, Mem1 Free:%u, Mem2 Free:%u",
 				MEM1_lo_freesize(), MEM1_freesize(), MEM2_freesize()), true);
+	m_btnMgr.setText(m_mem2FreeSize, wfmt(L"Covers:%u, Fanart:%u, Banner:%u, Theme:%u",
+				Residency.Used(RES_COVER), Residency.Used(RES_FANART), Residency.Used(RES_BANNER), Residency.Used(RES_THEME)), true);
 #endif
 
 #ifdef SHOWMEMGECKO
@@ -2030,8 +2102,41 @@ void CMenu::_mainLoopCommon(bool withCF, bool adjusting)
 		gprintf("Mem2 Free: %u\n", mem2);
 	}	
 #endif
+
+#ifdef PROFILER
+	_updateProfiler();
+#endif
 }
 
+#ifdef PROFILER
+void CMenu::_updateProfiler(void)
+{
+	u32 frames = Profiler.Frames();
+	if(frames == 0 || frames == m_profilerLastFrame)
+		return;
+	m_profilerLastFrame = frames;
+	if(m_profilerLogFrames > 0 && frames % m_profilerLogFrames == 0)
+	{
+		Profiler.Dump();
+		Residency.Dump();
+	}
+	/* Percentiles need a sort, refresh them twice a second */
+	if(!m_profilerHud || frames % 30 != 0)
+		return;
+	wstringEx hud(wfmt(L"dropped %u", Profiler.DroppedFrames()));
+	u32 p50, p99;
+	for(u32 i = 0; i < PROF_ZONES; ++i)
+	{
+		Profiler.GetStats(i, p50, p99);
+		hud.append(wfmt(L"\n%s %u/%u", CProfiler::ZoneName(i), p50, p99));
+	}
+	hud.append(wfmt(L"\nmem2 %uK", MEM2_freesize() >> 10));
+	for(u32 i = 0; i < RES_CATEGORIES; ++i)
+		hud.append(wfmt(L"\n%s %uK/%uK", CResidency::CategoryName(i), Residency.Used(i) >> 10, Residency.Budget(i) >> 10));
+	m_btnMgr.setText(m_profilerLbl, hud, true);
+}
+#endif
+
 void CMenu::_setBg(const TexData &tex, const TexData &lqTex)
 {
 	/* Not setting same bg again */
@@ -19,6 +19,7 @@
 #include "gui/cursor.hpp"
 #include "gui/fanart.hpp"
 #include "gui/gui.hpp"
+#include "gui/Profiler.hpp"
 #include "list/ListGenerator.hpp"
 #include "loader/disc.h"
 #include "loader/sys.h"
@@ -181,6 +182,13 @@ private:
 	unsigned int mem2old;
 	unsigned int mem2;
 #endif
+#ifdef PROFILER
+	s16 m_profilerLbl;
+	bool m_profilerHud;
+	u32 m_profilerLogFrames;
+	u32 m_profilerLastFrame;
+#endif
+	s32 m_themeResHandle;
 	s16 m_mainLblNotice;
 	s16 m_mainBtnNext;
 	s16 m_mainBtnPrev;
@@ -681,6 +689,7 @@ private:
 	volatile bool m_exit;
 	volatile bool m_thrdStop;
 	volatile bool m_thrdWorking;
+	volatile bool m_thrdFailed;
 	volatile bool m_thrdNetwork;
 	float m_thrdStep;
 	float m_thrdStepLen;
@@ -904,6 +913,7 @@ private:
 	void _refreshBoot();
 	void _refreshCfgSrc();
 	void _refreshExplorer(s8 direction = 0);
+	void _pageExplorer(bool entries_changed);
 	void _refreshLangSettings();
 	//
 	void _hideCheatSettings(bool instant = false);
@@ -1039,6 +1049,9 @@ private:
 	void _sourceFlow();
 	void _createSFList();
 	void _mainLoopCommon(bool withCF = false, bool adjusting = false);
+#ifdef PROFILER
+	void _updateProfiler(void);
+#endif
 public:
 	void directlaunch(const char *GameID);
 private:
@@ -76,7 +76,9 @@ void CMenu::_CheatSettings()
 	const char *id = CoverFlow.getId();
 
 	m_cheatSettingsPage = 1;
-	int txtavailable = m_cheatfile.openTxtfile(fmt("%s/%s.txt", m_txtCheatDir.c_str(), id)); 
+	fsop_MakeFolder(fmt("%s/cheats", m_cacheDir.c_str()));
+	int txtavailable = m_cheatfile.openTxtfile(fmt("%s/%s.txt", m_txtCheatDir.c_str(), id),
+		fmt("%s/cheats/%s.cht", m_cacheDir.c_str(), id));
 	
 	_showCheatSettings();
 	_textCheatSettings();
@@ -119,6 +121,7 @@ void CMenu::_CheatSettings()
 		{
 			fsop_deleteFile(fmt("%s/%s.gct", m_cheatDir.c_str(), id));
 			fsop_deleteFile(fmt("%s/%s.txt", m_txtCheatDir.c_str(), id));
+			fsop_deleteFile(fmt("%s/cheats/%s.cht", m_cacheDir.c_str(), id));
 			m_gcfg2.remove(id, "cheat");
 			m_gcfg2.remove(id, "hooktype");
 			break;
@@ -232,7 +235,8 @@ void CMenu::_CheatSettings()
 				}
 				_hideCheatDownload();
 				
-				txtavailable = m_cheatfile.openTxtfile(fmt("%s/%s.txt", m_txtCheatDir.c_str(), id));
+				txtavailable = m_cheatfile.openTxtfile(fmt("%s/%s.txt", m_txtCheatDir.c_str(), id),
+					fmt("%s/cheats/%s.cht", m_cacheDir.c_str(), id));
 				_showCheatSettings();
 
 				if(txtavailable)
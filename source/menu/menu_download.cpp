@@ -471,8 +471,8 @@ int CMenu::_coverDownloader(bool missingOnly)
 		c_gameTDB.SetLanguageCode(m_curLanguage.c_str());
 	}
 
-	Config m_checksums;
-	m_checksums.load(fmt("%s/%s", m_settingsDir.c_str(), PLUGIN_CRCS_FILENAME));
+	CChecksums m_checksums;
+	m_checksums.Load(fmt("%s/%s", m_settingsDir.c_str(), PLUGIN_CRCS_CACHE), fmt("%s/%s", m_settingsDir.c_str(), PLUGIN_CRCS_FILENAME));
 
 	if (m_coverDLGameId.empty())
 	{
@@ -518,6 +518,12 @@ int CMenu::_coverDownloader(bool missingOnly)
 	u32 n = coverList.size();
 	if (n > 0 && !m_thrdStop)
 	{
+		/* Hashes the ROMs in download order while the covers come in */
+		vector<string> romPaths;
+		for(u32 i = 0; i < pluginCoverList.size(); ++i)
+			romPaths.push_back(pluginCoverList[i].path);
+		if(romPaths.size() > 0)
+			m_checksums.Prefetch(romPaths);
 		step = 0;
 		nbSteps = 1 + n * 2;
 		LWP_MutexLock(m_mutex);
@@ -554,7 +560,7 @@ int CMenu::_coverDownloader(bool missingOnly)
 				m_newID.remove(domain, coverList[i]);
 			else if(!newID.empty())
 			{
-				gprintf("old id = %s\nnew id = %s\n", coverList[i].c_str(), newID.c_str());
+				glog(LOG_NET, LOG_DEBUG, "old id = %s\nnew id = %s\n", coverList[i].c_str(), newID.c_str());
 			}
 
 			for( int p = 0; p < 4; ++p )
@@ -1155,7 +1161,7 @@ int CMenu::_coverDownloader(bool missingOnly)
 		if(c_gameTDB.IsLoaded())
 			c_gameTDB.CloseFile();
 		coverList.clear();
-		m_checksums.unload();
+		m_checksums.Unload();
 		m_newID.unload();
 	}
 	LWP_MutexLock(m_mutex);
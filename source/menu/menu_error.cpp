@@ -30,7 +30,7 @@ void CMenu::error(const wstringEx &msg)
 	m_btnMgr.setText(m_errorLblMessage, msg, true);
 	_showError();
 
-	gprintf(msg.toUTF8().c_str());
+	gprintf("%s", msg.toUTF8().c_str());
 	do
 	{
 		_mainLoopCommon();
@@ -19,8 +19,12 @@
 #include <algorithm>
 #include "menu.hpp"
 #include "channel/nand.hpp"
+#include "list/dirlist.hpp"
 #include "defines.h"
 
+// Entries read per frame, the first page shows after one batch
+#define EXPLORER_FILL	256
+
 TexData m_explorerBg;
 s16 entries[7];
 s16 entries_sel[7];
@@ -33,13 +37,8 @@ s16 m_explorerBtnPageM;
 s16 m_explorerBtnPageP;
 s16 m_explorerLblUser[4];
 
-u32 dirs = 0;
-u32 files = 0;
 u32 start_pos = 0;
-typedef struct {
-	char name[NAME_MAX];
-} list_element;
-list_element *elements = NULL;
+CDirList explorerList;
 u32 elements_num = 0;
 char file[MAX_FAT_PATH];
 char dir[MAX_FAT_PATH];
@@ -67,10 +66,6 @@ void CMenu::_hideExplorer(bool instant)
 		if(m_explorerLblUser[i] != -1)
 			m_btnMgr.hide(m_explorerLblUser[i], instant);
 	}
-	if(elements != NULL)
-		free(elements);
-	elements = NULL;
-	elements_num = 0;
 }
 
 void CMenu::_showExplorer(void)
@@ -99,6 +94,13 @@ void CMenu::_Explorer(void)
 	while(!m_exit)
 	{
 		_mainLoopCommon();
+		/* Keep reading a large folder, the page is only redrawn when new entries sort into it */
+		if(dir[0] != '\0' && !explorerList.Complete())
+		{
+			u32 changed = explorerList.Fill(EXPLORER_FILL);
+			if(changed != DIRLIST_NONE)
+				_pageExplorer(changed < start_pos + 6);
+		}
 		if(BTN_HOME_PRESSED || BTN_B_PRESSED)
 		{
 			memset(folderPath, 0, MAX_FAT_PATH);
@@ -182,9 +184,9 @@ void CMenu::_Explorer(void)
 						_refreshExplorer();
 					}
 					//if it's a folder add folder+/ to path
-					else if(!fsop_FileExist(fmt("%s%s", dir, elements[start_pos+(i-1)].name)))
+					else if(start_pos+i <= explorerList.Dirs())
 					{
-						strcat(dir, elements[start_pos+(i-1)].name);
+						strcat(dir, explorerList.Name(start_pos+(i-1)));
 						strcpy(folderPath, dir);
 						strcat(dir, "/");
 						while(strlen(folderPath) > 48)
@@ -206,7 +208,7 @@ void CMenu::_Explorer(void)
 					else
 					{
 						memset(file, 0, MAX_FAT_PATH);
-						strncpy(file, fmt("%s%s", dir, elements[start_pos+(i-1)].name), MAX_FAT_PATH);
+						strncpy(file, fmt("%s%s", dir, explorerList.Name(start_pos+(i-1))), MAX_FAT_PATH);
 						if(strcasestr(file, ".mp3") != NULL || strcasestr(file, ".ogg") != NULL)
 							MusicPlayer.LoadFile(file, false);
 						else if(strcasestr(file, ".iso") != NULL || strcasestr(file, ".wbfs") != NULL)
@@ -265,6 +267,7 @@ void CMenu::_Explorer(void)
 		}
 	}
 	_hideExplorer();
+	explorerList.Clear();
 	_initCF();
 }
 
@@ -309,11 +312,9 @@ void CMenu::_textExplorer(void)
 	m_btnMgr.setText(m_explorerBtnBack, _t("cfgne35", L"Back"));
 }
 
-static bool list_element_cmp(list_element a, list_element b)
+static u32 explorerCount(void)
 {
-	const char *first = a.name;
-	const char *second = b.name;
-	return char_cmp(first, second, strlen(first), strlen(second));
+	return folderExplorer ? explorerList.Dirs() : explorerList.Dirs() + explorerList.Files();
 }
 
 void CMenu::_refreshExplorer(s8 direction)
@@ -352,72 +353,32 @@ void CMenu::_refreshExplorer(s8 direction)
 		m_btnMgr.show(entries[0]);
 		m_btnMgr.show(entries_sel[0]);
 		if(direction == 0)
-		{
-			dirent *pent = NULL;
-			DIR *pdir = NULL;
-			pdir = opendir(dir);
-			/* some sorting */
-			dirs = 0;
-			files = 0;
-			while((pent = readdir(pdir)) != NULL)
-			{
-				if(pent->d_name[0] == '.')
-					continue;
-				if(pent->d_type == DT_DIR)
-					dirs++;
-				else if(pent->d_type == DT_REG)
-					files++;
-			}
-			u32 pos = 0;
-			if(elements != NULL)
-				free(elements);
-			elements_num = (folderExplorer ? dirs : dirs+files);
-			elements = (list_element*)MEM2_alloc(elements_num*sizeof(list_element));
-			if(dirs > 0)
-			{
-				rewinddir(pdir);
-				while((pent = readdir(pdir)) != NULL)
-				{
-					if(pent->d_name[0] == '.')
-						continue;
-					if(pent->d_type == DT_DIR)
-					{
-						memcpy(elements[pos].name, pent->d_name, NAME_MAX);
-						pos++;
-					}
-				}
-				std::sort(elements, elements+pos, list_element_cmp);
-			}
-			if(folderExplorer == false && files > 0)
-			{
-				rewinddir(pdir);
-				while((pent = readdir(pdir)) != NULL)
-				{
-					if(pent->d_name[0] == '.')
-						continue;
-					if(pent->d_type == DT_REG)
-					{
-						memcpy(elements[pos].name, pent->d_name, NAME_MAX);
-						pos++;
-					}
-				}
-				std::sort(elements+dirs, elements+pos, list_element_cmp);
-			}
-			closedir(pdir);
-		}
+			explorerList.Open(dir, EXPLORER_FILL);
+		elements_num = explorerCount();
 		if(direction == -1)									/* dont question */
 			start_pos = start_pos >= 6 ? start_pos - 6 : (elements_num % 6 ? (elements_num - elements_num % 6) : elements_num - 6);
 		else if(direction == 1)
 			start_pos = start_pos + 6 >= elements_num ? 0 : start_pos + 6;
+	}
+	_pageExplorer(true);
+	m_btnMgr.show(m_explorerLblPage);
+	m_btnMgr.show(m_explorerBtnPageM);	
+	m_btnMgr.show(m_explorerBtnPageP);
+}
 
-		for(u8 i = 1; i < 7; i++)
+void CMenu::_pageExplorer(bool entries_changed)
+{
+	if(dir[0] != '\0')
+	{
+		elements_num = explorerCount();
+		for(u8 i = 1; i < 7 && entries_changed; i++)
 		{
 			if(start_pos+i > elements_num)
 				break;
-			if(start_pos+i <= dirs)
-				m_btnMgr.setText(entries[i], wfmt(L"/%.48s", elements[start_pos+i-1].name));
+			if(start_pos+i <= explorerList.Dirs())
+				m_btnMgr.setText(entries[i], wfmt(L"/%.48s", explorerList.Name(start_pos+i-1)));
 			else
-				m_btnMgr.setText(entries[i], wfmt(L"%.48s", elements[start_pos+i-1].name));
+				m_btnMgr.setText(entries[i], wfmt(L"%.48s", explorerList.Name(start_pos+i-1)));
 			m_btnMgr.show(entries[i]);
 			m_btnMgr.show(entries_sel[i]);
 		}
@@ -426,9 +387,6 @@ void CMenu::_refreshExplorer(s8 direction)
 		m_btnMgr.setText(m_explorerLblPage, wfmt(L"%i / %i", (start_pos/6 + 1), ((elements_num - 1)/6 +1)));
 	else
 		m_btnMgr.setText(m_explorerLblPage, L"1 / 1");
-	m_btnMgr.show(m_explorerLblPage);
-	m_btnMgr.show(m_explorerBtnPageM);	
-	m_btnMgr.show(m_explorerBtnPageP);
 }
 
 const char *CMenu::_FolderExplorer(const char *startPath)
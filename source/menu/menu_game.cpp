@@ -2,6 +2,7 @@
 #include <ogc/machine/processor.h>
 #include <ogc/lwp_threads.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <network.h>
 #include <errno.h>
@@ -347,6 +348,36 @@ static void setLanguage(int l)
 		configbytes[0] = 0xCD;
 }
 
+/* gameconfig.txt is compiled once into an index in the cache folder,
+   it's only rebuilt when the text file size or date changes */
+static u8 *loadGameConfigIndex(const char *txtPath, const char *indexPath, u32 &indexSize)
+{
+	struct stat txt;
+	indexSize = 0;
+	if(stat(txtPath, &txt) != 0)
+		return NULL;
+
+	u32 size = 0;
+	u8 *index = fsop_ReadFile(indexPath, &size);
+	if(index != NULL && app_gameconfig_check_index(index, size, txt.st_size, (u32)txt.st_mtime))
+	{
+		indexSize = size;
+		return index;
+	}
+	if(index != NULL)
+		free(index);
+
+	u8 *text = fsop_ReadFile(txtPath, &size);
+	if(text == NULL)
+		return NULL;
+	gprintf("Compiling %s\n", txtPath);
+	index = app_gameconfig_compile(text, size, txt.st_size, (u32)txt.st_mtime, &indexSize);
+	free(text);
+	if(index != NULL)
+		fsop_WriteFile(indexPath, index, indexSize);
+	return index;
+}
+
 void CMenu::_game(bool launch)
 {
 	m_gcfg1.load(fmt("%s/" GAME_SETTINGS1_FILENAME, m_settingsDir.c_str()));
@@ -432,19 +463,20 @@ void CMenu::_game(bool launch)
 				movie.Play();
 				m_banner.ReSetup_GX();
 				m_vid.setup2DProjection();
+				/* The frames belong to the movie, keep our background texture aside */
+				TexData curBg = m_curBg;
 				while(!BTN_B_PRESSED && !BTN_A_PRESSED && !BTN_HOME_PRESSED && movie.GetNextFrame(&m_curBg))
 				{
 					/* Draw movie BG and render */
 					_drawBg();
 					m_vid.render();
-					free(m_curBg.data);
 					/* Check if we want to stop */
 					WPAD_ScanPads();
 					PAD_ScanPads();
 					ButtonsPressed();
 				}
 				movie.Stop();
-				TexHandle.Cleanup(m_curBg);
+				m_curBg = curBg;
 				/* Finished, so lets re-setup the background */
 				_setBg(m_mainBg, m_mainBgLQ);
 				_updateBg();
@@ -1437,7 +1469,8 @@ void CMenu::_launchGame(dir_discHdr *hdr, bool dvd)
 	load_wip_patches((u8 *)m_wipDir.c_str(), (u8 *) &id);
 	if(cheat)
 		_loadFile(cheatFile, cheatSize, m_cheatDir.c_str(), fmt("%s.gct", id.c_str()));
-	_loadFile(gameconfig, gameconfigSize, m_txtCheatDir.c_str(), "gameconfig.txt");
+	gameconfig = loadGameConfigIndex(fmt("%s/gameconfig.txt", m_txtCheatDir.c_str()),
+		fmt("%s/gameconfig.bin", m_cacheDir.c_str()), gameconfigSize);
 
 	if(strlen(rtrn) == 4)
 		returnTo = rtrn[0] << 24 | rtrn[1] << 16 | rtrn[2] << 8 | rtrn[3];
@@ -1497,7 +1530,7 @@ void CMenu::_launchGame(dir_discHdr *hdr, bool dvd)
 	}
 	if(gameconfig != NULL)
 	{
-		app_gameconfig_load(id.c_str(), gameconfig, gameconfigSize);
+		app_gameconfig_load_index(id.c_str(), gameconfig, gameconfigSize);
 		free(gameconfig);
 	}
 
@@ -57,6 +57,10 @@ start_main:
 #ifdef SHOWMEM
 	m_btnMgr.show(m_mem1FreeSize);
 	m_btnMgr.show(m_mem2FreeSize);
+#endif
+#ifdef PROFILER
+	if(m_profilerHud)
+		m_btnMgr.show(m_profilerLbl);
 #endif
 	m_vid.set2DViewport(m_cfg.getInt("GENERAL", "tv_width", 640), m_cfg.getInt("GENERAL", "tv_height", 480),
 	m_cfg.getInt("GENERAL", "tv_x", 0), m_cfg.getInt("GENERAL", "tv_y", 0));
@@ -1014,6 +1018,9 @@ void CMenu::_initMainMenu()
 #ifdef SHOWMEM
 	m_mem1FreeSize = _addLabel("MEM1", theme.btnFont, L"", 0, 300, 480, 56, theme.btnFontColor, FTGX_JUSTIFY_LEFT, emptyTex);
 	m_mem2FreeSize = _addLabel("MEM2", theme.btnFont, L"", 0, 356, 480, 56, theme.btnFontColor, FTGX_JUSTIFY_LEFT, emptyTex);
+#endif
+#ifdef PROFILER
+	m_profilerLbl = _addLabel("PROFILER", theme.txtFont, L"", 20, 60, 300, 360, theme.txtFontColor, FTGX_JUSTIFY_LEFT | FTGX_ALIGN_TOP, emptyTex);
 #endif
 	// 
 	m_mainPrevZone.x = m_theme.getInt("MAIN/ZONES", "prev_x", -32);
@@ -1068,6 +1075,9 @@ void CMenu::_initMainMenu()
 #ifdef SHOWMEM
 	_setHideAnim(m_mem1FreeSize, "MEM1", 0, 0, 0.f, 0.f);
 	_setHideAnim(m_mem2FreeSize, "MEM2", 0, 0, 0.f, 0.f);
+#endif
+#ifdef PROFILER
+	_setHideAnim(m_profilerLbl, "PROFILER", 0, 0, 0.f, 0.f);
 #endif
 	_hideMain(true);
 	_textMain();
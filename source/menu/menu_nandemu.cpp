@@ -882,10 +882,13 @@ int CMenu::_NandFlasher(void *obj)
 		snprintf(dest, sizeof(dest), "/title/00010004/%08x", flashID);
 	}
 	NandHandle.ResetCounters();
+	NandHandle.SetVerify(m.m_cfg.getBool(CHANNEL_DOMAIN, "verify_dump", false));
 	m.m_nandexentry = 1;
 	m.m_dumpsize = NandHandle.CalcFlashSize(source, _ShowProgress, obj);
 	m_nandext = true;
 	NandHandle.FlashToNAND(source, dest, _ShowProgress, obj);
+	if(NandHandle.GetVerifyErrors() > 0)
+		gprintf("%u files failed verification\n", NandHandle.GetVerifyErrors());
 
 	m.m_thrdWorking = false;
 	LWP_MutexLock(m.m_mutex);
@@ -908,6 +911,7 @@ int CMenu::_NandDumper(void *obj)
 	m.m_foldersdone = 0;
 
 	NandHandle.ResetCounters();
+	NandHandle.SetVerify(m.m_cfg.getBool(CHANNEL_DOMAIN, "verify_dump", false));
 	emuPartition = m._FindEmuPart(emuPath, true);
 
 	if(emuPartition < 0)
@@ -985,6 +989,8 @@ int CMenu::_NandDumper(void *obj)
 			NandHandle.DoNandDump(source, basepath, CMenu::_ShowProgress, obj);
 		}
 	}
+	if(NandHandle.GetVerifyErrors() > 0)
+		gprintf("%u files failed verification\n", NandHandle.GetVerifyErrors());
 
 	m.m_thrdWorking = false;
 	LWP_MutexLock(m.m_mutex);
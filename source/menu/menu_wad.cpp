@@ -16,7 +16,10 @@
  ****************************************************************************/
 #include "menu/menu.hpp"
 #include "libwbfs/wiidisc.h"
+#include "libwbfs/rijndael.h"
 #include "channel/nand.hpp"
+#include "fileOps/buffer_ring.h"
+#include "loader/sys.h"
 
 extern "C" {
 #include "hw/sha1.h"
@@ -24,6 +27,26 @@ extern "C" {
 };
 
 #define WAD_BUF 0x10000
+#define WAD_RING_SLOTS 4
+#define WAD_THREAD_STACK 32 * 1024
+
+#define WAD_CHUNK_FIRST 1
+#define WAD_CHUNK_LAST 2
+
+enum
+{
+	WAD_STAGE_READ = 0,
+	WAD_STAGE_DECRYPT,
+	WAD_STAGE_WRITE,
+};
+
+struct wad_pipe
+{
+	buffer_ring ring;
+	FILE *wad_file;
+	const tmd *tmd_ptr;
+	const char *EmuNAND;
+};
 
 struct _hdr {
 	u32 header_len;
@@ -65,6 +88,85 @@ int isfs_WriteFile(const char *app_name, const void *content, u32 size)
 	return ret;
 }
 
+/* reads all contents in WAD_BUF chunks, one slot per chunk */
+static void *wad_reader(void *arg)
+{
+	wad_pipe *pipe = (wad_pipe*)arg;
+	const tmd *tmd_ptr = pipe->tmd_ptr;
+	for(u16 cnt = 0; cnt < tmd_ptr->num_contents && !pipe->ring.abort; cnt++)
+	{
+		u32 size_enc_full = ALIGN(16, tmd_ptr->contents[cnt].size);
+		u32 read = 0;
+		do
+		{
+			ring_slot *slot = ring_acquire(&pipe->ring, WAD_STAGE_READ);
+			u32 size_enc = size_enc_full - read;
+			if(size_enc > WAD_BUF)
+				size_enc = WAD_BUF;
+			slot->tag = cnt;
+			slot->flags = (read == 0 ? WAD_CHUNK_FIRST : 0);
+			slot->len = size_enc;
+			slot->last = false;
+			if(size_enc > 0 && fread(slot->data, size_enc, 1, pipe->wad_file) != 1)
+			{
+				/* hand out the slot as the end of the stream */
+				ring_abort(&pipe->ring);
+				slot->last = true;
+				ring_release(&pipe->ring, WAD_STAGE_READ);
+				return NULL;
+			}
+			read += size_enc;
+			if(read >= size_enc_full)
+				slot->flags |= WAD_CHUNK_LAST;
+			ring_release(&pipe->ring, WAD_STAGE_READ);
+		}
+		while(read < size_enc_full && !pipe->ring.abort);
+		skip_align(pipe->wad_file, size_enc_full);
+	}
+	ring_slot *slot = ring_acquire(&pipe->ring, WAD_STAGE_READ);
+	slot->last = true;
+	ring_release(&pipe->ring, WAD_STAGE_READ);
+	return NULL;
+}
+
+/* writes decrypted chunks to the emu nand app files */
+static void *wad_writer(void *arg)
+{
+	wad_pipe *pipe = (wad_pipe*)arg;
+	const tmd *tmd_ptr = pipe->tmd_ptr;
+	u64 tid = tmd_ptr->title_id;
+	char app_name[ISFS_MAXPATH + 128];
+	FILE *app_file = NULL;
+	while(1)
+	{
+		ring_slot *slot = ring_acquire(&pipe->ring, WAD_STAGE_WRITE);
+		if(slot->last)
+		{
+			ring_release(&pipe->ring, WAD_STAGE_WRITE);
+			break;
+		}
+		if(slot->flags & WAD_CHUNK_FIRST)
+		{
+			/* longass filename */
+			snprintf(app_name, sizeof(app_name), "%s/title/%08x/%08x/content/%08x.app", pipe->EmuNAND,
+				(u32)(tid>>32), (u32)tid&0xFFFFFFFF, tmd_ptr->contents[slot->tag].cid);
+			app_file = fopen(app_name, "wb");
+			gprintf("Writing Emu NAND File %s\n", app_name);
+		}
+		if(app_file != NULL && slot->len > 0)
+			fwrite(slot->data, slot->len, 1, app_file);
+		if((slot->flags & WAD_CHUNK_LAST) && app_file != NULL)
+		{
+			fclose(app_file);
+			app_file = NULL;
+		}
+		ring_release(&pipe->ring, WAD_STAGE_WRITE);
+	}
+	if(app_file != NULL)
+		fclose(app_file);
+	return NULL;
+}
+
 int installWad(const char *path)
 {
 	gprintf("Installing %s\n", path);
@@ -159,87 +261,143 @@ int installWad(const char *path)
 		fsop_MakeFolder(fmt("%s/title/%08x/%08x/content", EmuNAND, (u32)(tid>>32), (u32)tid&0xFFFFFFFF));
 		fsop_MakeFolder(fmt("%s/title/%08x/%08x/data", EmuNAND, (u32)(tid>>32), (u32)tid&0xFFFFFFFF));
 	}
+	/* reader -> decrypt and hash -> writer, real nand writes happen in the
+	   decrypt stage since ISFS resets the aes engine */
+	wad_pipe pipe;
+	pipe.wad_file = wad_file;
+	pipe.tmd_ptr = tmd_ptr;
+	pipe.EmuNAND = EmuNAND;
+	if(!ring_init(&pipe.ring, WAD_RING_SLOTS, WAD_BUF, mios ? 2 : 3))
+	{
+		ring_free(&pipe.ring);
+		free(tmd_buf);
+		free(tik_buf);
+		return -7;
+	}
+	lwp_t reader = LWP_THREAD_NULL;
+	lwp_t writer = LWP_THREAD_NULL;
+	if(LWP_CreateThread(&reader, wad_reader, &pipe, NULL, WAD_THREAD_STACK, 60) < 0)
+	{
+		ring_free(&pipe.ring);
+		free(tmd_buf);
+		free(tik_buf);
+		return -7;
+	}
+	if(mios == false && LWP_CreateThread(&writer, wad_writer, &pipe, NULL, WAD_THREAD_STACK, 60) < 0)
+	{
+		/* nothing would empty the ring, let the reader stop and drain it */
+		ring_abort(&pipe.ring);
+		bool last = false;
+		while(!last)
+		{
+			last = ring_acquire(&pipe.ring, WAD_STAGE_DECRYPT)->last;
+			ring_release(&pipe.ring, WAD_STAGE_DECRYPT);
+			ring_acquire(&pipe.ring, WAD_STAGE_WRITE);
+			ring_release(&pipe.ring, WAD_STAGE_WRITE);
+		}
+		LWP_JoinThread(reader, NULL);
+		ring_free(&pipe.ring);
+		free(tmd_buf);
+		free(tik_buf);
+		return -7;
+	}
+
+	bool hw_aes = Sys_HW_Access();
+	if(hw_aes == false)
+		aes_set_key(tik_key);
+
 	int hash_errors = 0;
-	u8 *AES_WAD_Buf = (u8*)MEM2_alloc(WAD_BUF);
-	/* decrypt and write app files */
-	for(u16 cnt = 0; cnt < tmd_ptr->num_contents; cnt++)
+	u8 aes_iv[16];
+	u8 next_iv[16];
+	u64 read = 0;
+	s32 fd = -1;
+	SHA1_CTX ctx;
+	/* decrypt and hash app files */
+	while(1)
 	{
-		u8 aes_iv[16];
-		memset(aes_iv, 0, 16);
-		const tmd_content *content = &tmd_ptr->contents[cnt];
-		u16 content_index = content->index;
-		memcpy(aes_iv, &content_index, 2);
-		/* longass filename */
-		FILE *app_file = NULL;
-		s32 fd = -1;
-		if(mios == false)
+		ring_slot *slot = ring_acquire(&pipe.ring, WAD_STAGE_DECRYPT);
+		if(slot->last)
 		{
-			const char *app_name = fmt("%s/title/%08x/%08x/content/%08x.app", EmuNAND,
-				(u32)(tid>>32), (u32)tid&0xFFFFFFFF, content->cid);
-			app_file = fopen(app_name, "wb");
-			gprintf("Writing Emu NAND File %s\n", app_name);
+			ring_release(&pipe.ring, WAD_STAGE_DECRYPT);
+			break;
 		}
-		else
+		const tmd_content *content = &tmd_ptr->contents[slot->tag];
+		if(slot->flags & WAD_CHUNK_FIRST)
 		{
-			/* delete then create file */
-			memset(&ISFS_Path, 0, ISFS_MAXPATH);
-			const char *app_name = fmt("/title/%08x/%08x/content/%08x.app",
-				(u32)(tid>>32), (u32)tid&0xFFFFFFFF, content->cid);
-			strcpy(ISFS_Path, app_name);
-			ISFS_Delete(ISFS_Path);
-			if(ISFS_CreateFile(ISFS_Path, 0, ISFS_OPEN_RW, ISFS_OPEN_RW, ISFS_OPEN_RW) == 0)
-				fd = ISFS_Open(ISFS_Path, ISFS_OPEN_RW);
-			if(fd >= 0)
-				gprintf("Writing Real NAND File %s\n", ISFS_Path);
+			memset(aes_iv, 0, 16);
+			u16 content_index = content->index;
+			memcpy(aes_iv, &content_index, 2);
+			read = 0;
+			SHA1Init(&ctx);
+			if(hw_aes)
+				AES_ResetEngine();
+			if(mios == true)
+			{
+				/* delete then create file */
+				memset(&ISFS_Path, 0, ISFS_MAXPATH);
+				const char *app_name = fmt("/title/%08x/%08x/content/%08x.app",
+					(u32)(tid>>32), (u32)tid&0xFFFFFFFF, content->cid);
+				strcpy(ISFS_Path, app_name);
+				ISFS_Delete(ISFS_Path);
+				fd = -1;
+				if(ISFS_CreateFile(ISFS_Path, 0, ISFS_OPEN_RW, ISFS_OPEN_RW, ISFS_OPEN_RW) == 0)
+					fd = ISFS_Open(ISFS_Path, ISFS_OPEN_RW);
+				if(fd >= 0)
+					gprintf("Writing Real NAND File %s\n", ISFS_Path);
+			}
 		}
-		u64 read = 0;
-
-		SHA1_CTX ctx;
-		SHA1Init(&ctx);
-		AES_ResetEngine();
-		u32 size_enc_full = ALIGN(16, content->size);
-		while(read < size_enc_full)
+		u32 size_enc = slot->len;
+		if(size_enc > 0)
 		{
-			u64 size_enc = (size_enc_full - read);
-			if (size_enc > WAD_BUF)
-				size_enc = WAD_BUF;
-
-			u16 num_blocks = (size_enc / 16);
-			fread(AES_WAD_Buf, size_enc, 1, wad_file);
-			AES_EnableDecrypt(tik_key, aes_iv); //ISFS seems to reset it?
-			memcpy(aes_iv, AES_WAD_Buf+(size_enc-16), 16); //last block for cbc
-			AES_Decrypt(AES_WAD_Buf, AES_WAD_Buf, num_blocks);
-
-			u64 size_dec = (content->size - read);
-			if(size_dec > WAD_BUF)
-				size_dec = WAD_BUF;
-			SHA1Update(&ctx, AES_WAD_Buf, size_dec);
-			if(mios == false)
-				fwrite(AES_WAD_Buf, size_dec, 1, app_file);
-			else if(fd >= 0)
-				ISFS_Write(fd, AES_WAD_Buf, size_dec);
-			/* dont forget to increase the read size */
-			read += size_enc;
-			mainMenu.update_pThread(size_enc);
+			memcpy(next_iv, slot->data+(size_enc-16), 16); //last block for cbc
+			if(hw_aes)
+			{
+				AES_EnableDecrypt(tik_key, aes_iv); //ISFS seems to reset it?
+				AES_Decrypt(slot->data, slot->data, size_enc / 16);
+			}
+			else
+				aes_decrypt(aes_iv, slot->data, slot->data, size_enc);
+			memcpy(aes_iv, next_iv, 16);
 		}
-		sha1 app_sha1;
-		SHA1Final(app_sha1, &ctx);
-		skip_align(wad_file, size_enc_full);
-
-		if(mios == false)
-			fclose(app_file);
-		else if(fd >= 0)
-			ISFS_Close(fd);
-
-		if(memcmp(app_sha1, content->hash, sizeof(sha1)) == 0)
-			gprintf("sha1 matches on %08x.app, success!\n", content->cid);
-		else
+		u64 size_dec = (content->size - read);
+		if(size_dec > size_enc)
+			size_dec = size_enc;
+		SHA1Update(&ctx, slot->data, size_dec);
+		slot->len = size_dec;
+		if(mios == true && fd >= 0)
+			ISFS_Write(fd, slot->data, size_dec);
+		/* dont forget to increase the read size */
+		read += size_enc;
+		mainMenu.update_pThread(size_enc);
+
+		if(slot->flags & WAD_CHUNK_LAST)
 		{
-			gprintf("sha1 mismatch on %08x.app!\n", content->cid);
-			hash_errors++;
+			sha1 app_sha1;
+			SHA1Final(app_sha1, &ctx);
+			if(mios == true && fd >= 0)
+				ISFS_Close(fd);
+			if(memcmp(app_sha1, content->hash, sizeof(sha1)) == 0)
+				gprintf("sha1 matches on %08x.app, success!\n", content->cid);
+			else
+			{
+				gprintf("sha1 mismatch on %08x.app!\n", content->cid);
+				hash_errors++;
+			}
 		}
+		ring_release(&pipe.ring, WAD_STAGE_DECRYPT);
+	}
+	LWP_JoinThread(reader, NULL);
+	if(writer != LWP_THREAD_NULL)
+		LWP_JoinThread(writer, NULL);
+	bool read_error = pipe.ring.abort;
+	ring_free(&pipe.ring);
+	if(read_error)
+	{
+		gprintf("Reading %s failed!\n", path);
+		free(tik_buf);
+		free(tmd_buf);
+		return -4;
 	}
-	MEM2_free(AES_WAD_Buf);
 
 	if(mios == false)
 	{
@@ -171,6 +171,8 @@ int CMenu::_GCgameInstaller()
 		rsize = 8192; // Use small chunks when skip on error is enabled
 
 	m_gcdump.Init(skip, comp, wexf, alig, nretry, rsize, DeviceName[currentPartition], m_DMLgameDir.c_str());
+	if(m_cfg.getBool(GC_DOMAIN, "verify_dump", false))
+		m_gcdump.SetVerify(fmt("%s/wiitdb.xml", m_settingsDir.c_str()));
 	
 	int ret;
 	m_progress = 0.f;
@@ -206,7 +208,9 @@ int CMenu::_GCgameInstaller()
 		_setThrdMsg(L"", 0);
 
 		ret = m_gcdump.DumpGame();
-		if(ret == 0)
+		if(ret == 0 && m_gcdump.Mismatches() > 0)
+			_setThrdMsg(_t("wbfsop27", L"Game installed, but it does not match any known dump"), 1.f);
+		else if(ret == 0)
 			_setThrdMsg(_t("wbfsop8", L"Game installed"), 1.f);
 		else if( ret >= 0x30200)
 			_setThrdMsg(wfmt(_fmt("wbfsop12", L"DVDError(%d)"), ret), 1.f);
@@ -247,10 +251,21 @@ int CMenu::_GCcopyGame(void *obj)
 	gprintf("Copying from:\n%s\nto:\n%s\n", source, target);
 	LWP_MutexUnlock(m.m_mutex);
 	fsop_MakeFolder(folder);
-	fsop_CopyFolder(source, target, _addDiscProgress, obj);
+	bool copied = fsop_CopyFolder(source, target, _addDiscProgress, obj);
+	if(!copied && fsop_FolderExist(target))
+		fsop_deleteFolder(target);
 	LWP_MutexLock(m.m_mutex);
-	m._setThrdMsg(m._t("wbfsop14", L"Game copied, press Back to boot the game."), 1.f);
-	gprintf("Game copied.\n");
+	if(copied)
+	{
+		m._setThrdMsg(m._t("wbfsop14", L"Game copied, press Back to boot the game."), 1.f);
+		gprintf("Game copied.\n");
+	}
+	else
+	{
+		m._setThrdMsg(m._t("wbfsop9", L"An error has occurred"), 1.f);
+		gprintf("Copying %s to %s failed.\n", source, target);
+	}
+	m.m_thrdFailed = !copied;
 	LWP_MutexUnlock(m.m_mutex);
 	slotLight(true);
 
@@ -455,10 +470,12 @@ bool CMenu::_wbfsOp(CMenu::WBFS_OP op)
 							GC_Path.erase(GC_Path.end() - 13, GC_Path.end());
 						else
 							GC_Path.erase(GC_Path.end() - 9, GC_Path.end());
-						if(fsop_GetFreeSpaceKb("sd:/") < fsop_GetFolderKb(GC_Path.c_str()))
+						/* The copy reuses this walk for its progress */
+						u32 gameKb = fsop_GetFolderKb(GC_Path.c_str());
+						if(fsop_GetFreeSpaceKb("sd:/") < gameKb)
 						{
 							m_btnMgr.hide(m_wbfsBtnGo);
-							_setThrdMsg(wfmt(_fmt("wbfsop24", L"Not enough space: %d blocks needed, %d available"), fsop_GetFolderKb(GC_Path.c_str()), fsop_GetFreeSpaceKb("sd:/")), 0.f);
+							_setThrdMsg(wfmt(_fmt("wbfsop24", L"Not enough space: %d blocks needed, %d available"), gameKb, fsop_GetFreeSpaceKb("sd:/")), 0.f);
 							break;
 						}
 						m_btnMgr.show(m_wbfsPBar, true);
@@ -471,6 +488,7 @@ bool CMenu::_wbfsOp(CMenu::WBFS_OP op)
 						done = true;
 						upd_dml = true;
 						m_thrdWorking = true;
+						m_thrdFailed = false;
 						m_thrdProgress = 0.f;
 						m_thrdMessageAdded = false;
 						LWP_CreateThread(&thread, (void *(*)(void *))_GCcopyGame, (void *)this, 0, 8 * 1024, 64);
@@ -529,6 +547,9 @@ bool CMenu::_wbfsOp(CMenu::WBFS_OP op)
 	}
 	else 
 	{
+		/* Don't boot a half copied game from SD */
+		if(done && op == WO_COPY_GAME && m_thrdFailed)
+			done = false;
 		if(done && op == WO_COPY_GAME)
 		{
 			UpdateCache(COVERFLOW_DML);
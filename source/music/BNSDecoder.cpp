@@ -31,114 +31,7 @@
 #include "BNSDecoder.hpp"
 #include "memory/mem2.hpp"
 
-SoundBlock DecodefromBNS(const u8 *buffer, u32 size);
-
-BNSDecoder::BNSDecoder(const char * filepath)
-	: SoundDecoder(filepath)
-{
-	SoundType = SOUND_BNS;
-	memset(&SoundData, 0, sizeof(SoundBlock));
-
-	if(!file_fd)
-		return;
-
-	OpenFile();
-}
-
-BNSDecoder::BNSDecoder(const u8 * snd, int len)
-	: SoundDecoder(snd, len)
-{
-	SoundType = SOUND_BNS;
-	memset(&SoundData, 0, sizeof(SoundBlock));
-
-	if(!file_fd)
-		return;
-
-	OpenFile();
-}
-
-BNSDecoder::~BNSDecoder()
-{
-	ExitRequested = true;
-	while(Decoding)
-		usleep(100);
-
-	if(SoundData.buffer != NULL)
-		free(SoundData.buffer);
-
-	SoundData.buffer = NULL;
-}
-
-void BNSDecoder::OpenFile()
-{
-	u8 *tempbuff = (u8*)MEM2_alloc(file_fd->size());
-	if(!tempbuff)
-	{
-		CloseFile();
-		return;
-	}
-
-	int done = 0;
-
-	while(done < file_fd->size())
-	{
-		int read = file_fd->read(tempbuff+done, file_fd->size()-done);
-		if(read > 0)
-			done += read;
-		else
-		{
-			CloseFile();
-			MEM2_free(tempbuff);
-			return;
-		}
-	}
-
-	SoundData = DecodefromBNS(tempbuff, done);
-	MEM2_free(tempbuff);
-	if(SoundData.buffer == NULL)
-	{
-		CloseFile();
-		return;
-	}
-	Decode();
-}
-
-void BNSDecoder::CloseFile()
-{
-	if(file_fd)
-		delete file_fd;
-
-	file_fd = NULL;
-}
-
-int BNSDecoder::Read(u8 * buffer, int buffer_size, int)
-{
-	if(!SoundData.buffer)
-		return -1;
-
-	if(SoundData.loopFlag)
-	{
-		int factor = SoundData.format == VOICE_STEREO_16BIT ? 4 : 2;
-		if(CurPos >= (int) SoundData.loopEnd*factor)
-			CurPos = SoundData.loopStart*factor;
-
-		if(buffer_size > (int) SoundData.loopEnd*factor-CurPos)
-			buffer_size = SoundData.loopEnd*factor-CurPos;
-	}
-	else
-	{
-		if(CurPos >= (int) SoundData.size)
-			return 0;
-
-		if(buffer_size > (int) SoundData.size-CurPos)
-			buffer_size = SoundData.size-CurPos;
-	}
-
-	memcpy(buffer, SoundData.buffer+CurPos, buffer_size);
-	CurPos += buffer_size;
-
-	return buffer_size;
-}
+#define BNS_MAX_INFO_SIZE	0x1000
 
 struct BNSHeader
 {
@@ -198,168 +91,285 @@ struct BNSData
 	u8 data;
 } ATTRIBUTE_PACKED;
 
-struct ADPCMByte
+BNSDecoder::BNSDecoder(const char * filepath)
+	: SoundDecoder(filepath)
 {
-	s8 sample1 : 4;
-	s8 sample2 : 4;
-} ATTRIBUTE_PACKED;
+	SoundType = SOUND_BNS;
+	ChanCount = 0;
+	Format = VOICE_MONO_16BIT;
+	Frequency = 0;
+	NumSamples = 0;
+
+	if(!file_fd)
+		return;
 
-struct BNSADPCMBlock
+	OpenFile();
+}
+
+BNSDecoder::BNSDecoder(const u8 * snd, int len)
+	: SoundDecoder(snd, len)
 {
-	u8 pad : 1;
-	u8 coeffIndex : 3;
-	u8 lshift : 4;
-	ADPCMByte samples[7];
-} ATTRIBUTE_PACKED;
+	SoundType = SOUND_BNS;
+	ChanCount = 0;
+	Format = VOICE_MONO_16BIT;
+	Frequency = 0;
+	NumSamples = 0;
+
+	if(!file_fd)
+		return;
 
-struct BNSDecObj
+	OpenFile();
+}
+
+BNSDecoder::~BNSDecoder()
 {
-	s16 prevSamples[2];
-	s16 coeff[8][2];
-};
+	ExitRequested = true;
+	while(Decoding)
+		usleep(100);
+}
 
-static void loadBNSInfo(BNSInfo &bnsInfo, const u8 *buffer)
+static bool loadBNSInfo(BNSInfo &bnsInfo, const u8 *buffer, u32 size)
 {
 	const u8 *ptr = buffer + 8;
+	const u32 coeffSize = (u8 *)bnsInfo.coefficients2 - (u8 *)&bnsInfo.coefficients1;
+	const u32 ptrSize = size - 8;
 	bnsInfo = *(const BNSInfo *)buffer;
 	if (bnsInfo.offsetToChanStarts == 0x18 && bnsInfo.chan1StartOffset == 0x20 && bnsInfo.chan2StartOffset == 0x2C
 		&& bnsInfo.coeff1Offset == 0x38 && bnsInfo.coeff2Offset == 0x68)
-		return;
+		return true;
+	if (bnsInfo.offsetToChanStarts + 8 > ptrSize)
+		return false;
 	bnsInfo.chan1StartOffset = *(const u32 *)(ptr + bnsInfo.offsetToChanStarts);
+	if (bnsInfo.chan1StartOffset + 8 > ptrSize)
+		return false;
 	bnsInfo.chan1Start = *(const u32 *)(ptr + bnsInfo.chan1StartOffset);
 	bnsInfo.coeff1Offset = *(const u32 *)(ptr + bnsInfo.chan1StartOffset + 4);
+	if (bnsInfo.coeff1Offset + coeffSize > ptrSize)
+		return false;
 	if ((u8 *)bnsInfo.coefficients1 != ptr + bnsInfo.coeff1Offset)
-		memcpy(bnsInfo.coefficients1, ptr + bnsInfo.coeff1Offset, (u8 *)bnsInfo.coefficients2 - (u8 *)&bnsInfo.coefficients1);
+		memcpy(bnsInfo.coefficients1, ptr + bnsInfo.coeff1Offset, coeffSize);
 	if (bnsInfo.chanCount == 2)
 	{
 		bnsInfo.chan2StartOffset = *(const u32 *)(ptr + bnsInfo.offsetToChanStarts + 4);
+		if (bnsInfo.chan2StartOffset + 8 > ptrSize)
+			return false;
 		bnsInfo.chan2Start = *(const u32 *)(ptr + bnsInfo.chan2StartOffset);
 		bnsInfo.coeff2Offset = *(const u32 *)(ptr + bnsInfo.chan2StartOffset + 4);
+		if (bnsInfo.coeff2Offset + coeffSize > ptrSize)
+			return false;
 		if ((u8 *)bnsInfo.coefficients2 != ptr + bnsInfo.coeff2Offset)
-			memcpy(bnsInfo.coefficients2, ptr + bnsInfo.coeff2Offset, (u8 *)bnsInfo.coefficients2 - (u8 *)&bnsInfo.coefficients1);
+			memcpy(bnsInfo.coefficients2, ptr + bnsInfo.coeff2Offset, coeffSize);
 	}
+	return true;
 }
 
-static void decodeADPCMBlock(s16 *buffer, const BNSADPCMBlock &block, BNSDecObj &bnsDec)
+/* one 8 byte ADPCM block: header byte (coefficient index, shift) and 14 nibbles */
+static void decodeADPCMBlock(s16 *buffer, int stride, const u8 *block, BNSChannel &chan)
 {
-	int h1 = bnsDec.prevSamples[0];
-	int h2 = bnsDec.prevSamples[1];
-	int c1 = bnsDec.coeff[block.coeffIndex][0];
-	int c2 = bnsDec.coeff[block.coeffIndex][1];
-	for (int i = 0; i < 14; ++i)
+	int h1 = chan.prevSamples[0];
+	int h2 = chan.prevSamples[1];
+	int coeffIndex = (block[0] >> 4) & 7;
+	int lshift = block[0] & 0xF;
+	int c1 = chan.coeff[coeffIndex][0];
+	int c2 = chan.coeff[coeffIndex][1];
+	for (int i = 0; i < BNS_BLOCK_SAMPLES; ++i)
 	{
-		int nibSample = ((i & 1) == 0) ? block.samples[i / 2].sample1 : block.samples[i / 2].sample2;
-		int sampleDeltaHP = (nibSample << block.lshift) << 11;
+		s8 nibbles = (s8)block[1 + i / 2];
+		int nibSample = ((i & 1) == 0) ? (nibbles >> 4) : ((s8)(nibbles << 4) >> 4);
+		int sampleDeltaHP = (nibSample << lshift) << 11;
 		int predictedSampleHP = c1 * h1 + c2 * h2;
 		int sampleHP = predictedSampleHP + sampleDeltaHP;
-		buffer[i] = std::min(std::max(-32768, (sampleHP + 1024) >> 11), 32767);
 		h2 = h1;
-		h1 = buffer[i];
+		h1 = std::min(std::max(-32768, (sampleHP + 1024) >> 11), 32767);
+		buffer[i * stride] = h1;
 	}
-	bnsDec.prevSamples[0] = h1;
-	bnsDec.prevSamples[1] = h2;
+	chan.prevSamples[0] = h1;
+	chan.prevSamples[1] = h2;
 }
 
-static u8 * decodeBNS(u32 &size, const BNSInfo &bnsInfo, const BNSData &bnsData)
+void BNSDecoder::OpenFile()
 {
-	static s16 smplBlock[14];
-	BNSDecObj decObj;
-	int numBlocks = (bnsData.size - 8) / 8;
-	int numSamples = numBlocks * 14;
-	const BNSADPCMBlock *inputBuf = (const BNSADPCMBlock *)&bnsData.data;
-	u8 * buffer = (u8 *) malloc(numSamples * sizeof (s16));
-	s16 *outputBuf;
-
-	if (!buffer)
-		return buffer;
-	memcpy(decObj.coeff, bnsInfo.coefficients1, sizeof decObj.coeff);
-	memcpy(decObj.prevSamples, bnsInfo.chan1PrevSamples, sizeof decObj.prevSamples);
-	outputBuf = (s16 *)buffer;
-	if (bnsInfo.chanCount == 1)
-		for (int i = 0; i < numBlocks; ++i)
-		{
-			decodeADPCMBlock(smplBlock, inputBuf[i], decObj);
-			memcpy(outputBuf, smplBlock, sizeof smplBlock);
-			outputBuf += 14;
-		}
-	else
+	u32 size = file_fd->size();
+	BNSHeader hdr;
+	if(size < sizeof hdr || file_fd->read((u8 *)&hdr, sizeof hdr) != sizeof hdr
+		|| memcmp(&hdr.fccBNS, "BNS ", 4) != 0)
 	{
-		numBlocks /= 2;
-		for (int i = 0; i < numBlocks; ++i)
-		{
-			decodeADPCMBlock(smplBlock, inputBuf[i], decObj);
-			for (int j = 0; j < 14; ++j)
-				outputBuf[j * 2] = smplBlock[j];
-			outputBuf += 2 * 14;
-		}
-		outputBuf = (s16 *)buffer + 1;
-		memcpy(decObj.coeff, bnsInfo.coefficients2, sizeof decObj.coeff);
-		memcpy(decObj.prevSamples, bnsInfo.chan2PrevSamples, sizeof decObj.prevSamples);
-		for (int i = 0; i < numBlocks; ++i)
-		{
-			decodeADPCMBlock(smplBlock, inputBuf[numBlocks + i], decObj);
-			for (int j = 0; j < 14; ++j)
-				outputBuf[j * 2] = smplBlock[j];
-			outputBuf += 2 * 14;
-		}
+		CloseFile();
+		return;
 	}
-	size = numSamples * sizeof (s16);
-	return buffer;
-}
-
-SoundBlock DecodefromBNS(const u8 *buffer, u32 size)
-{
-	SoundBlock OutBlock;
-	memset(&OutBlock, 0, sizeof(SoundBlock));
-
-	const BNSHeader &hdr = *(BNSHeader *)buffer;
-	if(size < sizeof hdr)
-		return OutBlock;
-	if(memcmp(&hdr.fccBNS, "BNS ", 4) != 0)
-		return OutBlock;
-	// Find info and data
-	BNSInfo infoChunk;
-	loadBNSInfo(infoChunk, buffer + hdr.infoOffset);
-	const BNSData &dataChunk = *(const BNSData *)(buffer + hdr.dataOffset);
 	// Check sizes
 	if (size < hdr.size || size < hdr.infoOffset + hdr.infoSize || size < hdr.dataOffset + hdr.dataSize
-		|| hdr.infoSize < 0x60 || hdr.dataSize < sizeof dataChunk
-		|| infoChunk.size != hdr.infoSize || dataChunk.size > hdr.dataSize)
-		return OutBlock;
+		|| hdr.infoSize < 0x60 || hdr.infoSize > BNS_MAX_INFO_SIZE || hdr.dataSize < sizeof(BNSData))
+	{
+		CloseFile();
+		return;
+	}
+	// Only the header and the info chunk are read up front, blocks are decoded while playing
+	u32 infoBufSize = std::max((u32)sizeof(BNSInfo), hdr.infoSize);
+	u8 *infoBuf = (u8 *)MEM2_alloc(infoBufSize);
+	if(!infoBuf)
+	{
+		CloseFile();
+		return;
+	}
+	memset(infoBuf, 0, infoBufSize);
+	BNSInfo infoChunk;
+	BNSData dataChunk;
+	bool ok = file_fd->seek(hdr.infoOffset, SEEK_SET) == 0
+		&& file_fd->read(infoBuf, hdr.infoSize) == (int)hdr.infoSize
+		&& loadBNSInfo(infoChunk, infoBuf, hdr.infoSize)
+		&& file_fd->seek(hdr.dataOffset, SEEK_SET) == 0
+		&& file_fd->read((u8 *)&dataChunk, 8) == 8;
+	MEM2_free(infoBuf);
+	if (!ok || infoChunk.size != hdr.infoSize || dataChunk.size > hdr.dataSize || dataChunk.size < 8)
+	{
+		CloseFile();
+		return;
+	}
 	// Check format
 	if (infoChunk.codecNum != 0)	// Only codec i've found : 0 = ADPCM. Maybe there's also 1 and 2 for PCM 8 or 16 bits ?
-		return OutBlock;
-	u8 format = (u8)-1;
-	if (infoChunk.chanCount == 1 && infoChunk.codecNum == 0)
-		format = VOICE_MONO_16BIT;
-	else if (infoChunk.chanCount == 2 && infoChunk.codecNum == 0)
-		format = VOICE_STEREO_16BIT;
-	if (format == (u8)-1)
-		return OutBlock;
-	u32 freq = (u32) infoChunk.freq;
-	u32 length = 0;
-	// Copy data
-	if (infoChunk.codecNum == 0)
 	{
-		OutBlock.buffer = decodeBNS(length, infoChunk, dataChunk);
-		if (!OutBlock.buffer)
-			return OutBlock;
+		CloseFile();
+		return;
 	}
+	if (infoChunk.chanCount == 1)
+		Format = VOICE_MONO_16BIT;
+	else if (infoChunk.chanCount == 2)
+		Format = VOICE_STEREO_16BIT;
 	else
 	{
-		OutBlock.buffer = (u8*) malloc(dataChunk.size);
-		if (!OutBlock.buffer)
-			return OutBlock;
-		memcpy(OutBlock.buffer, &dataChunk.data, dataChunk.size);
-		length = dataChunk.size;
+		CloseFile();
+		return;
 	}
+	ChanCount = infoChunk.chanCount;
+	Frequency = (u32) infoChunk.freq;
+	DataOffset = hdr.dataOffset + 8;
+	// Stereo data holds all blocks of the first channel followed by the second one
+	NumBlocks = (dataChunk.size - 8) / BNS_BLOCK_SIZE / ChanCount;
+	NumSamples = NumBlocks * BNS_BLOCK_SAMPLES;
+
+	memcpy(Channels[0].coeff, infoChunk.coefficients1, sizeof Channels[0].coeff);
+	memcpy(Channels[0].startSamples, infoChunk.chan1PrevSamples, sizeof Channels[0].startSamples);
+	memcpy(Channels[1].coeff, infoChunk.coefficients2, sizeof Channels[1].coeff);
+	memcpy(Channels[1].startSamples, infoChunk.chan2PrevSamples, sizeof Channels[1].startSamples);
+
+	LoopFlag = infoChunk.loopFlag;
+	LoopStartSample = infoChunk.loopStart;
+	LoopEndSample = std::min(infoChunk.loopEnd, NumSamples);
+	if(LoopStartSample >= LoopEndSample)
+		LoopFlag = false;
+	LoopSaved = false;
+
+	Rewind();
+	Decode();
+}
+
+void BNSDecoder::CloseFile()
+{
+	if(file_fd)
+		delete file_fd;
+
+	file_fd = NULL;
+	NumSamples = 0;
+}
+
+int BNSDecoder::Rewind()
+{
+	for(u8 ch = 0; ch < ChanCount; ++ch)
+		memcpy(Channels[ch].prevSamples, Channels[ch].startSamples, sizeof Channels[ch].prevSamples);
+	BlockPos = 0;
+	SamplePos = 0;
+	ChunkStart = 0;
+	ChunkSamples = 0;
+	CurPos = 0;
+	EndOfFile = false;
+
+	return 0;
+}
+
+void BNSDecoder::JumpToLoop()
+{
+	if(!LoopSaved)
+	{
+		// decoder state at the loop start is unknown, decode up to it again
+		Rewind();
+		SamplePos = LoopStartSample;
+		return;
+	}
+	for(u8 ch = 0; ch < ChanCount; ++ch)
+		memcpy(Channels[ch].prevSamples, Channels[ch].loopSamples, sizeof Channels[ch].prevSamples);
+	BlockPos = LoopStartSample / BNS_BLOCK_SAMPLES;
+	SamplePos = LoopStartSample;
+	ChunkSamples = 0;
+}
+
+bool BNSDecoder::DecodeChunk()
+{
+	if(BlockPos >= NumBlocks)
+		return false;
+
+	u32 blocks = std::min(NumBlocks - BlockPos, (u32)BNS_CHUNK_BLOCKS);
+	u32 loopBlock = LoopStartSample / BNS_BLOCK_SAMPLES;
+	bool saveLoop = LoopFlag && !LoopSaved && loopBlock >= BlockPos && loopBlock < BlockPos + blocks;
+	int readSize = blocks * BNS_BLOCK_SIZE;
 
-	OutBlock.frequency = freq;
-	OutBlock.format = format;
-	OutBlock.size = length;
-	OutBlock.loopStart = infoChunk.loopStart;
-	OutBlock.loopEnd = infoChunk.loopEnd;
-	OutBlock.loopFlag = infoChunk.loopFlag;
+	for(u8 ch = 0; ch < ChanCount; ++ch)
+	{
+		if(file_fd->seek(DataOffset + (ch * NumBlocks + BlockPos) * BNS_BLOCK_SIZE, SEEK_SET) != 0
+			|| file_fd->read(InBlocks, readSize) != readSize)
+			return false;
+
+		BNSChannel &chan = Channels[ch];
+		s16 *out = OutSamples + ch;
+		for(u32 i = 0; i < blocks; ++i)
+		{
+			if(saveLoop && BlockPos + i == loopBlock)
+				memcpy(chan.loopSamples, chan.prevSamples, sizeof chan.loopSamples);
+			decodeADPCMBlock(out, ChanCount, InBlocks + i * BNS_BLOCK_SIZE, chan);
+			out += BNS_BLOCK_SAMPLES * ChanCount;
+		}
+	}
+	if(saveLoop)
+		LoopSaved = true;
+
+	ChunkStart = BlockPos * BNS_BLOCK_SAMPLES;
+	ChunkSamples = blocks * BNS_BLOCK_SAMPLES;
+	BlockPos += blocks;
+
+	return true;
+}
+
+int BNSDecoder::Read(u8 * buffer, int buffer_size, int)
+{
+	if(!file_fd || NumSamples == 0)
+		return -1;
+
+	int frameSize = ChanCount * sizeof(s16);
+	int done = 0;
+
+	while(buffer_size - done >= frameSize)
+	{
+		u32 end = LoopFlag ? LoopEndSample : NumSamples;
+		if(SamplePos >= end)
+		{
+			if(!LoopFlag)
+				break;
+			JumpToLoop();
+			continue;
+		}
+		if(SamplePos < ChunkStart || SamplePos >= ChunkStart + ChunkSamples)
+		{
+			if(!DecodeChunk())
+				break;
+			continue;
+		}
+		u32 frames = std::min(ChunkStart + ChunkSamples, end) - SamplePos;
+		frames = std::min(frames, (u32)((buffer_size - done) / frameSize));
+		memcpy(buffer + done, OutSamples + (SamplePos - ChunkStart) * ChanCount, frames * frameSize);
+		done += frames * frameSize;
+		SamplePos += frames;
+	}
+	CurPos += done;
 
-	return OutBlock;
+	return done;
 }
@@ -28,16 +28,17 @@
 
 #include "SoundDecoder.hpp"
 
-typedef struct _SoundBlock
+#define BNS_CHUNK_BLOCKS	32
+#define BNS_BLOCK_SAMPLES	14
+#define BNS_BLOCK_SIZE		8
+
+typedef struct _BNSChannel
 {
-	u8 * buffer;
-	u32 size;
-	u8 format;
-	u32 frequency;
-	u32 loopStart;
-	u32 loopEnd;
-	u8 loopFlag;
-} SoundBlock;
+	s16 coeff[8][2];
+	s16 prevSamples[2];
+	s16 startSamples[2];
+	s16 loopSamples[2];
+} BNSChannel;
 
 class BNSDecoder : public SoundDecoder
 {
@@ -45,13 +46,32 @@ public:
 	BNSDecoder(const char * filepath);
 	BNSDecoder(const u8 * snd, int len);
 	virtual ~BNSDecoder();
-	int GetFormat() { return SoundData.format; };
-	int GetSampleRate() { return SoundData.frequency; };
+	int GetFormat() { return Format; };
+	int GetSampleRate() { return Frequency; };
+	int Rewind();
 	int Read(u8 * buffer, int buffer_size, int pos);
 protected:
 	void OpenFile();
 	void CloseFile();
-	SoundBlock SoundData;
+	bool DecodeChunk();
+	void JumpToLoop();
+	BNSChannel Channels[2];
+	u8 ChanCount;
+	u8 Format;
+	u32 Frequency;
+	u32 DataOffset;
+	u32 NumBlocks;
+	u32 NumSamples;
+	bool LoopFlag;
+	bool LoopSaved;
+	u32 LoopStartSample;
+	u32 LoopEndSample;
+	u32 BlockPos;
+	u32 SamplePos;
+	u32 ChunkStart;
+	u32 ChunkSamples;
+	u8 InBlocks[BNS_CHUNK_BLOCKS * BNS_BLOCK_SIZE];
+	s16 OutSamples[BNS_CHUNK_BLOCKS * BNS_BLOCK_SAMPLES * 2];
 };
 
 #endif
@@ -32,6 +32,7 @@
 #include "AifDecoder.hpp"
 #include "BNSDecoder.hpp"
 #include "gecko/gecko.hpp"
+#include "gui/Profiler.hpp"
 #include "memory/mem2.hpp"
 
 SoundHandler SoundHandle;
@@ -251,6 +252,7 @@ void SoundHandler::InternalSoundUpdates()
 				continue;
 
 			Decoding = true;
+			PROFILE_ZONE(PROF_SOUND);
 			DecoderList[i]->Decode();
 		}
 		Decoding = false;
@@ -84,6 +84,7 @@ public:
 	~WavDecoder();
 	int GetFormat() { return Format; };
 	int GetSampleRate() { return SampleRate; };
+	u32 GetDataSize() { return file_fd ? DataSize : 0; };
 	int Read(u8 * buffer, int buffer_size, int pos);
 protected:
 	void OpenFile();
@@ -26,6 +26,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <malloc.h>
+#include <vector>
 #include "gui_sound.h"
 #include "SoundHandler.hpp"
 #include "MusicPlayer.hpp"
@@ -57,6 +58,95 @@ static inline int GetFirstUnusedVoice()
 	return -1;
 }
 
+/* Decoded WAV soundeffects, shared by every GuiSound playing the same
+   embedded WAV and by copies of a GuiSound. An effect is freed with its
+   last user. */
+struct SoundEffect
+{
+	const u8 *src;	/* NULL for a theme file, those are never shared */
+	u32 srcLen;
+	u8 *pcm;
+	u32 length;
+	u8 format;
+	u32 rate;
+	u32 refs;
+};
+
+static vector<SoundEffect> SoundEffects;
+
+static SoundEffect *AcquireSoundEffect(const u8 *snd, u32 len, bool shared)
+{
+	for(vector<SoundEffect>::iterator i = SoundEffects.begin(); shared && i != SoundEffects.end(); ++i)
+	{
+		if(i->src == snd && i->srcLen == len)
+		{
+			i->refs++;
+			return &(*i);
+		}
+	}
+
+	WavDecoder decoder(snd, len);
+	u32 size = decoder.GetDataSize();
+	if(size == 0)
+		return NULL;
+	decoder.Rewind();
+
+	/* the data chunk size is known, decode in one go */
+	u8 *pcm = (u8 *)MEM2_memalign(32, size);
+	if(pcm == NULL)
+		return NULL;
+
+	u32 done = 0;
+	while(done < size)
+	{
+		int read = decoder.Read(pcm+done, size-done, done);
+		if(read <= 0)
+			break;
+		done += read;
+	}
+	if(done == 0)
+	{
+		free(pcm);
+		return NULL;
+	}
+	DCFlushRange(pcm, done);
+
+	SoundEffect effect;
+	effect.src = shared ? snd : NULL;
+	effect.srcLen = len;
+	effect.pcm = pcm;
+	effect.length = done;
+	effect.format = decoder.GetFormat();
+	effect.rate = decoder.GetSampleRate();
+	effect.refs = 1;
+	SoundEffects.push_back(effect);
+
+	return &SoundEffects.back();
+}
+
+static void ReleaseSoundEffect(const u8 *pcm)
+{
+	for(vector<SoundEffect>::iterator i = SoundEffects.begin(); i != SoundEffects.end(); ++i)
+	{
+		if(i->pcm == pcm)
+		{
+			if(i->refs > 0 && --i->refs == 0)
+			{
+				free(i->pcm);
+				SoundEffects.erase(i);
+			}
+			return;
+		}
+	}
+}
+
+static void ClearSoundEffects()
+{
+	for(vector<SoundEffect>::iterator i = SoundEffects.begin(); i != SoundEffects.end(); ++i)
+		free(i->pcm);
+	SoundEffects.clear();
+}
+
 extern "C" void SoundCallback(s32 voice)
 {
 	SoundDecoder *decoder = SoundHandle.Decoder(voice);
@@ -112,7 +202,23 @@ GuiSound::GuiSound(GuiSound *g)
 	if(g == NULL)
 		return;
 
-	if(g->sound != NULL)
+	if(g->SoundEffectLength > 0)
+	{
+		/* share the decoded soundeffect */
+		for(vector<SoundEffect>::iterator i = SoundEffects.begin(); i != SoundEffects.end(); ++i)
+		{
+			if(i->pcm == g->sound)
+			{
+				i->refs++;
+				sound = i->pcm;
+				SoundEffectLength = i->length;
+				SoundEffectFormat = i->format;
+				SoundEffectRate = i->rate;
+				break;
+			}
+		}
+	}
+	else if(g->sound != NULL)
 	{
 		u8 *snd = (u8 *)MEM2_memalign(32, g->length);
 		memcpy(snd, g->sound, g->length);
@@ -141,6 +247,8 @@ void GuiSound::Init()
 
 	volume = 255;
 	SoundEffectLength = 0;
+	SoundEffectFormat = VOICE_MONO_16BIT;
+	SoundEffectRate = 22050;
 	loop = false;
 	allocated = false;
 }
@@ -148,9 +256,11 @@ void GuiSound::Init()
 void GuiSound::FreeMemory()
 {
 	Stop();
-	if(this->voice != -1)
+	if(this->voice != -1)
 		SoundHandle.RemoveDecoder(this->voice);
-	if(allocated && sound != NULL)
+	if(SoundEffectLength > 0)
+		ReleaseSoundEffect(sound);
+	else if(allocated && sound != NULL)
 		free(sound);
 	allocated = false;
 	memset(this->filepath, 0, 256);
@@ -223,38 +333,39 @@ bool GuiSound::Load(const u8 *snd, u32 len, bool isallocated)
 	return true;
 }
 
-bool GuiSound::LoadSoundEffect(const u8 * snd, u32 len)
+bool GuiSound::LoadThemeSound(u8 *snd, u32 len, const char *name)
 {
-	FreeMemory();
-
-	WavDecoder decoder(snd, len);
-	decoder.Rewind();
-
-	u32 done = 0;
-	sound = (u8 *)MEM2_memalign(32, 4096);
-	memset(sound, 0, 4096);
-
-	while(1)
+	bool ret;
+	/* Theme WAVs are decoded once, the file is not needed after that */
+	if(snd != NULL && len > 4 && memcmp(snd, "RIFF", 4) == 0 && LoadSoundEffect(snd, len, true))
 	{
-		u8 * tmpsnd = (u8 *)MEM2_realloc(sound, done+4096);
-		if(!tmpsnd)
-		{
-			free(sound);
-			return false;
-		}
+		free(snd);
+		ret = true;
+	}
+	else
+		ret = Load(snd, len, true);
 
-		sound = tmpsnd;
+	if(name != NULL)
+	{
+		strncpy(this->filepath, name, 255);
+		this->filepath[255] = '\0';
+	}
+	return ret;
+}
 
-		int read = decoder.Read(sound+done, 4096, done);
-		if(read <= 0)
-			break;
+bool GuiSound::LoadSoundEffect(const u8 * snd, u32 len, bool allocated)
+{
+	FreeMemory();
 
-		done += read;
-	}
+	SoundEffect *effect = AcquireSoundEffect(snd, len, !allocated);
+	if(effect == NULL)
+		return false;
 
-	sound = (u8 *)MEM2_realloc(sound, done);
-	SoundEffectLength = done;
-	allocated = true;
+	sound = effect->pcm;
+	SoundEffectLength = effect->length;
+	SoundEffectFormat = effect->format;
+	SoundEffectRate = effect->rate;
+	allocated = false;
 
 	return true;
 }
@@ -264,7 +375,7 @@ void GuiSound::Play(int vol, bool restart)
 	if(SoundEffectLength > 0)
 	{
 		ASND_StopVoice(this->voice);
-		ASND_SetVoice(this->voice, VOICE_MONO_16BIT, 22050, 0, sound, SoundEffectLength, vol, vol, NULL);
+		ASND_SetVoice(this->voice, SoundEffectFormat, SoundEffectRate, 0, sound, SoundEffectLength, vol, vol, NULL);
 		return;
 	}
 
@@ -389,4 +500,5 @@ void soundDeinit(void)
 {
 	ASND_Pause(1);
 	ASND_End();
+	ClearSoundEffects();
 }
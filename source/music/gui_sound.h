@@ -50,8 +50,11 @@ public:
 	bool Load(const char *path);
 	//!Load a file and replace the old one
 	bool Load(const u8 * snd, u32 len, bool allocated = true);
+	//!Load a theme sound file, WAVs are decoded for quick playback and snd is freed
+	bool LoadThemeSound(u8 *snd, u32 len, const char *name);
 	//!For quick playback of the internal soundeffects
-	bool LoadSoundEffect(const u8 * snd, u32 len);
+	//!\param allocated snd is a loaded file, its effect is not shared by source
+	bool LoadSoundEffect(const u8 * snd, u32 len, bool allocated = false);
 	//!Start sound playback
 	void Play();
 	//!Start sound playback
@@ -96,6 +99,8 @@ protected:
 	int volume; //!< Sound volume (0-100)
 	u8 loop; //!< Loop sound playback
 	u32 SoundEffectLength; //!< Check if it is an app soundeffect for faster playback
+	u8 SoundEffectFormat; //!< ASND voice format of the decoded soundeffect
+	u32 SoundEffectRate; //!< Sample rate of the decoded soundeffect
 	bool allocated; //!< Is the file allocated or not
 };
 
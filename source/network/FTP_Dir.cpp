@@ -343,7 +343,7 @@ void ftp_dbg_print(char *dbg_info)
 {
 	dbg_msg_change = true;
 	/* for gecko and stuff */
-	gprintf(dbg_info);
+	gprintf("%s", dbg_info);
 	/* for our gui */
 	for(u8 i = 5; i > 0; --i)
 		memcpy(dbg_messages[i], dbg_messages[i-1], 128);
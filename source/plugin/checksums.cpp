@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checksums.hpp"
+#include "crc32.h"
+#include "fileOps/fileOps.h"
+#include "gecko/gecko.hpp"
+#include "memory/mem2.hpp"
+
+#define CHECKSUMS_MAGIC		0x57464353	// WFCS
+#define CHECKSUMS_VERSION	1
+#define CHECKSUMS_STACK		(16 * 1024)
+#define CHECKSUMS_BLOCK		0x10000
+
+/* File layout, all u32 native:
+   magic, version, count, then count times crc, size, mtime, path length and
+   the path without its terminator */
+
+CChecksums::CChecksums(void)
+{
+	m_unsaved = 0;
+	m_thread = LWP_THREAD_NULL;
+	m_stop = false;
+	LWP_MutexInit(&m_mutex, 0);
+	LWP_CondInit(&m_done);
+}
+
+CChecksums::~CChecksums(void)
+{
+	Unload();
+	LWP_CondDestroy(m_done);
+	LWP_MutexDestroy(m_mutex);
+}
+
+static inline u32 read32(const u8 *p)
+{
+	u32 v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static inline void write32(u8 *p, u32 v)
+{
+	memcpy(p, &v, 4);
+}
+
+void CChecksums::Load(const char *path, const char *legacy)
+{
+	Unload();
+	m_path = path;
+	if(legacy != NULL)
+		m_legacy.load(legacy);
+
+	u32 size = 0;
+	u8 *data = fsop_ReadFile(path, &size);
+	if(data == NULL)
+		return;
+	if(size < 12 || read32(data) != CHECKSUMS_MAGIC || read32(data + 4) != CHECKSUMS_VERSION)
+	{
+		gprintf("Checksums: %s is not a checksum cache, ignored\n", path);
+		MEM2_free(data);
+		return;
+	}
+	u32 count = read32(data + 8);
+	u32 pos = 12;
+	for(u32 i = 0; i < count; ++i)
+	{
+		if(size - pos < 16)
+			break;
+		SEntry e;
+		e.crc = read32(data + pos);
+		e.size = read32(data + pos + 4);
+		e.mtime = read32(data + pos + 8);
+		u32 len = read32(data + pos + 12);
+		pos += 16;
+		if(len > size - pos)
+			break;
+		m_entries[string((const char *)data + pos, len)] = e;
+		pos += len;
+	}
+	MEM2_free(data);
+}
+
+void CChecksums::Unload(void)
+{
+	Stop();
+	Save();
+	m_entries.clear();
+	m_legacy.unload();
+	m_path.clear();
+}
+
+void CChecksums::Save(void)
+{
+	LWP_MutexLock(m_mutex);
+	_save();
+	LWP_MutexUnlock(m_mutex);
+}
+
+void CChecksums::_save(void)
+{
+	if(m_unsaved == 0 || m_path.empty())
+		return;
+	u32 size = 12;
+	for(map<string, SEntry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+		size += 16 + it->first.size();
+	u8 *data = (u8 *)MEM2_alloc(size);
+	if(data == NULL)
+		return;
+	write32(data, CHECKSUMS_MAGIC);
+	write32(data + 4, CHECKSUMS_VERSION);
+	write32(data + 8, m_entries.size());
+	u32 pos = 12;
+	for(map<string, SEntry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+	{
+		write32(data + pos, it->second.crc);
+		write32(data + pos + 4, it->second.size);
+		write32(data + pos + 8, it->second.mtime);
+		write32(data + pos + 12, it->first.size());
+		memcpy(data + pos + 16, it->first.c_str(), it->first.size());
+		pos += 16 + it->first.size();
+	}
+	if(fsop_WriteFile(m_path.c_str(), data, size))
+		m_unsaved = 0;
+	MEM2_free(data);
+}
+
+bool CChecksums::_cached(const string &path, const struct stat &st, u32 &crc)
+{
+	map<string, SEntry>::const_iterator it = m_entries.find(path);
+	if(it != m_entries.end())
+	{
+		if(it->second.size == (u32)st.st_size && it->second.mtime == (u32)st.st_mtime)
+		{
+			crc = it->second.crc;
+			return true;
+		}
+		return false;
+	}
+	if(!m_legacy.loaded())
+		return false;
+	/* The ini only knows file names, trusted once and moved over */
+	size_t slash = path.find_last_of('/');
+	const string &legacy = m_legacy.getString("CHECKSUMS", slash != string::npos ? path.substr(slash + 1) : path);
+	if(legacy.size() != 8)
+		return false;
+	crc = strtoul(legacy.c_str(), NULL, 16);
+	_store(path, st, crc);
+	return true;
+}
+
+void CChecksums::_store(const string &path, const struct stat &st, u32 crc)
+{
+	/* Not read, try again next time */
+	if(crc == 0)
+		return;
+	SEntry &e = m_entries[path];
+	e.crc = crc;
+	e.size = st.st_size;
+	e.mtime = st.st_mtime;
+	if(++m_unsaved >= CHECKSUMS_BATCH)
+		_save();
+}
+
+u32 CChecksums::Get(const char *path)
+{
+	struct stat st;
+	if(stat(path, &st) != 0)
+		return RomChecksum(path);
+	string key(path);
+	u32 crc = 0;
+	LWP_MutexLock(m_mutex);
+	while(m_current == key)
+		LWP_CondWait(m_done, m_mutex);
+	m_pending.erase(key);
+	bool cached = _cached(key, st, crc);
+	LWP_MutexUnlock(m_mutex);
+	if(cached)
+	{
+		glog(LOG_PLUGIN, LOG_DEBUG, "CRC32 of %s is cached\n", path);
+		return crc;
+	}
+	glog(LOG_PLUGIN, LOG_DEBUG, "Generating CRC32 for %s\n", path);
+	crc = RomChecksum(path);
+	LWP_MutexLock(m_mutex);
+	_store(key, st, crc);
+	LWP_MutexUnlock(m_mutex);
+	return crc;
+}
+
+void CChecksums::Prefetch(const vector<string> &paths)
+{
+	Stop();
+	m_queue = paths;
+	m_pending.clear();
+	m_pending.insert(paths.begin(), paths.end());
+	m_stop = false;
+	if(LWP_CreateThread(&m_thread, _worker, this, NULL, CHECKSUMS_STACK, 40) < 0)
+	{
+		m_thread = LWP_THREAD_NULL;
+		m_pending.clear();
+	}
+}
+
+void CChecksums::Stop(void)
+{
+	if(m_thread == LWP_THREAD_NULL)
+		return;
+	m_stop = true;
+	LWP_JoinThread(m_thread, NULL);
+	m_thread = LWP_THREAD_NULL;
+	m_queue.clear();
+	m_pending.clear();
+}
+
+void *CChecksums::_worker(void *obj)
+{
+	CChecksums *c = (CChecksums *)obj;
+	u32 done = 0;
+	for(u32 i = 0; i < c->m_queue.size() && !c->m_stop; ++i)
+	{
+		const string &path = c->m_queue[i];
+		struct stat st;
+		u32 crc;
+		bool ok = stat(path.c_str(), &st) == 0;
+		LWP_MutexLock(c->m_mutex);
+		/* Gone from pending when asked for already, or queued twice */
+		ok = c->m_pending.erase(path) > 0 && ok && !c->_cached(path, st, crc);
+		if(ok)
+			c->m_current = path;
+		LWP_MutexUnlock(c->m_mutex);
+		if(!ok)
+			continue;
+		crc = RomChecksum(path.c_str());
+		LWP_MutexLock(c->m_mutex);
+		c->_store(path, st, crc);
+		c->m_current.clear();
+		LWP_CondBroadcast(c->m_done);
+		LWP_MutexUnlock(c->m_mutex);
+		++done;
+	}
+	gprintf("Checksums: %u ROMs done ahead\n", done);
+	return NULL;
+}
+
+static u32 zipChecksum(FILE *fp)
+{
+	/* CRC of the first file, from its local header */
+	u8 buf[4];
+	if(fseek(fp, 0x0e, SEEK_SET) != 0 || fread(buf, 1, 4, fp) != 4)
+		return 0;
+	return buf[0] | buf[1] << 8 | buf[2] << 16 | (u32)buf[3] << 24;
+}
+
+static u32 sevenZipChecksum(FILE *fp)
+{
+	/* The CRC sits 5 bytes before the last 00 05 01 11 of the headers at
+	   the end, looked for a block at a time from the end backwards */
+	static const u8 marker[4] = { 0x00, 0x05, 0x01, 0x11 };
+	if(fseek(fp, 0, SEEK_END) != 0)
+		return 0;
+	long end = ftell(fp);
+	if(end < 13)
+		return 0;
+	u8 *buf = (u8 *)MEM2_alloc(CHECKSUMS_BLOCK + 16);
+	if(buf == NULL)
+		return 0;
+	u32 crc = 0;
+	/* Blocks overlap by 16 bytes so no marker is cut in half */
+	long top = end;
+	while(top > 0)
+	{
+		long start = max(0L, top - CHECKSUMS_BLOCK);
+		long len = min(end, top + 16) - start;
+		if(fseek(fp, start, SEEK_SET) != 0 || fread(buf, 1, len, fp) != (size_t)len)
+			break;
+		long j = min(len - 4, end - start - 8);
+		for(; j >= 5; --j)
+		{
+			if(memcmp(buf + j, marker, 4) == 0)
+				break;
+		}
+		if(j >= 5)
+		{
+			const u8 *p = buf + j - 5;
+			crc = p[0] | p[1] << 8 | p[2] << 16 | (u32)p[3] << 24;
+			break;
+		}
+		top = start;
+	}
+	MEM2_free(buf);
+	return crc;
+}
+
+u32 CChecksums::RomChecksum(const char *path)
+{
+	bool zip = strstr(path, ".zip") != NULL;
+	bool sevenZip = strstr(path, ".7z") != NULL;
+	if(!zip && !sevenZip)
+		return crc32file(path);
+	FILE *fp = fopen(path, "rb");
+	if(fp == NULL)
+		return 0;
+	u32 crc = zip ? zipChecksum(fp) : sevenZipChecksum(fp);
+	fclose(fp);
+	return crc;
+}
@@ -0,0 +1,72 @@
+// Plugin ROM checksum cache
+
+#ifndef __CHECKSUMS_HPP
+#define __CHECKSUMS_HPP
+
+#include <ogc/cond.h>
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <gctypes.h>
+#include <sys/stat.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "config/config.hpp"
+
+using namespace std;
+
+#define CHECKSUMS_BATCH		32
+
+/* CRC32s of plugin ROMs keyed by full path, size and mtime, kept in a binary
+   file that is rewritten every CHECKSUMS_BATCH new entries. A worker thread
+   can checksum a list of ROMs ahead of the ones asking for them. A CRC of
+   0 is what a failed read returns and is never stored. */
+class CChecksums
+{
+public:
+	CChecksums(void);
+	~CChecksums(void);
+	/* Checksums missing from path are still looked up by file name in the
+	   older ini, if given */
+	void Load(const char *path, const char *legacy = NULL);
+	/* Stops the worker and writes what is left */
+	void Unload(void);
+	void Save(void);
+	/* Starts the worker on paths, in that order */
+	void Prefetch(const vector<string> &paths);
+	/* Waits for the ROM being checksummed, the others queued are dropped */
+	void Stop(void);
+	/* Waits for the worker if it is on that ROM already, computes it here if
+	   it didn't get to it yet */
+	u32 Get(const char *path);
+	/* What cover sites use: the CRC stored in zip and 7z archives, the CRC
+	   of the whole file otherwise */
+	static u32 RomChecksum(const char *path);
+private:
+	struct SEntry
+	{
+		u32 crc;
+		u32 size;
+		u32 mtime;
+	};
+	bool _cached(const string &path, const struct stat &st, u32 &crc);
+	void _store(const string &path, const struct stat &st, u32 crc);
+	void _save(void);
+	static void *_worker(void *obj);
+	map<string, SEntry> m_entries;
+	vector<string> m_queue;
+	set<string> m_pending;
+	string m_current;
+	string m_path;
+	Config m_legacy;
+	u32 m_unsaved;
+	lwp_t m_thread;
+	volatile bool m_stop;
+	mutex_t m_mutex;
+	/* Signalled with m_mutex held whenever the worker finishes a ROM */
+	cond_t m_done;
+};
+
+#endif // !defined(__CHECKSUMS_HPP)
@@ -47,10 +47,14 @@
 
 #include <stdio.h>
 #include <ogc/system.h>
+#include <ogc/lwp.h>
 #include "crc32.h"
+#include "fileOps/buffer_ring.h"
 #include "memory/mem2.hpp"
 
-#define FILEBUFFER 0x200000 /* 2MB */
+#define CRC_SLOTS		3
+#define CRC_SLOT_SIZE	0x80000 /* 512KB */
+#define CRC_STACK		8 * 1024
 
 static u32 crc_32_tab[] = { /* CRC polynomial 0xedb88320 */
 	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
@@ -98,14 +102,67 @@ static u32 crc_32_tab[] = { /* CRC polynomial 0xedb88320 */
 	0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
+/* Slicing by 8: crc_tables[k][n] is the CRC of byte n followed by k zero
+   bytes, so eight input bytes cost eight lookups that don't depend on each
+   other instead of eight in a row. Built from crc_32_tab on first use. */
+static u32 crc_tables[8][256];
+static volatile bool crc_tables_ready = false;
+
+static void crc32_tables(void)
+{
+	u32 k, n;
+	for(n = 0; n < 256; n++)
+		crc_tables[0][n] = crc_32_tab[n];
+	for(k = 1; k < 8; k++)
+	{
+		for(n = 0; n < 256; n++)
+			crc_tables[k][n] = UPDC32(0, crc_tables[k - 1][n]);
+	}
+	crc_tables_ready = true;
+}
+
 u32 crc32buffer(const u8 *buffer, const u32 len, u32 oldcrc32)
 {
-	u32 i;
-	for(i = 0; i < len; i++)
+	u32 i = 0;
+	if(!crc_tables_ready)
+		crc32_tables();
+	/* The CRC is reflected, bytes are combined little endian by hand so this
+	   works the same whatever the host byte order and alignment */
+	for(; i + 8 <= len; i += 8)
+	{
+		const u8 *p = buffer + i;
+		u32 lo = oldcrc32 ^ (p[0] | p[1] << 8 | p[2] << 16 | (u32)p[3] << 24);
+		u32 hi = p[4] | p[5] << 8 | p[6] << 16 | (u32)p[7] << 24;
+		oldcrc32 = crc_tables[7][lo & 0xff] ^ crc_tables[6][(lo >> 8) & 0xff] ^
+			crc_tables[5][(lo >> 16) & 0xff] ^ crc_tables[4][lo >> 24] ^
+			crc_tables[3][hi & 0xff] ^ crc_tables[2][(hi >> 8) & 0xff] ^
+			crc_tables[1][(hi >> 16) & 0xff] ^ crc_tables[0][hi >> 24];
+	}
+	for(; i < len; i++)
 		oldcrc32 = UPDC32(buffer[i], oldcrc32);
 	return oldcrc32;
 }
 
+typedef struct
+{
+	FILE *fp;
+	buffer_ring ring;
+} crc_pipe;
+
+static void *crc32_reader(void *arg)
+{
+	crc_pipe *pipe = (crc_pipe*)arg;
+	bool last;
+	do
+	{
+		ring_slot *slot = ring_acquire(&pipe->ring, 0);
+		slot->len = fread(slot->data, 1, slot->size, pipe->fp);
+		slot->last = last = slot->len == 0;
+		ring_release(&pipe->ring, 0);
+	} while(!last);
+	return NULL;
+}
+
 u32 crc32file(const char *name)
 {
 	FILE *fp = fopen(name, "rb");
@@ -115,22 +172,52 @@ u32 crc32file(const char *name)
 	u32 oldcrc32 = 0xFFFFFFFF;
 	/* Check our filesize */
 	fseek(fp, 0, SEEK_END);
-	if(ftell(fp) > 0x40000000) //pfff over 1gb would take ages
+	long size = ftell(fp);
+	if(size > 0x40000000) //pfff over 1gb would take ages
 	{
 		fclose(fp);
 		return oldcrc32;
 	}
 	rewind(fp);
-	/* Get a Buffer and begin */
-	u8 *Buffer = (u8*)MEM2_alloc(FILEBUFFER);
-	while(1)
+	/* Files bigger than a slot are read on a thread while the previous
+	   slot is summed, small ones aren't worth the thread */
+	crc_pipe pipe;
+	lwp_t reader = LWP_THREAD_NULL;
+	if(size > CRC_SLOT_SIZE && ring_init(&pipe.ring, CRC_SLOTS, CRC_SLOT_SIZE, 2))
+	{
+		pipe.fp = fp;
+		if(LWP_CreateThread(&reader, crc32_reader, &pipe, NULL, CRC_STACK, 60) < 0)
+			reader = LWP_THREAD_NULL;
+		while(reader != LWP_THREAD_NULL)
+		{
+			ring_slot *slot = ring_acquire(&pipe.ring, 1);
+			bool last = slot->last;
+			oldcrc32 = crc32buffer(slot->data, slot->len, oldcrc32);
+			ring_release(&pipe.ring, 1);
+			if(last)
+				break;
+		}
+		if(reader != LWP_THREAD_NULL)
+			LWP_JoinThread(reader, NULL);
+		ring_free(&pipe.ring);
+	}
+	if(reader == LWP_THREAD_NULL)
 	{
-		Length = fread(Buffer, 1, FILEBUFFER, fp);
-		if(Length == 0)
-			break;
-		oldcrc32 = crc32buffer(Buffer, Length, oldcrc32);
+		u8 *Buffer = (u8*)MEM2_alloc(CRC_SLOT_SIZE);
+		if(Buffer == NULL)
+		{
+			fclose(fp);
+			return 0;
+		}
+		while(1)
+		{
+			Length = fread(Buffer, 1, CRC_SLOT_SIZE, fp);
+			if(Length == 0)
+				break;
+			oldcrc32 = crc32buffer(Buffer, Length, oldcrc32);
+		}
+		MEM2_free(Buffer);
 	}
-	MEM2_free(Buffer);
 	fclose(fp);
 
 	return oldcrc32 = ~oldcrc32;
@@ -10,6 +10,9 @@ extern "C"
 #define UPDC32(octet, crc) (crc_32_tab[((crc)\
 			^ (octet)) & 0xff] ^ ((crc) >> 8))
 
+/* oldcrc32 starts at 0xFFFFFFFF and the result is inverted when done */
+u32 crc32buffer(const u8 *buffer, const u32 len, u32 oldcrc32);
+/* CRC32 of a whole file, 0 if it can't be opened */
 u32 crc32file(const char *name);
 
 #ifdef __cplusplus
@@ -27,7 +27,6 @@
 #include "devicemounter/PartitionHandle.h"
 #include "devicemounter/DeviceHandler.hpp"
 #include "types.h"
-#include "crc32.h"
 
 Plugin m_plugin;
 void Plugin::init(const string& m_pluginsDir)
@@ -249,7 +248,7 @@ vector<string> Plugin::CreateArgs(const char *device, const char *path,
 	return args;
 }
 
-string Plugin::GenerateCoverLink(dir_discHdr gameHeader, const string& constURL, Config &Checksums)
+string Plugin::GenerateCoverLink(dir_discHdr gameHeader, const string& constURL, CChecksums &Checksums)
 {
 	string url(constURL);
 	Plugin_Pos = GetPluginPosition(gameHeader.settings[0]);
@@ -260,53 +259,9 @@ string Plugin::GenerateCoverLink(dir_discHdr gameHeader, const string& constURL,
 	if(url.find(TAG_CONSOLE) != url.npos)
 		url.replace(url.find(TAG_CONSOLE), strlen(TAG_CONSOLE), (Plugins[Plugin_Pos].consoleCoverID.size() ? Plugins[Plugin_Pos].consoleCoverID.c_str() : "nintendo"));	
 
-	char gamePath[256];
-	if(string(gameHeader.path).find_last_of("/") != string::npos)
-		strncpy(gamePath, &gameHeader.path[string(gameHeader.path).find_last_of("/")+1], sizeof(gamePath));
-	else
-		strncpy(gamePath, gameHeader.path, sizeof(gamePath));
-	const string& cachedCRC = Checksums.getString("CHECKSUMS", gamePath);
 	char crc_string[9];
+	strncpy(crc_string, fmt("%08x", Checksums.Get(gameHeader.path)), 8);
 	crc_string[8] = '\0';
-	if(cachedCRC.size() == 8)
-	{
-		gprintf("CRC32 of %s is cached\n", gamePath);
-		strncpy(crc_string, cachedCRC.c_str(), 8);
-	}
-	else
-	{
-		gprintf("Generating CRC32 for %s\n", gamePath);
-		u32 buffer;
-		ifstream infile;
-		if(strstr(gameHeader.path, ".zip") != NULL)
-		{
-			infile.open(gameHeader.path, ios::binary);
-			infile.seekg(0x0e, ios::beg);
-			infile.read((char*)&buffer, 8);
-			infile.close();
-			strncpy(crc_string, fmt("%08x", (u32)__builtin_bswap32(buffer)), 8);
-		}
-		else if(strstr(gameHeader.path, ".7z") != NULL)
-		{
-			infile.open(gameHeader.path, ios::binary);
-			infile.seekg(-8, ios::end);
-			while(infile.tellg())
-			{
-				infile.read((char*)&buffer, 8);
-				if(buffer == 0x00050111)
-					break;
-				infile.seekg(-9, ios::cur);
-			}
-			infile.seekg(-13, ios::cur);
-			infile.read((char*)&buffer, 8);
-			infile.close();
-			strncpy(crc_string, fmt("%08x", (u32)__builtin_bswap32(buffer)), 8);
-		}
-		else
-			strncpy(crc_string, fmt("%08x", crc32file(gameHeader.path)), 8);
-		Checksums.setString("CHECKSUMS", gamePath, crc_string);
-		Checksums.save();
-	}
 	url.replace(url.find(TAG_GAME_ID), strlen(TAG_GAME_ID), upperCase(crc_string).c_str());
 	gprintf("URL: %s\n", url.c_str());
 	return url;
@@ -22,6 +22,7 @@
 #include <string>
 #include <vector>
 
+#include "checksums.hpp"
 #include "config/config.hpp"
 #include "loader/disc.h"
 
@@ -60,7 +61,7 @@ public:
 	const char *GetDolName(u32 magic);
 	const char *GetCoverFolderName(u32 magic);
 	bool GetEnableStatus(Config &cfg, u32 magic);
-	string GenerateCoverLink(dir_discHdr gameHeader, const string& constURL, Config &Checksums);
+	string GenerateCoverLink(dir_discHdr gameHeader, const string& constURL, CChecksums &Checksums);
 	wstringEx GetPluginName(u8 pos);
 	u32 getPluginMagic(u8 pos);
 	bool PluginExist(u8 pos);
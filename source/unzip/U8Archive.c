@@ -26,8 +26,19 @@
  * for Wiiflow 2011
  ***************************************************************************/
 
+#include <ctype.h>
 #include <string.h>
+#include <strings.h>
 #include "U8Archive.h"
+#include "memory/mem2.hpp"
+
+#define U8_MAGIC		0x55AA382D
+#define U8_FILE			0
+#define U8_DIR			1
+
+/* FNV-1a over the lower case path */
+#define FNV_BASIS		0x811C9DC5
+#define FNV_PRIME		0x01000193
 
 static char *u8Filename(const struct U8Entry *fst, int i)
 {
@@ -37,7 +48,7 @@ static char *u8Filename(const struct U8Entry *fst, int i)
 static struct U8Header *open_u8_archive(const u8 *u8_archive)
 {
 	struct U8Header *arcHdr = (struct U8Header *)u8_archive;
-	if (arcHdr->fcc != 0x55AA382D)
+	if (arcHdr->fcc != U8_MAGIC)
 	{
 		return NULL;
 	}
@@ -72,4 +83,270 @@ const u8 *u8_get_file(const u8 *archive, const char *filename, u32 *size)
 		
 	*size = fst[i].fileLength;
 	return archive + fst[i].fileOffset;
-}
\ No newline at end of file
+}
+
+static inline u32 u8_hash(u32 hash, char c)
+{
+	return (hash ^ (u8)tolower((u8)c)) * FNV_PRIME;
+}
+
+/* Names left out of paths, "." folders some tools put at the top */
+static inline bool u8_skipped(const char *name)
+{
+	return name[0] == '\0' || (name[0] == '.' && name[1] == '\0');
+}
+
+static void u8_insert(u32 *table, u32 mask, u32 hash, u32 index)
+{
+	u32 slot = hash & mask;
+	while (table[slot] != 0)
+		slot = (slot + 1) & mask;
+	table[slot] = index + 1;
+}
+
+bool u8_open(struct U8Archive *arc, const u8 *data, u32 size)
+{
+	memset(arc, 0, sizeof(struct U8Archive));
+	const struct U8Header *arcHdr = (const struct U8Header *)data;
+	if (data == NULL || size < sizeof(struct U8Header) || arcHdr->fcc != U8_MAGIC)
+		return false;
+
+	u32 root = arcHdr->rootNodeOffset;
+	if (root > size || size - root < sizeof(struct U8Entry))
+		return false;
+	const struct U8Entry *fst = (const struct U8Entry *)(data + root);
+	u32 count = fst[0].numEntries;
+	if (fst[0].fileType != U8_DIR || count == 0 || count > (size - root) / sizeof(struct U8Entry))
+		return false;
+	const char *names = (const char *)(fst + count);
+	u32 namesSize = size - root - count * sizeof(struct U8Entry);
+
+	u32 slots = 16;
+	while (slots < count * 2)
+		slots <<= 1;
+	/* hashes, parents and the path prefix of each folder, then both tables */
+	u32 *block = (u32 *)MEM2_alloc((count * 3 + slots * 2) * sizeof(u32));
+	if (block == NULL)
+		return false;
+	memset(block, 0, (count * 3 + slots * 2) * sizeof(u32));
+	u32 *hashes = block;
+	u32 *parents = hashes + count;
+	u32 *prefix = parents + count;
+	u32 *paths = prefix + count;
+	u32 *basenames = paths + slots;
+	u32 mask = slots - 1;
+
+	prefix[0] = FNV_BASIS;
+	u32 dir = 0;
+	u32 i;
+	for (i = 1; i < count; ++i)
+	{
+		const struct U8Entry *entry = &fst[i];
+		/* Leave the folders ending before this entry, the root ends at count */
+		while (i >= fst[dir].numEntries)
+			dir = parents[dir];
+
+		if (entry->nameOffset >= namesSize || memchr(names + entry->nameOffset, 0, namesSize - entry->nameOffset) == NULL)
+			break;
+		if (entry->fileType == U8_FILE)
+		{
+			if (entry->fileLength > size || entry->fileOffset > size - entry->fileLength)
+				break;
+		}
+		else if (entry->fileType != U8_DIR || entry->numEntries <= i || entry->numEntries > fst[dir].numEntries)
+			break;
+
+		const char *name = names + entry->nameOffset;
+		parents[i] = dir;
+		if (u8_skipped(name))
+		{
+			hashes[i] = hashes[dir];
+			prefix[i] = prefix[dir];
+		}
+		else
+		{
+			u32 hash = prefix[dir];
+			u32 base = FNV_BASIS;
+			const char *c;
+			for (c = name; *c != '\0'; ++c)
+			{
+				hash = u8_hash(hash, *c);
+				base = u8_hash(base, *c);
+			}
+			hashes[i] = hash;
+			prefix[i] = u8_hash(hash, '/');
+			u8_insert(paths, mask, hash, i);
+			u8_insert(basenames, mask, base, i);
+		}
+		if (entry->fileType == U8_DIR)
+			dir = i;
+	}
+	if (i < count)
+	{
+		MEM2_free(block);
+		return false;
+	}
+
+	arc->data = data;
+	arc->size = size;
+	arc->fst = fst;
+	arc->count = count;
+	arc->names = names;
+	arc->namesSize = namesSize;
+	arc->hashes = hashes;
+	arc->parents = parents;
+	arc->paths = paths;
+	arc->basenames = basenames;
+	arc->mask = mask;
+	return true;
+}
+
+void u8_close(struct U8Archive *arc)
+{
+	/* All the tables share one block */
+	if (arc->hashes != NULL)
+		MEM2_free(arc->hashes);
+	memset(arc, 0, sizeof(struct U8Archive));
+}
+
+const char *u8_name(const struct U8Archive *arc, u32 index)
+{
+	if (index >= arc->count)
+		return "";
+	return arc->names + arc->fst[index].nameOffset;
+}
+
+bool u8_is_dir(const struct U8Archive *arc, u32 index)
+{
+	return index < arc->count && arc->fst[index].fileType == U8_DIR;
+}
+
+const u8 *u8_view(const struct U8Archive *arc, u32 index, u32 *size)
+{
+	if (index == 0 || index >= arc->count || arc->fst[index].fileType != U8_FILE)
+		return NULL;
+	*size = arc->fst[index].fileLength;
+	return arc->data + arc->fst[index].fileOffset;
+}
+
+u32 u8_dir_next(const struct U8Archive *arc, u32 dir, u32 pos)
+{
+	if (!u8_is_dir(arc, dir) || pos >= arc->count)
+		return 0;
+	u32 next;
+	if (pos == 0)
+		next = dir + 1;
+	else if (arc->fst[pos].fileType == U8_DIR)
+		next = arc->fst[pos].numEntries;	/* skip what is inside */
+	else
+		next = pos + 1;
+	return next < arc->fst[dir].numEntries ? next : 0;
+}
+
+static inline u32 u8_up(const struct U8Archive *arc, u32 index)
+{
+	while (index != 0 && u8_skipped(u8_name(arc, index)))
+		index = arc->parents[index];
+	return index;
+}
+
+/* Length of the part of path before end, skipping "." and empty ones, end is moved to its start */
+static u32 u8_prev_part(const char *path, const char **end)
+{
+	while (*end > path)
+	{
+		const char *e = *end;
+		while (e > path && e[-1] == '/')
+			--e;
+		const char *s = e;
+		while (s > path && s[-1] != '/')
+			--s;
+		*end = s;
+		if (e - s > 1 || (e - s == 1 && *s != '.'))
+			return e - s;
+	}
+	return 0;
+}
+
+static bool u8_match(const struct U8Archive *arc, u32 index, const char *path)
+{
+	const char *end = path + strlen(path);
+	index = u8_up(arc, index);
+	while (true)
+	{
+		u32 len = u8_prev_part(path, &end);
+		if (len == 0)
+			return index == 0;
+		if (index == 0)
+			return false;
+		const char *name = u8_name(arc, index);
+		if (strncasecmp(name, end, len) != 0 || name[len] != '\0')
+			return false;
+		index = u8_up(arc, arc->parents[index]);
+	}
+}
+
+static u32 u8_search(const struct U8Archive *arc, const char *path, bool files)
+{
+	if (arc->paths == NULL || path == NULL)
+		return 0;
+
+	u32 hash = FNV_BASIS;
+	u32 parts = 0;
+	const char *last = NULL;
+	u32 lastLen = 0;
+	/* Same parts as u8_prev_part finds, from the start */
+	const char *p = path;
+	while (*p != '\0')
+	{
+		while (*p == '/')
+			++p;
+		const char *part = p;
+		while (*p != '\0' && *p != '/')
+			++p;
+		u32 len = p - part;
+		if (len == 0 || (len == 1 && *part == '.'))
+			continue;
+		if (parts++ > 0)
+			hash = u8_hash(hash, '/');
+		u32 k;
+		for (k = 0; k < len; ++k)
+			hash = u8_hash(hash, part[k]);
+		last = part;
+		lastLen = len;
+	}
+	if (parts == 0)
+		return 0;
+
+	const struct U8Entry *fst = arc->fst;
+	u32 slot;
+	if (parts == 1)
+	{
+		/* A bare name, the probe order keeps the first entry in the archive first */
+		for (slot = hash & arc->mask; arc->basenames[slot] != 0; slot = (slot + 1) & arc->mask)
+		{
+			u32 i = arc->basenames[slot] - 1;
+			const char *name = u8_name(arc, i);
+			if ((!files || fst[i].fileType == U8_FILE) && strncasecmp(name, last, lastLen) == 0 && name[lastLen] == '\0')
+				return i;
+		}
+		return 0;
+	}
+	for (slot = hash & arc->mask; arc->paths[slot] != 0; slot = (slot + 1) & arc->mask)
+	{
+		u32 i = arc->paths[slot] - 1;
+		if (arc->hashes[i] == hash && (!files || fst[i].fileType == U8_FILE) && u8_match(arc, i, path))
+			return i;
+	}
+	return 0;
+}
+
+u32 u8_lookup(const struct U8Archive *arc, const char *path)
+{
+	return u8_search(arc, path, false);
+}
+
+const u8 *u8_find(const struct U8Archive *arc, const char *path, u32 *size)
+{
+	return u8_view(arc, u8_search(arc, path, true), size);
+}
@@ -55,13 +55,47 @@ struct U8Entry
 	};
 } ATTRIBUTE_PACKED;
 
+/* An archive checked against its size with an index of the entry paths.
+   The index hashes full paths ("arc/timg/icon.tpl", "." folders and
+   letter case ignored) and bare names, lookups cost a hash and a compare
+   or two instead of going over every entry. */
+struct U8Archive
+{
+	const u8 *data;
+	u32 size;
+	const struct U8Entry *fst;
+	u32 count;
+	const char *names;
+	u32 namesSize;
+	u32 *hashes;	/* full path hash of each entry */
+	u32 *parents;	/* folder index of each entry */
+	u32 *paths;		/* hash slots holding entry index + 1, 0 when free */
+	u32 *basenames;
+	u32 mask;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* Do not trust the archive, only meant for the ones wiiflow made or got from NAND */
 const u8 *u8_get_file_by_index(const u8 *archive, u32 index, u32 *size);
 const u8 *u8_get_file(const u8 *archive, const char *filename, u32 *size);
 
+/* False if any offset or length points outside of size, the data stays owned by the caller */
+bool u8_open(struct U8Archive *arc, const u8 *data, u32 size);
+void u8_close(struct U8Archive *arc);
+/* Index of a full path or of the first entry named like a bare name, 0 (the root) if not found */
+u32 u8_lookup(const struct U8Archive *arc, const char *path);
+/* File data inside the archive, NULL for folders */
+const u8 *u8_view(const struct U8Archive *arc, u32 index, u32 *size);
+/* Same as u8_lookup and u8_view, bare names only match files like u8_get_file */
+const u8 *u8_find(const struct U8Archive *arc, const char *path, u32 *size);
+const char *u8_name(const struct U8Archive *arc, u32 index);
+bool u8_is_dir(const struct U8Archive *arc, u32 index);
+/* Next direct child of the folder dir after pos, start with pos 0; 0 at the end */
+u32 u8_dir_next(const struct U8Archive *arc, u32 dir, u32 pos);
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,6 +14,7 @@
  ******************************************************************************/
 #include <gccore.h>
 #include <stdlib.h>
+#include <string.h>
 #include "lz77.h"
 #include "memory/mem2.hpp"
 
@@ -22,19 +23,53 @@ static inline u32 packBytes(int a, int b, int c, int d)
 	return (d << 24) | (c << 16) | (b << 8) | (a);
 }
 
-static int __decompressLZ77_11(const u8 *in, u32 inputLen, u8 **output, u32 *outputLen)
+/* Copies a back-reference, dst - dist is always inside the already decoded output */
+static inline void __copyMatch(u8 *dst, u32 dist, u32 len)
+{
+	const u8 *src = dst - dist;
+	if(len <= 8)
+	{
+		/* short match, a plain forward byte copy also covers overlaps */
+		while(len--)
+			*dst++ = *src++;
+	}
+	else if(dist >= len)
+		memcpy(dst, src, len);
+	else if(dist == 1)
+		memset(dst, *src, len);
+	else
+	{
+		/* overlapping match, repeat the pattern while doubling the copied run */
+		u32 done = dist;
+		memcpy(dst, src, dist);
+		while(done < len)
+		{
+			u32 run = (len - done) < done ? (len - done) : done;
+			memcpy(dst + done, dst, run);
+			done += run;
+		}
+	}
+}
+
+static int __decompressLZ77(const u8 *in, u32 inputLen, u8 **output, u32 *outputLen, bool safe)
 {
 	int x = 0;
-	u32 y = 0;
+	if(in == NULL || inputLen < 4)
+		return -1;
+	u8 type = in[0];
 	u32 compressedPos = 0x4;
 	u32 decompressedPos = 0;
 	u32 decompressedSize = packBytes(in[0], in[1], in[2], in[3]) >> 8;
-	if(decompressedSize == 0)
+	if(decompressedSize == 0 && type == LZ77_0x11_FLAG)
 	{
+		if(inputLen < 8)
+			return -1;
 		decompressedSize = packBytes(in[4], in[5], in[6], in[7]);
 		compressedPos += 0x4;
 	}
 	//printf("Decompressed size : %i\n", decompressedSize);
+	if(decompressedSize == 0 || (safe && decompressedSize > LZ77_SAFE_MAX_SIZE))
+		return -1;
 
 	u8 *out = (u8*)MEM2_alloc(decompressedSize);
 	if(out == NULL)
@@ -43,35 +78,47 @@ static int __decompressLZ77_11(const u8 *in, u32 inputLen, u8 **output, u32 *out
 		return -1;
 	}
 
-	while(compressedPos < inputLen && decompressedPos < decompressedSize)
+	while(decompressedPos < decompressedSize && compressedPos < inputLen)
 	{
 		u8 byteFlag = in[compressedPos];
 		compressedPos++;
+		/* a token is at most 4 bytes, when the whole group fits skip the per token input checks */
+		bool groupInBounds = (inputLen - compressedPos) >= 8 * 4;
 
-		for(x = 7; x >= 0; x--)
+		for(x = 0; x < 8 && decompressedPos < decompressedSize; ++x, byteFlag <<= 1)
 		{
-			if((byteFlag & (1 << x)) > 0)
+			if(byteFlag & 0x80)
 			{
+				if(!groupInBounds && compressedPos + 2 > inputLen)
+					goto done;
 				u8 first = in[compressedPos];
 				u8 second = in[compressedPos + 1];
 
 				u32 pos, copyLen;
-				if(first < 0x20)
+				if(type == LZ77_0x10_FLAG)
 				{
+					pos = (u32)((((first << 8) | second) & 0xFFF) + 1);
+					copyLen = (u32)(first >> 4) + 3;
+					compressedPos += 2;
+				}
+				else if(first < 0x10)
+				{
+					if(!groupInBounds && compressedPos + 3 > inputLen)
+						goto done;
 					u8 third = in[compressedPos + 2];
-					if(first >= 0x10)
-					{
-						u32 fourth = in[compressedPos + 3];
-						pos = (u32)(((third & 0xF) << 8) | fourth) + 1;
-						copyLen = (u32)((second << 4) | ((first & 0xF) << 12) | (third >> 4)) + 273;
-						compressedPos += 4;
-					}
-					else
-					{
-						pos = (u32)(((second & 0xF) << 8) | third) + 1;
-						copyLen = (u32)(((first & 0xF) << 4) | (second >> 4)) + 17;
-						compressedPos += 3;
-					}
+					pos = (u32)(((second & 0xF) << 8) | third) + 1;
+					copyLen = (u32)(((first & 0xF) << 4) | (second >> 4)) + 17;
+					compressedPos += 3;
+				}
+				else if(first < 0x20)
+				{
+					if(!groupInBounds && compressedPos + 4 > inputLen)
+						goto done;
+					u8 third = in[compressedPos + 2];
+					u32 fourth = in[compressedPos + 3];
+					pos = (u32)(((third & 0xF) << 8) | fourth) + 1;
+					copyLen = (u32)((second << 4) | ((first & 0xF) << 12) | (third >> 4)) + 273;
+					compressedPos += 4;
 				}
 				else
 				{
@@ -79,69 +126,44 @@ static int __decompressLZ77_11(const u8 *in, u32 inputLen, u8 **output, u32 *out
 					copyLen = (u32)(first >> 4) + 1;
 					compressedPos += 2;
 				}
-				for(y = 0; y < copyLen; y++)
-					out[decompressedPos + y] = out[decompressedPos - pos + y];
+				/* never reference data in front of the output buffer */
+				if(pos > decompressedPos)
+				{
+					MEM2_free(out);
+					return -1;
+				}
+				if(copyLen > decompressedSize - decompressedPos)
+				{
+					if(safe)
+					{
+						MEM2_free(out);
+						return -1;
+					}
+					copyLen = decompressedSize - decompressedPos;
+				}
+				__copyMatch(out + decompressedPos, pos, copyLen);
 				decompressedPos += copyLen;
 			}
 			else
 			{
+				if(!groupInBounds && compressedPos >= inputLen)
+					goto done;
 				out[decompressedPos] = in[compressedPos];
 				decompressedPos++;
 				compressedPos++;
 			}
-			if(compressedPos >= inputLen || decompressedPos >= decompressedSize)
-				break;
 		}
 	}
-	*output = out;
-	*outputLen = decompressedSize;
-	return 0;
-}
-
-static int __decompressLZ77_10(const u8 *in, u8 **output, u32 *outputLen)
-{
-	int x = 0;
-	u32 y = 0;
-	u32 compressedPos = 0x4;
-	u32 decompressedPos = 0;
-	u32 decompressedSize = packBytes(in[0], in[1], in[2], in[3]) >> 8;
-	//printf("Decompressed size : %i\n", decompressedSize);
-
-	u8 *out = (u8*)MEM2_alloc(decompressedSize);
-	if(out == NULL)
-	{
-		//printf("Out of memory\n");
-		return -1;
-	}
-
-	while(decompressedPos < decompressedSize)
+done:
+	if(decompressedPos < decompressedSize)
 	{
-		u8 byteFlag = in[compressedPos];
-		compressedPos ++;
-
-		for(x = 0; x < 8; ++x)
+		/* truncated stream */
+		if(safe)
 		{
-			if(byteFlag & 0x80)
-			{
-				u8 first = in[compressedPos];
-				u8 second = in[compressedPos + 1];
-				u16 pos = (u16)((((first << 8) + second) & 0xFFF) + 1);
-				u8 copyLen = (u8)(3 + ((first >> 4) & 0xF));
-				for(y = 0; y < copyLen; y++)
-					out[decompressedPos + y] = out[decompressedPos - pos + (y % pos)];
-				compressedPos += 2;
-				decompressedPos += copyLen;
-			}
-			else
-			{
-				out[decompressedPos] = in[compressedPos];
-				compressedPos += 1;
-				decompressedPos += 1;
-			}
-			byteFlag <<= 1;
-			if(decompressedPos >= decompressedSize)
-				break;
+			MEM2_free(out);
+			return -1;
 		}
+		memset(out + decompressedPos, 0, decompressedSize - decompressedPos);
 	}
 	*output = out;
 	*outputLen = decompressedSize;
@@ -157,21 +179,17 @@ int isLZ77compressed(const u8 *buffer)
 
 int decompressLZ77content(const u8 *buffer, u32 length, u8 **output, u32 *outputLen)
 {
-	int ret = 0;
-	switch(buffer[0])
+	if(buffer == NULL || length == 0 || !isLZ77compressed(buffer))
 	{
-		case LZ77_0x10_FLAG:
-			//printf("LZ77 variant 0x10 compressed content...unpacking may take a while...\n");
-			ret = __decompressLZ77_10(buffer, output, outputLen);
-			break;
-		case LZ77_0x11_FLAG:
-			//printf("LZ77 variant 0x11 compressed content...unpacking may take a while...\n");
-			ret = __decompressLZ77_11(buffer, length, output, outputLen);
-			break;
-		default:
-			//printf("Not compressed ...\n");
-			ret = -1;
-			break;
+		//printf("Not compressed ...\n");
+		return -1;
 	}
-	return ret;
+	return __decompressLZ77(buffer, length, output, outputLen, false);
+}
+
+int decompressLZ77contentSafe(const u8 *buffer, u32 length, u8 **output, u32 *outputLen)
+{
+	if(buffer == NULL || length == 0 || !isLZ77compressed(buffer))
+		return -1;
+	return __decompressLZ77(buffer, length, output, outputLen, true);
 }
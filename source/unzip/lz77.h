@@ -19,12 +19,17 @@
 #define LZ77_0x10_FLAG 0x10
 #define LZ77_0x11_FLAG 0x11
 
+/* largest output the safe decoder accepts, banners and sounds stay well below */
+#define LZ77_SAFE_MAX_SIZE 0x2000000
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
 int isLZ77compressed(const u8 *buffer);
 int decompressLZ77content(const u8 *buffer, u32 length, u8 **output, u32 *outputLen);
+/* Fails instead of padding truncated or oversized streams, use for untrusted data */
+int decompressLZ77contentSafe(const u8 *buffer, u32 length, u8 **output, u32 *outputLen);
 
 #ifdef __cplusplus
 }